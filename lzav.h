@@ -40,7 +40,7 @@
 #include <string.h>
 #include <stdlib.h>
 
-#define LZAV_API_VER 0x106 ///< API version, unrelated to code's version.
+#define LZAV_API_VER 0x107 ///< API version, unrelated to code's version.
 #define LZAV_VER_STR "4.5" ///< LZAV source code version string.
 
 #if !defined( LZAV_FMT_MIN )
@@ -49,7 +49,7 @@
 		///< value of 2, to reduce decompressor's code size.
 #endif // !defined( LZAV_FMT_MIN )
 
-// Decompression error codes:
+// Error codes:
 
 #define LZAV_E_PARAMS -1 ///< Incorrect function parameters.
 #define LZAV_E_SRCOOB -2 ///< Source buffer OOB.
@@ -57,14 +57,34 @@
 #define LZAV_E_REFOOB -4 ///< Back-reference OOB.
 #define LZAV_E_DSTLEN -5 ///< Decompressed length mismatch.
 #define LZAV_E_UNKFMT -6 ///< Unknown stream format.
+#define LZAV_E_CHECK -7 ///< Uncompressed data checksum mismatch.
+#define LZAV_E_FILE -8 ///< File open, read or write error.
+#define LZAV_E_NOMEM -9 ///< Not enough memory.
+#define LZAV_E_NOENT -10 ///< Archive entry not found.
+#define LZAV_E_SINK -11 ///< Decompression aborted by the output callback.
+
+#define LZAV_WIN_LOG_MIN 16 ///< Minimal log2 of restricted window length.
+#define LZAV_WIN_LOG_MAX 30 ///< Maximal log2 of large window length.
 
 // NOTE: all macros defined below are for internal use, do not change.
 
-#define LZAV_WIN_LEN ( 1 << 23 ) ///< LZ77 window length, in bytes.
+#define LZAV_WIN_LOG 23 ///< log2 of LZ77 window length.
+#define LZAV_WIN_LEN ( 1 << LZAV_WIN_LOG ) ///< LZ77 window length, in bytes.
 #define LZAV_REF_MIN 6 ///< Min reference length, in bytes.
 #define LZAV_REF_LEN ( LZAV_REF_MIN + 15 + 255 + 254 ) ///< Max ref length.
 #define LZAV_LIT_FIN 6 ///< The number of literals required at finish.
 #define LZAV_FMT_CUR 2 ///< Stream format identifier used by the compressor.
+#define LZAV_FMT_LW 3 ///< Large-window stream format identifier.
+#define LZAV_LDM_MIN 64 ///< Long-distance match min length, hash window.
+#define LZAV_LDM_RATE 7 ///< log2 of long-distance matcher's sampling period.
+#define LZAV_SEQ_BATCH 32 ///< The number of blocks parsed per batch by the
+	///< two-phase decoder.
+#define LZAV_PF_DIST ( 1 << 18 ) ///< Minimal reference offset, which is
+	///< prefetched by the two-phase decoder (larger than L1, around L2 size).
+#define LZAV_FD_BLK 2 ///< Decoding cost of a block, in bytes, see
+	///< lzav_compress_hi_fd().
+#define LZAV_FD_FAR 8 ///< Decoding cost of a far reference, in bytes.
+#define LZAV_FD_REF 2 ///< Minimal reference length increase.
 
 /**
  * @def LZAV_LITTLE_ENDIAN
@@ -202,10 +222,194 @@
 
 #endif // Likelihood macros
 
+/**
+ * @def LZAV_PREFETCH( a )
+ * @brief Memory prefetch macro, a hint to load a cache line that is going
+ * to be read soon.
+ * @param a Address to prefetch.
+ */
+
+#if defined( LZAV_GCC_BUILTINS )
+	#define LZAV_PREFETCH( a ) __builtin_prefetch( a )
+#elif defined( _MSC_VER ) && ( defined( _M_X64 ) || defined( _M_IX86 ))
+	#define LZAV_PREFETCH( a ) _mm_prefetch( (const char*) ( a ), _MM_HINT_T0 )
+#else // defined( _MSC_VER )
+	#define LZAV_PREFETCH( a )
+#endif // defined( _MSC_VER )
+
+/**
+ * @def LZAV_INLINE_F
+ * @brief Function specifier that forces inlining. Used for functions whose
+ * constant arguments select code paths: each call site then compiles only
+ * the selected paths.
+ */
+
+#if defined( __GNUC__ ) || defined( __clang__ )
+	#define LZAV_INLINE_F inline __attribute__(( always_inline ))
+#elif defined( _MSC_VER )
+	#define LZAV_INLINE_F __forceinline
+#else // defined( _MSC_VER )
+	#define LZAV_INLINE_F inline
+#endif // defined( _MSC_VER )
+
 #if defined( _MSC_VER ) && !defined( LZAV_GCC_BUILTINS )
 	#include <intrin.h> // For _BitScanForwardX and _byteswap_X.
 #endif // defined( _MSC_VER ) && !defined( LZAV_GCC_BUILTINS )
 
+/**
+ * @brief Memory allocator interface.
+ *
+ * Allocations made by LZAV functions can be routed to a user allocator
+ * (e.g., an arena, or a per-thread slab), globally, via lzav_set_alloc(),
+ * or per call or context, via the `_al` function variants. The release
+ * function also receives the allocated block's length, which allows memory
+ * accounting. Both function pointers should be set, or both should be 0,
+ * which selects the standard malloc() and free() functions.
+ */
+
+typedef struct
+{
+	void* ( *alloc )( void* opaque, size_t size ); ///< Allocation function,
+		///< returns 0 on failure. Blocks should be aligned like by malloc().
+	void ( *free )( void* opaque, void* p, size_t size ); ///< Release
+		///< function, `p` is never 0, `size` is the allocated length.
+	void* opaque; ///< User pointer passed to `alloc` and `free`.
+} lzav_alloc;
+
+/**
+ * @def LZAV_SELECTANY
+ * @brief Variable attribute that makes a variable defined in this header
+ * file shared by all translation units of a program.
+ */
+
+#if defined( _MSC_VER )
+	#define LZAV_SELECTANY __declspec( selectany )
+#elif defined( LZAV_GCC_BUILTINS ) || defined( __GNUC__ )
+	#define LZAV_SELECTANY __attribute__(( weak ))
+#else // defined( __GNUC__ )
+	#define LZAV_SELECTANY static // Per translation unit.
+#endif // defined( __GNUC__ )
+
+/**
+ * @brief Global allocator, used by functions without an allocator parameter,
+ * and where the allocator parameter is 0. Should be set via
+ * lzav_set_alloc().
+ */
+
+LZAV_SELECTANY lzav_alloc lzav_alloc_global = { 0, 0, 0 };
+
+/**
+ * @brief Function sets the global allocator.
+ *
+ * Should be called before any other LZAV function, or when no allocations
+ * made by LZAV functions exist: contexts keep the allocator which was in
+ * effect at their initialization, but compression functions use the global
+ * allocator during the call. The function is not thread-safe.
+ *
+ * @param al Allocator, copied; 0 - restore malloc() and free().
+ */
+
+static inline void lzav_set_alloc( const lzav_alloc* const al )
+{
+	if( al == 0 )
+	{
+		memset( &lzav_alloc_global, 0, sizeof( lzav_alloc ));
+	}
+	else
+	{
+		lzav_alloc_global = *al;
+	}
+}
+
+/**
+ * @brief Function resolves an allocator parameter into the allocator to
+ * keep in a context.
+ *
+ * @param al Allocator, 0 - the global allocator.
+ */
+
+static inline lzav_alloc lzav_alloc_use( const lzav_alloc* const al )
+{
+	return( al == 0 ? lzav_alloc_global : *al );
+}
+
+/**
+ * @brief Function allocates a memory block.
+ *
+ * @param al Allocator, 0 - the global allocator.
+ * @param size Block's length, in bytes.
+ * @return Block's pointer, or 0 if not enough memory.
+ */
+
+static inline void* lzav_malloc( const lzav_alloc* al, const size_t size )
+{
+	al = ( al == 0 ? &lzav_alloc_global : al );
+
+	if( al -> alloc == 0 )
+	{
+		return( malloc( size ));
+	}
+
+	return( ( *al -> alloc )( al -> opaque, size ));
+}
+
+/**
+ * @brief Function releases a memory block allocated via lzav_malloc().
+ *
+ * @param al Allocator, 0 - the global allocator.
+ * @param p Block's pointer, can be 0.
+ * @param size Block's length, as specified on allocation.
+ */
+
+static inline void lzav_free( const lzav_alloc* al, void* const p,
+	const size_t size )
+{
+	al = ( al == 0 ? &lzav_alloc_global : al );
+
+	if( al -> alloc == 0 )
+	{
+		free( p );
+	}
+	else
+	if( p != 0 )
+	{
+		( *al -> free )( al -> opaque, p, size );
+	}
+}
+
+/**
+ * @brief Function changes the length of a memory block allocated via
+ * lzav_malloc(), preserving its contents.
+ *
+ * @param al Allocator, 0 - the global allocator.
+ * @param p Block's pointer, can be 0.
+ * @param ol Block's current length.
+ * @param size New length, in bytes, above 0.
+ * @return New block's pointer, or 0 if not enough memory (the block is then
+ * unchanged).
+ */
+
+static inline void* lzav_realloc( const lzav_alloc* al, void* const p,
+	const size_t ol, const size_t size )
+{
+	al = ( al == 0 ? &lzav_alloc_global : al );
+
+	if( al -> alloc == 0 )
+	{
+		return( realloc( p, size ));
+	}
+
+	void* const np = ( *al -> alloc )( al -> opaque, size );
+
+	if( np != 0 && p != 0 )
+	{
+		memcpy( np, p, ( ol < size ? ol : size ));
+		( *al -> free )( al -> opaque, p, ol );
+	}
+
+	return( np );
+}
+
 /**
  * @brief Data match length finding function.
  *
@@ -402,12 +606,15 @@ static inline size_t lzav_match_len_r( const uint8_t* p1, const uint8_t* p2,
 }
 
 /**
- * @brief Internal LZAV block header writing function (stream format 2).
+ * @brief Internal LZAV block header writing function (stream formats 2 and
+ * 3).
  *
  * Internal function writes a block to the output buffer. This function can be
- * used in custom compression algorithms.
+ * used in custom compression algorithms. The lzav_encode_sequences()
+ * function is a simpler alternative, which manages the offset carry and block
+ * length limits itself.
  *
- * Stream format 2.
+ * Stream formats 2 and 3.
  *
  * "Raw" compressed stream consists of any quantity of unnumerated "blocks".
  * A block starts with a header byte, followed by several optional bytes.
@@ -426,6 +633,11 @@ static inline size_t lzav_match_len_r( const uint8_t* p1, const uint8_t* p2,
  * lowest bits of offset of the next reference block). Block type 3 includes 3
  * carry bits (highest bits of 4th byte).
  *
+ * Stream format 3 (large window) differs in block type 3 only: the 4th
+ * byte's bit 5 is an extended offset flag, and its 2 highest bits are carry
+ * bits. If the flag is set, an additional offset byte follows the 4th byte,
+ * which defines offset bits 23-30.
+ *
  * The overall compressed data is prefixed with a byte whose lower 4 bits
  * contain minimal reference length (mref), and the highest 4 bits contain
  * stream format identifier. Compressed data always finishes with
@@ -438,21 +650,23 @@ static inline size_t lzav_match_len_r( const uint8_t* p1, const uint8_t* p2,
  * @param op Output buffer pointer.
  * @param lc Literal length, in bytes.
  * @param rc Reference length, in bytes, not lesser than mref.
- * @param d Reference offset, in bytes. Should be lesser than `LZAV_WIN_LEN`,
- * and not lesser than `rc` since fast copy on decompression cannot provide
- * consistency of copying of data that is not in the output yet.
+ * @param d Reference offset, in bytes. Should be lesser than `LZAV_WIN_LEN`
+ * (2^`LZAV_WIN_LOG_MAX` in stream format 3), and not lesser than `rc` since
+ * fast copy on decompression cannot provide consistency of copying of data
+ * that is not in the output yet.
  * @param ipa Literals anchor pointer.
  * @param cbpp Pointer to the pointer to the latest offset carry block header.
  * Cannot be 0, but the contained pointer can be 0 (initial value).
  * @param cshp Pointer to offset carry shift.
  * @param mref Minimal reference length, in bytes, used by the compression
  * algorithm.
+ * @param lw 1 - write stream format 3 blocks, 0 - stream format 2.
  * @return Incremented output buffer pointer.
  */
 
-static inline uint8_t* lzav_write_blk_2( uint8_t* op, size_t lc, size_t rc,
+static inline uint8_t* lzav_write_blk( uint8_t* op, size_t lc, size_t rc,
 	size_t d, const uint8_t* ipa, uint8_t** const cbpp, int* const cshp,
-	const size_t mref )
+	const size_t mref, const int lw )
 {
 	// Perform offset carry to a previous block (`csh` may be zero).
 
@@ -543,8 +757,15 @@ static inline uint8_t* lzav_write_blk_2( uint8_t* op, size_t lc, size_t rc,
 
 	// Write a reference block.
 
-	static const int ocsh[ 4 ] = { 0, 0, 0, 3 };
+	static const int ocsh[ 2 ][ 4 ] = {{ 0, 0, 0, 3 }, { 0, 0, 0, 2 }};
 	const size_t bt = 1 + ( d > ( 1 << 10 ) - 1 ) + ( d > ( 1 << 18 ) - 1 );
+	size_t dx = 0; // Extended offset byte, stream format 3.
+
+	if( lw != 0 && LZAV_UNLIKELY( d > LZAV_WIN_LEN - 1 ))
+	{
+		dx = d >> LZAV_WIN_LOG;
+		d = ( d & ( LZAV_WIN_LEN - 1 )) | LZAV_WIN_LEN; // Set the flag.
+	}
 
 	if( LZAV_LIKELY( rc < 16 ))
 	{
@@ -553,9 +774,15 @@ static inline uint8_t* lzav_write_blk_2( uint8_t* op, size_t lc, size_t rc,
 		memcpy( op, &ov, 4 );
 
 		op += bt;
-		*cshp = ocsh[ bt ];
+		*cshp = ocsh[ lw ][ bt ];
 		*cbpp = op;
 
+		if( LZAV_UNLIKELY( dx != 0 ))
+		{
+			op[ 1 ] = (uint8_t) dx;
+			op++;
+		}
+
 		return( op + 1 );
 	}
 
@@ -564,9 +791,15 @@ static inline uint8_t* lzav_write_blk_2( uint8_t* op, size_t lc, size_t rc,
 	memcpy( op, &ov, 4 );
 
 	op += bt;
-	*cshp = ocsh[ bt ];
+	*cshp = ocsh[ lw ][ bt ];
 	*cbpp = op;
 
+	if( LZAV_UNLIKELY( dx != 0 ))
+	{
+		op[ 1 ] = (uint8_t) dx;
+		op++;
+	}
+
 	if( LZAV_LIKELY( rc < 16 + 255 ))
 	{
 		op[ 1 ] = (uint8_t) ( rc - 16 );
@@ -578,6 +811,19 @@ static inline uint8_t* lzav_write_blk_2( uint8_t* op, size_t lc, size_t rc,
 	return( op + 3 );
 }
 
+/**
+ * @brief Internal LZAV block header writing function (stream format 2).
+ *
+ * See the lzav_write_blk() function for a detailed description.
+ */
+
+static inline uint8_t* lzav_write_blk_2( uint8_t* op, size_t lc, size_t rc,
+	size_t d, const uint8_t* ipa, uint8_t** const cbpp, int* const cshp,
+	const size_t mref )
+{
+	return( lzav_write_blk( op, lc, rc, d, ipa, cbpp, cshp, mref, 0 ));
+}
+
 /**
  * @brief Internal LZAV finishing function (stream format 2).
  *
@@ -643,6 +889,21 @@ static inline int lzav_compress_bound( const int srcl )
 	return(( srcl - l2 * 6 + k - 1 ) / k * 2 - l2 + srcl + 16 );
 }
 
+/**
+ * @def LZAV_BOUND_HI
+ * @brief Macro returns buffer size required for the higher-ratio LZAV
+ * compression.
+ *
+ * The macro is a constant expression for a constant source data length, and
+ * can be used to size arrays. The lzav_compress_bound_hi() function
+ * evaluates it for positive lengths.
+ *
+ * @param l Source data length, in bytes, should be positive.
+ */
+
+#define LZAV_BOUND_HI( l ) \
+	(( (l) - (l) / 21 * 5 + 15 ) / 16 * 2 - (l) / 21 + (l) + 16 )
+
 /**
  * @brief Function returns buffer size required for the higher-ratio LZAV
  * compression.
@@ -659,406 +920,538 @@ static inline int lzav_compress_bound_hi( const int srcl )
 		return( 16 );
 	}
 
-	const int l2 = srcl / ( 16 + 5 );
+	return( LZAV_BOUND_HI( srcl ));
+}
+
+/**
+ * @brief Function returns the maximal reference offset allowed by a window
+ * length option.
+ *
+ * @param win_log log2 of window length, see lzav_compress_win().
+ */
+
+static inline size_t lzav_win_max( const int win_log )
+{
+	if( win_log <= 0 || win_log >= LZAV_WIN_LOG )
+	{
+		return( LZAV_WIN_LEN - 1 );
+	}
 
-	return(( srcl - l2 * 5 + 15 ) / 16 * 2 - l2 + srcl + 16 );
+	return(( (size_t) 1 << ( win_log < LZAV_WIN_LOG_MIN ?
+		LZAV_WIN_LOG_MIN : win_log )) - 1 );
 }
 
 /**
- * @brief LZAV compression function, with external buffer option.
+ * @brief Function fills a "gear" rolling hash's table of byte values.
  *
- * Function performs in-memory data compression using the LZAV compression
- * algorithm and stream format. The function produces a "raw" compressed data,
- * without a header containing data length nor identifier nor checksum.
+ * A gear hash is updated as `h = ( h << 1 ) + gear[ byte ]`, and its higher
+ * bits depend on the preceding 64 bytes only. The table is fixed, so that
+ * hash values are reproducible between runs.
  *
- * Note that compression algorithm and its output on the same source data may
- * differ between LZAV versions, and may differ between big- and little-endian
- * systems. However, the decompression of a compressed data produced by any
- * prior compressor version will remain possible.
+ * @param[out] gear Receiver of 256 byte values.
+ */
+
+static inline void lzav_gear_init( uint64_t* const gear )
+{
+	uint64_t v = 0;
+	int i;
+
+	for( i = 0; i < 256; i++ )
+	{
+		v += 0x9E3779B97F4A7C15;
+		uint64_t g = v ^ v >> 33;
+		g *= 0xC2B2AE3D27D4EB4F;
+		gear[ i ] = g ^ g >> 29;
+	}
+}
+
+/**
+ * @brief Long-distance matcher's state.
  *
- * @param[in] src Source (uncompressed) data pointer, can be 0 if `srcl`
- * equals 0. Address alignment is unimportant.
- * @param[out] dst Destination (compressed data) buffer pointer. The allocated
- * size should be at least lzav_compress_bound() bytes large. Address
- * alignment is unimportant. Should be different to `src`.
- * @param srcl Source data length, in bytes, can be 0: in this case the
- * compressed length is assumed to be 0 as well.
- * @param dstl Destination buffer's capacity, in bytes.
- * @param ext_buf External buffer to use for hash-table, set to 0 for the
- * function to manage memory itself (via standard `malloc`). Supplying a
- * pre-allocated buffer is useful if compression is performed during
- * application's operation often: this reduces memory allocation overhead and
- * fragmentation. Note that the access to the supplied buffer is not
- * implicitly thread-safe. Buffer's address must be aligned to 32 bits.
- * @param ext_bufl The capacity of the `ext_buf`, in bytes, should be a
- * power-of-2 value. Set to 0 if `ext_buf` is 0. The capacity should not be
- * lesser than 4 x `srcl`, and for default compression ratio should not be
- * greater than 1 MiB. Same `ext_bufl` value can be used for any smaller
- * source data. Using smaller `ext_bufl` values reduces the compression ratio
- * and, at the same time, increases compression speed. This aspect can be
- * utilized on memory-constrained and low-performance processors.
- * @return The length of compressed data, in bytes. Returns 0 if `srcl` is
- * lesser or equal to 0, or if `dstl` is too small, or if buffer pointers are
- * invalid, or if not enough memory.
+ * The matcher rolls a "gear" hash over the source data, and samples, on
+ * average, every 2^`LZAV_LDM_RATE`-th position, depending on the hash value
+ * of the preceding `LZAV_LDM_MIN` bytes. Sampled positions are stored in a
+ * hash-table, and are looked up to find long repeats at any distance within
+ * the window. Unlike the compressor's own hash-table, this hash-table is
+ * sparse, and it covers the whole window at a small memory cost.
  */
 
-static inline int lzav_compress( const void* const src, void* const dst,
-	const int srcl, const int dstl, void* const ext_buf, const int ext_bufl )
+typedef struct
 {
-	if(( srcl <= 0 ) | ( src == 0 ) | ( dst == 0 ) | ( src == dst ) |
-		( dstl < lzav_compress_bound( srcl )))
+	const uint64_t* gear; ///< Rolling hash's byte values, 256 items.
+	uint32_t* ht; ///< Hash-table, 4 tuples (hash check; offset) per bucket.
+	void* buf; ///< Allocated buffer that holds `gear` and `ht`.
+	size_t bufl; ///< Allocated buffer's length, in bytes.
+	uint32_t hmask; ///< Hash-table's bucket mask.
+	uint64_t h; ///< Rolling hash value.
+	const uint8_t* rp; ///< Rolling pointer, the next byte to hash.
+	const uint8_t* sp; ///< Lookup start pointer, the previous match's end.
+} lzav_ldm;
+
+/**
+ * @brief Function initializes the long-distance matcher.
+ *
+ * @param[out] lm Matcher's state.
+ * @param src Source data pointer.
+ * @param srcl Source data length, in bytes.
+ * @param wmax Max reference offset.
+ * @param al Allocator, 0 - the global allocator.
+ * @return 1, if initialized; 0, if not enough memory.
+ */
+
+static inline int lzav_ldm_init( lzav_ldm* const lm, const uint8_t* const src,
+	const size_t srcl, const size_t wmax, const lzav_alloc* const al )
+{
+	const size_t sc = ( srcl > wmax ? wmax : srcl ) >> LZAV_LDM_RATE;
+	size_t htsize = 1 << 12; // Hash-table's size in bytes (power-of-2).
+
+	while( htsize != ( 1 << 24 ) && ( htsize >> 4 ) < sc )
 	{
-		return( 0 );
+		htsize <<= 1;
 	}
 
-	uint8_t* op = (uint8_t*) dst; // Destination (compressed data) pointer.
-	*op = LZAV_FMT_CUR << 4 | LZAV_REF_MIN; // Write prefix byte.
-	op++;
+	lm -> bufl = 256 * sizeof( uint64_t ) + htsize;
+	lm -> buf = lzav_malloc( al, lm -> bufl );
 
-	if( srcl < 16 )
+	if( lm -> buf == 0 )
 	{
-		// Handle a very short source data.
+		return( 0 );
+	}
 
-		*op = (uint8_t) srcl;
-		op++;
+	uint64_t* const gear = (uint64_t*) lm -> buf;
+	lzav_gear_init( gear );
 
-		memcpy( op, src, srcl );
+	lm -> gear = gear;
+	lm -> ht = (uint32_t*) ( gear + 256 );
+	lm -> hmask = (uint32_t) (( htsize >> 2 ) - 1 ) ^ 7;
+	lm -> h = 0;
+	lm -> rp = src;
+	lm -> sp = src;
 
-		if( srcl > LZAV_LIT_FIN - 1 )
-		{
-			return( 2 + srcl );
-		}
+	memset( lm -> ht, 0, htsize );
 
-		memset( op + srcl, 0, LZAV_LIT_FIN - srcl );
-		return( 2 + LZAV_LIT_FIN );
-	}
+	return( 1 );
+}
 
-	uint32_t stack_buf[ 4096 ]; // On-stack hash-table.
-	void* alloc_buf = 0; // Hash-table allocated on heap.
-	uint8_t* ht = (uint8_t*) stack_buf; // The actual hash-table pointer.
+/**
+ * @brief Function finds the next long-distance match.
+ *
+ * Found matches do not overlap, and follow in the source data order. A match
+ * is at least `LZAV_LDM_MIN` bytes long, and its offset is not lesser than
+ * `LZAV_REF_LEN`, so that it can be written as a series of maximal-length
+ * reference blocks.
+ *
+ * @param lm Matcher's state.
+ * @param src Source data pointer.
+ * @param ipe Source data end pointer, matches end before it.
+ * @param wmax Max reference offset.
+ * @param[out] pmp Receiver of match's start pointer.
+ * @param[out] pme Receiver of match's end pointer.
+ * @param[out] pmd Receiver of match's offset.
+ * @return 1, if a match was found; 0, if the end of data was reached.
+ */
 
-	size_t htsize; // Hash-table's size in bytes (power-of-2).
-	htsize = ( 1 << 7 ) * sizeof( uint32_t ) * 4;
+static inline int lzav_ldm_next( lzav_ldm* const lm, const uint8_t* const src,
+	const uint8_t* const ipe, const size_t wmax, const uint8_t** const pmp,
+	const uint8_t** const pme, size_t* const pmd )
+{
+	const uint64_t* const gear = lm -> gear;
+	const uint8_t* rp = lm -> rp;
+	const uint8_t* const rpe = ipe - LZAV_LDM_MIN;
+	uint64_t h = lm -> h;
 
-	if( ext_buf == 0 )
+	while( LZAV_LIKELY( rp < ipe ))
 	{
-		while( htsize != ( 1 << 20 ) && ( htsize >> 2 ) < (size_t) srcl )
-		{
-			htsize <<= 1;
-		}
+		h = ( h << 1 ) + gear[ *rp ];
+		rp++;
 
-		if( htsize > sizeof( stack_buf ))
+		if( LZAV_LIKELY(( h >> ( 64 - LZAV_LDM_RATE )) != 0 ))
 		{
-			alloc_buf = malloc( htsize );
+			continue;
+		}
 
-			if( alloc_buf == 0 )
-			{
-				return( 0 );
-			}
+		// Hash value covers `LZAV_LDM_MIN` bytes that precede `rp`.
 
-			ht = (uint8_t*) alloc_buf;
-		}
-	}
-	else
-	{
-		size_t htsizem;
+		const uint8_t* const wp = rp - LZAV_LDM_MIN;
 
-		if( ext_bufl > (int) sizeof( stack_buf ))
+		if( LZAV_UNLIKELY( wp < src ))
 		{
-			htsizem = (size_t) ext_bufl;
-			ht = (uint8_t*) ext_buf;
+			continue;
 		}
-		else
+
+		const uint32_t hc = (uint32_t) h; // Hash check value.
+		const uint32_t hi = (uint32_t) ( h >> 24 ) & lm -> hmask;
+		uint32_t* const hp = lm -> ht + hi;
+		const uint8_t* bp = 0; // Best match's pointer.
+		size_t bl = 0; // Best match's length.
+
+		if( wp >= lm -> sp && wp < rpe )
 		{
-			htsizem = sizeof( stack_buf );
+			int i;
+
+			for( i = 0; i < 8; i += 2 )
+			{
+				const uint8_t* const mp = src + hp[ i + 1 ];
+				const size_t d = wp - mp;
+
+				if(( hp[ i ] == hc ) & ( d >= LZAV_REF_LEN ) & ( d <= wmax ))
+				{
+					const size_t l = lzav_match_len( wp, mp, ipe - wp );
+
+					if( l > bl )
+					{
+						bp = mp;
+						bl = l;
+					}
+				}
+			}
 		}
 
-		while(( htsize >> 2 ) < (size_t) srcl )
+		// Insert the position as the newest tuple.
+
+		hp[ 6 ] = hp[ 4 ];
+		hp[ 7 ] = hp[ 5 ];
+		hp[ 4 ] = hp[ 2 ];
+		hp[ 5 ] = hp[ 3 ];
+		hp[ 2 ] = hp[ 0 ];
+		hp[ 3 ] = hp[ 1 ];
+		hp[ 0 ] = hc;
+		hp[ 1 ] = (uint32_t) ( wp - src );
+
+		if( bl >= LZAV_LDM_MIN )
 		{
-			const size_t htsize2 = htsize << 1;
+			// Extend the match backwards, up to the previous match's end.
 
-			if( htsize2 > htsizem )
+			size_t ml = wp - lm -> sp;
+
+			if( ml > (size_t) ( bp - src ))
 			{
-				break;
+				ml = bp - src;
 			}
 
-			htsize = htsize2;
+			const size_t bmc = lzav_match_len_r( wp, bp, ml );
+
+			*pmp = wp - bmc;
+			*pme = wp + bl;
+			*pmd = wp - bp;
+
+			lm -> sp = wp + bl;
+			lm -> rp = rp;
+			lm -> h = h;
+
+			return( 1 );
 		}
 	}
 
-	const uint32_t hmask = (uint32_t) (( htsize - 1 ) ^ 15 ); // Hash mask.
-	const uint8_t* ip = (const uint8_t*) src; // Source data pointer.
-	const uint8_t* const ipe = ip + srcl - LZAV_LIT_FIN; // End pointer.
-	const uint8_t* const ipet = ipe - 9; // Hashing threshold, avoids I/O OOB.
-	const uint8_t* ipa = ip; // Literals anchor pointer.
-
-	uint8_t* cbp = op; // Pointer to the latest offset carry block header.
-	int csh = 0; // Offset carry shift.
-
-	intptr_t mavg = 100 << 21; // Running average of hash match rate (*2^15).
-		// Two-factor average: success (0-64) by average reference length.
-	uint32_t rndb = 0; // PRNG bit derived from the non-matching offset.
+	lm -> rp = rp;
+	lm -> h = h;
 
-	ip += 16; // Skip source bytes, to avoid OOB in back-match.
+	return( 0 );
+}
 
-	// Initialize the hash-table. Each hash-table item consists of 2 tuples
-	// (4 initial match bytes; 32-bit source data offset). Set source data
-	// offset to avoid OOB in back-match.
+/**
+ * @brief Scatter-gather I/O segment.
+ *
+ * On POSIX systems, this is `struct iovec`, and an array of `struct iovec`
+ * can be passed to the lzav_compress_iov() and lzav_decompress_iov()
+ * functions directly. Elsewhere, a structure with the same members is
+ * defined.
+ */
 
-	uint32_t initv[ 2 ] = { 0, 16 };
+#if defined( __unix__ ) || defined( __unix ) || defined( __APPLE__ )
 
-	if( LZAV_LIKELY( ip < ipet ))
-	{
-		memcpy( initv, ip, 4 );
-	}
+	#include <sys/uio.h>
 
-	uint32_t* ht32 = (uint32_t*) ht;
-	uint32_t* const ht32e = (uint32_t*) ( ht + htsize );
+	typedef struct iovec lzav_iovec;
 
-	while( ht32 != ht32e )
-	{
-		ht32[ 0 ] = initv[ 0 ];
-		ht32[ 1 ] = initv[ 1 ];
-		ht32 += 2;
-	}
+#else // POSIX check
 
-	while( LZAV_LIKELY( ip < ipet ))
+	typedef struct
 	{
-		// Hash source data (endianness is unimportant for compression
-		// efficiency). Hash is based on the "komihash" math construct, see
-		// https://github.com/avaneev/komihash for details.
+		void* iov_base; ///< Segment's data pointer.
+		size_t iov_len; ///< Segment's length, in bytes.
+	} lzav_iovec;
 
-		uint32_t iw1;
-		uint16_t iw2, ww2;
-		memcpy( &iw1, ip, 4 );
-		const uint32_t Seed1 = 0x243F6A88 ^ iw1;
-		memcpy( &iw2, ip + 4, 2 );
-		const uint64_t hm = (uint64_t) Seed1 * (uint32_t) ( 0x85A308D3 ^ iw2 );
-		const uint32_t hval = (uint32_t) hm ^ (uint32_t) ( hm >> 32 );
+#endif // POSIX check
 
-		// Hash-table access.
+/**
+ * @brief Function returns the index of a scatter-gather segment that
+ * contains the specified logical offset.
+ *
+ * @param cum Cumulative segment offsets, `n + 1` values.
+ * @param n The number of segments.
+ * @param o Logical offset, lesser than `cum[ n ]`.
+ * @return Segment's index `k`, with `cum[ k ] <= o < cum[ k + 1 ]`.
+ */
 
-		uint32_t* const hp = (uint32_t*) ( ht + ( hval & hmask ));
-		const uint32_t ipo = (uint32_t) ( ip - (const uint8_t*) src );
-		const uint32_t hw1 = hp[ 0 ]; // Tuple 1's match word.
-		const uint8_t* wp; // At window pointer.
-		size_t d, ml, rc, lc;
+static inline int lzav_iov_find( const size_t* const cum, int n,
+	const size_t o )
+{
+	int lo = 0;
 
-		// Find source data in hash-table tuples.
+	while( n - lo > 1 )
+	{
+		const int m = ( lo + n ) >> 1;
 
-		if( LZAV_LIKELY( iw1 != hw1 ))
+		if( cum[ m ] <= o )
 		{
-			if( LZAV_LIKELY( iw1 != hp[ 2 ]))
-			{
-				goto _no_match;
-			}
-
-			wp = (const uint8_t*) src + hp[ 3 ];
-			memcpy( &ww2, wp + 4, 2 );
-
-			if( LZAV_UNLIKELY( iw2 != ww2 ))
-			{
-				goto _no_match;
-			}
+			lo = m;
 		}
 		else
 		{
-			wp = (const uint8_t*) src + hp[ 1 ];
-			memcpy( &ww2, wp + 4, 2 );
+			n = m;
+		}
+	}
 
-			if( LZAV_UNLIKELY( iw2 != ww2 ))
-			{
-				if( LZAV_LIKELY( iw1 != hp[ 2 ]))
-				{
-					goto _no_match;
-				}
+	return( lo );
+}
 
-				wp = (const uint8_t*) src + hp[ 3 ];
-				memcpy( &ww2, wp + 4, 2 );
+/**
+ * @brief Function copies logically-contiguous data from scatter-gather
+ * segments.
+ *
+ * @param[out] op Destination pointer.
+ * @param iov Segments.
+ * @param cum Cumulative segment offsets.
+ * @param k Index of the segment that contains `o`, or of a prior segment.
+ * @param o Logical offset of data.
+ * @param l Data length, in bytes, within the segments.
+ */
 
-				if( LZAV_UNLIKELY( iw2 != ww2 ))
-				{
-					goto _no_match;
-				}
-			}
+static inline void lzav_iov_copy( uint8_t* op, const lzav_iovec* const iov,
+	const size_t* const cum, int k, size_t o, size_t l )
+{
+	while( l != 0 )
+	{
+		while( cum[ k + 1 ] <= o )
+		{
+			k++;
 		}
 
-		d = ip - wp; // Reference offset (distance).
+		size_t cl = cum[ k + 1 ] - o;
 
-		if( LZAV_UNLIKELY(( d < 8 ) | ( d > LZAV_WIN_LEN - 1 )))
+		if( cl > l )
 		{
-			// Small offsets may be inefficient.
-
-			goto _d_oob;
+			cl = l;
 		}
 
-		// Source data and hash-table entry match.
-
-		// Disallow reference copy overlap by using `d` as max match length.
+		memcpy( op, (const uint8_t*) iov[ k ].iov_base + ( o - cum[ k ]),
+			cl );
 
-		ml = ( d > LZAV_REF_LEN ? LZAV_REF_LEN : d );
+		op += cl;
+		o += cl;
+		l -= cl;
+	}
+}
 
-		if( LZAV_UNLIKELY( ip + ml > ipe ))
-		{
-			// Make sure `LZAV_LIT_FIN` literals remain on finish.
+/**
+ * @brief Data match length finding function, for logical offsets in
+ * scatter-gather segments. See lzav_match_len().
+ *
+ * @param iov Segments.
+ * @param cum Cumulative segment offsets.
+ * @param k1 Index of the segment that contains `o1`, or of a prior segment.
+ * @param o1 Logical offset 1.
+ * @param k2 Index of the segment that contains `o2`, or of a prior segment.
+ * @param o2 Logical offset 2.
+ * @param ml Maximal number of bytes to match, within the segments.
+ * @return The number of matching leading bytes.
+ */
 
-			ml = ipe - ip;
-		}
+static inline size_t lzav_iov_match_len( const lzav_iovec* const iov,
+	const size_t* const cum, int k1, size_t o1, int k2, size_t o2,
+	const size_t ml )
+{
+	size_t l = 0;
 
-		if( LZAV_LIKELY( d > 273 ))
+	while( l != ml )
+	{
+		while( cum[ k1 + 1 ] <= o1 )
 		{
-			// Update a matching entry which is not inside max reference
-			// length's range. Otherwise, source data consisting of same-byte
-			// runs won't compress well.
-
-			if( LZAV_LIKELY( iw1 == hw1 )) // Replace tuple, or insert.
-			{
-				hp[ 1 ] = ipo;
-			}
-			else
-			{
-				hp[ 2 ] = hw1;
-				hp[ 3 ] = hp[ 1 ];
-				hp[ 0 ] = iw1;
-				hp[ 1 ] = ipo;
-			}
+			k1++;
 		}
 
-		rc = LZAV_REF_MIN + lzav_match_len( ip + LZAV_REF_MIN,
-			wp + LZAV_REF_MIN, ml - LZAV_REF_MIN );
-
-		lc = ip - ipa;
-
-		if( LZAV_UNLIKELY( lc != 0 ))
+		while( cum[ k2 + 1 ] <= o2 )
 		{
-			// Try to consume literals by finding a match at a back-position.
-
-			ml -= rc;
-			size_t bmc = ( lc > 16 ? 16 : lc );
-
-			if( LZAV_LIKELY( ml > bmc ))
-			{
-				ml = bmc;
-			}
+			k2++;
+		}
 
-			bmc = lzav_match_len_r( ip, wp, ml );
+		size_t c = ml - l;
+		const size_t r1 = cum[ k1 + 1 ] - o1;
+		const size_t r2 = cum[ k2 + 1 ] - o2;
 
-			if( LZAV_UNLIKELY( bmc != 0 ))
-			{
-				rc += bmc;
-				ip -= bmc;
-				lc -= bmc;
-			}
-		}
+		c = ( c > r1 ? r1 : c );
+		c = ( c > r2 ? r2 : c );
 
-		op = lzav_write_blk_2( op, lc, rc, d, ipa, &cbp, &csh, LZAV_REF_MIN );
-		ip += rc;
-		ipa = ip;
-		mavg += ( (intptr_t) ( rc << 21 ) - mavg ) >> 10;
-		continue;
+		const size_t m = lzav_match_len(
+			(const uint8_t*) iov[ k1 ].iov_base + ( o1 - cum[ k1 ]),
+			(const uint8_t*) iov[ k2 ].iov_base + ( o2 - cum[ k2 ]), c );
 
-	_d_oob:
-		ip++;
+		l += m;
 
-		if( LZAV_LIKELY( d < LZAV_WIN_LEN ))
+		if( m != c || l == ml )
 		{
-			continue;
+			break;
 		}
 
-		hp[ 1 + ( iw1 != hw1 ) * 2 ] = ipo;
-		continue;
-
-	_no_match:
-		hp[ 2 ] = iw1;
-		hp[ 3 ] = ipo;
+		o1 += c;
+		o2 += c;
+	}
 
-		mavg -= mavg >> 11;
+	return( l );
+}
 
-		if( mavg < ( 200 << 14 ) && ip != ipa ) // Speed-up threshold.
-		{
-			// Compression speed-up technique that keeps the number of hash
-			// evaluations around 45% of compressed data length. In some cases
-			// reduces the number of blocks by several percent.
+/**
+ * @brief Function writes a literal block, or finishing literals (if `cv`
+ * equals 0), with literals gathered from scatter-gather segments. See
+ * lzav_write_blk_2() and lzav_write_fin_2().
+ *
+ * @param op Output buffer pointer.
+ * @param cv Offset carry value, in the highest 2 bits.
+ * @param lc Literal length, in bytes, not 0.
+ * @param iov Segments.
+ * @param cum Cumulative segment offsets.
+ * @param ka Index of the segment that contains `ipa`, or of a prior segment.
+ * @param ipa Logical offset of literals.
+ * @return Incremented output buffer pointer.
+ */
 
-			ip += 1 + rndb; // Use PRNG bit to dither match positions.
-			rndb = ipo & 1; // Delay to decorrelate from current match.
+static inline uint8_t* lzav_write_lit_iov( uint8_t* op, const size_t cv,
+	const size_t lc, const lzav_iovec* const iov, const size_t* const cum,
+	const int ka, const size_t ipa )
+{
+	if( lc < 16 )
+	{
+		*op = (uint8_t) ( cv | lc );
+		op++;
+	}
+	else
+	{
+		*op = (uint8_t) cv;
+		op++;
 
-			if( LZAV_UNLIKELY( mavg < ( 130 << 14 )))
-			{
-				ip++;
+		size_t lcw = lc - 16;
 
-				if( LZAV_UNLIKELY( mavg < ( 100 << 14 )))
-				{
-					ip += 100 - ( mavg >> 14 ); // Gradually faster.
-				}
-			}
+		while( lcw > 127 )
+		{
+			*op = (uint8_t) ( 0x80 | lcw );
+			lcw >>= 7;
+			op++;
 		}
 
-		ip++;
+		*op = (uint8_t) lcw;
+		op++;
 	}
 
-	if( alloc_buf != 0 )
-	{
-		free( alloc_buf );
-	}
+	lzav_iov_copy( op, iov, cum, ka, ipa, lc );
 
-	return( (int) ( lzav_write_fin_2( op, ipe - ipa + LZAV_LIT_FIN, ipa ) -
-		(uint8_t*) dst ));
+	return( op + lc );
 }
 
 /**
- * @brief Default LZAV compression function.
- *
- * Function performs in-memory data compression using the LZAV compression
- * algorithm, with the default settings.
- *
- * See the lzav_compress() function for a more detailed description.
+ * @brief Function loads the 5th and 6th bytes of a hash-table candidate from
+ * scatter-gather segments.
  *
- * @param[in] src Source (uncompressed) data pointer.
- * @param[out] dst Destination (compressed data) buffer pointer. The allocated
- * size should be at least lzav_compress_bound() bytes large.
- * @param srcl Source data length, in bytes.
- * @param dstl Destination buffer's capacity, in bytes.
- * @return The length of compressed data, in bytes. Returns 0 if `srcl` is
- * lesser or equal to 0, or if `dstl` is too small, or if not enough memory.
+ * @param iov Segments.
+ * @param cum Cumulative segment offsets.
+ * @param k Index of the current segment, the candidate's offset is lesser
+ * than current offset.
+ * @param o Logical offset of the 5th byte.
+ * @param[out] v Receiver of the loaded bytes.
+ * @return Index of the segment that contains the candidate's offset.
  */
 
-static inline int lzav_compress_default( const void* const src,
-	void* const dst, const int srcl, const int dstl )
+static inline int lzav_iov_ld16( const lzav_iovec* const iov,
+	const size_t* const cum, const int k, const size_t o, uint16_t* const v )
 {
-	return( lzav_compress( src, dst, srcl, dstl, 0, 0 ));
+	const size_t wo = o - 4;
+
+	if( LZAV_LIKELY(( wo >= cum[ k ]) & ( o + 2 <= cum[ k + 1 ])))
+	{
+		memcpy( v, (const uint8_t*) iov[ k ].iov_base + ( o - cum[ k ]), 2 );
+		return( k );
+	}
+
+	const int wk = ( wo >= cum[ k ] ? k : lzav_iov_find( cum, k, wo ));
+	uint8_t b[ 2 ];
+
+	lzav_iov_copy( b, iov, cum, wk, o, 2 );
+	memcpy( v, b, 2 );
+
+	return( wk );
 }
 
 /**
- * @brief Higher-ratio LZAV compression function (much slower).
+ * @brief LZAV compression function (stream format 2), with external buffer,
+ * window length, and long-distance matching options; the core of the
+ * lzav_compress_2() function.
  *
- * Function performs in-memory data compression using the higher-ratio LZAV
- * compression algorithm.
+ * Function performs in-memory data compression using the LZAV compression
+ * algorithm and stream format. The function produces a "raw" compressed data,
+ * without a header containing data length nor identifier nor checksum.
  *
- * @param[in] src Source (uncompressed) data pointer.
+ * Note that compression algorithm and its output on the same source data may
+ * differ between LZAV versions, and may differ between big- and little-endian
+ * systems. However, the decompression of a compressed data produced by any
+ * prior compressor version will remain possible.
+ *
+ * @param[in] src Source (uncompressed) data pointer, can be 0 if `srcl`
+ * equals 0. Address alignment is unimportant.
  * @param[out] dst Destination (compressed data) buffer pointer. The allocated
- * size should be at least lzav_compress_bound_hi() bytes large.
- * @param srcl Source data length, in bytes.
+ * size should be at least lzav_compress_bound() bytes large. Address
+ * alignment is unimportant. Should be different to `src`.
+ * @param srcl Source data length, in bytes, can be 0: in this case the
+ * compressed length is assumed to be 0 as well.
  * @param dstl Destination buffer's capacity, in bytes.
+ * @param ext_buf External buffer to use for hash-table, set to 0 for the
+ * function to manage memory itself (via standard `malloc`). Supplying a
+ * pre-allocated buffer is useful if compression is performed during
+ * application's operation often: this reduces memory allocation overhead and
+ * fragmentation. Note that the access to the supplied buffer is not
+ * implicitly thread-safe. Buffer's address must be aligned to 32 bits.
+ * @param ext_bufl The capacity of the `ext_buf`, in bytes, should be a
+ * power-of-2 value. Set to 0 if `ext_buf` is 0. The capacity should not be
+ * lesser than 4 x `srcl`, and for default compression ratio should not be
+ * greater than 1 MiB. Same `ext_bufl` value can be used for any smaller
+ * source data. Using smaller `ext_bufl` values reduces the compression ratio
+ * and, at the same time, increases compression speed. This aspect can be
+ * utilized on memory-constrained and low-performance processors.
+ * @param al Allocator of the hash-table, if `ext_buf` is 0; 0 - the global
+ * allocator.
+ * @param win_log log2 of LZ77 window length: references are restricted to
+ * the specified number of preceding bytes, `LZAV_WIN_LOG_MIN` (64 KiB) or
+ * higher. Set to 0 for the full 8 MiB window. A small window (e.g., 16 or 18)
+ * keeps back-references in L1/L2 cache during decompression, which increases
+ * decompression speed at the expense of compression ratio. The stream format
+ * is unchanged, and the window length is not recorded in the stream.
+ * @param ldm 1 - run the long-distance matcher alongside the compressor, see
+ * lzav_compress_ldm(); 0 - disabled. Should be a constant: the function is
+ * always inlined, and with 0, the matcher's code is not compiled in.
+ * @param sg 1 - the source is the scatter-gather segments `iov`, with `src`
+ * and `ldm` set to 0, see lzav_compress_iov_al(); 0 - contiguous `src`.
+ * Should be a constant: with 0, segment tracking is not compiled in.
+ * @param iov Source segments, if `sg` is 1.
+ * @param cum Cumulative segment offsets, the number of segments plus 1
+ * values, if `sg` is 1.
  * @return The length of compressed data, in bytes. Returns 0 if `srcl` is
  * lesser or equal to 0, or if `dstl` is too small, or if buffer pointers are
  * invalid, or if not enough memory.
  */
 
-static inline int lzav_compress_hi( const void* const src, void* const dst,
-	const int srcl, const int dstl )
+static LZAV_INLINE_F int lzav_compress_2c( const void* const src,
+	void* const dst, const int srcl, const int dstl, void* const ext_buf,
+	const int ext_bufl, const lzav_alloc* const al, const int win_log,
+	const int ldm, const int sg, const lzav_iovec* const iov,
+	const size_t* const cum )
 {
-	if(( srcl <= 0 ) | ( src == 0 ) | ( dst == 0 ) | ( src == dst ) |
-		( dstl < lzav_compress_bound_hi( srcl )))
+	if(( srcl <= 0 ) | (( src == 0 ) & ( sg == 0 )) | ( dst == 0 ) |
+		( src == dst ) | ( dstl < lzav_compress_bound( srcl )))
 	{
 		return( 0 );
 	}
 
-	const size_t mref = 5; // Minimal reference length.
-	const size_t mlen = LZAV_REF_LEN - LZAV_REF_MIN + mref;
-
 	uint8_t* op = (uint8_t*) dst; // Destination (compressed data) pointer.
-	*op = (uint8_t) ( LZAV_FMT_CUR << 4 | mref ); // Write prefix byte.
+	*op = LZAV_FMT_CUR << 4 | LZAV_REF_MIN; // Write prefix byte.
 	op++;
 
 	if( srcl < 16 )
@@ -1068,7 +1461,14 @@ static inline int lzav_compress_hi( const void* const src, void* const dst,
 		*op = (uint8_t) srcl;
 		op++;
 
-		memcpy( op, src, srcl );
+		if( sg == 0 )
+		{
+			memcpy( op, src, srcl );
+		}
+		else
+		{
+			lzav_iov_copy( op, iov, cum, 0, 0, (size_t) srcl );
+		}
 
 		if( srcl > LZAV_LIT_FIN - 1 )
 		{
@@ -1079,36 +1479,113 @@ static inline int lzav_compress_hi( const void* const src, void* const dst,
 		return( 2 + LZAV_LIT_FIN );
 	}
 
+	uint32_t stack_buf[ 4096 ]; // On-stack hash-table.
+	void* alloc_buf = 0; // Hash-table allocated on heap.
+	uint8_t* ht = (uint8_t*) stack_buf; // The actual hash-table pointer.
+
 	size_t htsize; // Hash-table's size in bytes (power-of-2).
-	htsize = ( 1 << 7 ) * sizeof( uint32_t ) * 2 * 8;
+	htsize = ( 1 << 7 ) * sizeof( uint32_t ) * 4;
 
-	while( htsize != ( 1 << 23 ) && ( htsize >> 2 ) < (size_t) srcl )
+	if( ext_buf == 0 )
 	{
-		htsize <<= 1;
-	}
+		while( htsize != ( 1 << 20 ) && ( htsize >> 2 ) < (size_t) srcl )
+		{
+			htsize <<= 1;
+		}
 
-	uint8_t* ht = (uint8_t*) malloc( htsize ); // The hash-table pointer.
+		if( htsize > sizeof( stack_buf ))
+		{
+			alloc_buf = lzav_malloc( al, htsize );
 
-	if( ht == 0 )
+			if( alloc_buf == 0 )
+			{
+				return( 0 );
+			}
+
+			ht = (uint8_t*) alloc_buf;
+		}
+	}
+	else
 	{
-		return( 0 );
+		size_t htsizem;
+
+		if( ext_bufl > (int) sizeof( stack_buf ))
+		{
+			htsizem = (size_t) ext_bufl;
+			ht = (uint8_t*) ext_buf;
+		}
+		else
+		{
+			htsizem = sizeof( stack_buf );
+		}
+
+		while(( htsize >> 2 ) < (size_t) srcl )
+		{
+			const size_t htsize2 = htsize << 1;
+
+			if( htsize2 > htsizem )
+			{
+				break;
+			}
+
+			htsize = htsize2;
+		}
 	}
 
-	const uint32_t hmask = (uint32_t) (( htsize - 1 ) ^ 63 ); // Hash mask.
-	const uint8_t* ip = (const uint8_t*) src; // Source data pointer.
-	const uint8_t* const ipe = ip + srcl - LZAV_LIT_FIN; // End pointer.
-	const uint8_t* const ipet = ipe - 9; // Hashing threshold, avoids I/O OOB.
-	const uint8_t* ipa = ip; // Literals anchor pointer.
+	// Source positions are logical offsets. Scatter-gather segments are
+	// tracked by the index `k` of the segment containing `ipo`; hash-table
+	// candidates mostly reside in the current segment, which avoids segment
+	// search. Contiguous source data is a single segment.
+
+	const uint32_t hmask = (uint32_t) (( htsize - 1 ) ^ 15 ); // Hash mask.
+	const size_t wmax = lzav_win_max( win_log ); // Max reference offset.
+	const size_t ipe = (size_t) srcl - LZAV_LIT_FIN; // End offset.
+	const size_t ipet = ipe - 9; // Hashing threshold, avoids I/O OOB.
+	size_t ipo = 16; // Source offset, skip bytes to avoid OOB in back-match.
+	size_t ipa = 0; // Literals anchor offset.
+
+	const uint8_t* sp = (const uint8_t*) src; // Current segment's data.
+	size_t so = 0; // Segment's start offset.
+	size_t se = (size_t) srcl; // Segment's end offset.
+	int k = 0; // Index of the segment containing `ipo`.
+	int ka = 0; // Index of the segment containing `ipa`, or a prior one.
+
+	if( sg != 0 )
+	{
+		while( cum[ k + 1 ] <= ipo )
+		{
+			k++;
+		}
+
+		sp = (const uint8_t*) iov[ k ].iov_base;
+		so = cum[ k ];
+		se = cum[ k + 1 ];
+	}
 
 	uint8_t* cbp = op; // Pointer to the latest offset carry block header.
 	int csh = 0; // Offset carry shift.
 
-	// Initialize the hash-table. Each hash-table item consists of 8 tuples
-	// (4 initial match bytes; 32-bit source data offset). The last value of
-	// the last tuple is used as head tuple offset (an even value).
+	intptr_t mavg = 100 << 21; // Running average of hash match rate (*2^15).
+		// Two-factor average: success (0-64) by average reference length.
+	uint32_t rndb = 0; // PRNG bit derived from the non-matching offset.
 
-	uint32_t initv[ 2 ] = { 0, 0 };
-	memcpy( initv, ip, 4 );
+	// Initialize the hash-table. Each hash-table item consists of 2 tuples
+	// (4 initial match bytes; 32-bit source data offset). Set source data
+	// offset to avoid OOB in back-match.
+
+	uint32_t initv[ 2 ] = { 0, 16 };
+
+	if( LZAV_LIKELY( ipo < ipet ))
+	{
+		if( sg == 0 )
+		{
+			memcpy( initv, sp + ipo, 4 );
+		}
+		else
+		{
+			lzav_iov_copy( (uint8_t*) initv, iov, cum, k, ipo, 4 );
+		}
+	}
 
 	uint32_t* ht32 = (uint32_t*) ht;
 	uint32_t* const ht32e = (uint32_t*) ( ht + htsize );
@@ -1120,872 +1597,4268 @@ static inline int lzav_compress_hi( const void* const src, void* const dst,
 		ht32 += 2;
 	}
 
-	size_t prc = 0; // Length of a previously found match.
-	size_t pd = 0; // Distance of a previously found match.
-	const uint8_t* pip = ip; // Source pointer of a previously found match.
+	lzav_ldm lm; // Long-distance matcher.
+	memset( &lm, 0, sizeof( lm ));
+	const uint8_t* const ipep = ( ldm != 0 ? // End pointer.
+		(const uint8_t*) src + ipe : 0 );
+	const uint8_t* lmp = ipep; // Long-distance match's start, `ipep` - none.
+	const uint8_t* lme = ipep; // Long-distance match's end.
+	size_t lmd = 0; // Long-distance match's offset.
 
-	while( LZAV_LIKELY( ip < ipet ))
+	if( ldm != 0 && srcl > ( 1 << 16 ))
 	{
-		// Hash source data (endianness is unimportant for compression
-		// efficiency). Hash is based on the "komihash" math construct, see
-		// https://github.com/avaneev/komihash for details.
-
-		uint32_t iw1;
-		memcpy( &iw1, ip, 4 );
-		const uint64_t hm = (uint64_t) ( 0x243F6A88 ^ iw1 ) *
-			(uint32_t) ( 0x85A308D3 ^ ip[ 4 ]);
-
-		const uint32_t hval = (uint32_t) hm ^ (uint32_t) ( hm >> 32 );
-
-		// Hash-table access.
+		if( !lzav_ldm_init( &lm, (const uint8_t*) src, srcl, wmax, al ))
+		{
+			if( alloc_buf != 0 )
+			{
+				lzav_free( al, alloc_buf, htsize );
+			}
 
-		uint32_t* const hp = (uint32_t*) ( ht + ( hval & hmask ));
-		const uint32_t ipo = (uint32_t) ( ip - (const uint8_t*) src );
-		size_t ti0 = hp[ 15 ]; // Head tuple offset.
+			return( 0 );
+		}
 
-		// Find source data in hash-table tuples, in up to 7 previous
-		// positions.
+		if( !lzav_ldm_next( &lm, (const uint8_t*) src, ipep, wmax, &lmp,
+			&lme, &lmd ))
+		{
+			lmp = ipep;
+		}
+	}
 
-		const uint8_t* wp = ip; // Best found window pointer.
-		size_t rc = 0; // Best found match length, 0 - not found.
-		size_t d; // Reference offset (distance).
-		size_t ti = ti0;
-		int i;
+	// Loads candidate's bytes 5-6 to `ww2`, and its segment's index to `wk`.
+
+	#define LZAV_LD16 \
+		if( sg == 0 || LZAV_LIKELY(( wpo >= so ) & ipf )) \
+		{ \
+			wk = k; \
+			memcpy( &ww2, sp + ( wpo - so ) + 4, 2 ); \
+		} \
+		else \
+		{ \
+			wk = lzav_iov_ld16( iov, cum, k, wpo + 4, &ww2 ); \
+		}
 
-		if( LZAV_LIKELY( ip + mlen < ipe ))
+	while( LZAV_LIKELY( ipo < ipet ))
+	{
+		if( sg != 0 && LZAV_UNLIKELY( ipo >= se ))
 		{
-			// Optimized match-finding.
-
-			for( i = 0; i < 7; i++ )
+			do
 			{
-				const uint32_t ww1 = hp[ ti ];
-				const uint8_t* const wp0 = (const uint8_t*) src + hp[ ti + 1 ];
-				d = ip - wp0;
-				ti = ( ti == 12 ? 0 : ti + 2 );
-
-				if( iw1 == ww1 )
-				{
-					const size_t rc0 = 4 + lzav_match_len( ip + 4, wp0 + 4,
-						( d > mlen ? mlen : d ) - 4 );
+				k++;
+			} while( ipo >= cum[ k + 1 ]);
 
-					if( rc0 > rc + ( d > ( 1 << 18 )))
-					{
-						wp = wp0;
-						rc = rc0;
-					}
-				}
-			}
+			sp = (const uint8_t*) iov[ k ].iov_base;
+			so = cum[ k ];
+			se = cum[ k + 1 ];
 		}
-		else
+
+		const uint8_t* const ip = sp + ( ipo - so ); // Source data pointer.
+
+		if( ldm != 0 && LZAV_UNLIKELY( ip >= lmp ))
 		{
-			for( i = 0; i < 7; i++ )
+			// Write a long-distance match, or its remainder if a prior match
+			// overlaps it, as a series of reference blocks.
+
+			if( lme > ip + 16 )
 			{
-				const uint32_t ww1 = hp[ ti ];
-				const uint8_t* const wp0 = (const uint8_t*) src + hp[ ti + 1 ];
-				d = ip - wp0;
-				ti = ( ti == 12 ? 0 : ti + 2 );
+				size_t rc = lme - ip;
 
-				if( iw1 == ww1 )
+				while( rc >= LZAV_REF_MIN )
 				{
-					// Disallow reference copy overlap by using `d` as max
-					// match length.
-
-					size_t ml = ( d > mlen ? mlen : d );
+					const size_t c = ( rc > LZAV_REF_LEN ? LZAV_REF_LEN : rc );
 
-					if( LZAV_UNLIKELY( ip + ml > ipe ))
-					{
-						// Make sure `LZAV_LIT_FIN` literals remain on finish.
+					op = lzav_write_blk_2( op, ipo - ipa, c, lmd, sp + ipa,
+						&cbp, &csh, LZAV_REF_MIN );
 
-						ml = ipe - ip;
-					}
+					ipo += c;
+					ipa = ipo;
+					rc -= c;
+				}
 
-					const size_t rc0 = 4 + lzav_match_len( ip + 4, wp0 + 4,
-						ml - 4 );
+				mavg += ( (intptr_t) ( LZAV_REF_LEN << 21 ) - mavg ) >> 10;
+			}
 
-					if( rc0 > rc + ( d > ( 1 << 18 )))
-					{
-						wp = wp0;
-						rc = rc0;
-					}
-				}
+			if( !lzav_ldm_next( &lm, (const uint8_t*) src, ipep, wmax, &lmp,
+				&lme, &lmd ))
+			{
+				lmp = ipep;
 			}
+
+			continue;
 		}
 
-		d = ip - wp;
+		// Hash source data (endianness is unimportant for compression
+		// efficiency). Hash is based on the "komihash" math construct, see
+		// https://github.com/avaneev/komihash for details.
 
-		if(( rc == 0 ) | ( d > 273 ))
-		{
-			// Update a matching entry which is not inside max reference
-			// length's range. Otherwise, source data consisting of same-byte
-			// runs won't compress well.
+		uint32_t iw1;
+		uint16_t iw2, ww2;
+		const int ipf = ( sg == 0 || ipo + 6 <= se ); // Not at the tail.
 
-			ti0 = ( ti0 == 0 ? 12 : ti0 - 2 );
-			hp[ ti0 ] = iw1;
-			hp[ ti0 + 1 ] = ipo;
-			hp[ 15 ] = (uint32_t) ti0;
+		if( LZAV_LIKELY( ipf ))
+		{
+			memcpy( &iw1, ip, 4 );
+			memcpy( &iw2, ip + 4, 2 );
 		}
-
-		if(( rc < mref + ( d > ( 1 << 18 ))) | ( d < 8 ) |
-			( d > LZAV_WIN_LEN - 1 ))
+		else
 		{
-			ip++;
-			continue;
+			uint8_t b[ 6 ];
+			lzav_iov_copy( b, iov, cum, k, ipo, 6 );
+			memcpy( &iw1, b, 4 );
+			memcpy( &iw2, b + 4, 2 );
 		}
 
-		// Source data and hash-table entry match of suitable length.
+		const uint32_t Seed1 = 0x243F6A88 ^ iw1;
+		const uint64_t hm = (uint64_t) Seed1 * (uint32_t) ( 0x85A308D3 ^ iw2 );
+		const uint32_t hval = (uint32_t) hm ^ (uint32_t) ( hm >> 32 );
 
-		const uint8_t* const ip0 = ip;
-		size_t lc = ip - ipa;
+		// Hash-table access.
 
-		if( LZAV_UNLIKELY( lc != 0 ))
-		{
-			// Try to consume literals by finding a match at back-position.
+		uint32_t* const hp = (uint32_t*) ( ht + ( hval & hmask ));
+		const uint32_t ipc = (uint32_t) ipo; // Current source data offset.
+		const uint32_t hw1 = hp[ 0 ]; // Tuple 1's match word.
+		size_t wpo; // At window offset.
+		int wk; // Index of the segment containing `wpo`.
+		size_t d, ml, rc, lc;
 
-			size_t ml = ( d > mlen ? mlen : d );
+		// Find source data in hash-table tuples.
 
-			if( LZAV_UNLIKELY( ip + ml > ipe ))
+		if( LZAV_LIKELY( iw1 != hw1 ))
+		{
+			if( LZAV_LIKELY( iw1 != hp[ 2 ]))
 			{
-				ml = ipe - ip;
+				goto _no_match;
 			}
 
-			ml -= rc;
-			const size_t wpo = wp - (const uint8_t*) src;
+			wpo = hp[ 3 ];
+			LZAV_LD16
 
-			if( LZAV_LIKELY( ml > lc ))
+			if( LZAV_UNLIKELY( iw2 != ww2 ))
 			{
-				ml = lc;
+				goto _no_match;
 			}
+		}
+		else
+		{
+			wpo = hp[ 1 ];
+			LZAV_LD16
 
-			if( LZAV_UNLIKELY( ml > wpo ))
+			if( LZAV_UNLIKELY( iw2 != ww2 ))
 			{
-				ml = wpo;
-			}
+				if( LZAV_LIKELY( iw1 != hp[ 2 ]))
+				{
+					goto _no_match;
+				}
 
-			const size_t bmc = lzav_match_len_r( ip, wp, ml );
+				wpo = hp[ 3 ];
+				LZAV_LD16
 
-			if( LZAV_UNLIKELY( bmc != 0 ))
-			{
-				rc += bmc;
-				ip -= bmc;
-				lc -= bmc;
+				if( LZAV_UNLIKELY( iw2 != ww2 ))
+				{
+					goto _no_match;
+				}
 			}
 		}
 
-		if( prc == 0 )
+		d = ipo - wpo; // Reference offset (distance).
+
+		if( LZAV_UNLIKELY(( d < 8 ) | ( d > wmax )))
 		{
-			// Save match for a later comparison.
+			// Small offsets may be inefficient.
 
-			prc = rc;
-			pd = d;
-			pip = ip;
-			ip = ip0 + 1;
-			continue;
+			goto _d_oob;
 		}
 
-		// Block size overhead estimation, and comparison with a previously
-		// found match.
+		// Source data and hash-table entry match.
 
-		const int lb = ( lc != 0 );
-		const int sh0 = 10 + ( csh != 0 ) * 3;
-		const int sh = sh0 + lb * 2;
-		const size_t ov = lc + lb + ( lc > 15 ) + 2 +
-			( d >= ( (size_t) 1 << sh )) +
-			( d >= ( (size_t) 1 << ( sh + 8 )));
+		// Disallow reference copy overlap by using `d` as max match length.
 
-		const size_t plc = pip - ipa;
-		const int plb = ( plc != 0 );
-		const int psh = sh0 + plb * 2;
-		const size_t pov = plc + plb + ( plc > 15 ) + 2 +
-			( pd >= ( (size_t) 1 << psh )) +
-			( pd >= ( (size_t) 1 << ( psh + 8 )));
+		ml = ( d > LZAV_REF_LEN ? LZAV_REF_LEN : d );
 
-		if( LZAV_LIKELY( prc * ov > rc * pov ))
+		if( LZAV_UNLIKELY( ipo + ml > ipe ))
 		{
-			if( LZAV_UNLIKELY( pip + prc <= ip ))
+			// Make sure `LZAV_LIT_FIN` literals remain on finish.
+
+			ml = ipe - ipo;
+		}
+
+		if( LZAV_LIKELY( d > 273 ))
+		{
+			// Update a matching entry which is not inside max reference
+			// length's range. Otherwise, source data consisting of same-byte
+			// runs won't compress well.
+
+			if( LZAV_LIKELY( iw1 == hw1 )) // Replace tuple, or insert.
 			{
-				// A winning previous match does not overlap a current match.
+				hp[ 1 ] = ipc;
+			}
+			else
+			{
+				hp[ 2 ] = hw1;
+				hp[ 3 ] = hp[ 1 ];
+				hp[ 0 ] = iw1;
+				hp[ 1 ] = ipc;
+			}
+		}
+
+		if( sg == 0 || LZAV_LIKELY(( wk == k ) & ( ipo + ml <= se )))
+		{
+			rc = LZAV_REF_MIN + lzav_match_len( ip + LZAV_REF_MIN,
+				sp + ( wpo - so ) + LZAV_REF_MIN, ml - LZAV_REF_MIN );
+		}
+		else
+		{
+			rc = LZAV_REF_MIN + lzav_iov_match_len( iov, cum, k,
+				ipo + LZAV_REF_MIN, wk, wpo + LZAV_REF_MIN,
+				ml - LZAV_REF_MIN );
+		}
 
-				op = lzav_write_blk_2( op, plc, prc, pd, ipa, &cbp, &csh,
-					mref );
+		lc = ipo - ipa;
 
-				ipa = pip + prc;
-				prc = rc;
-				pd = d;
-				pip = ip;
-				ip++;
-				continue;
+		if( LZAV_UNLIKELY( lc != 0 ))
+		{
+			// Try to consume literals by finding a match at a back-position.
+
+			ml -= rc;
+			size_t bmc = ( lc > 16 ? 16 : lc );
+			const uint8_t* wp = sp + ( wpo - so ); // At window pointer.
+
+			if( sg != 0 )
+			{
+				// Back-match is performed within the current segments only.
+
+				const size_t ipso = ipo - so;
+				const size_t wpso = wpo - cum[ wk ];
+
+				bmc = ( bmc > ipso ? ipso : bmc );
+				bmc = ( bmc > wpso ? wpso : bmc );
+				wp = (const uint8_t*) iov[ wk ].iov_base + wpso;
 			}
 
-			rc = prc;
-			d = pd;
-			ip = pip;
-			lc = plc;
+			if( LZAV_LIKELY( ml > bmc ))
+			{
+				ml = bmc;
+			}
+
+			bmc = lzav_match_len_r( ip, wp, ml );
+
+			if( LZAV_UNLIKELY( bmc != 0 ))
+			{
+				rc += bmc;
+				ipo -= bmc;
+				lc -= bmc;
+			}
 		}
 
-		op = lzav_write_blk_2( op, lc, rc, d, ipa, &cbp, &csh, mref );
-		ip += rc;
-		ipa = ip;
-		prc = 0;
+		if( sg == 0 || LZAV_LIKELY(( ipa >= so ) & ( ipa + 32 <= se )))
+		{
+			// Literals, and lzav_write_blk_2()'s over-read, are within the
+			// current segment.
+
+			op = lzav_write_blk_2( op, lc, rc, d, sp + ( ipa - so ), &cbp,
+				&csh, LZAV_REF_MIN );
+		}
+		else
+		if( lc == 0 )
+		{
+			op = lzav_write_blk_2( op, 0, rc, d, 0, &cbp, &csh,
+				LZAV_REF_MIN );
+		}
+		else
+		{
+			// Perform offset carry, as in lzav_write_blk_2(), and write a
+			// literal block with gathered literals; the reference block
+			// then needs no carry.
+
+			*cbp |= (uint8_t) (( d << 8 ) >> csh );
+			d >>= csh;
+
+			op = lzav_write_lit_iov( op, ( d & 3 ) << 6, lc, iov, cum,
+				ka, ipa );
+
+			d >>= 2;
+			csh = 0;
+			op = lzav_write_blk_2( op, 0, rc, d, 0, &cbp, &csh,
+				LZAV_REF_MIN );
+		}
+
+		ipo += rc;
+		ipa = ipo;
+		ka = k;
+		mavg += ( (intptr_t) ( rc << 21 ) - mavg ) >> 10;
+		continue;
+
+	_d_oob:
+		ipo++;
+
+		if( LZAV_LIKELY( d <= wmax ))
+		{
+			continue;
+		}
+
+		hp[ 1 + ( iw1 != hw1 ) * 2 ] = ipc;
+		continue;
+
+	_no_match:
+		hp[ 2 ] = iw1;
+		hp[ 3 ] = ipc;
+
+		mavg -= mavg >> 11;
+
+		if( mavg < ( 200 << 14 ) && ipo != ipa ) // Speed-up threshold.
+		{
+			// Compression speed-up technique that keeps the number of hash
+			// evaluations around 45% of compressed data length. In some cases
+			// reduces the number of blocks by several percent.
+
+			ipo += 1 + rndb; // Use PRNG bit to dither match positions.
+			rndb = ipc & 1; // Delay to decorrelate from current match.
+
+			if( LZAV_UNLIKELY( mavg < ( 130 << 14 )))
+			{
+				ipo++;
+
+				if( LZAV_UNLIKELY( mavg < ( 100 << 14 )))
+				{
+					ipo += 100 - ( mavg >> 14 ); // Gradually faster.
+				}
+			}
+		}
+
+		ipo++;
 	}
 
-	if( prc != 0 )
+	#undef LZAV_LD16
+
+	if( alloc_buf != 0 )
 	{
-		op = lzav_write_blk_2( op, pip - ipa, prc, pd, ipa, &cbp, &csh,
-			mref );
+		lzav_free( al, alloc_buf, htsize );
+	}
 
-		ipa = pip + prc;
+	if( ldm != 0 && lm.buf != 0 )
+	{
+		lzav_free( al, lm.buf, lm.bufl );
+	}
+
+	if( sg == 0 )
+	{
+		op = lzav_write_fin_2( op, ipe - ipa + LZAV_LIT_FIN, sp + ipa );
+	}
+	else
+	{
+		op = lzav_write_lit_iov( op, 0, ipe - ipa + LZAV_LIT_FIN, iov, cum,
+			ka, ipa );
 	}
 
-	free( ht );
+	return( (int) ( op - (uint8_t*) dst ));
+}
 
-	return( (int) ( lzav_write_fin_2( op, ipe - ipa + LZAV_LIT_FIN, ipa ) -
-		(uint8_t*) dst ));
+/**
+ * @brief LZAV compression function (stream format 2), with external buffer,
+ * window length, and long-distance matching options.
+ *
+ * Function selects the lzav_compress_2c() variant, with or without the
+ * long-distance matcher, at run time. See the lzav_compress_2c() function
+ * for a detailed description.
+ */
+
+static inline int lzav_compress_2( const void* const src, void* const dst,
+	const int srcl, const int dstl, void* const ext_buf, const int ext_bufl,
+	const lzav_alloc* const al, const int win_log, const int ldm )
+{
+	if( ldm != 0 )
+	{
+		return( lzav_compress_2c( src, dst, srcl, dstl, ext_buf, ext_bufl,
+			al, win_log, 1, 0, 0, 0 ));
+	}
+
+	return( lzav_compress_2c( src, dst, srcl, dstl, ext_buf, ext_bufl, al,
+		win_log, 0, 0, 0, 0 ));
 }
 
 /**
- * @brief Internal LZAV decompression function (stream format 2).
+ * @brief LZAV compression function, with external buffer and window length
+ * options.
  *
- * Function decompresses "raw" data previously compressed into the LZAV stream
- * format 2.
+ * See the lzav_compress_2c() function for a detailed description.
+ */
+
+static inline int lzav_compress_win( const void* const src, void* const dst,
+	const int srcl, const int dstl, void* const ext_buf, const int ext_bufl,
+	const lzav_alloc* const al, const int win_log )
+{
+	return( lzav_compress_2c( src, dst, srcl, dstl, ext_buf, ext_bufl, al,
+		win_log, 0, 0, 0, 0 ));
+}
+
+/**
+ * @brief LZAV compression function, with the long-distance matching
+ * pre-pass.
  *
- * This function should not be called directly since it does not check the
- * format identifier.
+ * Function compresses data like lzav_compress_win(), but additionally rolls
+ * a hash over the source data, to find long repeats (64 bytes or longer)
+ * anywhere within the window. The compressor's own hash-table is limited to
+ * 1 MiB, and it keeps only 2 recent positions per bucket, so repeats farther
+ * apart than several hundred KiB are mostly missed by it. Found long repeats
+ * replace the compressor's own matches, the stream format is unchanged. The
+ * pre-pass uses an additional buffer, about 1/8 of the window length (or of
+ * `srcl`, if smaller), and it is disabled for `srcl` of 64 KiB or less.
  *
- * @param[in] src Source (compressed) data pointer.
- * @param[out] dst Destination (decompressed data) buffer pointer.
+ * See the lzav_compress_2c() function for a detailed description of
+ * parameters.
+ */
+
+static inline int lzav_compress_ldm( const void* const src, void* const dst,
+	const int srcl, const int dstl, const lzav_alloc* const al,
+	const int win_log )
+{
+	return( lzav_compress_2c( src, dst, srcl, dstl, 0, 0, al, win_log, 1, 0,
+		0, 0 ));
+}
+
+/**
+ * @brief LZAV compression function, with the full window.
+ *
+ * See the lzav_compress_2c() function for a detailed description.
+ */
+
+static inline int lzav_compress_al( const void* const src, void* const dst,
+	const int srcl, const int dstl, void* const ext_buf, const int ext_bufl,
+	const lzav_alloc* const al )
+{
+	return( lzav_compress_win( src, dst, srcl, dstl, ext_buf, ext_bufl, al,
+		0 ));
+}
+
+/**
+ * @brief LZAV compression function, with the global allocator.
+ *
+ * See the lzav_compress_win() function for a detailed description.
+ */
+
+static inline int lzav_compress( const void* const src, void* const dst,
+	const int srcl, const int dstl, void* const ext_buf, const int ext_bufl )
+{
+	return( lzav_compress_al( src, dst, srcl, dstl, ext_buf, ext_bufl, 0 ));
+}
+
+/**
+ * @brief Default LZAV compression function.
+ *
+ * Function performs in-memory data compression using the LZAV compression
+ * algorithm, with the default settings.
+ *
+ * See the lzav_compress() function for a more detailed description.
+ *
+ * @param[in] src Source (uncompressed) data pointer.
+ * @param[out] dst Destination (compressed data) buffer pointer. The allocated
+ * size should be at least lzav_compress_bound() bytes large.
  * @param srcl Source data length, in bytes.
- * @param dstl Expected destination data length, in bytes.
- * @param[out] pwl Pointer to variable that receives the number of bytes
- * written to the destination buffer (until error or end of buffer).
- * @return The length of decompressed data, in bytes, or any negative value if
- * some error happened.
+ * @param dstl Destination buffer's capacity, in bytes.
+ * @return The length of compressed data, in bytes. Returns 0 if `srcl` is
+ * lesser or equal to 0, or if `dstl` is too small, or if not enough memory.
+ */
+
+static inline int lzav_compress_default( const void* const src,
+	void* const dst, const int srcl, const int dstl )
+{
+	return( lzav_compress( src, dst, srcl, dstl, 0, 0 ));
+}
+
+#define LZAV_PAGE_LEN_MAX ( 1 << 16 ) ///< Max page length, in bytes.
+#define LZAV_PAGE_HT_SIZE ( 1 << 16 ) ///< Page context's hash-table size.
+
+/**
+ * @def LZAV_PAGE_BOUND
+ * @brief Macro returns buffer size required for LZAV page compression.
+ *
+ * The macro evaluates to the same value as the lzav_compress_bound()
+ * function for positive lengths, but it is a constant expression for a
+ * constant page length, and can be used to size arrays.
+ *
+ * @param l Page length, in bytes, should be positive.
+ */
+
+#define LZAV_PAGE_BOUND( l ) \
+	(( (l) - (l) / 150 * 6 + 143 ) / 144 * 2 - (l) / 150 + (l) + 16 )
+
+/**
+ * @brief LZAV page compression context.
+ *
+ * The context keeps a hash-table that persists between lzav_compress_page()
+ * calls. Hash-table entries store source offsets biased by a running `base`
+ * value, which is advanced by the page length after each page, and match
+ * words salted by a `base`-derived value. This way entries left by previous
+ * pages are recognized as stale (and rarely even reach an offset check)
+ * without a hash-table reinitialization on every call. A context should be
+ * initialized with lzav_page_init() before use. Access to a context is not
+ * implicitly thread-safe, each thread should use its own context.
+ */
+
+typedef struct
+{
+	uint32_t ht[ LZAV_PAGE_HT_SIZE / sizeof( uint32_t )]; ///< Hash-table.
+	uint32_t base; ///< Offset bias of the current page.
+} lzav_page_ctx;
+
+/**
+ * @brief Function initializes LZAV page compression context.
+ *
+ * @param[out] ctx Context to initialize.
+ */
+
+static inline void lzav_page_init( lzav_page_ctx* const ctx )
+{
+	memset( ctx -> ht, 0, sizeof( ctx -> ht ));
+
+	// Zero offsets are stale with this bias.
+
+	ctx -> base = LZAV_PAGE_LEN_MAX;
+}
+
+/**
+ * @brief LZAV fixed-size page compression function.
+ *
+ * Function performs in-memory compression of a small data block (e.g., a 4
+ * or 16 KiB storage page), using the default LZAV compression algorithm and
+ * stream format. The output can be decompressed with lzav_decompress() or
+ * lzav_decompress_page(), and it is equivalent in ratio to that of
+ * lzav_compress() with a hash-table of the same size.
+ *
+ * Unlike lzav_compress(), this function does not allocate memory nor
+ * initialize a hash-table on each call, which reduces per-page latency. The
+ * hash-table size is 4 x `pagel`, limited to LZAV_PAGE_HT_SIZE. Since the
+ * function is inline, a constant `pagel` is propagated into the hash-table
+ * mask and bound checks.
+ *
+ * @param ctx Initialized page compression context.
+ * @param[in] src Source (uncompressed) data pointer. Address alignment is
+ * unimportant.
+ * @param[out] dst Destination (compressed data) buffer pointer. The allocated
+ * size should be at least LZAV_PAGE_BOUND( `pagel` ) bytes large. Should be
+ * different to `src`.
+ * @param pagel Source data (page) length, in bytes, 1 to LZAV_PAGE_LEN_MAX.
+ * @param dstl Destination buffer's capacity, in bytes.
+ * @return The length of compressed data, in bytes. Returns 0 if `pagel` is
+ * out of range, or if `dstl` is too small, or if pointers are invalid.
+ */
+
+static inline int lzav_compress_page( lzav_page_ctx* const ctx,
+	const void* const src, void* const dst, const int pagel, const int dstl )
+{
+	if(( pagel <= 0 ) | ( pagel > LZAV_PAGE_LEN_MAX ) | ( ctx == 0 ) |
+		( src == 0 ) | ( dst == 0 ) | ( src == dst ) |
+		( dstl < LZAV_PAGE_BOUND( pagel )))
+	{
+		return( 0 );
+	}
+
+	if( pagel < 16 )
+	{
+		return( lzav_compress( src, dst, pagel, dstl, 0, 0 ));
+	}
+
+	if( ctx -> base > 0xFFFFFFFFU - LZAV_PAGE_LEN_MAX * 2 )
+	{
+		// Reinitialize before biased offsets wrap around.
+
+		lzav_page_init( ctx );
+	}
+
+	uint8_t* op = (uint8_t*) dst; // Destination (compressed data) pointer.
+	*op = LZAV_FMT_CUR << 4 | LZAV_REF_MIN; // Write prefix byte.
+	op++;
+
+	size_t htsize = ( 1 << 7 ) * sizeof( uint32_t ) * 4; // Hash-table size.
+
+	while( htsize != LZAV_PAGE_HT_SIZE && ( htsize >> 2 ) < (size_t) pagel )
+	{
+		htsize <<= 1;
+	}
+
+	uint8_t* const ht = (uint8_t*) ctx -> ht;
+	const uint32_t base = ctx -> base;
+	const uint32_t salt = base * 0x9E3779B1; // Per-page match word salt.
+	const uint32_t hmask = (uint32_t) (( htsize - 1 ) ^ 15 ); // Hash mask.
+	const uint8_t* const s = (const uint8_t*) src;
+	const uint8_t* ip = s; // Source data pointer.
+	const uint8_t* const ipe = ip + pagel - LZAV_LIT_FIN; // End pointer.
+	const uint8_t* const ipet = ipe - 9; // Hashing threshold, avoids I/O OOB.
+	const uint8_t* ipa = ip; // Literals anchor pointer.
+
+	uint8_t* cbp = op; // Pointer to the latest offset carry block header.
+	int csh = 0; // Offset carry shift.
+
+	intptr_t mavg = 100 << 21; // Running average of hash match rate (*2^15).
+	uint32_t rndb = 0; // PRNG bit derived from the non-matching offset.
+
+	ctx -> base = base + (uint32_t) pagel;
+	ip += 16; // Skip source bytes, to avoid OOB in back-match.
+
+	while( LZAV_LIKELY( ip < ipet ))
+	{
+		uint32_t iw1;
+		uint16_t iw2, ww2;
+		memcpy( &iw1, ip, 4 );
+		const uint32_t Seed1 = 0x243F6A88 ^ iw1;
+		memcpy( &iw2, ip + 4, 2 );
+		const uint64_t hm = (uint64_t) Seed1 * (uint32_t) ( 0x85A308D3 ^ iw2 );
+		const uint32_t hval = (uint32_t) hm ^ (uint32_t) ( hm >> 32 );
+		const uint32_t sw1 = iw1 ^ salt; // Salted match word.
+
+		// Hash-table access. A tuple matches only if its unbiased offset
+		// lies before the current position: offsets left by previous pages
+		// wrap around to large values.
+
+		uint32_t* const hp = (uint32_t*) ( ht + ( hval & hmask ));
+		const uint32_t ipo = (uint32_t) ( ip - s );
+		const uint32_t hw1 = hp[ 0 ]; // Tuple 1's match word.
+		const uint8_t* wp; // At window pointer.
+		uint32_t wo; // Unbiased window offset.
+		size_t d, ml, rc, lc;
+
+		if( LZAV_LIKELY( sw1 != hw1 ))
+		{
+			if( LZAV_LIKELY( sw1 != hp[ 2 ]))
+			{
+				goto _no_match;
+			}
+
+			wo = hp[ 3 ] - base;
+
+			if( LZAV_UNLIKELY( wo >= ipo ))
+			{
+				goto _no_match;
+			}
+
+			wp = s + wo;
+			memcpy( &ww2, wp + 4, 2 );
+
+			if( LZAV_UNLIKELY( iw2 != ww2 ))
+			{
+				goto _no_match;
+			}
+		}
+		else
+		{
+			wo = hp[ 1 ] - base;
+			wp = s + ( wo < ipo ? wo : 0 );
+
+			if( LZAV_LIKELY( wo < ipo ))
+			{
+				memcpy( &ww2, wp + 4, 2 );
+			}
+			else
+			{
+				ww2 = (uint16_t) ~iw2;
+			}
+
+			if( LZAV_UNLIKELY( iw2 != ww2 ))
+			{
+				if( LZAV_LIKELY( sw1 != hp[ 2 ]))
+				{
+					goto _no_match;
+				}
+
+				wo = hp[ 3 ] - base;
+
+				if( LZAV_UNLIKELY( wo >= ipo ))
+				{
+					goto _no_match;
+				}
+
+				wp = s + wo;
+				memcpy( &ww2, wp + 4, 2 );
+
+				if( LZAV_UNLIKELY( iw2 != ww2 ))
+				{
+					goto _no_match;
+				}
+			}
+		}
+
+		d = ip - wp; // Reference offset (distance), always within window.
+
+		if( LZAV_UNLIKELY( d < 8 ))
+		{
+			// Small offsets may be inefficient.
+
+			ip++;
+			continue;
+		}
+
+		ml = ( d > LZAV_REF_LEN ? LZAV_REF_LEN : d );
+
+		if( LZAV_UNLIKELY( ip + ml > ipe ))
+		{
+			ml = ipe - ip;
+		}
+
+		if( LZAV_LIKELY( d > 273 ))
+		{
+			if( LZAV_LIKELY( sw1 == hw1 )) // Replace tuple, or insert.
+			{
+				hp[ 1 ] = base + ipo;
+			}
+			else
+			{
+				hp[ 2 ] = hw1;
+				hp[ 3 ] = hp[ 1 ];
+				hp[ 0 ] = sw1;
+				hp[ 1 ] = base + ipo;
+			}
+		}
+
+		rc = LZAV_REF_MIN + lzav_match_len( ip + LZAV_REF_MIN,
+			wp + LZAV_REF_MIN, ml - LZAV_REF_MIN );
+
+		lc = ip - ipa;
+
+		if( LZAV_UNLIKELY( lc != 0 ))
+		{
+			ml -= rc;
+			size_t bmc = ( lc > 16 ? 16 : lc );
+
+			if( LZAV_LIKELY( ml > bmc ))
+			{
+				ml = bmc;
+			}
+
+			bmc = lzav_match_len_r( ip, wp, ml );
+
+			if( LZAV_UNLIKELY( bmc != 0 ))
+			{
+				rc += bmc;
+				ip -= bmc;
+				lc -= bmc;
+			}
+		}
+
+		op = lzav_write_blk_2( op, lc, rc, d, ipa, &cbp, &csh, LZAV_REF_MIN );
+		ip += rc;
+		ipa = ip;
+		mavg += ( (intptr_t) ( rc << 21 ) - mavg ) >> 10;
+		continue;
+
+	_no_match:
+		hp[ 2 ] = sw1;
+		hp[ 3 ] = base + ipo;
+
+		mavg -= mavg >> 11;
+
+		if( mavg < ( 200 << 14 ) && ip != ipa ) // Speed-up threshold.
+		{
+			ip += 1 + rndb;
+			rndb = ipo & 1;
+
+			if( LZAV_UNLIKELY( mavg < ( 130 << 14 )))
+			{
+				ip++;
+
+				if( LZAV_UNLIKELY( mavg < ( 100 << 14 )))
+				{
+					ip += 100 - ( mavg >> 14 );
+				}
+			}
+		}
+
+		ip++;
+	}
+
+	return( (int) ( lzav_write_fin_2( op, ipe - ipa + LZAV_LIT_FIN, ipa ) -
+		(uint8_t*) dst ));
+}
+
+/**
+ * @brief Scatter-gather LZAV compression function.
+ *
+ * Function compresses data stored in several segments (e.g., a message
+ * header and body fragments) as a single logical source, without gathering
+ * it into a contiguous buffer. References may span segment boundaries. The
+ * produced data is a regular "raw" LZAV compressed stream which can be
+ * decompressed with the lzav_decompress() or lzav_decompress_iov()
+ * functions.
+ *
+ * The function runs the lzav_compress_2c() compressor, with segment
+ * tracking compiled in. See the lzav_compress() function for a more detailed
+ * description.
+ *
+ * @param[in] iov Source segments. Segments of zero length are allowed.
+ * @param iovcnt The number of source segments.
+ * @param[out] dst Destination (compressed data) buffer pointer. The allocated
+ * size should be at least lzav_compress_bound() bytes large, for the total
+ * length of segments. Should not overlap the source segments.
+ * @param dstl Destination buffer's capacity, in bytes.
+ * @param ext_buf External buffer to use for hash-table, can be 0. See
+ * lzav_compress().
+ * @param ext_bufl The capacity of the `ext_buf`, in bytes.
+ * @param al Allocator of the hash-table and of the segment offsets, 0 - the
+ * global allocator.
+ * @return The length of compressed data, in bytes. Returns 0 if the total
+ * length of segments is 0 or exceeds 2 GiB, or if `dstl` is too small, or if
+ * buffer pointers are invalid, or if not enough memory.
+ */
+
+static inline int lzav_compress_iov_al( const lzav_iovec* const iov,
+	const int iovcnt, void* const dst, const int dstl, void* const ext_buf,
+	const int ext_bufl, const lzav_alloc* const al )
+{
+	if(( iovcnt <= 0 ) | ( iov == 0 ) | ( dst == 0 ))
+	{
+		return( 0 );
+	}
+
+	if( iovcnt == 1 )
+	{
+		if( iov[ 0 ].iov_len > 0x7FFFFFFF )
+		{
+			return( 0 );
+		}
+
+		return( lzav_compress_al( iov[ 0 ].iov_base, dst,
+			(int) iov[ 0 ].iov_len, dstl, ext_buf, ext_bufl, al ));
+	}
+
+	size_t stack_cum[ 33 ]; // Cumulative offsets for up to 32 segments.
+	size_t* cum = stack_cum;
+	const size_t cuml = ( (size_t) iovcnt + 1 ) * sizeof( size_t );
+	int i;
+
+	if( iovcnt > 32 )
+	{
+		cum = (size_t*) lzav_malloc( al, cuml );
+
+		if( cum == 0 )
+		{
+			return( 0 );
+		}
+	}
+
+	cum[ 0 ] = 0;
+
+	for( i = 0; i < iovcnt; i++ )
+	{
+		cum[ i + 1 ] = cum[ i ] + iov[ i ].iov_len;
+
+		if( iov[ i ].iov_len > 0x7FFFFFFF || cum[ i + 1 ] > 0x7FFFFFFF ||
+			( iov[ i ].iov_base == 0 && iov[ i ].iov_len != 0 ))
+		{
+			cum[ iovcnt ] = 0;
+			break;
+		}
+	}
+
+	const int srcl = (int) cum[ iovcnt ];
+	int r;
+
+	if( srcl <= 4096 )
+	{
+		// Gathering a short source on stack is faster than segment
+		// tracking.
+
+		uint8_t sb[ 4096 ];
+		lzav_iov_copy( sb, iov, cum, 0, 0, (size_t) srcl );
+
+		r = lzav_compress_al( sb, dst, srcl, dstl, 0, 0, al );
+	}
+	else
+	{
+		r = lzav_compress_2c( 0, dst, srcl, dstl, ext_buf, ext_bufl, al, 0,
+			0, 1, iov, cum );
+	}
+
+	if( cum != stack_cum )
+	{
+		lzav_free( al, cum, cuml );
+	}
+
+	return( r );
+}
+
+/**
+ * @brief Scatter-gather LZAV compression function, with the global
+ * allocator.
+ *
+ * See the lzav_compress_iov_al() function for a detailed description.
+ */
+
+static inline int lzav_compress_iov( const lzav_iovec* const iov,
+	const int iovcnt, void* const dst, const int dstl, void* const ext_buf,
+	const int ext_bufl )
+{
+	return( lzav_compress_iov_al( iov, iovcnt, dst, dstl, ext_buf, ext_bufl,
+		0 ));
+}
+
+/**
+ * @brief Higher-ratio LZAV compression function (much slower).
+ *
+ * Function performs in-memory data compression using the higher-ratio LZAV
+ * compression algorithm.
+ *
+ * @param[in] src Source (uncompressed) data pointer.
+ * @param[out] dst Destination (compressed data) buffer pointer. The allocated
+ * size should be at least lzav_compress_bound_hi() bytes large.
+ * @param srcl Source data length, in bytes.
+ * @param dstl Destination buffer's capacity, in bytes.
+ * @param al Allocator of the hash-table, 0 - the global allocator.
+ * @param win_log log2 of LZ77 window length, 0 - the full window, see
+ * lzav_compress_win(). A value greater than `LZAV_WIN_LOG` (up to
+ * `LZAV_WIN_LOG_MAX`) selects a large window: if `srcl` exceeds
+ * `LZAV_WIN_LEN`, the large-window stream format 3 is produced, which
+ * references data up to 2^`win_log` bytes back, and uses an up to 32 times
+ * larger hash-table (up to 256 MiB, 4 times `srcl`). Stream format 3 is
+ * decompressed by lzav_decompress(), lzav_decompress_tab(),
+ * lzav_decompress_batch() and lzav_decompress_partial() only.
+ * @param fd 1 - optimize the parse for decompression speed, see
+ * lzav_compress_hi_fd(); 0 - for compression ratio.
+ * @return The length of compressed data, in bytes. Returns 0 if `srcl` is
+ * lesser or equal to 0, or if `dstl` is too small, or if buffer pointers are
+ * invalid, or if not enough memory.
+ */
+
+static inline int lzav_compress_hi_2( const void* const src,
+	void* const dst, const int srcl, const int dstl,
+	const lzav_alloc* const al, const int win_log, const int fd )
+{
+	if(( srcl <= 0 ) | ( src == 0 ) | ( dst == 0 ) | ( src == dst ) |
+		( dstl < lzav_compress_bound_hi( srcl )))
+	{
+		return( 0 );
+	}
+
+	const size_t mref = 5; // Minimal reference length.
+	const size_t mlen = LZAV_REF_LEN - LZAV_REF_MIN + mref;
+	const int lw = ( win_log > LZAV_WIN_LOG ) & ( srcl > LZAV_WIN_LEN );
+
+	// Decoder cost model, in compressed byte equivalents: a block's cost, a
+	// far reference's (likely cache miss) cost, and reference length
+	// increase over `mref`; all zero if the compression ratio is optimized.
+
+	const size_t fdb = ( fd != 0 ? LZAV_FD_BLK : 0 );
+	const size_t fdf = ( fd != 0 ? LZAV_FD_FAR : 0 );
+	const size_t fdr = ( fd != 0 ? LZAV_FD_REF : 0 );
+	const int fmt = ( lw ? LZAV_FMT_LW : LZAV_FMT_CUR ); // Stream format.
+
+	uint8_t* op = (uint8_t*) dst; // Destination (compressed data) pointer.
+	*op = (uint8_t) ( fmt << 4 | mref ); // Write prefix byte.
+	op++;
+
+	if( srcl < 16 )
+	{
+		// Handle a very short source data.
+
+		*op = (uint8_t) srcl;
+		op++;
+
+		memcpy( op, src, srcl );
+
+		if( srcl > LZAV_LIT_FIN - 1 )
+		{
+			return( 2 + srcl );
+		}
+
+		memset( op + srcl, 0, LZAV_LIT_FIN - srcl );
+		return( 2 + LZAV_LIT_FIN );
+	}
+
+	size_t htsize; // Hash-table's size in bytes (power-of-2).
+	htsize = ( 1 << 7 ) * sizeof( uint32_t ) * 2 * 8;
+	const size_t htmax = (size_t) 1 << ( !lw ? 23 :
+		( win_log > 25 ? 28 : win_log + 3 )); // Max hash-table's size.
+
+	while( htsize != htmax && ( htsize >> 2 ) < (size_t) srcl )
+	{
+		htsize <<= 1;
+	}
+
+	uint8_t* ht = (uint8_t*) lzav_malloc( al, htsize ); // Hash-table pointer.
+
+	if( ht == 0 )
+	{
+		return( 0 );
+	}
+
+	const uint32_t hmask = (uint32_t) (( htsize - 1 ) ^ 63 ); // Hash mask.
+	const size_t wmax = ( lw ? ( (size_t) 1 << ( win_log > LZAV_WIN_LOG_MAX ?
+		LZAV_WIN_LOG_MAX : win_log )) - 1 :
+		lzav_win_max( win_log )); // Max reference offset.
+	const uint8_t* ip = (const uint8_t*) src; // Source data pointer.
+	const uint8_t* const ipe = ip + srcl - LZAV_LIT_FIN; // End pointer.
+	const uint8_t* const ipet = ipe - 9; // Hashing threshold, avoids I/O OOB.
+	const uint8_t* ipa = ip; // Literals anchor pointer.
+
+	uint8_t* cbp = op; // Pointer to the latest offset carry block header.
+	int csh = 0; // Offset carry shift.
+
+	// Initialize the hash-table. Each hash-table item consists of 8 tuples
+	// (4 initial match bytes; 32-bit source data offset). The last value of
+	// the last tuple is used as head tuple offset (an even value).
+
+	uint32_t initv[ 2 ] = { 0, 0 };
+	memcpy( initv, ip, 4 );
+
+	uint32_t* ht32 = (uint32_t*) ht;
+	uint32_t* const ht32e = (uint32_t*) ( ht + htsize );
+
+	while( ht32 != ht32e )
+	{
+		ht32[ 0 ] = initv[ 0 ];
+		ht32[ 1 ] = initv[ 1 ];
+		ht32 += 2;
+	}
+
+	size_t prc = 0; // Length of a previously found match.
+	size_t pd = 0; // Distance of a previously found match.
+	const uint8_t* pip = ip; // Source pointer of a previously found match.
+
+	while( LZAV_LIKELY( ip < ipet ))
+	{
+		// Hash source data (endianness is unimportant for compression
+		// efficiency). Hash is based on the "komihash" math construct, see
+		// https://github.com/avaneev/komihash for details.
+
+		uint32_t iw1;
+		memcpy( &iw1, ip, 4 );
+		const uint64_t hm = (uint64_t) ( 0x243F6A88 ^ iw1 ) *
+			(uint32_t) ( 0x85A308D3 ^ ip[ 4 ]);
+
+		const uint32_t hval = (uint32_t) hm ^ (uint32_t) ( hm >> 32 );
+
+		// Hash-table access.
+
+		uint32_t* const hp = (uint32_t*) ( ht + ( hval & hmask ));
+		const uint32_t ipo = (uint32_t) ( ip - (const uint8_t*) src );
+		size_t ti0 = hp[ 15 ]; // Head tuple offset.
+
+		// Find source data in hash-table tuples, in up to 7 previous
+		// positions.
+
+		const uint8_t* wp = ip; // Best found window pointer.
+		size_t rc = 0; // Best found match length, 0 - not found.
+		size_t d; // Reference offset (distance).
+		size_t ti = ti0;
+		int i;
+
+		if( LZAV_LIKELY( ip + mlen < ipe ))
+		{
+			// Optimized match-finding.
+
+			for( i = 0; i < 7; i++ )
+			{
+				const uint32_t ww1 = hp[ ti ];
+				const uint8_t* const wp0 = (const uint8_t*) src + hp[ ti + 1 ];
+				d = ip - wp0;
+				ti = ( ti == 12 ? 0 : ti + 2 );
+
+				if(( iw1 == ww1 ) & ( d <= wmax ))
+				{
+					const size_t rc0 = 4 + lzav_match_len( ip + 4, wp0 + 4,
+						( d > mlen ? mlen : d ) - 4 );
+
+					if( rc0 > rc + ( d > ( 1 << 18 )) +
+						( d > LZAV_WIN_LEN - 1 ))
+					{
+						wp = wp0;
+						rc = rc0;
+					}
+				}
+			}
+		}
+		else
+		{
+			for( i = 0; i < 7; i++ )
+			{
+				const uint32_t ww1 = hp[ ti ];
+				const uint8_t* const wp0 = (const uint8_t*) src + hp[ ti + 1 ];
+				d = ip - wp0;
+				ti = ( ti == 12 ? 0 : ti + 2 );
+
+				if(( iw1 == ww1 ) & ( d <= wmax ))
+				{
+					// Disallow reference copy overlap by using `d` as max
+					// match length.
+
+					size_t ml = ( d > mlen ? mlen : d );
+
+					if( LZAV_UNLIKELY( ip + ml > ipe ))
+					{
+						// Make sure `LZAV_LIT_FIN` literals remain on finish.
+
+						ml = ipe - ip;
+					}
+
+					const size_t rc0 = 4 + lzav_match_len( ip + 4, wp0 + 4,
+						ml - 4 );
+
+					if( rc0 > rc + ( d > ( 1 << 18 )) +
+						( d > LZAV_WIN_LEN - 1 ))
+					{
+						wp = wp0;
+						rc = rc0;
+					}
+				}
+			}
+		}
+
+		d = ip - wp;
+
+		if(( rc == 0 ) | ( d > 273 ))
+		{
+			// Update a matching entry which is not inside max reference
+			// length's range. Otherwise, source data consisting of same-byte
+			// runs won't compress well.
+
+			ti0 = ( ti0 == 0 ? 12 : ti0 - 2 );
+			hp[ ti0 ] = iw1;
+			hp[ ti0 + 1 ] = ipo;
+			hp[ 15 ] = (uint32_t) ti0;
+		}
+
+		if(( rc < mref + fdr + ( d > ( 1 << 18 )) + ( d > LZAV_WIN_LEN - 1 ) +
+			( d >= LZAV_PF_DIST ) * fdf ) | ( d < 8 ) | ( d > wmax ))
+		{
+			ip++;
+			continue;
+		}
+
+		// Source data and hash-table entry match of suitable length.
+
+		const uint8_t* const ip0 = ip;
+		size_t lc = ip - ipa;
+
+		if( LZAV_UNLIKELY( lc != 0 ))
+		{
+			// Try to consume literals by finding a match at back-position.
+
+			size_t ml = ( d > mlen ? mlen : d );
+
+			if( LZAV_UNLIKELY( ip + ml > ipe ))
+			{
+				ml = ipe - ip;
+			}
+
+			ml -= rc;
+			const size_t wpo = wp - (const uint8_t*) src;
+
+			if( LZAV_LIKELY( ml > lc ))
+			{
+				ml = lc;
+			}
+
+			if( LZAV_UNLIKELY( ml > wpo ))
+			{
+				ml = wpo;
+			}
+
+			const size_t bmc = lzav_match_len_r( ip, wp, ml );
+
+			if( LZAV_UNLIKELY( bmc != 0 ))
+			{
+				rc += bmc;
+				ip -= bmc;
+				lc -= bmc;
+			}
+		}
+
+		if( prc == 0 )
+		{
+			// Save match for a later comparison.
+
+			prc = rc;
+			pd = d;
+			pip = ip;
+			ip = ip0 + 1;
+			continue;
+		}
+
+		// Block size overhead estimation, and comparison with a previously
+		// found match.
+
+		const int lb = ( lc != 0 );
+		const int sh0 = 10 + ( csh != 0 ) * 3;
+		const int sh = sh0 + lb * 2;
+		const size_t ov = lc + lb + ( lc > 15 ) + 2 +
+			( d >= ( (size_t) 1 << sh )) +
+			( d >= ( (size_t) 1 << ( sh + 8 ))) +
+			( d >= ( (size_t) 1 << ( sh + 13 ))) +
+			( fdb << lb ) + ( d >= LZAV_PF_DIST ) * fdf;
+
+		const size_t plc = pip - ipa;
+		const int plb = ( plc != 0 );
+		const int psh = sh0 + plb * 2;
+		const size_t pov = plc + plb + ( plc > 15 ) + 2 +
+			( pd >= ( (size_t) 1 << psh )) +
+			( pd >= ( (size_t) 1 << ( psh + 8 ))) +
+			( pd >= ( (size_t) 1 << ( psh + 13 ))) +
+			( fdb << plb ) + ( pd >= LZAV_PF_DIST ) * fdf;
+
+		if( LZAV_LIKELY( prc * ov > rc * pov ))
+		{
+			if( LZAV_UNLIKELY( pip + prc <= ip ))
+			{
+				// A winning previous match does not overlap a current match.
+
+				op = lzav_write_blk( op, plc, prc, pd, ipa, &cbp, &csh,
+					mref, lw );
+
+				ipa = pip + prc;
+				prc = rc;
+				pd = d;
+				pip = ip;
+				ip++;
+				continue;
+			}
+
+			rc = prc;
+			d = pd;
+			ip = pip;
+			lc = plc;
+		}
+
+		op = lzav_write_blk( op, lc, rc, d, ipa, &cbp, &csh, mref, lw );
+		ip += rc;
+		ipa = ip;
+		prc = 0;
+	}
+
+	if( prc != 0 )
+	{
+		op = lzav_write_blk( op, pip - ipa, prc, pd, ipa, &cbp, &csh,
+			mref, lw );
+
+		ipa = pip + prc;
+	}
+
+	lzav_free( al, ht, htsize );
+
+	return( (int) ( lzav_write_fin_2( op, ipe - ipa + LZAV_LIT_FIN, ipa ) -
+		(uint8_t*) dst ));
+}
+
+/**
+ * @brief Higher-ratio LZAV compression function, with window length option.
+ *
+ * See the lzav_compress_hi_2() function for a detailed description.
+ */
+
+static inline int lzav_compress_hi_win( const void* const src,
+	void* const dst, const int srcl, const int dstl,
+	const lzav_alloc* const al, const int win_log )
+{
+	return( lzav_compress_hi_2( src, dst, srcl, dstl, al, win_log, 0 ));
+}
+
+/**
+ * @brief Higher-ratio LZAV compression function, with the parse optimized
+ * for decompression speed.
+ *
+ * Function is meant for data that is compressed once, and decompressed many
+ * times. The compressor's match selection adds estimated decoding costs to
+ * the compressed length: each block's cost, and the cost of a reference
+ * with an offset of `LZAV_PF_DIST` bytes or larger (likely a cache miss on
+ * decompression), and it does not use references shorter than
+ * `LZAV_FD_REF` + 5 bytes. This produces fewer, longer blocks, and fewer
+ * far references, at the expense of compression ratio. The stream format is
+ * unchanged.
+ *
+ * See the lzav_compress_hi_2() function for a detailed description of
+ * parameters.
+ */
+
+static inline int lzav_compress_hi_fd( const void* const src,
+	void* const dst, const int srcl, const int dstl,
+	const lzav_alloc* const al, const int win_log )
+{
+	return( lzav_compress_hi_2( src, dst, srcl, dstl, al, win_log, 1 ));
+}
+
+/**
+ * @brief Higher-ratio LZAV compression function, with the full window.
+ *
+ * See the lzav_compress_hi_win() function for a detailed description.
+ */
+
+static inline int lzav_compress_hi_al( const void* const src,
+	void* const dst, const int srcl, const int dstl,
+	const lzav_alloc* const al )
+{
+	return( lzav_compress_hi_win( src, dst, srcl, dstl, al, 0 ));
+}
+
+/**
+ * @brief Higher-ratio LZAV compression function, with the global allocator.
+ *
+ * See the lzav_compress_hi_win() function for a detailed description.
+ */
+
+static inline int lzav_compress_hi( const void* const src, void* const dst,
+	const int srcl, const int dstl )
+{
+	return( lzav_compress_hi_al( src, dst, srcl, dstl, 0 ));
+}
+
+/**
+ * @brief Internal LZAV decompression function (stream formats 2 and 3).
+ *
+ * Function decompresses "raw" data previously compressed into the LZAV stream
+ * format 2, or into the large-window stream format 3.
+ *
+ * This function should not be called directly since it does not check the
+ * format identifier.
+ *
+ * @param[in] src Source (compressed) data pointer.
+ * @param[out] dst Destination (decompressed data) buffer pointer.
+ * @param srcl Source data length, in bytes.
+ * @param dstl Expected destination data length, in bytes.
+ * @param[out] pwl Pointer to variable that receives the number of bytes
+ * written to the destination buffer (until error or end of buffer).
+ * @return The length of decompressed data, in bytes, or any negative value if
+ * some error happened.
+ */
+
+static inline int lzav_decompress_2( const void* const src, void* const dst,
+	const int srcl, const int dstl, int* const pwl )
+{
+	const uint8_t* ip = (const uint8_t*) src; // Compressed data pointer.
+	const uint8_t* const ipe = ip + srcl; // Compressed data boundary pointer.
+	const uint8_t* const ipet = ipe - 6; // Block header read threshold.
+	uint8_t* op = (uint8_t*) dst; // Destination (decompressed data) pointer.
+	uint8_t* const ope = op + dstl; // Destination boundary pointer.
+	uint8_t* const opet = ope - 63; // Threshold for fast copy to destination.
+	*pwl = dstl;
+	const size_t mref1 = ( *ip & 15 ) - 1; // Minimal reference length - 1.
+	const size_t lwt = ( *ip >> 4 == LZAV_FMT_LW ? 3 : 4 ); // Extended type.
+	size_t bh = 0; // Current block header, updated in each branch.
+	size_t cv = 0; // Reference offset carry value.
+	int csh = 0; // Reference offset carry shift.
+
+	#define LZAV_LOAD16( a ) \
+		uint16_t bv; \
+		memcpy( &bv, a, 2 ); \
+		LZAV_IEC16( bv );
+
+	#define LZAV_LOAD32( a ) \
+		uint32_t bv; \
+		memcpy( &bv, a, 4 ); \
+		LZAV_IEC32( bv );
+
+	#define LZAV_MEMMOVE( d, s, c ) \
+		{ uint8_t tmp[ c ]; memcpy( tmp, s, c ); memcpy( d, tmp, c ); }
+
+	#define LZAV_SET_IPD_CV( x, v, sh ) \
+		const size_t d = ( x ) << csh | cv; \
+		ipd = op - d; \
+		if( LZAV_UNLIKELY( (uint8_t*) dst + d > op )) \
+			goto _err_refoob; \
+		csh = ( sh ); \
+		cv = ( v );
+
+	#define LZAV_SET_IPD( x ) \
+		LZAV_SET_IPD_CV( x, 0, 0 )
+
+	ip++; // Advance beyond prefix byte.
+
+	if( LZAV_UNLIKELY( ip >= ipet ))
+	{
+		goto _err_srcoob;
+	}
+
+	bh = *ip;
+
+	while( LZAV_LIKELY( ip < ipet ))
+	{
+		const uint8_t* ipd; // Source data pointer.
+		size_t cc; // Byte copy count.
+		size_t bt; // Block type.
+
+		if( LZAV_UNLIKELY(( bh & 0x30 ) == 0 )) // Block type 0.
+		{
+			size_t ncv = bh >> 6;
+			ip++;
+			cc = bh & 15;
+
+			if( LZAV_LIKELY( cc != 0 )) // True, if no additional length byte.
+			{
+				ipd = ip;
+				ncv <<= csh;
+				ip += cc;
+
+				if( LZAV_LIKELY(( op < opet ) & ( ipd < ipe - 15 - 7 )))
+				{
+					cv |= ncv;
+					csh += 2;
+					bh = *ip;
+					memcpy( op, ipd, 16 );
+					op += cc;
+					goto _refblk; // Reference block follows, if not EOS.
+				}
+			}
+			else
+			{
+				size_t lcw = *ip;
+				ncv <<= csh;
+				ip++;
+				cc = lcw & 0x7F;
+				int sh = 7;
+
+				while(( lcw & 0x80 ) != 0 )
+				{
+					lcw = *ip;
+					ip++;
+					cc |= ( lcw & 0x7F ) << sh;
+
+					if( sh == 28 ) // No more than 4 additional bytes.
+					{
+						break;
+					}
+
+					sh += 7;
+				}
+
+				cc += 16;
+				ipd = ip;
+				ip += cc;
+
+				if( LZAV_LIKELY(( op < opet ) & ( ipd < ipe - 63 - 16 )))
+				{
+					memcpy( op, ipd, 16 );
+					memcpy( op + 16, ipd + 16, 16 );
+					memcpy( op + 32, ipd + 32, 16 );
+					memcpy( op + 48, ipd + 48, 16 );
+
+					if( LZAV_LIKELY( cc < 65 ))
+					{
+						cv |= ncv;
+						csh += 2;
+						bh = *ip;
+						op += cc;
+						goto _refblk; // Reference block follows, if not EOS.
+					}
+
+					ipd += 64;
+					op += 64;
+					cc -= 64;
+				}
+			}
+
+			cv |= ncv;
+			csh += 2;
+
+			if( LZAV_LIKELY( ip < ipe ))
+			{
+				bh = *ip;
+			}
+			else
+			if( LZAV_UNLIKELY( ip != ipe ))
+			{
+				goto _err_srcoob_lit;
+			}
+
+			if( LZAV_UNLIKELY( op + cc > ope ))
+			{
+				goto _err_dstoob_lit;
+			}
+
+			// This and other alike copy-blocks are transformed into fast SIMD
+			// instructions, by a modern compiler. Direct use of `memcpy` is
+			// slower due to shortness of data remaining to copy, on average.
+
+			while( cc != 0 )
+			{
+				*op = *ipd;
+				ipd++;
+				op++;
+				cc--;
+			}
+
+			continue;
+
+		_err_srcoob_lit:
+			cc = ipe - ipd;
+
+			if( op + cc < ope )
+			{
+				memcpy( op, ipd, cc );
+				*pwl = (int) ( op + cc - (uint8_t*) dst );
+			}
+			else
+			{
+				memcpy( op, ipd, ope - op );
+			}
+
+			return( LZAV_E_SRCOOB );
+
+		_err_dstoob_lit:
+			memcpy( op, ipd, ope - op );
+			return( LZAV_E_DSTOOB );
+		}
+
+	_refblk:
+		bt = ( bh >> 4 ) & 3;
+		ip++;
+		const int bt8 = (int) ( bt << 3 );
+
+		LZAV_LOAD32( ip );
+		const uint32_t om = (uint32_t) (( 1 << bt8 ) - 1 );
+		ip += bt;
+		const size_t o = bv & om;
+		bv >>= bt8;
+
+		if( LZAV_UNLIKELY( bt == lwt ))
+		{
+			// Stream format 3's block type 3: 2 carry bits, and an optional
+			// extended offset byte.
+
+			size_t x = bh >> 6 | ( o & 0x1FFFFF ) << 2;
+
+			if(( o & 0x200000 ) != 0 )
+			{
+				if( LZAV_UNLIKELY( ip > ipe - 4 ))
+				{
+					goto _err_srcoob;
+				}
+
+				x |= (size_t) ( bv & 0xFF ) << 23;
+				ip++;
+				bv = *ip;
+			}
+
+			LZAV_SET_IPD_CV( x, o >> 22, 2 );
+		}
+		else
+		{
+			static const int ocsh[ 4 ] = { 0, 0, 0, 3 };
+			const int wcsh = ocsh[ bt ];
+
+			LZAV_SET_IPD_CV( bh >> 6 | ( o & 0x1FFFFF ) << 2, o >> 21,
+				wcsh );
+		}
+
+		cc = bh & 15;
+
+		if( LZAV_LIKELY( cc != 0 )) // True, if no additional length byte.
+		{
+			bh = bv & 0xFF;
+			cc += mref1;
+
+			if( LZAV_LIKELY( op < opet ))
+			{
+				LZAV_MEMMOVE( op, ipd, 16 );
+				LZAV_MEMMOVE( op + 16, ipd + 16, 4 );
+
+				op += cc;
+				continue;
+			}
+		}
+		else
+		{
+			bh = bv & 0xFF;
+
+			if( LZAV_UNLIKELY( bh == 255 ))
+			{
+				cc = 16 + mref1 + 255 + ip[ 1 ];
+				bh = ip[ 2 ];
+				ip += 2;
+			}
+			else
+			{
+				cc = 16 + mref1 + bh;
+				ip++;
+				bh = *ip;
+			}
+
+			if( LZAV_LIKELY( op < opet ))
+			{
+				LZAV_MEMMOVE( op, ipd, 16 );
+				LZAV_MEMMOVE( op + 16, ipd + 16, 16 );
+				LZAV_MEMMOVE( op + 32, ipd + 32, 16 );
+				LZAV_MEMMOVE( op + 48, ipd + 48, 16 );
+
+				if( LZAV_LIKELY( cc < 65 ))
+				{
+					op += cc;
+					continue;
+				}
+
+				ipd += 64;
+				op += 64;
+				cc -= 64;
+			}
+		}
+
+		if( LZAV_UNLIKELY( op + cc > ope ))
+		{
+			goto _err_dstoob_ref;
+		}
+
+		while( cc != 0 )
+		{
+			*op = *ipd;
+			ipd++;
+			op++;
+			cc--;
+		}
+
+		continue;
+
+	_err_dstoob_ref:
+		memmove( op, ipd, ope - op );
+		return( LZAV_E_DSTOOB );
+	}
+
+	if( LZAV_UNLIKELY( op != ope ))
+	{
+		goto _err_dstlen;
+	}
+
+	return( (int) ( op - (uint8_t*) dst ));
+
+_err_srcoob:
+	*pwl = (int) ( op - (uint8_t*) dst );
+	return( LZAV_E_SRCOOB );
+
+_err_refoob:
+	*pwl = (int) ( op - (uint8_t*) dst );
+	return( LZAV_E_REFOOB );
+
+_err_dstlen:
+	*pwl = (int) ( op - (uint8_t*) dst );
+	return( LZAV_E_DSTLEN );
+}
+
+/**
+ * @def LZAV_HDR_ITEM
+ * @brief Block header lookup table's item, for header byte `h` (stream
+ * format 2).
+ *
+ * Bits 0-4: length (1-16) from the header; bit 5: additional length bytes
+ * follow; bits 6-7: the number of offset bytes (0 - literal block); bits
+ * 8-10: offset carry shift after the block; bits 11-31: offset bytes' mask.
+ */
+
+#define LZAV_HDR_ITEM( h ) ( \
+	((( h ) & 15 ) == 0 ? 16 | 32 : ( h ) & 15 ) | \
+	((( h ) & 0x30 ) << 2 ) | \
+	((( h ) & 0x30 ) == 0x30 ? 3 << 8 : 0 ) | \
+	((( h ) & 0x30 ) == 0x10 ? 0xFFU << 11 : \
+	((( h ) & 0x30 ) == 0x20 ? 0xFFFFU << 11 : \
+	((( h ) & 0x30 ) == 0x30 ? 0x1FFFFFU << 11 : 0 ))))
+
+#define LZAV_HDR_ITEM4( h ) LZAV_HDR_ITEM( h ), LZAV_HDR_ITEM( h + 1 ), \
+	LZAV_HDR_ITEM( h + 2 ), LZAV_HDR_ITEM( h + 3 )
+
+#define LZAV_HDR_ITEM16( h ) LZAV_HDR_ITEM4( h ), LZAV_HDR_ITEM4( h + 4 ), \
+	LZAV_HDR_ITEM4( h + 8 ), LZAV_HDR_ITEM4( h + 12 )
+
+#define LZAV_HDR_ITEM64( h ) LZAV_HDR_ITEM16( h ), \
+	LZAV_HDR_ITEM16( h + 16 ), LZAV_HDR_ITEM16( h + 32 ), \
+	LZAV_HDR_ITEM16( h + 48 )
+
+/**
+ * @brief Internal LZAV table-driven decompression function (stream formats
+ * 2 and 3).
+ *
+ * Function is an alternative to the lzav_decompress_2() function, with the
+ * same interface, and the same results on valid streams. The block's
+ * length, offset length, offset mask and carry shift are read from a
+ * 256-item table indexed by the header byte, and a reference block's
+ * additional length byte is applied without a branch. References of up to
+ * 32 bytes are copied by a single fixed-length copy.
+ *
+ * @param[in] src Source (compressed) data pointer.
+ * @param[out] dst Destination (decompressed data) buffer pointer.
+ * @param srcl Source data length, in bytes.
+ * @param dstl Expected destination data length, in bytes.
+ * @param[out] pwl Pointer to variable that receives the number of bytes
+ * written to the destination buffer (until error or end of buffer).
+ * @return The length of decompressed data, in bytes, or any negative value if
+ * some error happened.
+ */
+
+static inline int lzav_decompress_2t( const void* const src,
+	void* const dst, const int srcl, const int dstl, int* const pwl )
+{
+	static const uint32_t hdrt[ 256 ] = { LZAV_HDR_ITEM64( 0 ),
+		LZAV_HDR_ITEM64( 64 ), LZAV_HDR_ITEM64( 128 ),
+		LZAV_HDR_ITEM64( 192 ) };
+
+	const uint8_t* ip = (const uint8_t*) src; // Compressed data pointer.
+	const uint8_t* const ipe = ip + srcl; // Compressed data boundary pointer.
+	const uint8_t* const ipet = ipe - 6; // Block header read threshold.
+	uint8_t* op = (uint8_t*) dst; // Destination (decompressed data) pointer.
+	uint8_t* const ope = op + dstl; // Destination boundary pointer.
+	uint8_t* const opet = ope - 63; // Threshold for fast copy to destination.
+	*pwl = dstl;
+	const size_t mref1 = ( *ip & 15 ) - 1; // Minimal reference length - 1.
+	const size_t lwt = ( *ip >> 4 == LZAV_FMT_LW ? 3 : 4 ); // Extended type.
+	size_t bh = 0; // Current block header, updated in each branch.
+	size_t cv = 0; // Reference offset carry value.
+	int csh = 0; // Reference offset carry shift.
+
+	ip++; // Advance beyond prefix byte.
+
+	if( LZAV_UNLIKELY( ip >= ipet ))
+	{
+		goto _err_srcoob;
+	}
+
+	bh = *ip;
+
+	while( LZAV_LIKELY( ip < ipet ))
+	{
+		const uint8_t* ipd; // Source data pointer.
+		size_t cc; // Byte copy count.
+		uint32_t tv = hdrt[ bh ]; // Header's table item.
+
+		if( LZAV_UNLIKELY(( tv & 0xC0 ) == 0 )) // Literal block.
+		{
+			const size_t ncv = ( bh >> 6 ) << csh;
+			ip++;
+			cc = tv & 31;
+
+			if( LZAV_LIKELY(( tv & 32 ) == 0 ))
+			{
+				ipd = ip;
+				ip += cc;
+
+				if( LZAV_LIKELY(( op < opet ) & ( ipd < ipe - 15 - 7 )))
+				{
+					cv |= ncv;
+					csh += 2;
+					bh = *ip;
+					tv = hdrt[ bh ];
+					memcpy( op, ipd, 16 );
+					op += cc;
+					goto _refblk; // Reference block follows, if not EOS.
+				}
+			}
+			else
+			{
+				size_t lcw = *ip;
+				ip++;
+				cc = lcw & 0x7F;
+				int sh = 7;
+
+				while(( lcw & 0x80 ) != 0 )
+				{
+					lcw = *ip;
+					ip++;
+					cc |= ( lcw & 0x7F ) << sh;
+
+					if( sh == 28 ) // No more than 4 additional bytes.
+					{
+						break;
+					}
+
+					sh += 7;
+				}
+
+				cc += 16;
+				ipd = ip;
+				ip += cc;
+
+				if( LZAV_LIKELY(( op < opet ) & ( ipd < ipe - 63 - 16 )))
+				{
+					memcpy( op, ipd, 16 );
+					memcpy( op + 16, ipd + 16, 16 );
+					memcpy( op + 32, ipd + 32, 16 );
+					memcpy( op + 48, ipd + 48, 16 );
+
+					if( LZAV_LIKELY( cc < 65 ))
+					{
+						cv |= ncv;
+						csh += 2;
+						bh = *ip;
+						tv = hdrt[ bh ];
+						op += cc;
+						goto _refblk; // Reference block follows, if not EOS.
+					}
+
+					ipd += 64;
+					op += 64;
+					cc -= 64;
+				}
+			}
+
+			cv |= ncv;
+			csh += 2;
+
+			if( LZAV_LIKELY( ip < ipe ))
+			{
+				bh = *ip;
+			}
+			else
+			if( LZAV_UNLIKELY( ip != ipe ))
+			{
+				goto _err_srcoob_lit;
+			}
+
+			if( LZAV_UNLIKELY( op + cc > ope ))
+			{
+				goto _err_dstoob_lit;
+			}
+
+			while( cc != 0 )
+			{
+				*op = *ipd;
+				ipd++;
+				op++;
+				cc--;
+			}
+
+			continue;
+
+		_err_srcoob_lit:
+			cc = ipe - ipd;
+
+			if( op + cc < ope )
+			{
+				memcpy( op, ipd, cc );
+				*pwl = (int) ( op + cc - (uint8_t*) dst );
+			}
+			else
+			{
+				memcpy( op, ipd, ope - op );
+			}
+
+			return( LZAV_E_SRCOOB );
+
+		_err_dstoob_lit:
+			memcpy( op, ipd, ope - op );
+			return( LZAV_E_DSTOOB );
+		}
+
+	_refblk:
+		ip++;
+		const size_t bt = tv >> 6 & 3;
+
+		LZAV_LOAD32( ip );
+		ip += bt;
+
+		if( LZAV_UNLIKELY( bt == lwt ))
+		{
+			// Stream format 3's block type 3, see lzav_decompress_2().
+
+			const size_t o = bv & 0xFFFFFF;
+			size_t x = bh >> 6 | ( o & 0x1FFFFF ) << 2;
+			bv >>= 24;
+
+			if(( o & 0x200000 ) != 0 )
+			{
+				if( LZAV_UNLIKELY( ip > ipe - 4 ))
+				{
+					goto _err_srcoob;
+				}
+
+				x |= (size_t) ( bv & 0xFF ) << 23;
+				ip++;
+				bv = *ip;
+			}
+
+			LZAV_SET_IPD_CV( x, o >> 22, 2 );
+		}
+		else
+		{
+			const int wcsh = (int) ( tv >> 8 & 7 );
+
+			LZAV_SET_IPD_CV( bh >> 6 | ( bv & tv >> 11 ) << 2,
+				bv >> 21 & (( 1U << wcsh ) - 1 ), wcsh );
+
+			bv >>= bt << 3;
+		}
+
+		// A reference block's additional length byte, if present, is added
+		// via a mask; the value 255 requires one more length byte.
+
+		const size_t e = tv >> 5 & 1;
+		cc = ( tv & 31 ) + mref1 + ( bv & ( 0 - e ) & 0xFF );
+
+		if( LZAV_UNLIKELY( cc == 16 + 255 + mref1 ))
+		{
+			cc += ip[ 1 ];
+			bh = ip[ 2 ];
+			ip += 2;
+		}
+		else
+		{
+			ip += e;
+			bh = *ip;
+		}
+
+		if( LZAV_LIKELY( op < opet ))
+		{
+			LZAV_MEMMOVE( op, ipd, 16 );
+			LZAV_MEMMOVE( op + 16, ipd + 16, 16 );
+
+			if( LZAV_LIKELY( cc < 33 ))
+			{
+				op += cc;
+				continue;
+			}
+
+			LZAV_MEMMOVE( op + 32, ipd + 32, 16 );
+			LZAV_MEMMOVE( op + 48, ipd + 48, 16 );
+
+			if( LZAV_LIKELY( cc < 65 ))
+			{
+				op += cc;
+				continue;
+			}
+
+			ipd += 64;
+			op += 64;
+			cc -= 64;
+		}
+
+		if( LZAV_UNLIKELY( op + cc > ope ))
+		{
+			goto _err_dstoob_ref;
+		}
+
+		while( cc != 0 )
+		{
+			*op = *ipd;
+			ipd++;
+			op++;
+			cc--;
+		}
+
+		continue;
+
+	_err_dstoob_ref:
+		memmove( op, ipd, ope - op );
+		return( LZAV_E_DSTOOB );
+	}
+
+	if( LZAV_UNLIKELY( op != ope ))
+	{
+		goto _err_dstlen;
+	}
+
+	return( (int) ( op - (uint8_t*) dst ));
+
+_err_srcoob:
+	*pwl = (int) ( op - (uint8_t*) dst );
+	return( LZAV_E_SRCOOB );
+
+_err_refoob:
+	*pwl = (int) ( op - (uint8_t*) dst );
+	return( LZAV_E_REFOOB );
+
+_err_dstlen:
+	*pwl = (int) ( op - (uint8_t*) dst );
+	return( LZAV_E_DSTLEN );
+}
+
+#undef LZAV_HDR_ITEM
+#undef LZAV_HDR_ITEM4
+#undef LZAV_HDR_ITEM16
+#undef LZAV_HDR_ITEM64
+
+/**
+ * @brief Decoded sequence of the two-phase decoder: a literal run followed
+ * by a reference.
+ */
+
+typedef struct
+{
+	const uint8_t* lp; ///< Literals pointer, in the source data.
+	const uint8_t* rp; ///< Reference pointer, in the destination buffer.
+	uint32_t lc; ///< Literal length, can be 0.
+	uint32_t rc; ///< Reference length, can be 0.
+} lzav_dec_seq;
+
+/**
+ * @brief Internal LZAV two-phase decompression function (stream formats 2
+ * and 3).
+ *
+ * Function is an alternative to the lzav_decompress_2() function. It parses
+ * up to `LZAV_SEQ_BATCH` blocks into an array of sequences, with all
+ * lengths, offsets and bounds validated, and then performs the copies of
+ * the whole batch in a separate loop. The copy loop has no header decoding
+ * dependencies, and the parsing loop has no copying, which reduces branch
+ * mispredictions, and lets the CPU run ahead of reference reads. The
+ * references with offsets of at least `LZAV_PF_DIST` bytes are prefetched
+ * while the batch is parsed.
+ *
+ * On a stream error, the data decoded by the preceding batches remains in
+ * the destination buffer.
+ *
+ * @param[in] src Source (compressed) data pointer.
+ * @param[out] dst Destination (decompressed data) buffer pointer.
+ * @param srcl Source data length, in bytes.
+ * @param dstl Expected destination data length, in bytes.
+ * @return The length of decompressed data, in bytes, or any negative value if
+ * some error happened.
+ */
+
+static inline int lzav_decompress_2s( const void* const src,
+	void* const dst, const int srcl, const int dstl )
+{
+	lzav_dec_seq sq[ LZAV_SEQ_BATCH ];
+
+	const uint8_t* ip = (const uint8_t*) src; // Compressed data pointer.
+	const uint8_t* const ipe = ip + srcl; // Compressed data boundary pointer.
+	const uint8_t* const ipet = ipe - 6; // Block header read threshold.
+	const uint8_t* const iplt = ipe - 15; // Fast literal copy threshold.
+	uint8_t* op = (uint8_t*) dst; // Destination (decompressed data) pointer.
+	uint8_t* const ope = op + dstl; // Destination boundary pointer.
+	uint8_t* const opet = ope - 63; // Threshold for fast copy to destination.
+	uint8_t* pp = op; // Parsed data's destination pointer.
+	const size_t mref1 = ( *ip & 15 ) - 1; // Minimal reference length - 1.
+	const size_t lwt = ( *ip >> 4 == LZAV_FMT_LW ? 3 : 4 ); // Extended type.
+	size_t bh = 0; // Current block header.
+	size_t cv = 0; // Reference offset carry value.
+	int csh = 0; // Reference offset carry shift.
+	int r = 0; // Error code of the parsed batch.
+
+	ip++; // Advance beyond prefix byte.
+
+	if( LZAV_UNLIKELY( ip >= ipet ))
+	{
+		return( LZAV_E_SRCOOB );
+	}
+
+	bh = *ip;
+
+	while( ip < ipet )
+	{
+		lzav_dec_seq* s = sq;
+		lzav_dec_seq* const se = sq + LZAV_SEQ_BATCH;
+
+		// Parsing phase.
+
+		do
+		{
+			size_t cc = 0;
+			s -> lp = ip; // For a reference block without literals.
+
+			if(( bh & 0x30 ) == 0 ) // Literal block.
+			{
+				cv |= ( bh >> 6 ) << csh;
+				csh += 2;
+				ip++;
+				cc = bh & 15;
+
+				if( cc == 0 )
+				{
+					size_t lcw = *ip;
+					ip++;
+					cc = lcw & 0x7F;
+					int sh = 7;
+
+					while(( lcw & 0x80 ) != 0 )
+					{
+						lcw = *ip;
+						ip++;
+						cc |= ( lcw & 0x7F ) << sh;
+
+						if( sh == 28 ) // No more than 4 additional bytes.
+						{
+							break;
+						}
+
+						sh += 7;
+					}
+
+					cc += 16;
+				}
+
+				if( LZAV_UNLIKELY( cc > (size_t) ( ipe - ip )))
+				{
+					r = LZAV_E_SRCOOB;
+					break;
+				}
+
+				if( LZAV_UNLIKELY( cc > (size_t) ( ope - pp )))
+				{
+					r = LZAV_E_DSTOOB;
+					break;
+				}
+
+				s -> lp = ip;
+				ip += cc;
+				pp += cc;
+
+				if( ip >= ipet || ( *ip & 0x30 ) == 0 )
+				{
+					// The last block, or a literal block follows: an empty
+					// reference which copies in-place.
+
+					s -> lc = (uint32_t) cc;
+					s -> rp = pp;
+					s -> rc = 0;
+					s++;
+
+					if( ip < ipet )
+					{
+						bh = *ip;
+					}
+
+					continue;
+				}
+
+				bh = *ip;
+			}
+
+			s -> lc = (uint32_t) cc;
+
+			// Reference block.
+
+			const size_t bt = ( bh >> 4 ) & 3;
+			ip++;
+			const int bt8 = (int) ( bt << 3 );
+
+			LZAV_LOAD32( ip );
+			const uint32_t om = (uint32_t) (( 1 << bt8 ) - 1 );
+			ip += bt;
+			const size_t o = bv & om;
+			bv >>= bt8;
+
+			size_t x = bh >> 6 | ( o & 0x1FFFFF ) << 2;
+			size_t ncv = o >> 21;
+			int ncsh = ( bt == 3 ? 3 : 0 );
+
+			if( LZAV_UNLIKELY( bt == lwt ))
+			{
+				ncv = o >> 22;
+				ncsh = 2;
+
+				if(( o & 0x200000 ) != 0 )
+				{
+					if( LZAV_UNLIKELY( ip > ipe - 4 ))
+					{
+						r = LZAV_E_SRCOOB;
+						break;
+					}
+
+					x |= (size_t) ( bv & 0xFF ) << 23;
+					ip++;
+					bv = *ip;
+				}
+			}
+
+			const size_t d = x << csh | cv;
+			csh = ncsh;
+			cv = ncv;
+
+			if( LZAV_UNLIKELY( d > (size_t) ( pp - (uint8_t*) dst )))
+			{
+				r = LZAV_E_REFOOB;
+				break;
+			}
+
+			cc = bh & 15;
+			bh = bv & 0xFF;
+
+			if( LZAV_LIKELY( cc != 0 ))
+			{
+				cc += mref1;
+			}
+			else
+			if( LZAV_UNLIKELY( bh == 255 ))
+			{
+				cc = 16 + mref1 + 255 + ip[ 1 ];
+				bh = ip[ 2 ];
+				ip += 2;
+			}
+			else
+			{
+				cc = 16 + mref1 + bh;
+				ip++;
+				bh = *ip;
+			}
+
+			if( LZAV_UNLIKELY( cc > (size_t) ( ope - pp )))
+			{
+				r = LZAV_E_DSTOOB;
+				break;
+			}
+
+			s -> rp = pp - d;
+			s -> rc = (uint32_t) cc;
+
+			if( d >= LZAV_PF_DIST )
+			{
+				// A far reference is likely a cache miss: the loads of its
+				// first and last cache lines are started before the batch's
+				// copies.
+
+				LZAV_PREFETCH( s -> rp );
+				LZAV_PREFETCH( s -> rp + cc - 1 );
+			}
+
+			pp += cc;
+			s++;
+
+		} while( s != se && ip < ipet );
+
+		// Copying phase.
+
+		const lzav_dec_seq* sp = sq;
+
+		while( sp != s )
+		{
+			size_t cc = sp -> lc;
+			const uint8_t* ipd = sp -> lp;
+
+			if( LZAV_LIKELY(( cc < 17 ) & ( op < opet ) & ( ipd < iplt )))
+			{
+				memcpy( op, ipd, 16 );
+			}
+			else
+			{
+				memcpy( op, ipd, cc );
+			}
+
+			op += cc;
+			cc = sp -> rc;
+			ipd = sp -> rp;
+			sp++;
+
+			if( LZAV_LIKELY(( cc < 33 ) & ( op < opet )))
+			{
+				LZAV_MEMMOVE( op, ipd, 16 );
+				LZAV_MEMMOVE( op + 16, ipd + 16, 16 );
+				op += cc;
+				continue;
+			}
+
+			if( LZAV_LIKELY( ipd + cc <= op ))
+			{
+				memcpy( op, ipd, cc );
+				op += cc;
+				continue;
+			}
+
+			while( cc != 0 ) // Overlapping copy.
+			{
+				*op = *ipd;
+				ipd++;
+				op++;
+				cc--;
+			}
+		}
+
+		if( LZAV_UNLIKELY( r != 0 ))
+		{
+			return( r );
+		}
+	}
+
+	if( LZAV_UNLIKELY( op != ope ))
+	{
+		return( LZAV_E_DSTLEN );
+	}
+
+	return( (int) ( op - (uint8_t*) dst ));
+}
+
+#if LZAV_FMT_MIN < 2
+
+/**
+ * @brief Internal LZAV decompression function (stream format 1).
+ *
+ * Function decompresses "raw" data previously compressed into the LZAV stream
+ * format 1.
+ *
+ * This function should not be called directly since it does not check the
+ * format identifier.
+ *
+ * @param[in] src Source (compressed) data pointer.
+ * @param[out] dst Destination (decompressed data) buffer pointer.
+ * @param srcl Source data length, in bytes.
+ * @param dstl Expected destination data length, in bytes.
+ * @return The length of decompressed data, in bytes, or any negative value if
+ * some error happened.
+ */
+
+static inline int lzav_decompress_1( const void* const src, void* const dst,
+	const int srcl, const int dstl )
+{
+	const uint8_t* ip = (const uint8_t*) src; // Compressed data pointer.
+	const uint8_t* const ipe = ip + srcl; // Compressed data boundary pointer.
+	const uint8_t* const ipet = ipe - 5; // Block header read threshold.
+	uint8_t* op = (uint8_t*) dst; // Destination (decompressed data) pointer.
+	uint8_t* const ope = op + dstl; // Destination boundary pointer.
+	uint8_t* const opet = ope - 63; // Threshold for fast copy to destination.
+	const size_t mref1 = ( *ip & 15 ) - 1; // Minimal reference length - 1.
+	size_t bh = 0; // Current block header, updated in each branch.
+	size_t cv = 0; // Reference offset carry value.
+	int csh = 0; // Reference offset carry shift.
+
+	ip++; // Advance beyond prefix byte.
+
+	if( LZAV_UNLIKELY( ip >= ipet ))
+	{
+		goto _err_srcoob;
+	}
+
+	bh = *ip;
+
+	while( LZAV_LIKELY( ip < ipet ))
+	{
+		const uint8_t* ipd; // Source data pointer.
+		size_t cc; // Byte copy count.
+
+		if( LZAV_UNLIKELY(( bh & 0x30 ) == 0 )) // Block type 0.
+		{
+			cv = bh >> 6;
+			csh = 2;
+			ip++;
+			cc = bh & 15;
+
+			if( LZAV_LIKELY( cc != 0 )) // True, if no additional length byte.
+			{
+				ipd = ip;
+				ip += cc;
+
+				if( LZAV_LIKELY(( op < opet ) & ( ipd < ipe - 15 - 6 )))
+				{
+					bh = *ip;
+					memcpy( op, ipd, 16 );
+					op += cc;
+					goto _refblk; // Reference block follows, if not EOS.
+				}
+			}
+			else
+			{
+				LZAV_LOAD16( ip );
+
+				const int l2 = bv & 0xFF;
+				cc = 16;
+				ip++;
+				const int lb = ( l2 == 255 );
+				cc += l2 + (( bv >> 8 ) & ( 0x100 - lb ));
+				ip += lb;
+
+				ipd = ip;
+				ip += cc;
+
+				if( LZAV_LIKELY(( op < opet ) & ( ipd < ipe - 63 - 1 )))
+				{
+					memcpy( op, ipd, 16 );
+					memcpy( op + 16, ipd + 16, 16 );
+					memcpy( op + 32, ipd + 32, 16 );
+					memcpy( op + 48, ipd + 48, 16 );
+
+					if( LZAV_LIKELY( cc < 65 ))
+					{
+						bh = *ip;
+						op += cc;
+						continue;
+					}
+
+					ipd += 64;
+					op += 64;
+					cc -= 64;
+				}
+			}
+
+			if( LZAV_LIKELY( ip < ipe ))
+			{
+				bh = *ip;
+			}
+			else
+			if( LZAV_UNLIKELY( ip != ipe ))
+			{
+				goto _err_srcoob;
+			}
+
+			if( LZAV_UNLIKELY( op + cc > ope ))
+			{
+				goto _err_dstoob;
+			}
+
+			// This and other alike copy-blocks are transformed into fast SIMD
+			// instructions, by a modern compiler. Direct use of `memcpy` is
+			// slower due to shortness of data remaining to copy, on average.
+
+			while( cc != 0 )
+			{
+				*op = *ipd;
+				ipd++;
+				op++;
+				cc--;
+			}
+
+			continue;
+		}
+
+	_refblk:
+		cc = bh & 15;
+
+		if( LZAV_UNLIKELY(( bh & 32 ) == 0 )) // True, if block type 1.
+		{
+			LZAV_SET_IPD( bh >> 6 | (size_t) ip[ 1 ] << 2 );
+			ip += 2;
+			bh = *ip;
+		}
+		else // Block type 2 or 3.
+		{
+			if( LZAV_LIKELY(( bh & 16 ) == 0 )) // True, if block type 2.
+			{
+				LZAV_LOAD16( ip + 1 );
+				LZAV_SET_IPD( bh >> 6 | (size_t) bv << 2 );
+				ip += 3;
+				bh = *ip;
+			}
+			else // Block type 3.
+			{
+				LZAV_LOAD32( ip + 1 );
+				LZAV_SET_IPD_CV( bv & 0xFFFFFF, bh >> 6, 2 );
+				ip += 4;
+				bh = bv >> 24;
+			}
+		}
+
+		if( LZAV_LIKELY( cc != 0 )) // True, if no additional length byte.
+		{
+			cc += mref1;
+
+			if( LZAV_LIKELY( op < opet ))
+			{
+				LZAV_MEMMOVE( op, ipd, 16 );
+				LZAV_MEMMOVE( op + 16, ipd + 16, 4 );
+
+				op += cc;
+				continue;
+			}
+		}
+		else
+		{
+			cc = 16 + mref1 + bh;
+			ip++;
+			bh = *ip;
+
+			if( LZAV_LIKELY( op < opet ))
+			{
+				LZAV_MEMMOVE( op, ipd, 16 );
+				LZAV_MEMMOVE( op + 16, ipd + 16, 16 );
+				LZAV_MEMMOVE( op + 32, ipd + 32, 16 );
+				LZAV_MEMMOVE( op + 48, ipd + 48, 16 );
+
+				if( LZAV_LIKELY( cc < 65 ))
+				{
+					op += cc;
+					continue;
+				}
+
+				ipd += 64;
+				op += 64;
+				cc -= 64;
+			}
+		}
+
+		if( LZAV_UNLIKELY( op + cc > ope ))
+		{
+			goto _err_dstoob;
+		}
+
+		while( cc != 0 )
+		{
+			*op = *ipd;
+			ipd++;
+			op++;
+			cc--;
+		}
+	}
+
+	if( LZAV_UNLIKELY( op != ope ))
+	{
+		goto _err_dstlen;
+	}
+
+	return( (int) ( op - (uint8_t*) dst ));
+
+_err_srcoob:
+	return( LZAV_E_SRCOOB );
+
+_err_dstoob:
+	return( LZAV_E_DSTOOB );
+
+_err_refoob:
+	return( LZAV_E_REFOOB );
+
+_err_dstlen:
+	return( LZAV_E_DSTLEN );
+}
+
+#endif // LZAV_FMT_MIN < 2
+
+#undef LZAV_LOAD16
+#undef LZAV_LOAD32
+#undef LZAV_MEMMOVE
+#undef LZAV_SET_IPD_CV
+#undef LZAV_SET_IPD
+
+/**
+ * @brief LZAV decompression function (partial).
+ *
+ * Function decompresses "raw" data previously compressed into the LZAV stream
+ * format, for partial or recovery decompression. For example, this function
+ * can be used to decompress only an initial segment of a larger data block.
+ *
+ * @param[in] src Source (compressed) data pointer, can be 0 if `srcl` is 0.
+ * Address alignment is unimportant.
+ * @param[out] dst Destination (decompressed data) buffer pointer. Address
+ * alignment is unimportant. Should be different to `src`.
+ * @param srcl Source data length, in bytes, can be 0.
+ * @param dstl Destination buffer length, in bytes, can be 0.
+ * @return The length of decompressed data, in bytes. Always a non-negative
+ * value (error codes are not returned).
+ */
+
+static inline int lzav_decompress_partial( const void* const src,
+	void* const dst, const int srcl, const int dstl )
+{
+	if( srcl <= 0 || src == 0 || dst == 0 || src == dst || dstl <= 0 )
+	{
+		return( 0 );
+	}
+
+	const int fmt = *(const uint8_t*) src >> 4;
+	int dl = 0;
+
+	if(( fmt == 2 ) | ( fmt == LZAV_FMT_LW ))
+	{
+		lzav_decompress_2( src, dst, srcl, dstl, &dl );
+	}
+
+	return( dl );
+}
+
+/**
+ * @brief LZAV decompression function.
+ *
+ * Function decompresses "raw" data previously compressed into the LZAV stream
+ * format.
+ *
+ * Note that while the function does perform checks to avoid OOB memory
+ * accesses, and checks for decompressed data length equality, this is not a
+ * strict guarantee of a valid decompression. In cases when the compressed
+ * data is stored in a long-term storage without embedded data integrity
+ * mechanisms (e.g., a database without RAID 1 guarantee, a binary container
+ * without a digital signature nor CRC), then a checksum (hash) of the
+ * original uncompressed data should be stored, and then evaluated against
+ * that of the decompressed data. Also, a separate checksum (hash) of
+ * application-defined header, which contains uncompressed and compressed data
+ * lengths, should be checked before decompression. A high-performance
+ * "komihash" hash function can be used to obtain a hash value of the data.
+ *
+ * @param[in] src Source (compressed) data pointer, can be 0 if `srcl` is 0.
+ * Address alignment is unimportant.
+ * @param[out] dst Destination (decompressed data) buffer pointer. Address
+ * alignment is unimportant. Should be different to `src`.
+ * @param srcl Source data length, in bytes, can be 0.
+ * @param dstl Expected destination data length, in bytes, can be 0. Should
+ * not be confused with the actual size of the destination buffer (which may
+ * be larger).
+ * @return The length of decompressed data, in bytes, or any negative value if
+ * some error happened. Always returns a negative value if the resulting
+ * decompressed data length differs from `dstl`. This means that error result
+ * handling requires just a check for a negative return value (see the
+ * `LZAV_E_` macros for possible values).
+ */
+
+static inline int lzav_decompress( const void* const src, void* const dst,
+	const int srcl, const int dstl )
+{
+	if( srcl < 0 )
+	{
+		return( LZAV_E_PARAMS );
+	}
+
+	if( srcl == 0 )
+	{
+		return( dstl == 0 ? 0 : LZAV_E_PARAMS );
+	}
+
+	if( src == 0 || dst == 0 || src == dst || dstl <= 0 )
+	{
+		return( LZAV_E_PARAMS );
+	}
+
+	const int fmt = *(const uint8_t*) src >> 4;
+
+	if(( fmt == 2 ) | ( fmt == LZAV_FMT_LW ))
+	{
+		int tmp;
+		return( lzav_decompress_2( src, dst, srcl, dstl, &tmp ));
+	}
+
+#if LZAV_FMT_MIN < 2
+	if( fmt == 1 )
+	{
+		return( lzav_decompress_1( src, dst, srcl, dstl ));
+	}
+#endif // LZAV_FMT_MIN < 2
+
+	return( LZAV_E_UNKFMT );
+}
+
+/**
+ * @brief LZAV decompression function, with the table-driven decoder.
+ *
+ * Function is equivalent to the lzav_decompress() function, but uses the
+ * lzav_decompress_2t() decoder which derives block parameters from a lookup
+ * table. Which decoder is faster depends on the CPU and data: the
+ * `lzav -D file` command compares them.
+ *
+ * @param[in] src Source (compressed) data pointer.
+ * @param[out] dst Destination (decompressed data) buffer pointer.
+ * @param srcl Source data length, in bytes.
+ * @param dstl Expected destination data length, in bytes.
+ * @return The length of decompressed data, in bytes, or any negative value if
+ * some error happened.
+ */
+
+static inline int lzav_decompress_tab( const void* const src,
+	void* const dst, const int srcl, const int dstl )
+{
+	if(( srcl <= 0 ) | ( dstl <= 0 ) | ( src == 0 ) | ( dst == 0 ) |
+		( src == dst ))
+	{
+		return( srcl == 0 && dstl == 0 ? 0 : LZAV_E_PARAMS );
+	}
+
+	const int fmt = *(const uint8_t*) src >> 4;
+
+	if(( fmt == 2 ) | ( fmt == LZAV_FMT_LW ))
+	{
+		int tmp;
+		return( lzav_decompress_2t( src, dst, srcl, dstl, &tmp ));
+	}
+
+	return( lzav_decompress( src, dst, srcl, dstl ));
+}
+
+/**
+ * @brief LZAV decompression function, with the two-phase decoder.
+ *
+ * Function is equivalent to the lzav_decompress() function, but uses the
+ * lzav_decompress_2s() decoder which parses a batch of blocks before
+ * copying their data, and prefetches far references. This decoder is
+ * preferable for data with mostly far references, like disk images
+ * compressed with a large window. The `lzav -D file` command compares the
+ * decoders.
+ *
+ * @param[in] src Source (compressed) data pointer.
+ * @param[out] dst Destination (decompressed data) buffer pointer.
+ * @param srcl Source data length, in bytes.
+ * @param dstl Expected destination data length, in bytes.
+ * @return The length of decompressed data, in bytes, or any negative value if
+ * some error happened.
+ */
+
+static inline int lzav_decompress_batch( const void* const src,
+	void* const dst, const int srcl, const int dstl )
+{
+	if(( srcl <= 0 ) | ( dstl <= 0 ) | ( src == 0 ) | ( dst == 0 ) |
+		( src == dst ))
+	{
+		return( srcl == 0 && dstl == 0 ? 0 : LZAV_E_PARAMS );
+	}
+
+	const int fmt = *(const uint8_t*) src >> 4;
+
+	if(( fmt == 2 ) | ( fmt == LZAV_FMT_LW ))
+	{
+		return( lzav_decompress_2s( src, dst, srcl, dstl ));
+	}
+
+	return( lzav_decompress( src, dst, srcl, dstl ));
+}
+
+/**
+ * @brief LZAV fixed-size page decompression function.
+ *
+ * Function decompresses a page previously compressed with
+ * lzav_compress_page() (or with any other compression function of the
+ * current stream format). The function is an alias of lzav_decompress()
+ * limited to the current stream format, and it has no separate fast path:
+ * unlike the compressor, the decompressor has no per-call setup to avoid,
+ * and a constant `pagel` is propagated into the inlined
+ * lzav_decompress_2() in either case. The function performs the same memory
+ * access checks as lzav_decompress().
+ *
+ * @param[in] src Source (compressed) data pointer.
+ * @param[out] dst Destination (decompressed data) buffer pointer, at least
+ * `pagel` bytes large. Should be different to `src`.
+ * @param srcl Source data length, in bytes.
+ * @param pagel Expected page length, in bytes.
+ * @return The length of decompressed data, equal to `pagel`, or any negative
+ * value if some error happened (see the `LZAV_E_` macros).
+ */
+
+static inline int lzav_decompress_page( const void* const src,
+	void* const dst, const int srcl, const int pagel )
+{
+	if(( srcl <= 0 ) | ( pagel <= 0 ) | ( src == 0 ) | ( dst == 0 ) |
+		( src == dst ))
+	{
+		return( LZAV_E_PARAMS );
+	}
+
+	if( *(const uint8_t*) src >> 4 != LZAV_FMT_CUR )
+	{
+		return( LZAV_E_UNKFMT );
+	}
+
+	int tmp;
+	return( lzav_decompress_2( src, dst, srcl, pagel, &tmp ));
+}
+
+#define LZAV_DS_END 0 ///< Stream decompression finished.
+#define LZAV_DS_INPUT 1 ///< More input is required to continue.
+#define LZAV_DS_OUTPUT 2 ///< Output limit reached, call again to continue.
+
+/**
+ * @brief Resumable LZAV stream decompressor's state.
+ *
+ * The decompressor consumes input in chunks of any length, and suspends at
+ * block boundaries, when input is exhausted (a partially-received block
+ * header is kept in the state), or when a requested amount of output was
+ * produced. This allows decompression of data as it arrives from network,
+ * without blocking. Decompressed data is written to a destination buffer
+ * that holds the whole decompressed data, which is needed by LZ77
+ * back-references; the first `wl` bytes of the buffer are final, and can be
+ * consumed by the caller while decompression is in progress.
+ *
+ * Only the current stream format is supported.
+ */
+
+typedef struct
+{
+	uint8_t* dst; ///< Destination buffer.
+	size_t dstl; ///< Expected decompressed data length.
+	size_t wl; ///< The number of bytes written to `dst`.
+	size_t lc; ///< Remaining literal byte count of the current block.
+	size_t cv; ///< Reference offset carry value.
+	int csh; ///< Reference offset carry shift.
+	int mref1; ///< Minimal reference length - 1, -1 before prefix byte.
+	int st; ///< Sticky error code, 0 if none.
+	int hl; ///< The number of bytes in `hb`.
+	uint8_t hb[ 8 ]; ///< Partially-received block header.
+} lzav_dstream;
+
+/**
+ * @brief Function initializes resumable LZAV stream decompressor's state.
+ *
+ * @param[out] ds State to initialize.
+ * @param[out] dst Destination (decompressed data) buffer pointer.
+ * @param dstl Expected decompressed data length, in bytes.
+ */
+
+static inline void lzav_dstream_init( lzav_dstream* const ds,
+	void* const dst, const size_t dstl )
+{
+	ds -> dst = (uint8_t*) dst;
+	ds -> dstl = dstl;
+	ds -> wl = 0;
+	ds -> lc = 0;
+	ds -> cv = 0;
+	ds -> csh = 0;
+	ds -> mref1 = -1;
+	ds -> st = ( dst == 0 || dstl == 0 ? LZAV_E_PARAMS : 0 );
+	ds -> hl = 0;
+}
+
+/**
+ * @brief Internal function returns the length of a block header, in bytes.
+ *
+ * @param h Block header bytes.
+ * @param n The number of available header bytes, at least 1.
+ * @return Block header's length, or 0 if more bytes are needed to obtain it.
+ */
+
+static inline size_t lzav_dstream_hdr_len( const uint8_t* const h,
+	const size_t n )
+{
+	const size_t bh = h[ 0 ];
+
+	if(( bh & 0x30 ) == 0 )
+	{
+		if(( bh & 15 ) != 0 )
+		{
+			return( 1 );
+		}
+
+		size_t i;
+
+		for( i = 1; i < 6; i++ ) // No more than 5 length bytes.
+		{
+			if( n <= i )
+			{
+				return( 0 );
+			}
+
+			if(( h[ i ] & 0x80 ) == 0 )
+			{
+				break;
+			}
+		}
+
+		return( i == 6 ? 6 : i + 1 );
+	}
+
+	const size_t l = 1 + (( bh >> 4 ) & 3 );
+
+	if(( bh & 15 ) != 0 )
+	{
+		return( l );
+	}
+
+	if( n <= l )
+	{
+		return( 0 );
+	}
+
+	return( h[ l ] == 255 ? l + 2 : l + 1 );
+}
+
+/**
+ * @brief Function decodes a whole block header (stream format 2), and
+ * updates the reference offset carry state.
+ *
+ * @param h Block header, lzav_dstream_hdr_len() bytes long.
+ * @param mref1 Minimal reference length - 1.
+ * @param[in,out] pcv Pointer to reference offset carry value.
+ * @param[in,out] pcsh Pointer to reference offset carry shift.
+ * @param[out] pcc Receiver of the literal or reference length.
+ * @return Reference offset, or 0 if this is a literal block (a literal block
+ * has `( h[ 0 ] & 0x30 ) == 0`).
+ */
+
+static inline size_t lzav_dstream_hdr( const uint8_t* h, const size_t mref1,
+	size_t* const pcv, int* const pcsh, size_t* const pcc )
+{
+	const size_t bh = h[ 0 ];
+	size_t cc = bh & 15;
+
+	if(( bh & 0x30 ) == 0 ) // Block type 0.
+	{
+		if( cc == 0 )
+		{
+			int sh = 0;
+			h++;
+
+			do
+			{
+				cc |= ( *h & (size_t) 0x7F ) << sh;
+				sh += 7;
+
+			} while(( *h++ & 0x80 ) != 0 && sh != 35 );
+
+			cc += 16;
+		}
+
+		if( *pcsh < 30 )
+		{
+			*pcv |= ( bh >> 6 ) << *pcsh;
+			*pcsh += 2;
+		}
+
+		*pcc = cc;
+		return( 0 );
+	}
+
+	const size_t bt = ( bh >> 4 ) & 3;
+	size_t o = h[ 1 ];
+
+	if( bt > 1 )
+	{
+		o |= (size_t) h[ 2 ] << 8;
+
+		if( bt > 2 )
+		{
+			o |= (size_t) h[ 3 ] << 16;
+		}
+	}
+
+	const size_t d = ( bh >> 6 | ( o & 0x1FFFFF ) << 2 ) << *pcsh | *pcv;
+	*pcsh = ( bt == 3 ? 3 : 0 );
+	*pcv = o >> 21;
+
+	if( cc != 0 )
+	{
+		cc += mref1;
+	}
+	else
+	{
+		const size_t e = h[ 1 + bt ];
+		cc = 16 + mref1 + e + ( e == 255 ? (size_t) h[ 2 + bt ] : 0 );
+	}
+
+	*pcc = cc;
+
+	return( d );
+}
+
+/**
+ * @brief Internal function consumes the stream's prefix byte, if it was not
+ * consumed yet, and checks the stream format.
+ *
+ * @param ds Decompressor's state.
+ * @param[in,out] pip Pointer to input pointer.
+ * @param ipe Input end pointer.
+ * @return 0, or LZAV_E_UNKFMT.
+ */
+
+static inline int lzav_dstream_fmt( lzav_dstream* const ds,
+	const uint8_t** const pip, const uint8_t* const ipe )
+{
+	const uint8_t* const ip = *pip;
+
+	if( ds -> mref1 < 0 && ip != ipe )
+	{
+		if( *ip >> 4 != LZAV_FMT_CUR || ( *ip & 15 ) == 0 )
+		{
+			return( LZAV_E_UNKFMT );
+		}
+
+		ds -> mref1 = ( *ip & 15 ) - 1;
+		*pip = ip + 1;
+	}
+
+	return( 0 );
+}
+
+/**
+ * @brief Internal function obtains a whole block header: directly from
+ * input if possible, or by accumulating header bytes in the state, across
+ * input chunks.
+ *
+ * @param ds Decompressor's state.
+ * @param[in,out] pip Pointer to input pointer, advanced beyond the header.
+ * @param ipe Input end pointer.
+ * @return Pointer to the block header, or 0 if input was exhausted.
+ */
+
+static inline const uint8_t* lzav_dstream_get_hdr( lzav_dstream* const ds,
+	const uint8_t** const pip, const uint8_t* const ipe )
+{
+	const uint8_t* ip = *pip;
+
+	if( ds -> hl == 0 && ipe - ip >= 6 )
+	{
+		*pip = ip + lzav_dstream_hdr_len( ip, 6 );
+		return( ip );
+	}
+
+	while( 1 )
+	{
+		const size_t hl = ( ds -> hl == 0 ? 0 :
+			lzav_dstream_hdr_len( ds -> hb, ds -> hl ));
+
+		if( hl != 0 && hl <= (size_t) ds -> hl )
+		{
+			break;
+		}
+
+		if( ip == ipe )
+		{
+			*pip = ip;
+			return( 0 );
+		}
+
+		ds -> hb[ ds -> hl ] = *ip;
+		ds -> hl++;
+		ip++;
+	}
+
+	*pip = ip;
+	ds -> hl = 0;
+
+	return( ds -> hb );
+}
+
+/**
+ * @brief Resumable LZAV stream decompression function.
+ *
+ * Function decompresses the next chunk of a compressed data stream,
+ * following the block logic of the lzav_decompress_2() function. The
+ * function can be called repeatedly, with consecutive input chunks of any
+ * length.
+ *
+ * @param ds Initialized decompressor's state.
+ * @param[in] src Input chunk pointer, can be 0 if `srcl` is 0.
+ * @param srcl Input chunk's length, in bytes.
+ * @param[out] pcl Receiver of the number of consumed input bytes. All input
+ * is consumed if LZAV_DS_INPUT is returned.
+ * @param outl Output limit, in bytes: the function returns LZAV_DS_OUTPUT at
+ * a block boundary after at least `outl` bytes were produced by this call.
+ * 0 - no limit.
+ * @return LZAV_DS_END, if all `dstl` bytes were decompressed (the remaining
+ * input is not consumed), LZAV_DS_INPUT, LZAV_DS_OUTPUT, or a negative
+ * `LZAV_E_` error code, which is then returned by all subsequent calls.
+ */
+
+static inline int lzav_dstream_run( lzav_dstream* const ds,
+	const void* const src, const size_t srcl, size_t* const pcl,
+	const size_t outl )
+{
+	const uint8_t* ip = (const uint8_t*) src; // Input pointer.
+	const uint8_t* const ipe = ip + srcl; // Input end pointer.
+	uint8_t* const dst = ds -> dst;
+	const size_t wl0 = ds -> wl;
+	size_t wl = wl0;
+	size_t cv = ds -> cv;
+	int csh = ds -> csh;
+	int r = LZAV_DS_INPUT;
+
+	if( ds -> st != 0 )
+	{
+		*pcl = 0;
+		return( ds -> st );
+	}
+
+	if( lzav_dstream_fmt( ds, &ip, ipe ) != 0 )
+	{
+		r = LZAV_E_UNKFMT;
+		goto _end;
+	}
+
+	while( 1 )
+	{
+		if( ds -> lc != 0 )
+		{
+			// Copy literals of the current block.
+
+			size_t cc = ds -> lc;
+
+			if( cc > (size_t) ( ipe - ip ))
+			{
+				cc = ipe - ip;
+			}
+
+			memcpy( dst + wl, ip, cc );
+			ip += cc;
+			wl += cc;
+			ds -> lc -= cc;
+
+			if( ds -> lc != 0 )
+			{
+				break;
+			}
+		}
+
+		if( wl == ds -> dstl )
+		{
+			r = LZAV_DS_END;
+			break;
+		}
+
+		if( outl != 0 && wl - wl0 >= outl )
+		{
+			r = LZAV_DS_OUTPUT;
+			break;
+		}
+
+		const uint8_t* const h = lzav_dstream_get_hdr( ds, &ip, ipe );
+
+		if( h == 0 )
+		{
+			break;
+		}
+
+		const int blit = (( h[ 0 ] & 0x30 ) == 0 );
+		size_t cc;
+		const size_t d = lzav_dstream_hdr( h, (size_t) ds -> mref1, &cv, &csh,
+			&cc );
+
+		if( blit )
+		{
+			if( cc > ds -> dstl - wl )
+			{
+				r = LZAV_E_DSTOOB;
+				break;
+			}
+
+			ds -> lc = cc;
+			continue;
+		}
+
+		if( d > wl )
+		{
+			r = LZAV_E_REFOOB;
+			break;
+		}
+
+		if( cc > ds -> dstl - wl )
+		{
+			r = LZAV_E_DSTOOB;
+			break;
+		}
+
+		uint8_t* op = dst + wl;
+		const uint8_t* ipd = op - d;
+		wl += cc;
+
+		if( d >= cc )
+		{
+			memcpy( op, ipd, cc );
+		}
+		else
+		{
+			while( cc != 0 )
+			{
+				*op = *ipd;
+				ipd++;
+				op++;
+				cc--;
+			}
+		}
+	}
+
+_end:
+	ds -> wl = wl;
+	ds -> cv = cv;
+	ds -> csh = csh;
+	*pcl = (size_t) ( ip - (const uint8_t*) src );
+
+	if( r < 0 )
+	{
+		ds -> st = r;
+	}
+
+	return( r );
+}
+
+#define LZAV_SINK_CHUNK 65536 ///< Default output chunk length, in bytes.
+
+/**
+ * @brief Output callback of the callback-sink decompressor.
+ *
+ * @param ctx User context pointer.
+ * @param p Decompressed data chunk pointer, valid during the call only.
+ * @param l Chunk's length, in bytes.
+ * @return 0 to continue decompression, any other value aborts it.
+ */
+
+typedef int( *lzav_sink_fn )( void* ctx, const void* p, size_t l );
+
+/**
+ * @brief Callback-sink LZAV stream decompressor's state.
+ *
+ * Decompressed data is delivered to a callback function in chunks of a
+ * fixed length (the last chunk may be shorter), while only the LZ77 window
+ * (LZAV_WIN_LEN bytes) of the preceding output is kept in a window buffer.
+ * This allows a consumer, like a hash function or a parser, to process
+ * decompressed data of any length with a constant amount of memory. Input
+ * is consumed in chunks of any length, like by lzav_dstream_run().
+ *
+ * Only the current stream format is supported.
+ */
+
+typedef struct
+{
+	lzav_dstream ds; ///< Block decoding state, `ds.dst` is the window
+		///< buffer, `ds.wl` is the logical output position.
+	size_t bufl; ///< Window buffer's length.
+	size_t base; ///< Logical output position of the window buffer's start.
+	size_t el; ///< The number of bytes delivered to the callback.
+	size_t cbl; ///< Output chunk length.
+	lzav_sink_fn cb; ///< Output callback.
+	void* ctx; ///< Output callback's context.
+	void* mb; ///< Allocated window buffer, 0 if provided by the caller.
+	lzav_alloc al; ///< Allocator of the window buffer.
+} lzav_dsink;
+
+/**
+ * @brief Function returns the recommended length of the window buffer of
+ * the callback-sink decompressor, which is also the length allocated by
+ * lzav_dsink_init(). It does not exceed `dstl`, and is not larger than
+ * about 2 * LZAV_WIN_LEN + `cbl` for large `dstl`.
+ *
+ * @param dstl Expected decompressed data length, in bytes.
+ * @param cbl Output chunk length, in bytes, 0 - LZAV_SINK_CHUNK.
  */
 
-static inline int lzav_decompress_2( const void* const src, void* const dst,
-	const int srcl, const int dstl, int* const pwl )
+static inline size_t lzav_dsink_buf_len( const size_t dstl, size_t cbl )
 {
-	const uint8_t* ip = (const uint8_t*) src; // Compressed data pointer.
-	const uint8_t* const ipe = ip + srcl; // Compressed data boundary pointer.
-	const uint8_t* const ipet = ipe - 6; // Block header read threshold.
-	uint8_t* op = (uint8_t*) dst; // Destination (decompressed data) pointer.
-	uint8_t* const ope = op + dstl; // Destination boundary pointer.
-	uint8_t* const opet = ope - 63; // Threshold for fast copy to destination.
-	*pwl = dstl;
-	const size_t mref1 = ( *ip & 15 ) - 1; // Minimal reference length - 1.
-	size_t bh = 0; // Current block header, updated in each branch.
-	size_t cv = 0; // Reference offset carry value.
-	int csh = 0; // Reference offset carry shift.
+	cbl = ( cbl == 0 ? LZAV_SINK_CHUNK : cbl );
 
-	#define LZAV_LOAD16( a ) \
-		uint16_t bv; \
-		memcpy( &bv, a, 2 ); \
-		LZAV_IEC16( bv );
+	// Window buffer's length beyond the minimal one reduces the frequency
+	// of window shifts.
 
-	#define LZAV_LOAD32( a ) \
-		uint32_t bv; \
-		memcpy( &bv, a, 4 ); \
-		LZAV_IEC32( bv );
+	const size_t bl = LZAV_WIN_LEN * 2 + cbl + LZAV_REF_LEN;
 
-	#define LZAV_MEMMOVE( d, s, c ) \
-		{ uint8_t tmp[ c ]; memcpy( tmp, s, c ); memcpy( d, tmp, c ); }
+	return( dstl < bl ? dstl : bl );
+}
 
-	#define LZAV_SET_IPD_CV( x, v, sh ) \
-		const size_t d = ( x ) << csh | cv; \
-		ipd = op - d; \
-		if( LZAV_UNLIKELY( (uint8_t*) dst + d > op )) \
-			goto _err_refoob; \
-		csh = ( sh ); \
-		cv = ( v );
+/**
+ * @brief Function initializes the callback-sink LZAV stream decompressor's
+ * state.
+ *
+ * @param[out] dk State to initialize.
+ * @param dstl Expected decompressed data length, in bytes.
+ * @param cbl Output chunk length, in bytes, 0 - LZAV_SINK_CHUNK.
+ * @param cb Output callback.
+ * @param ctx Output callback's context, passed to `cb` as is.
+ * @param buf Window buffer, 0 - allocate a buffer of lzav_dsink_buf_len()
+ * bytes; should then be released via lzav_dsink_free().
+ * @param bufl Window buffer's length, in bytes. Should be equal to or
+ * greater than `dstl`, or LZAV_WIN_LEN + `cbl` + LZAV_REF_LEN; ignored if
+ * `buf` is 0.
+ * @param al Allocator of the window buffer, 0 - the global allocator.
+ * @return 0, or LZAV_E_PARAMS, if parameters are incorrect, or LZAV_E_NOMEM,
+ * if the buffer allocation failed. The error is also returned by all
+ * subsequent calls to lzav_dsink_run().
+ */
 
-	#define LZAV_SET_IPD( x ) \
-		LZAV_SET_IPD_CV( x, 0, 0 )
+static inline int lzav_dsink_init_al( lzav_dsink* const dk,
+	const size_t dstl, size_t cbl, const lzav_sink_fn cb, void* const ctx,
+	void* buf, size_t bufl, const lzav_alloc* const al )
+{
+	cbl = ( cbl == 0 ? LZAV_SINK_CHUNK : cbl );
+	dk -> mb = 0;
+	dk -> al = lzav_alloc_use( al );
 
-	ip++; // Advance beyond prefix byte.
+	if( buf == 0 && dstl != 0 )
+	{
+		bufl = lzav_dsink_buf_len( dstl, cbl );
+		buf = lzav_malloc( &dk -> al, bufl );
+		dk -> mb = buf;
+	}
 
-	if( LZAV_UNLIKELY( ip >= ipet ))
+	lzav_dstream_init( &dk -> ds, buf, dstl );
+
+	dk -> bufl = bufl;
+	dk -> base = 0;
+	dk -> el = 0;
+	dk -> cbl = cbl;
+	dk -> cb = cb;
+	dk -> ctx = ctx;
+
+	if( cb == 0 || ( bufl < dstl && ( bufl < cbl ||
+		bufl - cbl < (size_t) LZAV_WIN_LEN + LZAV_REF_LEN )))
 	{
-		goto _err_srcoob;
+		dk -> ds.st = LZAV_E_PARAMS;
+	}
+	else
+	if( buf == 0 && dstl != 0 )
+	{
+		dk -> ds.st = LZAV_E_NOMEM;
 	}
 
-	bh = *ip;
+	return( dk -> ds.st );
+}
 
-	while( LZAV_LIKELY( ip < ipet ))
+/**
+ * @brief Function initializes the callback-sink LZAV stream decompressor's
+ * state, with the global allocator. See lzav_dsink_init_al().
+ */
+
+static inline int lzav_dsink_init( lzav_dsink* const dk, const size_t dstl,
+	const size_t cbl, const lzav_sink_fn cb, void* const ctx, void* const buf,
+	const size_t bufl )
+{
+	return( lzav_dsink_init_al( dk, dstl, cbl, cb, ctx, buf, bufl, 0 ));
+}
+
+/**
+ * @brief Function releases the window buffer allocated by
+ * lzav_dsink_init().
+ *
+ * @param dk Decompressor's state.
+ */
+
+static inline void lzav_dsink_free( lzav_dsink* const dk )
+{
+	lzav_free( &dk -> al, dk -> mb, dk -> bufl );
+	dk -> mb = 0;
+}
+
+/**
+ * @brief Internal function delivers whole output chunks to the callback;
+ * and the remaining output, if `fin` is non-zero.
+ *
+ * @param dk Decompressor's state.
+ * @param wl Logical output position.
+ * @param fin Non-zero, if output is complete.
+ * @return 0, or LZAV_E_SINK.
+ */
+
+static inline int lzav_dsink_emit( lzav_dsink* const dk, const size_t wl,
+	const int fin )
+{
+	const uint8_t* const buf = dk -> ds.dst;
+
+	while( wl - dk -> el >= dk -> cbl || ( fin && wl != dk -> el ))
 	{
-		const uint8_t* ipd; // Source data pointer.
-		size_t cc; // Byte copy count.
-		size_t bt; // Block type.
+		size_t l = wl - dk -> el;
+		l = ( l > dk -> cbl ? dk -> cbl : l );
 
-		if( LZAV_UNLIKELY(( bh & 0x30 ) == 0 )) // Block type 0.
-		{
-			size_t ncv = bh >> 6;
-			ip++;
-			cc = bh & 15;
+		const uint8_t* const p = buf + ( dk -> el - dk -> base );
 
-			if( LZAV_LIKELY( cc != 0 )) // True, if no additional length byte.
-			{
-				ipd = ip;
-				ncv <<= csh;
-				ip += cc;
+		if(( *dk -> cb )( dk -> ctx, p, l ) != 0 )
+		{
+			return( LZAV_E_SINK );
+		}
 
-				if( LZAV_LIKELY(( op < opet ) & ( ipd < ipe - 15 - 7 )))
-				{
-					cv |= ncv;
-					csh += 2;
-					bh = *ip;
-					memcpy( op, ipd, 16 );
-					op += cc;
-					goto _refblk; // Reference block follows, if not EOS.
-				}
-			}
-			else
-			{
-				size_t lcw = *ip;
-				ncv <<= csh;
-				ip++;
-				cc = lcw & 0x7F;
-				int sh = 7;
+		dk -> el += l;
+	}
 
-				while(( lcw & 0x80 ) != 0 )
-				{
-					lcw = *ip;
-					ip++;
-					cc |= ( lcw & 0x7F ) << sh;
+	return( 0 );
+}
 
-					if( sh == 28 ) // No more than 4 additional bytes.
-					{
-						break;
-					}
+/**
+ * @brief Internal function shifts the window buffer's contents towards its
+ * start, keeping the LZ77 window and undelivered output.
+ *
+ * @param dk Decompressor's state.
+ * @param wl Logical output position.
+ */
 
-					sh += 7;
-				}
+static inline void lzav_dsink_shift( lzav_dsink* const dk, const size_t wl )
+{
+	size_t ks = ( wl > LZAV_WIN_LEN ? wl - LZAV_WIN_LEN : 0 );
+	ks = ( ks > dk -> el ? dk -> el : ks );
 
-				cc += 16;
-				ipd = ip;
-				ip += cc;
+	if( ks > dk -> base )
+	{
+		memmove( dk -> ds.dst, dk -> ds.dst + ( ks - dk -> base ), wl - ks );
+		dk -> base = ks;
+	}
+}
 
-				if( LZAV_LIKELY(( op < opet ) & ( ipd < ipe - 63 - 16 )))
-				{
-					memcpy( op, ipd, 16 );
-					memcpy( op + 16, ipd + 16, 16 );
-					memcpy( op + 32, ipd + 32, 16 );
-					memcpy( op + 48, ipd + 48, 16 );
+/**
+ * @brief Callback-sink LZAV stream decompression function.
+ *
+ * Function decompresses the next chunk of a compressed data stream, and
+ * delivers decompressed data to the callback, in whole chunks. The
+ * remaining output is delivered when all `dstl` bytes were decompressed.
+ * The function can be called repeatedly, with consecutive input chunks of
+ * any length.
+ *
+ * @param dk Initialized decompressor's state.
+ * @param[in] src Input chunk pointer, can be 0 if `srcl` is 0.
+ * @param srcl Input chunk's length, in bytes.
+ * @param[out] pcl Receiver of the number of consumed input bytes. All input
+ * is consumed if LZAV_DS_INPUT is returned.
+ * @return LZAV_DS_END, if all `dstl` bytes were decompressed and delivered
+ * (the remaining input is not consumed), LZAV_DS_INPUT, or a negative
+ * `LZAV_E_` error code, which is then returned by all subsequent calls.
+ * LZAV_E_REFOOB is also returned if a reference exceeds the window.
+ */
 
-					if( LZAV_LIKELY( cc < 65 ))
-					{
-						cv |= ncv;
-						csh += 2;
-						bh = *ip;
-						op += cc;
-						goto _refblk; // Reference block follows, if not EOS.
-					}
+static inline int lzav_dsink_run( lzav_dsink* const dk,
+	const void* const src, const size_t srcl, size_t* const pcl )
+{
+	lzav_dstream* const ds = &dk -> ds;
+	const uint8_t* ip = (const uint8_t*) src; // Input pointer.
+	const uint8_t* const ipe = ip + srcl; // Input end pointer.
+	size_t wl = ds -> wl;
+	size_t cv = ds -> cv;
+	int csh = ds -> csh;
+	int r = LZAV_DS_INPUT;
+
+	if( ds -> st != 0 )
+	{
+		*pcl = 0;
+		return( ds -> st );
+	}
 
-					ipd += 64;
-					op += 64;
-					cc -= 64;
-				}
-			}
+	if( lzav_dstream_fmt( ds, &ip, ipe ) != 0 )
+	{
+		r = LZAV_E_UNKFMT;
+		goto _end;
+	}
 
-			cv |= ncv;
-			csh += 2;
+	while( 1 )
+	{
+		if( ds -> lc != 0 )
+		{
+			// Copy literals of the current block, within the window buffer.
 
-			if( LZAV_LIKELY( ip < ipe ))
-			{
-				bh = *ip;
-			}
-			else
-			if( LZAV_UNLIKELY( ip != ipe ))
+			if( ip == ipe )
 			{
-				goto _err_srcoob_lit;
+				break;
 			}
 
-			if( LZAV_UNLIKELY( op + cc > ope ))
+			if( wl - dk -> base == dk -> bufl )
 			{
-				goto _err_dstoob_lit;
+				lzav_dsink_shift( dk, wl );
 			}
 
-			// This and other alike copy-blocks are transformed into fast SIMD
-			// instructions, by a modern compiler. Direct use of `memcpy` is
-			// slower due to shortness of data remaining to copy, on average.
+			size_t cc = ds -> lc;
+			const size_t bl = dk -> bufl - ( wl - dk -> base );
 
-			while( cc != 0 )
+			cc = ( cc > (size_t) ( ipe - ip ) ? (size_t) ( ipe - ip ) : cc );
+			cc = ( cc > bl ? bl : cc );
+
+			memcpy( ds -> dst + ( wl - dk -> base ), ip, cc );
+			ip += cc;
+			wl += cc;
+			ds -> lc -= cc;
+
+			if( lzav_dsink_emit( dk, wl, 0 ) != 0 )
 			{
-				*op = *ipd;
-				ipd++;
-				op++;
-				cc--;
+				r = LZAV_E_SINK;
+				break;
 			}
 
 			continue;
+		}
 
-		_err_srcoob_lit:
-			cc = ipe - ipd;
+		if( wl == ds -> dstl )
+		{
+			r = ( lzav_dsink_emit( dk, wl, 1 ) != 0 ?
+				LZAV_E_SINK : LZAV_DS_END );
 
-			if( op + cc < ope )
-			{
-				memcpy( op, ipd, cc );
-				*pwl = (int) ( op + cc - (uint8_t*) dst );
-			}
-			else
-			{
-				memcpy( op, ipd, ope - op );
-			}
+			break;
+		}
 
-			return( LZAV_E_SRCOOB );
+		const uint8_t* const h = lzav_dstream_get_hdr( ds, &ip, ipe );
 
-		_err_dstoob_lit:
-			memcpy( op, ipd, ope - op );
-			return( LZAV_E_DSTOOB );
+		if( h == 0 )
+		{
+			break;
 		}
 
-	_refblk:
-		bt = ( bh >> 4 ) & 3;
-		ip++;
-		const int bt8 = (int) ( bt << 3 );
-
-		LZAV_LOAD32( ip );
-		const uint32_t om = (uint32_t) (( 1 << bt8 ) - 1 );
-		ip += bt;
-		const size_t o = bv & om;
-		bv >>= bt8;
+		const int blit = (( h[ 0 ] & 0x30 ) == 0 );
+		size_t cc;
+		const size_t d = lzav_dstream_hdr( h, (size_t) ds -> mref1, &cv, &csh,
+			&cc );
 
-		static const int ocsh[ 4 ] = { 0, 0, 0, 3 };
-		const int wcsh = ocsh[ bt ];
+		if( cc > ds -> dstl - wl )
+		{
+			r = LZAV_E_DSTOOB;
+			break;
+		}
 
-		LZAV_SET_IPD_CV( bh >> 6 | ( o & 0x1FFFFF ) << 2, o >> 21, wcsh );
+		if( blit )
+		{
+			ds -> lc = cc;
+			continue;
+		}
 
-		cc = bh & 15;
+		if( d > wl - dk -> base )
+		{
+			r = LZAV_E_REFOOB;
+			break;
+		}
 
-		if( LZAV_LIKELY( cc != 0 )) // True, if no additional length byte.
+		if( cc > dk -> bufl - ( wl - dk -> base ))
 		{
-			bh = bv & 0xFF;
-			cc += mref1;
+			lzav_dsink_shift( dk, wl );
+		}
 
-			if( LZAV_LIKELY( op < opet ))
-			{
-				LZAV_MEMMOVE( op, ipd, 16 );
-				LZAV_MEMMOVE( op + 16, ipd + 16, 4 );
+		uint8_t* op = ds -> dst + ( wl - dk -> base );
+		const uint8_t* ipd = op - d;
+		wl += cc;
 
-				op += cc;
-				continue;
-			}
+		if( d >= cc )
+		{
+			memcpy( op, ipd, cc );
 		}
 		else
 		{
-			bh = bv & 0xFF;
-
-			if( LZAV_UNLIKELY( bh == 255 ))
-			{
-				cc = 16 + mref1 + 255 + ip[ 1 ];
-				bh = ip[ 2 ];
-				ip += 2;
-			}
-			else
+			while( cc != 0 )
 			{
-				cc = 16 + mref1 + bh;
-				ip++;
-				bh = *ip;
+				*op = *ipd;
+				ipd++;
+				op++;
+				cc--;
 			}
+		}
+
+		if( lzav_dsink_emit( dk, wl, 0 ) != 0 )
+		{
+			r = LZAV_E_SINK;
+			break;
+		}
+	}
+
+_end:
+	ds -> wl = wl;
+	ds -> cv = cv;
+	ds -> csh = csh;
+	*pcl = (size_t) ( ip - (const uint8_t*) src );
+
+	if( r < 0 )
+	{
+		ds -> st = r;
+	}
+
+	return( r );
+}
+
+/**
+ * @brief Callback-sink LZAV decompression function.
+ *
+ * Function decompresses a whole compressed data stream, and delivers
+ * decompressed data to the callback, in chunks of the specified length,
+ * without storing the whole decompressed data: the memory use is limited
+ * to lzav_dsink_buf_len() bytes. See lzav_dsink_run() for details.
+ *
+ * @param[in] src Source (compressed) data pointer.
+ * @param srcl Source data length, in bytes.
+ * @param dstl Expected decompressed data length, in bytes.
+ * @param cbl Output chunk length, in bytes, 0 - LZAV_SINK_CHUNK.
+ * @param cb Output callback.
+ * @param ctx Output callback's context, passed to `cb` as is.
+ * @return 0, if all `dstl` bytes were decompressed and delivered, or a
+ * negative `LZAV_E_` error code.
+ */
 
-			if( LZAV_LIKELY( op < opet ))
-			{
-				LZAV_MEMMOVE( op, ipd, 16 );
-				LZAV_MEMMOVE( op + 16, ipd + 16, 16 );
-				LZAV_MEMMOVE( op + 32, ipd + 32, 16 );
-				LZAV_MEMMOVE( op + 48, ipd + 48, 16 );
+static inline int lzav_decompress_cb( const void* const src,
+	const size_t srcl, const size_t dstl, const size_t cbl,
+	const lzav_sink_fn cb, void* const ctx )
+{
+	if( srcl == 0 && dstl == 0 )
+	{
+		return( 0 );
+	}
 
-				if( LZAV_LIKELY( cc < 65 ))
-				{
-					op += cc;
-					continue;
-				}
+	lzav_dsink dk;
+	int r = lzav_dsink_init( &dk, dstl, cbl, cb, ctx, 0, 0 );
 
-				ipd += 64;
-				op += 64;
-				cc -= 64;
-			}
-		}
+	if( r == 0 )
+	{
+		size_t cl;
+		r = lzav_dsink_run( &dk, src, srcl, &cl );
 
-		if( LZAV_UNLIKELY( op + cc > ope ))
+		if( r == LZAV_DS_INPUT )
 		{
-			goto _err_dstoob_ref;
+			r = LZAV_E_SRCOOB;
 		}
+	}
 
-		while( cc != 0 )
+	lzav_dsink_free( &dk );
+
+	return( r );
+}
+
+/**
+ * @brief Function copies data to scatter-gather segments, at the specified
+ * logical offset. See lzav_iov_copy().
+ */
+
+static inline void lzav_iov_scatter( const lzav_iovec* const iov,
+	const size_t* const cum, int k, size_t o, const uint8_t* ip, size_t l )
+{
+	while( l != 0 )
+	{
+		while( cum[ k + 1 ] <= o )
 		{
-			*op = *ipd;
-			ipd++;
-			op++;
-			cc--;
+			k++;
 		}
 
-		continue;
+		size_t cl = cum[ k + 1 ] - o;
 
-	_err_dstoob_ref:
-		memmove( op, ipd, ope - op );
-		return( LZAV_E_DSTOOB );
+		if( cl > l )
+		{
+			cl = l;
+		}
+
+		memcpy( (uint8_t*) iov[ k ].iov_base + ( o - cum[ k ]), ip, cl );
+		ip += cl;
+		o += cl;
+		l -= cl;
 	}
+}
 
-	if( LZAV_UNLIKELY( op != ope ))
+/**
+ * @brief Function copies reference data within scatter-gather segments, in
+ * chunks that do not exceed the reference offset (overlapping references
+ * repeat prior data).
+ *
+ * @param iov Segments.
+ * @param cum Cumulative segment offsets.
+ * @param n The number of segments.
+ * @param k Index of the segment that contains `o`, or of a prior segment.
+ * @param o Logical destination offset.
+ * @param d Reference offset, not 0, not greater than `o`.
+ * @param cc Reference length, within the segments.
+ */
+
+static inline void lzav_iov_ref( const lzav_iovec* const iov,
+	const size_t* const cum, const int n, int k, size_t o, const size_t d,
+	size_t cc )
+{
+	size_t so = o - d;
+	int ks = lzav_iov_find( cum, n, so );
+
+	while( cc != 0 )
 	{
-		goto _err_dstlen;
-	}
+		while( cum[ k + 1 ] <= o )
+		{
+			k++;
+		}
 
-	return( (int) ( op - (uint8_t*) dst ));
+		while( cum[ ks + 1 ] <= so )
+		{
+			ks++;
+		}
 
-_err_srcoob:
-	*pwl = (int) ( op - (uint8_t*) dst );
-	return( LZAV_E_SRCOOB );
+		size_t c = ( cc > d ? d : cc );
+		c = ( c > cum[ k + 1 ] - o ? cum[ k + 1 ] - o : c );
+		c = ( c > cum[ ks + 1 ] - so ? cum[ ks + 1 ] - so : c );
 
-_err_refoob:
-	*pwl = (int) ( op - (uint8_t*) dst );
-	return( LZAV_E_REFOOB );
+		memcpy( (uint8_t*) iov[ k ].iov_base + ( o - cum[ k ]),
+			(const uint8_t*) iov[ ks ].iov_base + ( so - cum[ ks ]), c );
 
-_err_dstlen:
-	*pwl = (int) ( op - (uint8_t*) dst );
-	return( LZAV_E_DSTLEN );
+		o += c;
+		so += c;
+		cc -= c;
+	}
 }
 
-#if LZAV_FMT_MIN < 2
-
 /**
- * @brief Internal LZAV decompression function (stream format 1).
+ * @brief Scatter-gather LZAV decompression function.
  *
- * Function decompresses "raw" data previously compressed into the LZAV stream
- * format 1.
+ * Function decompresses "raw" data previously compressed into the LZAV
+ * stream format 2, directly into several destination segments (e.g.,
+ * page-aligned I/O buffers, or fixed-size chunks of a buffer pool), which
+ * are filled in order, as a single logical buffer. References that span
+ * segment boundaries are resolved. Older stream formats are not supported.
  *
- * This function should not be called directly since it does not check the
- * format identifier.
+ * See the lzav_decompress() function for a more detailed description.
  *
  * @param[in] src Source (compressed) data pointer.
- * @param[out] dst Destination (decompressed data) buffer pointer.
+ * @param iov Destination segments. Their total length should be equal to
+ * the original uncompressed data length. Segments of zero length are
+ * allowed. Should not overlap the source data.
  * @param srcl Source data length, in bytes.
- * @param dstl Expected destination data length, in bytes.
- * @return The length of decompressed data, in bytes, or any negative value if
- * some error happened.
+ * @param iovcnt The number of destination segments.
+ * @return The length of decompressed data, in bytes, or any negative value
+ * if some error happened (see the `LZAV_E_` macros). On error, the contents
+ * of the destination segments are undefined. LZAV_E_NOMEM is returned if
+ * over 32 segments are passed, and their offset table could not be
+ * allocated.
  */
 
-static inline int lzav_decompress_1( const void* const src, void* const dst,
-	const int srcl, const int dstl )
+static inline int lzav_decompress_iov( const void* const src,
+	const lzav_iovec* const iov, const int srcl, const int iovcnt )
 {
+	if(( srcl < 0 ) | ( iovcnt < 0 ) | ( iov == 0 && iovcnt != 0 ))
+	{
+		return( LZAV_E_PARAMS );
+	}
+
+	if( iovcnt == 1 )
+	{
+		if( iov[ 0 ].iov_len > 0x7FFFFFFF )
+		{
+			return( LZAV_E_PARAMS );
+		}
+
+		return( lzav_decompress( src, iov[ 0 ].iov_base, srcl,
+			(int) iov[ 0 ].iov_len ));
+	}
+
+	size_t stack_cum[ 33 ]; // Cumulative offsets for up to 32 segments.
+	size_t* cum = stack_cum;
+	const size_t cuml = ( (size_t) iovcnt + 1 ) * sizeof( size_t );
+	int i;
+
+	if( iovcnt > 32 )
+	{
+		cum = (size_t*) lzav_malloc( 0, cuml );
+
+		if( cum == 0 )
+		{
+			return( LZAV_E_NOMEM );
+		}
+	}
+
+	int r = 0;
+	cum[ 0 ] = 0;
+
+	// Common length of all segments but the last one, or 0, if the lengths
+	// differ: allows a direct lookup of the reference source segment.
+
+	size_t ul = iov[ 0 ].iov_len;
+
+	for( i = 0; i < iovcnt; i++ )
+	{
+		cum[ i + 1 ] = cum[ i ] + iov[ i ].iov_len;
+
+		if( iov[ i ].iov_len != ul && i < iovcnt - 1 )
+		{
+			ul = 0;
+		}
+
+		if( iov[ i ].iov_len > 0x7FFFFFFF || cum[ i + 1 ] > 0x7FFFFFFF ||
+			( iov[ i ].iov_base == 0 && iov[ i ].iov_len != 0 ))
+		{
+			r = LZAV_E_PARAMS;
+			break;
+		}
+	}
+
+	const size_t dstl = ( r == 0 ? cum[ iovcnt ] : 0 );
+
+	if( r != 0 || srcl == 0 || dstl == 0 )
+	{
+		if( r == 0 && ( srcl != 0 || dstl != 0 ))
+		{
+			r = LZAV_E_PARAMS;
+		}
+
+		if( cum != stack_cum )
+		{
+			lzav_free( 0, cum, cuml );
+		}
+
+		return( r );
+	}
+
 	const uint8_t* ip = (const uint8_t*) src; // Compressed data pointer.
 	const uint8_t* const ipe = ip + srcl; // Compressed data boundary pointer.
-	const uint8_t* const ipet = ipe - 5; // Block header read threshold.
-	uint8_t* op = (uint8_t*) dst; // Destination (decompressed data) pointer.
-	uint8_t* const ope = op + dstl; // Destination boundary pointer.
-	uint8_t* const opet = ope - 63; // Threshold for fast copy to destination.
-	const size_t mref1 = ( *ip & 15 ) - 1; // Minimal reference length - 1.
-	size_t bh = 0; // Current block header, updated in each branch.
+	const size_t mref1 = (size_t) ( *ip & 15 ) - 1;
+	size_t opo = 0; // Destination data offset.
 	size_t cv = 0; // Reference offset carry value.
 	int csh = 0; // Reference offset carry shift.
 
-	ip++; // Advance beyond prefix byte.
+	// `k` is the index of the segment containing `opo`; `sp`, `so` and `se`
+	// are its pointer, and start and end offsets.
 
-	if( LZAV_UNLIKELY( ip >= ipet ))
+	int k = lzav_iov_find( cum, iovcnt, 0 );
+	uint8_t* sp = (uint8_t*) iov[ k ].iov_base;
+	size_t so = cum[ k ];
+	size_t se = cum[ k + 1 ];
+
+	if( *ip >> 4 != LZAV_FMT_CUR || mref1 == (size_t) -1 )
 	{
-		goto _err_srcoob;
+		r = LZAV_E_UNKFMT;
+		ip = ipe;
+	}
+	else
+	{
+		ip++;
 	}
 
-	bh = *ip;
+	// The loop ends once all output is written, like in lzav_decompress_2():
+	// short streams are zero-padded, and the padding is not a block.
 
-	while( LZAV_LIKELY( ip < ipet ))
+	while(( ip < ipe ) & ( opo < dstl ))
 	{
-		const uint8_t* ipd; // Source data pointer.
-		size_t cc; // Byte copy count.
-
-		if( LZAV_UNLIKELY(( bh & 0x30 ) == 0 )) // Block type 0.
+		if( se - opo > 64 )
 		{
-			cv = bh >> 6;
-			csh = 2;
-			ip++;
-			cc = bh & 15;
+			// Fast loop for short literal blocks, and reference blocks
+			// within the current segment: fixed-length copies, like in
+			// lzav_decompress_2(), which may write past the block, but
+			// stay within the segment. Other blocks are handled below.
 
-			if( LZAV_LIKELY( cc != 0 )) // True, if no additional length byte.
+			uint8_t* op = sp + ( opo - so );
+			uint8_t* const ope = sp + ( se - so );
+			const uint8_t* const ipf = ipe - 32;
+
+			while( LZAV_LIKELY(( ope - op > 64 ) & ( ip < ipf )))
 			{
-				ipd = ip;
-				ip += cc;
+				const size_t bh = *ip;
+				size_t cc = bh & 15;
 
-				if( LZAV_LIKELY(( op < opet ) & ( ipd < ipe - 15 - 6 )))
+				if(( bh & 0x30 ) == 0 )
 				{
-					bh = *ip;
-					memcpy( op, ipd, 16 );
+					if( LZAV_UNLIKELY(( cc == 0 ) | ( csh >= 30 )))
+					{
+						break;
+					}
+
+					cv |= ( bh >> 6 ) << csh;
+					csh += 2;
+					memcpy( op, ip + 1, 16 );
+					ip += 1 + cc;
 					op += cc;
-					goto _refblk; // Reference block follows, if not EOS.
+					continue;
 				}
-			}
-			else
-			{
-				LZAV_LOAD16( ip );
 
-				const int l2 = bv & 0xFF;
-				cc = 16;
-				ip++;
-				const int lb = ( l2 == 255 );
-				cc += l2 + (( bv >> 8 ) & ( 0x100 - lb ));
-				ip += lb;
+				const size_t bt = ( bh >> 4 ) & 3;
+				size_t hl = 1 + bt;
+				uint32_t bv;
+				memcpy( &bv, ip + 1, 4 );
+				LZAV_IEC32( bv );
 
-				ipd = ip;
-				ip += cc;
+				const size_t o = bv & (( (uint32_t) 1 << ( bt << 3 )) - 1 );
+				const size_t d =
+					( bh >> 6 | ( o & 0x1FFFFF ) << 2 ) << csh | cv;
 
-				if( LZAV_LIKELY(( op < opet ) & ( ipd < ipe - 63 - 1 )))
+				if( LZAV_LIKELY( cc != 0 ))
 				{
-					memcpy( op, ipd, 16 );
-					memcpy( op + 16, ipd + 16, 16 );
-					memcpy( op + 32, ipd + 32, 16 );
-					memcpy( op + 48, ipd + 48, 16 );
-
-					if( LZAV_LIKELY( cc < 65 ))
-					{
-						bh = *ip;
-						op += cc;
-						continue;
-					}
+					cc += mref1;
+				}
+				else
+				{
+					const size_t e = ip[ hl ];
+					const size_t e2 = ( e == 255 ? (size_t) ip[ hl + 1 ] : 0 );
 
-					ipd += 64;
-					op += 64;
-					cc -= 64;
+					cc = 16 + mref1 + e + e2;
+					hl += 1 + ( e == 255 );
 				}
-			}
 
-			if( LZAV_LIKELY( ip < ipe ))
-			{
-				bh = *ip;
-			}
-			else
-			if( LZAV_UNLIKELY( ip != ipe ))
-			{
-				goto _err_srcoob;
-			}
+				if( LZAV_UNLIKELY(( d < cc ) | ( cc >= (size_t) ( ope - op ))))
+				{
+					break;
+				}
 
-			if( LZAV_UNLIKELY( op + cc > ope ))
-			{
-				goto _err_dstoob;
-			}
+				if( LZAV_LIKELY( d <= (size_t) ( op - sp )))
+				{
+					const uint8_t* const ipd = op - d;
+					uint8_t tmp[ 64 ];
 
-			// This and other alike copy-blocks are transformed into fast SIMD
-			// instructions, by a modern compiler. Direct use of `memcpy` is
-			// slower due to shortness of data remaining to copy, on average.
+					if( LZAV_LIKELY( cc < 21 ))
+					{
+						memcpy( tmp, ipd, 20 );
+						memcpy( op, tmp, 20 );
+					}
+					else
+					if( cc < 65 )
+					{
+						memcpy( tmp, ipd, 64 );
+						memcpy( op, tmp, 64 );
+					}
+					else
+					{
+						memcpy( op, ipd, cc );
+					}
+				}
+				else
+				{
+					// The reference source is in a prior segment.
 
-			while( cc != 0 )
-			{
-				*op = *ipd;
-				ipd++;
-				op++;
-				cc--;
-			}
+					const size_t ol = so + (size_t) ( op - sp );
 
-			continue;
-		}
+					if( LZAV_UNLIKELY( d > ol ))
+					{
+						break;
+					}
 
-	_refblk:
-		cc = bh & 15;
+					const size_t s = ol - d;
+					const int ks = ( ul != 0 ? (int) ( s / ul ) :
+						lzav_iov_find( cum, k, s ));
 
-		if( LZAV_UNLIKELY(( bh & 32 ) == 0 )) // True, if block type 1.
-		{
-			LZAV_SET_IPD( bh >> 6 | (size_t) ip[ 1 ] << 2 );
-			ip += 2;
-			bh = *ip;
-		}
-		else // Block type 2 or 3.
-		{
-			if( LZAV_LIKELY(( bh & 16 ) == 0 )) // True, if block type 2.
-			{
-				LZAV_LOAD16( ip + 1 );
-				LZAV_SET_IPD( bh >> 6 | (size_t) bv << 2 );
-				ip += 3;
-				bh = *ip;
-			}
-			else // Block type 3.
-			{
-				LZAV_LOAD32( ip + 1 );
-				LZAV_SET_IPD_CV( bv & 0xFFFFFF, bh >> 6, 2 );
-				ip += 4;
-				bh = bv >> 24;
+					const size_t sl = cum[ ks + 1 ] - s;
+
+					if( sl < cc )
+					{
+						break;
+					}
+
+					const uint8_t* const ipd =
+						(const uint8_t*) iov[ ks ].iov_base + ( s - cum[ ks ]);
+
+					if( LZAV_LIKELY(( cc < 21 ) & ( sl >= 20 )))
+					{
+						memcpy( op, ipd, 20 );
+					}
+					else
+					{
+						memcpy( op, ipd, cc );
+					}
+				}
+
+				csh = ( bt == 3 ? 3 : 0 );
+				cv = o >> 21;
+				ip += hl;
+				op += cc;
 			}
+
+			opo = so + (size_t) ( op - sp );
 		}
 
-		if( LZAV_LIKELY( cc != 0 )) // True, if no additional length byte.
+		size_t cc;
+
 		{
-			cc += mref1;
+			const size_t n = (size_t) ( ipe - ip );
+			const size_t hl = lzav_dstream_hdr_len( ip, ( n < 6 ? n : 6 ));
 
-			if( LZAV_LIKELY( op < opet ))
+			if( hl == 0 || hl > n )
 			{
-				LZAV_MEMMOVE( op, ipd, 16 );
-				LZAV_MEMMOVE( op + 16, ipd + 16, 4 );
+				r = LZAV_E_SRCOOB;
+				break;
+			}
 
-				op += cc;
-				continue;
+			const int blit = (( *ip & 0x30 ) == 0 );
+			const size_t d = lzav_dstream_hdr( ip, mref1, &cv, &csh, &cc );
+			ip += hl;
+
+			if( cc > dstl - opo )
+			{
+				r = LZAV_E_DSTOOB;
+				break;
 			}
-		}
-		else
-		{
-			cc = 16 + mref1 + bh;
-			ip++;
-			bh = *ip;
 
-			if( LZAV_LIKELY( op < opet ))
+			if( blit )
 			{
-				LZAV_MEMMOVE( op, ipd, 16 );
-				LZAV_MEMMOVE( op + 16, ipd + 16, 16 );
-				LZAV_MEMMOVE( op + 32, ipd + 32, 16 );
-				LZAV_MEMMOVE( op + 48, ipd + 48, 16 );
+				if( cc > (size_t) ( ipe - ip ))
+				{
+					r = LZAV_E_SRCOOB;
+					break;
+				}
 
-				if( LZAV_LIKELY( cc < 65 ))
+				if( LZAV_LIKELY( opo + cc <= se ))
 				{
-					op += cc;
-					continue;
+					memcpy( sp + ( opo - so ), ip, cc );
+				}
+				else
+				{
+					lzav_iov_scatter( iov, cum, k, opo, ip, cc );
 				}
 
-				ipd += 64;
-				op += 64;
-				cc -= 64;
+				ip += cc;
 			}
-		}
+			else
+			{
+				if( d > opo || d == 0 )
+				{
+					r = LZAV_E_REFOOB;
+					break;
+				}
 
-		if( LZAV_UNLIKELY( op + cc > ope ))
-		{
-			goto _err_dstoob;
+				if( LZAV_LIKELY(( opo - d >= so ) & ( opo + cc <= se )))
+				{
+					uint8_t* op = sp + ( opo - so );
+					const uint8_t* ipd = op - d;
+
+					if( LZAV_LIKELY( d >= cc ))
+					{
+						memcpy( op, ipd, cc );
+					}
+					else
+					{
+						size_t c = cc;
+
+						while( c != 0 )
+						{
+							*op = *ipd;
+							ipd++;
+							op++;
+							c--;
+						}
+					}
+				}
+				else
+				{
+					lzav_iov_ref( iov, cum, iovcnt, k, opo, d, cc );
+				}
+			}
 		}
 
-		while( cc != 0 )
+		opo += cc;
+
+		if( opo >= se && opo < dstl )
 		{
-			*op = *ipd;
-			ipd++;
-			op++;
-			cc--;
+			do
+			{
+				k++;
+			} while( opo >= cum[ k + 1 ]);
+
+			sp = (uint8_t*) iov[ k ].iov_base;
+			so = cum[ k ];
+			se = cum[ k + 1 ];
 		}
 	}
 
-	if( LZAV_UNLIKELY( op != ope ))
+	if( r == 0 && opo != dstl )
 	{
-		goto _err_dstlen;
+		r = LZAV_E_DSTLEN;
 	}
 
-	return( (int) ( op - (uint8_t*) dst ));
+	if( cum != stack_cum )
+	{
+		lzav_free( 0, cum, cuml );
+	}
 
-_err_srcoob:
-	return( LZAV_E_SRCOOB );
+	return( r == 0 ? (int) opo : r );
+}
 
-_err_dstoob:
-	return( LZAV_E_DSTOOB );
+/**
+ * @brief Sequence of a data parse: a literal run, followed by a reference.
+ *
+ * Sequences cover the source data in order: each sequence's literals start
+ * where the previous sequence's reference ends. The last sequence of a parse
+ * usually has no reference.
+ */
 
-_err_refoob:
-	return( LZAV_E_REFOOB );
+typedef struct
+{
+	uint32_t lc; ///< Literal length, in bytes, can be 0.
+	uint32_t rc; ///< Reference length, in bytes, 0 - no reference.
+	uint32_t d; ///< Reference offset, in bytes, back from the reference's
+		///< position. Ignored if `rc` is 0.
+} lzav_seq;
 
-_err_dstlen:
-	return( LZAV_E_DSTLEN );
-}
+/**
+ * @brief Function returns the number of sequences required for
+ * lzav_find_sequences().
+ *
+ * The built-in compressors do not produce references shorter than 5 bytes.
+ *
+ * @param srcl The length of the source data.
+ * @return The maximal number of sequences of a parse. Always a positive
+ * value.
+ */
 
-#endif // LZAV_FMT_MIN < 2
+static inline int lzav_seq_bound( const int srcl )
+{
+	if( srcl <= 0 )
+	{
+		return( 1 );
+	}
 
-#undef LZAV_LOAD16
-#undef LZAV_LOAD32
-#undef LZAV_MEMMOVE
-#undef LZAV_SET_IPD_CV
-#undef LZAV_SET_IPD
+	return( srcl / 5 + 1 );
+}
 
 /**
- * @brief LZAV decompression function (partial).
+ * @brief Function finds the parse of the source data which a built-in
+ * compressor chooses.
  *
- * Function decompresses "raw" data previously compressed into the LZAV stream
- * format, for partial or recovery decompression. For example, this function
- * can be used to decompress only an initial segment of a larger data block.
+ * Function compresses the source data, and converts the resulting stream's
+ * blocks into sequences, with reference offsets resolved from the offset
+ * carry. Adjacent reference blocks with the same offset are returned as a
+ * single sequence. The sequences can be modified (e.g., by a
+ * domain-specific match finder), and passed to lzav_encode_sequences().
  *
- * @param[in] src Source (compressed) data pointer, can be 0 if `srcl` is 0.
- * Address alignment is unimportant.
- * @param[out] dst Destination (decompressed data) buffer pointer. Address
- * alignment is unimportant. Should be different to `src`.
- * @param srcl Source data length, in bytes, can be 0.
- * @param dstl Destination buffer length, in bytes, can be 0.
- * @return The length of decompressed data, in bytes. Always a non-negative
- * value (error codes are not returned).
+ * @param[in] src Source (uncompressed) data pointer.
+ * @param srcl Source data length, in bytes.
+ * @param[out] seq Receiver of sequences.
+ * @param seqn The capacity of `seq`, at least lzav_seq_bound() items.
+ * @param level 1 - the parse of lzav_compress(), 2 - of lzav_compress_hi().
+ * @param al Allocator of the temporary buffers, 0 - the global allocator.
+ * @return The number of sequences. Returns 0 if `srcl` is lesser or equal
+ * to 0, or if `seqn` is too small, or if pointers are invalid, or if not
+ * enough memory.
  */
 
-static inline int lzav_decompress_partial( const void* const src,
-	void* const dst, const int srcl, const int dstl )
+static inline int lzav_find_sequences( const void* const src,
+	const int srcl, lzav_seq* const seq, const int seqn, const int level,
+	const lzav_alloc* const al )
 {
-	if( srcl <= 0 || src == 0 || dst == 0 || src == dst || dstl <= 0 )
+	if(( srcl <= 0 ) | ( src == 0 ) | ( seq == 0 ) |
+		( seqn < lzav_seq_bound( srcl )))
 	{
 		return( 0 );
 	}
 
-	const int fmt = *(const uint8_t*) src >> 4;
-	int dl = 0;
+	const int bl = ( level > 1 ? lzav_compress_bound_hi( srcl ) :
+		lzav_compress_bound( srcl ));
 
-	if( fmt == 2 )
+	uint8_t* const buf = (uint8_t*) lzav_malloc( al, (size_t) bl );
+
+	if( buf == 0 )
 	{
-		lzav_decompress_2( src, dst, srcl, dstl, &dl );
+		return( 0 );
 	}
 
-	return( dl );
+	const int cl = ( level > 1 ?
+		lzav_compress_hi_al( src, buf, srcl, bl, al ) :
+		lzav_compress_al( src, buf, srcl, bl, 0, 0, al ));
+
+	const uint8_t* ip = buf + 1; // Compressed data pointer.
+	const uint8_t* const ipe = buf + cl; // Compressed data boundary pointer.
+	const size_t mref1 = ( *buf & 15 ) - 1; // Minimal reference length - 1.
+	size_t cv = 0; // Reference offset carry value.
+	int csh = 0; // Reference offset carry shift.
+	size_t pos = 0; // Decoded data position.
+	size_t lc = 0; // Pending literal length.
+	int n = 0; // The number of sequences.
+
+	// A very short source data's stream is padded after its only block, so
+	// blocks are read up to the source data's length.
+
+	while(( cl > 0 ) & ( pos < (size_t) srcl ))
+	{
+		const size_t il = (size_t) ( ipe - ip );
+		const size_t hl = lzav_dstream_hdr_len( ip, ( il < 6 ? il : 6 ));
+		size_t cc;
+
+		const size_t d = lzav_dstream_hdr( ip, mref1, &cv, &csh, &cc );
+		ip += hl;
+		pos += cc;
+
+		if( d == 0 ) // Literal block.
+		{
+			ip += cc;
+			lc += cc;
+		}
+		else
+		if( lc == 0 && n != 0 && seq[ n - 1 ].d == d )
+		{
+			seq[ n - 1 ].rc += (uint32_t) cc;
+		}
+		else
+		{
+			seq[ n ].lc = (uint32_t) lc;
+			seq[ n ].rc = (uint32_t) cc;
+			seq[ n ].d = (uint32_t) d;
+			lc = 0;
+			n++;
+		}
+	}
+
+	lzav_free( al, buf, (size_t) bl );
+
+	if( cl <= 0 )
+	{
+		return( 0 );
+	}
+
+	if( lc != 0 )
+	{
+		seq[ n ].lc = (uint32_t) lc;
+		seq[ n ].rc = 0;
+		seq[ n ].d = 0;
+		n++;
+	}
+
+	return( n );
 }
 
 /**
- * @brief LZAV decompression function.
- *
- * Function decompresses "raw" data previously compressed into the LZAV stream
- * format.
+ * @brief LZAV compression function (stream format 2), which encodes a
+ * specified parse of the source data.
  *
- * Note that while the function does perform checks to avoid OOB memory
- * accesses, and checks for decompressed data length equality, this is not a
- * strict guarantee of a valid decompression. In cases when the compressed
- * data is stored in a long-term storage without embedded data integrity
- * mechanisms (e.g., a database without RAID 1 guarantee, a binary container
- * without a digital signature nor CRC), then a checksum (hash) of the
- * original uncompressed data should be stored, and then evaluated against
- * that of the decompressed data. Also, a separate checksum (hash) of
- * application-defined header, which contains uncompressed and compressed data
- * lengths, should be checked before decompression. A high-performance
- * "komihash" hash function can be used to obtain a hash value of the data.
+ * Function produces the same "raw" compressed data as the lzav_compress()
+ * function, but uses the caller's sequences instead of searching for
+ * references. The reference offset carry, the block length limits, and the
+ * stream's finishing literals are handled by the function: references
+ * longer than a block allows, and references that overlap the data they
+ * produce (offset lesser than length) are split into several blocks;
+ * references shorter than 5 bytes or with offsets lesser than 5 bytes, or
+ * with offsets beyond the 8 MiB window, and references' parts that are
+ * within the last `LZAV_LIT_FIN` bytes of the source data, are stored as
+ * literals. References are checked against the source data.
  *
- * @param[in] src Source (compressed) data pointer, can be 0 if `srcl` is 0.
- * Address alignment is unimportant.
- * @param[out] dst Destination (decompressed data) buffer pointer. Address
- * alignment is unimportant. Should be different to `src`.
- * @param srcl Source data length, in bytes, can be 0.
- * @param dstl Expected destination data length, in bytes, can be 0. Should
- * not be confused with the actual size of the destination buffer (which may
- * be larger).
- * @return The length of decompressed data, in bytes, or any negative value if
- * some error happened. Always returns a negative value if the resulting
- * decompressed data length differs from `dstl`. This means that error result
- * handling requires just a check for a negative return value (see the
- * `LZAV_E_` macros for possible values).
+ * @param[in] src Source (uncompressed) data pointer.
+ * @param[out] dst Destination (compressed data) buffer pointer. The allocated
+ * size should be at least lzav_compress_bound() bytes large. Should be
+ * different to `src`.
+ * @param srcl Source data length, in bytes.
+ * @param dstl Destination buffer's capacity, in bytes.
+ * @param[in] seq Sequences, see lzav_find_sequences(). Their total literal
+ * and reference length should be equal to `srcl`.
+ * @param seqn The number of sequences.
+ * @return The length of compressed data, in bytes. Returns 0 if `srcl` is
+ * lesser or equal to 0, or if `dstl` is too small, or if buffer pointers are
+ * invalid, or if sequences do not match the source data.
  */
 
-static inline int lzav_decompress( const void* const src, void* const dst,
-	const int srcl, const int dstl )
+static inline int lzav_encode_sequences( const void* const src,
+	void* const dst, const int srcl, const int dstl,
+	const lzav_seq* const seq, const int seqn )
 {
-	if( srcl < 0 )
+	if(( srcl <= 0 ) | ( src == 0 ) | ( dst == 0 ) | ( src == dst ) |
+		( dstl < lzav_compress_bound( srcl )) | ( seqn < 0 ) |
+		( seq == 0 && seqn != 0 ))
 	{
-		return( LZAV_E_PARAMS );
+		return( 0 );
 	}
 
-	if( srcl == 0 )
+	size_t mref = LZAV_REF_MIN; // Minimal reference length.
+	int i;
+
+	for( i = 0; i < seqn; i++ )
 	{
-		return( dstl == 0 ? 0 : LZAV_E_PARAMS );
+		// Use 5-byte references only if the parse has them, otherwise the
+		// output equals the compressor's output on its own parse.
+
+		if(( seq[ i ].rc > 4 ) & (( seq[ i ].rc < LZAV_REF_MIN ) |
+			( seq[ i ].d == 5 )))
+		{
+			mref = 5;
+			break;
+		}
 	}
 
-	if( src == 0 || dst == 0 || src == dst || dstl <= 0 )
+	const size_t mlen = LZAV_REF_LEN - LZAV_REF_MIN + mref;
+	const uint8_t* const ips = (const uint8_t*) src; // Source data start.
+	const uint8_t* const ipse = ips + srcl; // Source data end.
+	const uint8_t* const ipe = ( srcl < 16 ? ips : ipse - LZAV_LIT_FIN );
+		// References end limit.
+	const uint8_t* ip = ips; // Source data pointer.
+	const uint8_t* ipa = ips; // Literals anchor pointer.
+
+	uint8_t* op = (uint8_t*) dst; // Destination (compressed data) pointer.
+	*op = (uint8_t) ( LZAV_FMT_CUR << 4 | mref ); // Write prefix byte.
+	op++;
+
+	uint8_t* cbp = op; // Pointer to the latest offset carry block header.
+	int csh = 0; // Offset carry shift.
+
+	for( i = 0; i < seqn; i++ )
 	{
-		return( LZAV_E_PARAMS );
-	}
+		size_t rc = seq[ i ].rc;
+		const size_t d = seq[ i ].d;
 
-	const int fmt = *(const uint8_t*) src >> 4;
+		if( (size_t) seq[ i ].lc + rc > (size_t) ( ipse - ip ))
+		{
+			return( 0 );
+		}
+
+		ip += seq[ i ].lc;
+
+		if( rc == 0 )
+		{
+			continue;
+		}
 
-	if( fmt == 2 )
+		if(( d == 0 ) | ( d > (size_t) ( ip - ips )) ||
+			memcmp( ip, ip - d, rc ) != 0 )
+		{
+			return( 0 );
+		}
+
+		const uint8_t* const ire = ip + rc; // Reference's end.
+		const size_t rl = ( ip < ipe ? (size_t) ( ipe - ip ) : 0 );
+		size_t wc = ( rc < rl ? rc : rl ); // Reference length to write.
+
+		if(( d < mref ) | ( d > LZAV_WIN_LEN - 1 ))
+		{
+			wc = 0;
+		}
+
+		while( wc >= mref )
+		{
+			size_t c = ( wc < mlen ? wc : mlen );
+			c = ( c < d ? c : d );
+
+			if(( c != wc ) & ( wc - c < mref ) & ( c >= mref * 2 ))
+			{
+				c -= mref; // Leave a remainder that is a valid reference.
+			}
+
+			const size_t lc = (size_t) ( ip - ipa );
+			const uint8_t* lp = ipa;
+			uint8_t lb[ 32 ];
+
+			if( LZAV_UNLIKELY( ipa + 32 > ipse ))
+			{
+				// Avoid lzav_write_blk()'s over-read of literals.
+
+				memcpy( lb, ipa, lc );
+				lp = lb;
+			}
+
+			op = lzav_write_blk( op, lc, c, d, lp, &cbp, &csh, mref, 0 );
+			ip += c;
+			ipa = ip;
+			wc -= c;
+		}
+
+		ip = ire; // Reference's remainder follows as literals.
+	}
+
+	if( ip != ipse )
 	{
-		int tmp;
-		return( lzav_decompress_2( src, dst, srcl, dstl, &tmp ));
+		return( 0 );
 	}
 
-#if LZAV_FMT_MIN < 2
-	if( fmt == 1 )
+	const size_t lc = (size_t) ( ipse - ipa );
+	op = lzav_write_fin_2( op, lc, ipa );
+
+	if( lc < LZAV_LIT_FIN )
 	{
-		return( lzav_decompress_1( src, dst, srcl, dstl ));
+		// Pad a very short source data, like lzav_compress_2() does.
+
+		memset( op, 0, LZAV_LIT_FIN - lc );
+		op += LZAV_LIT_FIN - lc;
 	}
-#endif // LZAV_FMT_MIN < 2
 
-	return( LZAV_E_UNKFMT );
+	return( (int) ( op - (uint8_t*) dst ));
 }
 
 #endif // LZAV_INCLUDED
@@ -0,0 +1,1045 @@
+/**
+ * @file lzav.hpp
+ *
+ * @version 4.5
+ *
+ * @brief The inclusion file for the C++ interface of the "LZAV" in-memory
+ * data compression and decompression algorithms.
+ *
+ * Requires C++11. Provides function templates for data whose length is a
+ * compile-time constant (e.g., fixed-size structures and records): the
+ * length is propagated into the compression bound, hash-table sizing, and
+ * end-of-data thresholds of the C functions, which are inlined into each
+ * template instance where the compiler supports it.
+ *
+ * Also provides a resumable stream decoder for data arriving in chunks, and
+ * a decompressor that passes output to a function object in chunks.
+ *
+ * With C++20, also provides `std::span`-based functions, a move-only output
+ * buffer that grows without value-initialization, a reusable compressor
+ * that allocates its hash-tables from a `std::pmr` memory resource, and a
+ * coroutine generator of decompressed output.
+ *
+ * Description is available at https://github.com/avaneev/lzav
+ *
+ * E-mail: aleksey.vaneev@gmail.com or info@voxengo.com
+ *
+ * LICENSE:
+ *
+ * Copyright (c) 2023-2024 Aleksey Vaneev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef LZAV_HPP_INCLUDED
+#define LZAV_HPP_INCLUDED
+
+#include "lzav.h"
+#include <type_traits>
+
+#if __cplusplus >= 202002L || \
+	( defined( _MSVC_LANG ) && _MSVC_LANG >= 202002L )
+
+	#define LZAV_CPP20 1 ///< Defined if C++20 features are available.
+
+	#include <coroutine>
+	#include <cstddef>
+	#include <iterator>
+	#include <memory_resource>
+	#include <new>
+	#include <span>
+	#include <utility>
+
+#endif // C++20 check
+
+/**
+ * @def LZAV_FLATTEN
+ * @brief Function attribute that requests inlining of all calls made by the
+ * function, so that compile-time constant lengths are propagated into the
+ * (otherwise rarely inlined, due to their size) compression functions.
+ */
+
+#if defined( LZAV_GCC_BUILTINS )
+	#define LZAV_FLATTEN __attribute__(( flatten ))
+#else // defined( LZAV_GCC_BUILTINS )
+	#define LZAV_FLATTEN
+#endif // defined( LZAV_GCC_BUILTINS )
+
+namespace lzav {
+
+/**
+ * @brief Function returns buffer size required for compression of `N` bytes,
+ * equals lzav_compress_bound( N ).
+ *
+ * @tparam N Source data length, in bytes.
+ */
+
+template< int N >
+constexpr int compress_bound() noexcept
+{
+	static_assert( N > 0, "N should be positive" );
+
+	return( LZAV_PAGE_BOUND( N ));
+}
+
+/**
+ * @brief Function returns buffer size required for the higher-ratio
+ * compression of `N` bytes, equals lzav_compress_bound_hi( N ).
+ *
+ * @tparam N Source data length, in bytes.
+ */
+
+template< int N >
+constexpr int compress_bound_hi() noexcept
+{
+	static_assert( N > 0, "N should be positive" );
+
+	return( LZAV_BOUND_HI( N ));
+}
+
+/**
+ * @brief LZAV compression function for a compile-time constant source data
+ * length, see lzav_compress().
+ *
+ * @tparam N Source data length, in bytes.
+ * @param[in] src Source (uncompressed) data pointer.
+ * @param[out] dst Destination (compressed data) buffer pointer.
+ * @param dstl Destination buffer's capacity, in bytes, should be at least
+ * compress_bound< N >().
+ * @return The length of compressed data, in bytes, 0 on error.
+ */
+
+template< int N >
+LZAV_FLATTEN inline int compress( const void* const src, void* const dst,
+	const int dstl = compress_bound< N >() ) noexcept
+{
+	static_assert( N > 0, "N should be positive" );
+
+	return( lzav_compress( src, dst, N, dstl, 0, 0 ));
+}
+
+/**
+ * @brief LZAV page compression function for a compile-time constant page
+ * length, see lzav_compress_page(). Avoids hash-table initialization on each
+ * call.
+ *
+ * @tparam N Page length, in bytes.
+ * @param ctx Initialized page compression context.
+ * @param[in] src Source (uncompressed) data pointer.
+ * @param[out] dst Destination (compressed data) buffer pointer.
+ * @param dstl Destination buffer's capacity, in bytes, should be at least
+ * compress_bound< N >().
+ * @return The length of compressed data, in bytes, 0 on error.
+ */
+
+template< int N >
+LZAV_FLATTEN inline int compress( lzav_page_ctx* const ctx,
+	const void* const src, void* const dst,
+	const int dstl = compress_bound< N >() ) noexcept
+{
+	static_assert( N > 0 && N <= LZAV_PAGE_LEN_MAX,
+		"N should be within 1 and LZAV_PAGE_LEN_MAX" );
+
+	return( lzav_compress_page( ctx, src, dst, N, dstl ));
+}
+
+/**
+ * @brief Higher-ratio LZAV compression function for a compile-time constant
+ * source data length, see lzav_compress_hi().
+ *
+ * @tparam N Source data length, in bytes.
+ * @param[in] src Source (uncompressed) data pointer.
+ * @param[out] dst Destination (compressed data) buffer pointer.
+ * @param dstl Destination buffer's capacity, in bytes, should be at least
+ * compress_bound_hi< N >().
+ * @return The length of compressed data, in bytes, 0 on error.
+ */
+
+template< int N >
+LZAV_FLATTEN inline int compress_hi( const void* const src, void* const dst,
+	const int dstl = compress_bound_hi< N >() ) noexcept
+{
+	static_assert( N > 0, "N should be positive" );
+
+	return( lzav_compress_hi( src, dst, N, dstl ));
+}
+
+/**
+ * @brief LZAV decompression function for a compile-time constant
+ * decompressed data length, see lzav_decompress_page(). Only the current
+ * stream format is supported.
+ *
+ * @tparam N Expected decompressed data length, in bytes.
+ * @param[in] src Source (compressed) data pointer.
+ * @param[out] dst Destination (decompressed data) buffer pointer, at least
+ * `N` bytes large.
+ * @param srcl Source data length, in bytes.
+ * @return `N`, or any negative value if some error happened.
+ */
+
+template< int N >
+LZAV_FLATTEN inline int decompress( const void* const src, void* const dst,
+	const int srcl ) noexcept
+{
+	static_assert( N > 0, "N should be positive" );
+
+	return( lzav_decompress_page( src, dst, srcl, N ));
+}
+
+/**
+ * @brief Function compresses a trivially-copyable object, see compress().
+ *
+ * @param v Object to compress.
+ * @param[out] dst Destination buffer pointer, at least
+ * compress_bound< sizeof( T )>() bytes large.
+ * @return The length of compressed data, in bytes, 0 on error.
+ */
+
+template< typename T >
+inline int compress_obj( const T& v, void* const dst ) noexcept
+{
+	static_assert( std::is_trivially_copyable< T >::value,
+		"T should be trivially-copyable" );
+
+	return( compress< (int) sizeof( T )>( &v, dst ));
+}
+
+/**
+ * @brief Function decompresses a trivially-copyable object, previously
+ * compressed with compress_obj().
+ *
+ * @param[in] src Source (compressed) data pointer.
+ * @param srcl Source data length, in bytes.
+ * @param[out] v Receiving object. Its contents are undefined on error.
+ * @return `sizeof( T )`, or any negative value if some error happened.
+ */
+
+template< typename T >
+inline int decompress_obj( const void* const src, const int srcl,
+	T& v ) noexcept
+{
+	static_assert( std::is_trivially_copyable< T >::value,
+		"T should be trivially-copyable" );
+
+	return( decompress< (int) sizeof( T )>( src, &v, srcl ));
+}
+
+/**
+ * @brief Resumable LZAV stream decoder, see lzav_dstream_run().
+ *
+ * The decoder accepts input in chunks of any length, and never blocks:
+ * feed() returns when input is exhausted, or when an output limit is
+ * reached. The decoder refers to a destination buffer which should hold the
+ * whole decompressed data.
+ */
+
+class decoder
+{
+public:
+	/**
+	 * @brief Constructor.
+	 *
+	 * @param[out] dst Destination buffer pointer.
+	 * @param dstl Expected decompressed data length, in bytes.
+	 */
+
+	decoder( void* const dst, const size_t dstl ) noexcept
+	{
+		lzav_dstream_init( &ds_, dst, dstl );
+	}
+
+	/**
+	 * @brief Function decompresses the next input chunk.
+	 *
+	 * @param[in] src Input chunk pointer.
+	 * @param srcl Input chunk's length, in bytes.
+	 * @param[out] cl Receiver of the number of consumed input bytes.
+	 * @param outl Output limit, in bytes, 0 - no limit.
+	 * @return `LZAV_DS_END`, `LZAV_DS_INPUT`, `LZAV_DS_OUTPUT`, or a negative
+	 * `LZAV_E_` error code.
+	 */
+
+	int feed( const void* const src, const size_t srcl, size_t& cl,
+		const size_t outl = 0 ) noexcept
+	{
+		return( lzav_dstream_run( &ds_, src, srcl, &cl, outl ));
+	}
+
+	/**
+	 * @brief Function returns the number of final decompressed bytes at the
+	 * start of the destination buffer.
+	 */
+
+	size_t produced() const noexcept
+	{
+		return( ds_.wl );
+	}
+
+	const uint8_t* data() const noexcept
+	{
+		return( ds_.dst );
+	}
+
+	bool done() const noexcept
+	{
+		return( ds_.st == 0 && ds_.wl == ds_.dstl && ds_.lc == 0 );
+	}
+
+	/**
+	 * @brief Function returns a negative `LZAV_E_` error code, or 0 if no
+	 * error happened.
+	 */
+
+	int error() const noexcept
+	{
+		return( ds_.st );
+	}
+
+private:
+	lzav_dstream ds_; ///< Decompressor's state.
+};
+
+/**
+ * @brief Function decompresses a whole compressed data stream, and passes
+ * decompressed data to a function object in chunks, keeping only the LZ77
+ * window in memory, see lzav_decompress_cb().
+ *
+ * @param[in] src Source (compressed) data pointer.
+ * @param srcl Source data length, in bytes.
+ * @param dstl Expected decompressed data length, in bytes.
+ * @param f Function object, called as `f( p, l )` with a `const uint8_t*`
+ * chunk pointer and `size_t` chunk length; should return `bool`, `false`
+ * aborts decompression.
+ * @param cbl Output chunk length, in bytes, 0 - LZAV_SINK_CHUNK.
+ * @return 0, or a negative `LZAV_E_` error code.
+ */
+
+template< typename F >
+inline int decompress_sink( const void* const src, const size_t srcl,
+	const size_t dstl, F&& f, const size_t cbl = 0 )
+{
+	struct thunk
+	{
+		static int call( void* ctx, const void* p, size_t l )
+		{
+			return( !( *(typename std::remove_reference< F >::type*) ctx )(
+				(const uint8_t*) p, l ));
+		}
+	};
+
+	return( lzav_decompress_cb( src, srcl, dstl, cbl, &thunk::call, &f ));
+}
+
+#if defined( LZAV_CPP20 )
+
+/**
+ * @brief Move-only byte buffer.
+ *
+ * The buffer's storage is allocated from a `std::pmr` memory resource. Unlike
+ * `std::vector`, the buffer grows without value-initialization of the added
+ * bytes, which are then overwritten by compression or decompression. The
+ * storage is retained by clear() and resize() to a smaller length, so that a
+ * buffer can be reused without reallocations.
+ */
+
+class buffer
+{
+public:
+	/**
+	 * @brief Constructor creates an empty buffer.
+	 *
+	 * @param mr Memory resource to allocate storage from.
+	 */
+
+	explicit buffer( std::pmr::memory_resource* const mr =
+		std::pmr::get_default_resource() ) noexcept
+		: mr_( mr )
+		, p_( nullptr )
+		, l_( 0 )
+		, cap_( 0 )
+	{
+	}
+
+	buffer( buffer&& s ) noexcept
+		: mr_( s.mr_ )
+		, p_( std::exchange( s.p_, nullptr ))
+		, l_( std::exchange( s.l_, 0 ))
+		, cap_( std::exchange( s.cap_, 0 ))
+	{
+	}
+
+	buffer& operator = ( buffer&& s ) noexcept
+	{
+		if( this != &s )
+		{
+			release();
+			mr_ = s.mr_;
+			p_ = std::exchange( s.p_, nullptr );
+			l_ = std::exchange( s.l_, 0 );
+			cap_ = std::exchange( s.cap_, 0 );
+		}
+
+		return( *this );
+	}
+
+	buffer( const buffer& ) = delete;
+	buffer& operator = ( const buffer& ) = delete;
+
+	~buffer()
+	{
+		release();
+	}
+
+	std::byte* data() noexcept
+	{
+		return( p_ );
+	}
+
+	const std::byte* data() const noexcept
+	{
+		return( p_ );
+	}
+
+	size_t size() const noexcept
+	{
+		return( l_ );
+	}
+
+	size_t capacity() const noexcept
+	{
+		return( cap_ );
+	}
+
+	bool empty() const noexcept
+	{
+		return( l_ == 0 );
+	}
+
+	std::pmr::memory_resource* resource() const noexcept
+	{
+		return( mr_ );
+	}
+
+	std::span< std::byte > span() noexcept
+	{
+		return( std::span< std::byte >( p_, l_ ));
+	}
+
+	std::span< const std::byte > span() const noexcept
+	{
+		return( std::span< const std::byte >( p_, l_ ));
+	}
+
+	operator std::span< const std::byte > () const noexcept
+	{
+		return( span() );
+	}
+
+	/**
+	 * @brief Function ensures the buffer's capacity, retaining its contents.
+	 *
+	 * @param c Required capacity, in bytes.
+	 * @throws std::bad_alloc If memory resource's allocation fails.
+	 */
+
+	void reserve( const size_t c )
+	{
+		if( c <= cap_ )
+		{
+			return;
+		}
+
+		std::byte* const np = static_cast< std::byte* >(
+			mr_ -> allocate( c ));
+
+		if( l_ != 0 )
+		{
+			memcpy( np, p_, l_ );
+		}
+
+		release();
+		p_ = np;
+		cap_ = c;
+	}
+
+	/**
+	 * @brief Function changes the buffer's length. Bytes added beyond the
+	 * current length are left uninitialized. The capacity grows at least
+	 * 1.5 times, to amortize reallocations.
+	 *
+	 * @param l New length, in bytes.
+	 * @throws std::bad_alloc If memory resource's allocation fails.
+	 */
+
+	void resize( const size_t l )
+	{
+		if( l > cap_ )
+		{
+			const size_t gc = cap_ + cap_ / 2;
+			reserve( l > gc ? l : gc );
+		}
+
+		l_ = l;
+	}
+
+	void clear() noexcept
+	{
+		l_ = 0;
+	}
+
+private:
+	std::pmr::memory_resource* mr_; ///< Memory resource.
+	std::byte* p_; ///< Storage pointer.
+	size_t l_; ///< Length, in bytes.
+	size_t cap_; ///< Storage capacity, in bytes.
+
+	void release() noexcept
+	{
+		if( p_ != nullptr )
+		{
+			mr_ -> deallocate( p_, cap_ );
+			p_ = nullptr;
+		}
+
+		cap_ = 0;
+	}
+};
+
+/**
+ * @brief Move-only result of compression or decompression, with the output
+ * data and a status value.
+ */
+
+class result
+{
+public:
+	result( buffer&& d, const int st ) noexcept
+		: data_( std::move( d ))
+		, status_( st )
+	{
+	}
+
+	/**
+	 * @brief Function returns output length, or a negative `LZAV_E_` error
+	 * code.
+	 */
+
+	int status() const noexcept
+	{
+		return( status_ );
+	}
+
+	bool ok() const noexcept
+	{
+		return( status_ >= 0 );
+	}
+
+	explicit operator bool () const noexcept
+	{
+		return( ok() );
+	}
+
+	buffer& data() noexcept
+	{
+		return( data_ );
+	}
+
+	const buffer& data() const noexcept
+	{
+		return( data_ );
+	}
+
+	std::span< const std::byte > span() const noexcept
+	{
+		return( data_.span() );
+	}
+
+	/**
+	 * @brief Function moves the output buffer out of the result.
+	 */
+
+	buffer release() noexcept
+	{
+		return( std::move( data_ ));
+	}
+
+private:
+	buffer data_; ///< Output data.
+	int status_; ///< Output length, or a negative error code.
+};
+
+/**
+ * @brief Adapter of a `std::pmr` memory resource to the `lzav_alloc`
+ * interface of the C functions.
+ *
+ * Exceptions are not propagated through the C functions: an allocation
+ * failure is recorded, the C function fails, and then check() throws
+ * `std::bad_alloc`. The adapter is not copyable, as the allocator refers to
+ * it.
+ */
+
+class pmr_alloc
+{
+public:
+	/**
+	 * @brief Constructor.
+	 *
+	 * @param mr Memory resource to allocate blocks from.
+	 */
+
+	explicit pmr_alloc( std::pmr::memory_resource* const mr ) noexcept
+		: mr_( mr )
+		, failed_( false )
+	{
+		al_.alloc = do_alloc;
+		al_.free = do_free;
+		al_.opaque = this;
+	}
+
+	pmr_alloc( const pmr_alloc& ) = delete;
+	pmr_alloc& operator = ( const pmr_alloc& ) = delete;
+
+	/**
+	 * @brief Function returns the allocator to pass to the `_al` C
+	 * functions.
+	 */
+
+	const lzav_alloc* get() const noexcept
+	{
+		return( &al_ );
+	}
+
+	/**
+	 * @brief Function throws `std::bad_alloc` if an allocation has failed.
+	 */
+
+	void check() const
+	{
+		if( failed_ )
+		{
+			throw std::bad_alloc();
+		}
+	}
+
+private:
+	lzav_alloc al_; ///< Allocator that refers to this adapter.
+	std::pmr::memory_resource* mr_; ///< Memory resource.
+	bool failed_; ///< An allocation has failed.
+
+	static void* do_alloc( void* const opaque, const size_t size ) noexcept
+	{
+		pmr_alloc* const a = static_cast< pmr_alloc* >( opaque );
+
+		try
+		{
+			return( a -> mr_ -> allocate( size,
+				alignof( std::max_align_t )));
+		}
+		catch( ... )
+		{
+			a -> failed_ = true;
+			return( nullptr );
+		}
+	}
+
+	static void do_free( void* const opaque, void* const p,
+		const size_t size ) noexcept
+	{
+		static_cast< pmr_alloc* >( opaque ) -> mr_ -> deallocate( p, size,
+			alignof( std::max_align_t ));
+	}
+};
+
+/**
+ * @brief Reusable LZAV compressor.
+ *
+ * The compressor keeps the hash-table of the default compression algorithm
+ * between calls, allocated from a `std::pmr` memory resource, to avoid its
+ * reallocation on each call. The higher-ratio algorithm (level 2) allocates
+ * its hash-table from the same memory resource on each call, via pmr_alloc.
+ * A compressor is not thread-safe, each thread should use its own
+ * compressor.
+ */
+
+class compressor
+{
+public:
+	/**
+	 * @brief Constructor.
+	 *
+	 * @param mr Memory resource to allocate the hash-table from.
+	 */
+
+	explicit compressor( std::pmr::memory_resource* const mr =
+		std::pmr::get_default_resource() ) noexcept
+		: ht_( mr )
+	{
+	}
+
+	/**
+	 * @brief Function compresses data into a buffer, replacing its
+	 * contents. The buffer's storage is reused if it is large enough.
+	 *
+	 * @param src Source data.
+	 * @param[out] dst Destination buffer.
+	 * @param level Compression level: 1 - default, 2 - higher-ratio.
+	 * @return The length of compressed data, in bytes, 0 if `src` is empty,
+	 * or a negative `LZAV_E_` error code.
+	 * @throws std::bad_alloc If memory resource's allocation fails.
+	 */
+
+	int compress( const std::span< const std::byte > src, buffer& dst,
+		const int level = 1 )
+	{
+		dst.clear();
+
+		if( src.empty() )
+		{
+			return( 0 );
+		}
+
+		if( src.size() > 0x70000000 ) // Keeps bounds within `int` range.
+		{
+			return( LZAV_E_PARAMS );
+		}
+
+		const int srcl = (int) src.size();
+		const pmr_alloc al( ht_.resource() );
+		int cl;
+
+		if( level > 1 )
+		{
+			dst.resize( (size_t) lzav_compress_bound_hi( srcl ));
+			cl = lzav_compress_hi_al( src.data(), dst.data(), srcl,
+				(int) dst.size(), al.get() );
+		}
+		else
+		{
+			// Hash-table size selection matches that of lzav_compress()
+			// without an external buffer. Smaller hash-tables fit its
+			// on-stack buffer.
+
+			size_t htl = 1 << 14;
+
+			while( htl != ( 1 << 20 ) && ( htl >> 2 ) < (size_t) srcl )
+			{
+				htl <<= 1;
+			}
+
+			if( htl > ht_.size() && htl > ( 1 << 14 ))
+			{
+				ht_.clear(); // Avoids copying of the previous contents.
+				ht_.resize( htl );
+			}
+
+			dst.resize( (size_t) lzav_compress_bound( srcl ));
+			cl = lzav_compress_al( src.data(), dst.data(), srcl,
+				(int) dst.size(), ht_.data(), (int) ht_.size(), al.get() );
+		}
+
+		dst.resize( (size_t) cl );
+		al.check();
+
+		return( cl == 0 ? LZAV_E_PARAMS : cl );
+	}
+
+	/**
+	 * @brief Function compresses data into a new buffer, allocated from the
+	 * specified memory resource.
+	 *
+	 * @param src Source data.
+	 * @param level Compression level: 1 - default, 2 - higher-ratio.
+	 * @param mr Memory resource for the output buffer.
+	 * @throws std::bad_alloc If memory resource's allocation fails.
+	 */
+
+	result compress( const std::span< const std::byte > src,
+		const int level = 1, std::pmr::memory_resource* const mr =
+		std::pmr::get_default_resource() )
+	{
+		buffer d( mr );
+		const int st = compress( src, d, level );
+
+		return( result( std::move( d ), st ));
+	}
+
+private:
+	buffer ht_; ///< Hash-table storage, its length is the hash-table size.
+};
+
+/**
+ * @brief Function compresses data into a buffer, replacing its contents,
+ * see compressor::compress().
+ */
+
+inline int compress( const std::span< const std::byte > src, buffer& dst,
+	const int level = 1 )
+{
+	compressor c( dst.resource() );
+
+	return( c.compress( src, dst, level ));
+}
+
+/**
+ * @brief Function compresses data into a new buffer, see
+ * compressor::compress().
+ */
+
+inline result compress( const std::span< const std::byte > src,
+	const int level = 1, std::pmr::memory_resource* const mr =
+	std::pmr::get_default_resource() )
+{
+	compressor c( mr );
+
+	return( c.compress( src, level, mr ));
+}
+
+/**
+ * @brief Function decompresses data into a buffer, replacing its contents.
+ * The buffer's storage is reused if it is large enough.
+ *
+ * @param src Source (compressed) data.
+ * @param[out] dst Destination buffer.
+ * @param dstl Expected decompressed data length, in bytes.
+ * @return The length of decompressed data, in bytes, or a negative `LZAV_E_`
+ * error code. The buffer is cleared on error.
+ * @throws std::bad_alloc If memory resource's allocation fails.
+ */
+
+inline int decompress( const std::span< const std::byte > src, buffer& dst,
+	const int dstl )
+{
+	dst.clear();
+
+	if( src.size() > 0x7FFFFFFF || dstl < 0 )
+	{
+		return( LZAV_E_PARAMS );
+	}
+
+	dst.resize( (size_t) dstl );
+
+	const int r = lzav_decompress( src.data(), dst.data(), (int) src.size(),
+		dstl );
+
+	if( r < 0 )
+	{
+		dst.clear();
+	}
+
+	return( r );
+}
+
+/**
+ * @brief Function decompresses data into a new buffer, allocated from the
+ * specified memory resource.
+ *
+ * @param src Source (compressed) data.
+ * @param dstl Expected decompressed data length, in bytes.
+ * @param mr Memory resource for the output buffer.
+ * @throws std::bad_alloc If memory resource's allocation fails.
+ */
+
+inline result decompress( const std::span< const std::byte > src,
+	const int dstl, std::pmr::memory_resource* const mr =
+	std::pmr::get_default_resource() )
+{
+	buffer d( mr );
+	const int st = decompress( src, d, dstl );
+
+	return( result( std::move( d ), st ));
+}
+
+/**
+ * @brief Coroutine generator of decompressed output spans, see decode().
+ *
+ * The generator is move-only, and can be iterated with a range-based `for`
+ * loop. Each produced span remains valid while the destination buffer of
+ * the decoder is valid.
+ */
+
+class output_generator
+{
+public:
+	struct promise_type
+	{
+		std::span< const std::byte > cur; ///< Latest yielded output.
+
+		output_generator get_return_object() noexcept
+		{
+			return( output_generator( handle::from_promise( *this )));
+		}
+
+		std::suspend_always initial_suspend() const noexcept
+		{
+			return( std::suspend_always() );
+		}
+
+		std::suspend_always final_suspend() const noexcept
+		{
+			return( std::suspend_always() );
+		}
+
+		std::suspend_always yield_value(
+			const std::span< const std::byte > s ) noexcept
+		{
+			cur = s;
+			return( std::suspend_always() );
+		}
+
+		void return_void() const noexcept
+		{
+		}
+
+		void unhandled_exception() const
+		{
+			throw;
+		}
+	};
+
+	using handle = std::coroutine_handle< promise_type >;
+
+	class iterator
+	{
+	public:
+		explicit iterator( const handle h = nullptr ) noexcept
+			: h_( h )
+		{
+		}
+
+		std::span< const std::byte > operator * () const noexcept
+		{
+			return( h_.promise().cur );
+		}
+
+		iterator& operator ++ ()
+		{
+			h_.resume();
+			return( *this );
+		}
+
+		bool operator == ( std::default_sentinel_t ) const noexcept
+		{
+			return( h_ == nullptr || h_.done() );
+		}
+
+	private:
+		handle h_; ///< Generator's coroutine.
+	};
+
+	output_generator( output_generator&& s ) noexcept
+		: h_( std::exchange( s.h_, nullptr ))
+	{
+	}
+
+	output_generator& operator = ( output_generator&& s ) noexcept
+	{
+		if( this != &s )
+		{
+			if( h_ )
+			{
+				h_.destroy();
+			}
+
+			h_ = std::exchange( s.h_, nullptr );
+		}
+
+		return( *this );
+	}
+
+	~output_generator()
+	{
+		if( h_ )
+		{
+			h_.destroy();
+		}
+	}
+
+	iterator begin()
+	{
+		h_.resume();
+		return( iterator( h_ ));
+	}
+
+	std::default_sentinel_t end() const noexcept
+	{
+		return( std::default_sentinel );
+	}
+
+private:
+	handle h_; ///< Generator's coroutine.
+
+	explicit output_generator( const handle h ) noexcept
+		: h_( h )
+	{
+	}
+};
+
+/**
+ * @brief Function decompresses an input chunk, yielding newly-decompressed
+ * output after every `outl` or more bytes (at a block boundary), and after
+ * the input chunk is exhausted.
+ *
+ * This function allows an asynchronous reader to interleave decompression
+ * of a large input chunk with its other work, e.g., with sending of the
+ * decompressed data:
+ *
+ * @code
+ * for( auto out : lzav::decode( dec, chunk, 64 << 10 ))
+ * {
+ *     co_await send( out );
+ * }
+ *
+ * if( dec.error() != 0 ) ...
+ * @endcode
+ *
+ * @param dec Decoder, should outlive the generator.
+ * @param in Input chunk, should outlive the generator. The whole chunk is
+ * consumed, unless decompression finishes or fails earlier.
+ * @param outl Output length per yield, in bytes, 0 - yield once.
+ */
+
+inline output_generator decode( decoder& dec, std::span< const std::byte > in,
+	const size_t outl = 0 )
+{
+	while( true )
+	{
+		const size_t wl = dec.produced();
+		size_t cl;
+
+		const int r = dec.feed( in.data(), in.size(), cl, outl );
+		in = in.subspan( cl );
+
+		if( dec.produced() != wl )
+		{
+			co_yield std::span< const std::byte >(
+				(const std::byte*) dec.data() + wl, dec.produced() - wl );
+		}
+
+		if( r != LZAV_DS_OUTPUT )
+		{
+			co_return;
+		}
+	}
+}
+
+#endif // defined( LZAV_CPP20 )
+
+} // namespace lzav
+
+#endif // LZAV_HPP_INCLUDED
@@ -0,0 +1,889 @@
+/**
+ * @file lzav_arc.h
+ *
+ * @version 4.5
+ *
+ * @brief The inclusion file for the "LZAV" archive of named compressed
+ * blobs.
+ *
+ * An archive stores many independently-compressed named entries (e.g.,
+ * static assets) in a single file, with an index sorted by name hash. An
+ * archive reader memory-maps the archive file, and performs no parsing on
+ * open: entries are looked up by binary search over the mapped index, and
+ * entry names and compressed data are accessed in-place. A single entry is
+ * decompressed on demand.
+ *
+ * Archive layout (all values are little-endian):
+ *
+ * Archive header, `LZAV_ARC_HDR_LEN` bytes:
+ * 0-3: `LZAV_ARC_MAGIC` value.
+ * 4: Archive format version, `LZAV_ARC_VER`.
+ * 5-7: Reserved, zero.
+ * 8-11: The number of entries.
+ * 12-15: Reserved, zero.
+ * 16-23: Index offset.
+ * 24-31: Name table offset.
+ *
+ * Entries' compressed data follows the header. The index follows entries'
+ * data, and consists of `LZAV_ARC_IDX_LEN`-byte items, sorted by name hash,
+ * and then by name:
+ * 0-7: Compressed data offset.
+ * 8-11: Compressed data length, ORed with `LZAV_FRAME_RAW` if the data is
+ * stored uncompressed.
+ * 12-15: Uncompressed data length.
+ * 16-19: The lower 32 bits of lzav_hash64() of the name.
+ * 20-23: Name offset, relative to the name table.
+ * 24-27: Name length.
+ * 28-31: The lower 32 bits of lzav_hash64() of the uncompressed data.
+ *
+ * The name table follows the index, and extends to the end of the file.
+ * Names are not zero-terminated.
+ *
+ * Description is available at https://github.com/avaneev/lzav
+ *
+ * E-mail: aleksey.vaneev@gmail.com or info@voxengo.com
+ *
+ * LICENSE:
+ *
+ * Copyright (c) 2023-2024 Aleksey Vaneev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef LZAV_ARC_INCLUDED
+#define LZAV_ARC_INCLUDED
+
+#include "lzav_file.h"
+
+#define LZAV_ARC_MAGIC 0x52414C8CU ///< Archive identifier, "\x8CLAR" bytes.
+#define LZAV_ARC_VER 1 ///< Archive format version.
+#define LZAV_ARC_HDR_LEN 32 ///< Archive header length, in bytes.
+#define LZAV_ARC_IDX_LEN 32 ///< Index item length, in bytes.
+
+/**
+ * @brief Archive entry information. Pointers refer to the archive's memory.
+ */
+
+typedef struct
+{
+	const char* name; ///< Entry's name, not zero-terminated.
+	size_t namel; ///< Name's length, in bytes.
+	const uint8_t* data; ///< Compressed data.
+	size_t cl; ///< Compressed data length.
+	size_t len; ///< Uncompressed data length.
+	int raw; ///< Non-zero if data is stored uncompressed.
+	uint32_t check; ///< Uncompressed data checksum.
+} lzav_arc_entry;
+
+/**
+ * @brief Archive reader.
+ */
+
+typedef struct
+{
+	const uint8_t* p; ///< Archive's data.
+	size_t l; ///< Archive's length.
+	const uint8_t* idx; ///< Index.
+	const uint8_t* names; ///< Name table.
+	size_t namesl; ///< Name table's length.
+	uint32_t n; ///< The number of entries.
+	int own; ///< 1 - `p` is mapped, 2 - `p` is allocated, 0 - external.
+	size_t c; ///< Allocated capacity of `p`, if `own` is 2.
+	lzav_alloc al; ///< Allocator of `p`.
+} lzav_arc;
+
+/**
+ * @brief Function stores a 64-bit value in little-endian order.
+ */
+
+static inline void lzav_arc_st64( uint8_t* const p, const uint64_t v )
+{
+	lzav_frame_st32( p, (uint32_t) v );
+	lzav_frame_st32( p + 4, (uint32_t) ( v >> 32 ));
+}
+
+/**
+ * @brief Function loads a 64-bit value stored in little-endian order.
+ */
+
+static inline uint64_t lzav_arc_ld64( const uint8_t* const p )
+{
+	return( lzav_frame_ld32( p ) |
+		(uint64_t) lzav_frame_ld32( p + 4 ) << 32 );
+}
+
+/**
+ * @brief Function ensures buffer's capacity, preserving contents. The
+ * capacity grows at least twice, to amortize reallocations.
+ *
+ * @param al Allocator, 0 - the global allocator.
+ * @param[in,out] pbuf Pointer to the buffer pointer.
+ * @param[in,out] pc Pointer to the buffer's capacity.
+ * @param l Required capacity.
+ * @return 1 on success, 0 if not enough memory.
+ */
+
+static inline int lzav_arc_grow( const lzav_alloc* const al,
+	void** const pbuf, size_t* const pc, const size_t l )
+{
+	if( *pc < l )
+	{
+		const size_t c = ( l > *pc * 2 ? l : *pc * 2 );
+		void* const p = lzav_realloc( al, *pbuf, *pc, c );
+
+		if( p == 0 )
+		{
+			return( 0 );
+		}
+
+		*pbuf = p;
+		*pc = c;
+	}
+
+	return( 1 );
+}
+
+/**
+ * @brief Function returns archive's name hash value.
+ */
+
+static inline uint32_t lzav_arc_name_hash( const char* const name,
+	const size_t namel )
+{
+	return( (uint32_t) lzav_hash64( name, namel, 0 ));
+}
+
+/**
+ * @brief Function opens an archive residing in memory.
+ *
+ * Only the header is validated: index items are validated on access.
+ *
+ * @param[out] a Archive reader.
+ * @param p Archive's data, should remain valid while the reader is used.
+ * @param l Archive's length.
+ * @return 0 on success, or `LZAV_E_UNKFMT` if the data is not a valid
+ * archive.
+ */
+
+static inline int lzav_arc_open_mem( lzav_arc* const a, const void* const p,
+	const size_t l )
+{
+	const uint8_t* const s = (const uint8_t*) p;
+
+	memset( a, 0, sizeof( lzav_arc ));
+
+	if( s == 0 || l < LZAV_ARC_HDR_LEN ||
+		lzav_frame_ld32( s ) != LZAV_ARC_MAGIC || s[ 4 ] != LZAV_ARC_VER )
+	{
+		return( LZAV_E_UNKFMT );
+	}
+
+	const uint64_t n = lzav_frame_ld32( s + 8 );
+	const uint64_t io = lzav_arc_ld64( s + 16 );
+	const uint64_t no = lzav_arc_ld64( s + 24 );
+
+	if( io < LZAV_ARC_HDR_LEN || io > l || no > l ||
+		n > ( l - io ) / LZAV_ARC_IDX_LEN ||
+		no < io + n * LZAV_ARC_IDX_LEN )
+	{
+		return( LZAV_E_UNKFMT );
+	}
+
+	a -> p = s;
+	a -> l = l;
+	a -> idx = s + io;
+	a -> names = s + no;
+	a -> namesl = l - (size_t) no;
+	a -> n = (uint32_t) n;
+
+	return( 0 );
+}
+
+/**
+ * @brief Function loads a file for random read access.
+ *
+ * If memory-mapping is available, the file is mapped, with a random access
+ * hint. Otherwise, the whole file is read into memory.
+ *
+ * @param fn File name.
+ * @param al Allocator of the file's contents, if the file is not mapped.
+ * @param[out] pp Receiver of file's data pointer.
+ * @param[out] pl Receiver of file's length.
+ * @param[out] pc Receiver of allocated capacity of `*pp`, if the file was
+ * read into memory.
+ * @return 1 if the file was mapped, 2 if it was read into memory, or a
+ * negative `LZAV_E_` error code. Should be released via lzav_arc_unload().
+ */
+
+static inline int lzav_arc_load( const char* const fn,
+	const lzav_alloc* const al, const uint8_t** const pp, size_t* const pl,
+	size_t* const pc )
+{
+	void* p = 0;
+	size_t l = 0;
+	int r;
+
+	*pp = 0;
+	*pl = 0;
+	*pc = 0;
+
+#if LZAV_FILE_MMAP
+
+	r = lzav_file_map_src( fn, &p, &l );
+
+	if( r < 0 )
+	{
+		return( r );
+	}
+
+	if( r > 0 )
+	{
+		if( p != 0 )
+		{
+			posix_madvise( p, l, POSIX_MADV_RANDOM );
+		}
+
+		*pp = (const uint8_t*) p;
+		*pl = l;
+
+		return( 1 );
+	}
+
+#endif // LZAV_FILE_MMAP
+
+	FILE* const f = fopen( fn, "rb" );
+	size_t c = 0;
+
+	if( f == 0 )
+	{
+		return( LZAV_E_FILE );
+	}
+
+	r = 2;
+
+	while( 1 )
+	{
+		if( !lzav_arc_grow( al, &p, &c, l + ( 1 << 16 )))
+		{
+			r = LZAV_E_NOMEM;
+			break;
+		}
+
+		const size_t rl = fread( (uint8_t*) p + l, 1, c - l, f );
+		l += rl;
+
+		if( rl == 0 )
+		{
+			if( ferror( f ))
+			{
+				r = LZAV_E_FILE;
+			}
+
+			break;
+		}
+	}
+
+	fclose( f );
+
+	if( r < 0 )
+	{
+		lzav_free( al, p, c );
+		return( r );
+	}
+
+	*pp = (const uint8_t*) p;
+	*pl = l;
+	*pc = c;
+
+	return( r );
+}
+
+/**
+ * @brief Function releases a file loaded via lzav_arc_load().
+ *
+ * @param p File's data pointer.
+ * @param l File's length.
+ * @param own Value returned by lzav_arc_load(), 0 - not loaded.
+ * @param c Allocated capacity of `p`.
+ * @param al Allocator passed to lzav_arc_load().
+ */
+
+static inline void lzav_arc_unload( const uint8_t* const p, const size_t l,
+	const int own, const size_t c, const lzav_alloc* const al )
+{
+#if LZAV_FILE_MMAP
+	if( own == 1 && p != 0 )
+	{
+		munmap( (void*) p, l );
+	}
+#endif // LZAV_FILE_MMAP
+
+	if( own == 2 )
+	{
+		lzav_free( al, (void*) p, c );
+	}
+}
+
+/**
+ * @brief Function opens an archive file.
+ *
+ * The file is loaded via lzav_arc_load().
+ *
+ * @param[out] a Archive reader, should be released via lzav_arc_close().
+ * @param fn File name.
+ * @param al Allocator of the file's contents, if the file is not mapped;
+ * 0 - the global allocator.
+ * @return 0 on success, or a negative `LZAV_E_` error code.
+ */
+
+static inline int lzav_arc_open_al( lzav_arc* const a, const char* const fn,
+	const lzav_alloc* const al )
+{
+	const lzav_alloc cal = lzav_alloc_use( al );
+	const uint8_t* p;
+	size_t l;
+	size_t c;
+
+	memset( a, 0, sizeof( lzav_arc ));
+
+	const int own = lzav_arc_load( fn, &cal, &p, &l, &c );
+
+	if( own < 0 )
+	{
+		return( own );
+	}
+
+	const int r = lzav_arc_open_mem( a, p, l );
+
+	if( r < 0 )
+	{
+		lzav_arc_unload( p, l, own, c, &cal );
+		return( r );
+	}
+
+	a -> own = own;
+	a -> c = c;
+	a -> al = cal;
+
+	return( 0 );
+}
+
+/**
+ * @brief Function opens an archive file, with the global allocator. See
+ * lzav_arc_open_al().
+ */
+
+static inline int lzav_arc_open( lzav_arc* const a, const char* const fn )
+{
+	return( lzav_arc_open_al( a, fn, 0 ));
+}
+
+/**
+ * @brief Function releases an archive reader.
+ */
+
+static inline void lzav_arc_close( lzav_arc* const a )
+{
+	lzav_arc_unload( a -> p, a -> l, a -> own, a -> c, &a -> al );
+	memset( a, 0, sizeof( lzav_arc ));
+}
+
+/**
+ * @brief Function returns information about an archive entry by its index
+ * position.
+ *
+ * @param a Archive reader.
+ * @param i Entry's index position, 0 to `a -> n` - 1.
+ * @param[out] e Receiver of entry's information.
+ * @return 0 on success, `LZAV_E_PARAMS` if `i` is out of range, or
+ * `LZAV_E_UNKFMT` if the index item is invalid.
+ */
+
+static inline int lzav_arc_get( const lzav_arc* const a, const uint32_t i,
+	lzav_arc_entry* const e )
+{
+	if( i >= a -> n )
+	{
+		return( LZAV_E_PARAMS );
+	}
+
+	const uint8_t* const ix = a -> idx + (size_t) i * LZAV_ARC_IDX_LEN;
+	const uint64_t o = lzav_arc_ld64( ix );
+	const uint32_t cl = lzav_frame_ld32( ix + 8 );
+	const size_t no = lzav_frame_ld32( ix + 20 );
+	const size_t nl = lzav_frame_ld32( ix + 24 );
+	const size_t dl = cl & ~LZAV_FRAME_RAW;
+
+	if( o > a -> l || dl > a -> l - o || no > a -> namesl ||
+		nl > a -> namesl - no )
+	{
+		return( LZAV_E_UNKFMT );
+	}
+
+	e -> name = (const char*) a -> names + no;
+	e -> namel = nl;
+	e -> data = a -> p + o;
+	e -> cl = dl;
+	e -> len = lzav_frame_ld32( ix + 12 );
+	e -> raw = (( cl & LZAV_FRAME_RAW ) != 0 );
+	e -> check = lzav_frame_ld32( ix + 28 );
+
+	return( 0 );
+}
+
+/**
+ * @brief Function finds an archive entry by its name.
+ *
+ * @param a Archive reader.
+ * @param name Entry's name.
+ * @param namel Name's length, in bytes.
+ * @param[out] e Receiver of entry's information, can be 0.
+ * @return Entry's index position, `LZAV_E_NOENT` if the entry was not found,
+ * or `LZAV_E_UNKFMT` if the index is invalid.
+ */
+
+static inline int lzav_arc_find( const lzav_arc* const a,
+	const char* const name, const size_t namel, lzav_arc_entry* const e )
+{
+	const uint32_t h = lzav_arc_name_hash( name, namel );
+	uint32_t lo = 0;
+	uint32_t hi = a -> n;
+
+	while( lo < hi ) // Find the first item with a matching hash.
+	{
+		const uint32_t m = lo + ( hi - lo ) / 2;
+
+		if( lzav_frame_ld32( a -> idx + (size_t) m * LZAV_ARC_IDX_LEN +
+			16 ) < h )
+		{
+			lo = m + 1;
+		}
+		else
+		{
+			hi = m;
+		}
+	}
+
+	lzav_arc_entry te;
+	lzav_arc_entry* const pe = ( e == 0 ? &te : e );
+
+	while( lo < a -> n && lzav_frame_ld32( a -> idx +
+		(size_t) lo * LZAV_ARC_IDX_LEN + 16 ) == h )
+	{
+		const int r = lzav_arc_get( a, lo, pe );
+
+		if( r < 0 )
+		{
+			return( r );
+		}
+
+		if( pe -> namel == namel && memcmp( pe -> name, name, namel ) == 0 )
+		{
+			return( (int) lo );
+		}
+
+		lo++;
+	}
+
+	return( LZAV_E_NOENT );
+}
+
+/**
+ * @brief Function decompresses an archive entry, and verifies its checksum.
+ *
+ * @param e Entry's information.
+ * @param[out] dst Destination buffer, at least `e -> len` bytes large.
+ * @return The length of decompressed data, or a negative `LZAV_E_` error
+ * code.
+ */
+
+static inline int lzav_arc_decompress( const lzav_arc_entry* const e,
+	void* const dst )
+{
+	if( e -> len > 0x7FFFFFFF || e -> cl > 0x7FFFFFFF )
+	{
+		return( LZAV_E_PARAMS );
+	}
+
+	if( e -> raw )
+	{
+		if( e -> cl != e -> len )
+		{
+			return( LZAV_E_DSTLEN );
+		}
+
+		if( e -> len != 0 )
+		{
+			memcpy( dst, e -> data, e -> len );
+		}
+	}
+	else
+	{
+		const int r = lzav_decompress( e -> data, dst, (int) e -> cl,
+			(int) e -> len );
+
+		if( r < 0 )
+		{
+			return( r );
+		}
+	}
+
+	if( (uint32_t) lzav_hash64( dst, e -> len, 0 ) != e -> check )
+	{
+		return( LZAV_E_CHECK );
+	}
+
+	return( (int) e -> len );
+}
+
+/**
+ * @brief Archive writer's entry.
+ */
+
+typedef struct
+{
+	uint64_t o; ///< Compressed data offset.
+	uint32_t cl; ///< Compressed data length, with the raw flag.
+	uint32_t len; ///< Uncompressed data length.
+	uint32_t h; ///< Name hash.
+	uint32_t check; ///< Uncompressed data checksum.
+	char* name; ///< Name, allocated.
+	size_t namel; ///< Name's length.
+} lzav_arc_wentry;
+
+/**
+ * @brief Archive writer.
+ */
+
+typedef struct
+{
+	FILE* f; ///< Archive file.
+	char* fn; ///< Archive file's name, allocated.
+	uint64_t pos; ///< Current write position.
+	lzav_arc_wentry* e; ///< Entries.
+	size_t n; ///< The number of entries.
+	size_t c; ///< Capacity of `e`, in bytes.
+	uint8_t* buf; ///< Compression buffer.
+	size_t bufc; ///< Compression buffer's capacity.
+	int level; ///< Compression level.
+	int err; ///< Sticky error code, 0 if none.
+	lzav_alloc al; ///< Allocator of writer's buffers, also used by
+		///< compression.
+} lzav_arc_writer;
+
+/**
+ * @brief Function creates an archive file for writing.
+ *
+ * @param[out] w Archive writer, should be finished via
+ * lzav_arc_writer_close().
+ * @param fn Archive file name. An existing file is overwritten.
+ * @param level Compression level: 1 - default, 2 - higher-ratio, 3 -
+ * higher-ratio with faster decompression; can be ORed with LZAV_FRAME_WIN().
+ * @param al Allocator, 0 - the global allocator.
+ * @return 0 on success, or a negative `LZAV_E_` error code.
+ */
+
+static inline int lzav_arc_writer_open_al( lzav_arc_writer* const w,
+	const char* const fn, const int level, const lzav_alloc* const al )
+{
+	uint8_t hdr[ LZAV_ARC_HDR_LEN ];
+	const size_t fnl = strlen( fn );
+
+	memset( w, 0, sizeof( lzav_arc_writer ));
+	w -> level = level;
+	w -> al = lzav_alloc_use( al );
+	w -> fn = (char*) lzav_malloc( &w -> al, fnl + 1 );
+
+	if( w -> fn == 0 )
+	{
+		return( LZAV_E_NOMEM );
+	}
+
+	memcpy( w -> fn, fn, fnl + 1 );
+	w -> f = fopen( fn, "wb" );
+
+	if( w -> f == 0 )
+	{
+		lzav_free( &w -> al, w -> fn, fnl + 1 );
+		w -> fn = 0;
+		return( LZAV_E_FILE );
+	}
+
+	// The header is rewritten on close.
+
+	memset( hdr, 0, sizeof( hdr ));
+
+	if( fwrite( hdr, 1, sizeof( hdr ), w -> f ) != sizeof( hdr ))
+	{
+		w -> err = LZAV_E_FILE;
+	}
+
+	w -> pos = sizeof( hdr );
+
+	return( w -> err );
+}
+
+/**
+ * @brief Function creates an archive file for writing, with the global
+ * allocator. See lzav_arc_writer_open_al().
+ */
+
+static inline int lzav_arc_writer_open( lzav_arc_writer* const w,
+	const char* const fn, const int level )
+{
+	return( lzav_arc_writer_open_al( w, fn, level, 0 ));
+}
+
+/**
+ * @brief Function compresses and adds an entry to the archive. The data is
+ * stored uncompressed if it does not compress.
+ *
+ * @param w Archive writer.
+ * @param name Entry's name.
+ * @param namel Name's length, in bytes.
+ * @param data Entry's data.
+ * @param len Data length, in bytes, below 2 GiB.
+ * @return 0 on success, or a negative `LZAV_E_` error code. Errors are
+ * sticky, and are also returned by lzav_arc_writer_close().
+ */
+
+static inline int lzav_arc_add( lzav_arc_writer* const w,
+	const char* const name, const size_t namel, const void* const data,
+	const size_t len )
+{
+	if( w -> err != 0 )
+	{
+		return( w -> err );
+	}
+
+	if( len > 0x70000000 || namel > 0x7FFFFFFF )
+	{
+		return( LZAV_E_PARAMS );
+	}
+
+	const int srcl = (int) len;
+	const int hi = (( w -> level & 7 ) > 1 );
+	const int bl = ( hi ? lzav_compress_bound_hi( srcl ) :
+		lzav_compress_bound( srcl ));
+
+	lzav_arc_wentry* e;
+
+	if( !lzav_arc_grow( &w -> al, (void**) &w -> e, &w -> c,
+		( w -> n + 1 ) * sizeof( lzav_arc_wentry )) ||
+		!lzav_file_reserve( &w -> al, &w -> buf, &w -> bufc, (size_t) bl ))
+	{
+		w -> err = LZAV_E_NOMEM;
+		return( w -> err );
+	}
+
+	e = w -> e + w -> n;
+	e -> name = (char*) lzav_malloc( &w -> al, namel + 1 );
+
+	if( e -> name == 0 )
+	{
+		w -> err = LZAV_E_NOMEM;
+		return( w -> err );
+	}
+
+	memcpy( e -> name, name, namel );
+	e -> name[ namel ] = 0;
+	e -> namel = namel;
+	e -> h = lzav_arc_name_hash( name, namel );
+	e -> o = w -> pos;
+	e -> len = (uint32_t) len;
+	e -> check = (uint32_t) lzav_hash64( data, len, 0 );
+	w -> n++;
+
+	int cl = 0;
+
+	if( srcl > 0 )
+	{
+		const int wl = lzav_frame_win_log( w -> level );
+
+		cl = ( hi ?
+			lzav_compress_hi_2( data, w -> buf, srcl, bl, &w -> al, wl,
+			( w -> level & 7 ) == 3 ) :
+			lzav_compress_2( data, w -> buf, srcl, bl, 0, 0, &w -> al, wl,
+			( w -> level & LZAV_FRAME_LDM ) != 0 ));
+	}
+
+	const void* wd = w -> buf;
+
+	if( cl == 0 || cl >= srcl )
+	{
+		cl = srcl;
+		wd = data;
+		e -> cl = (uint32_t) cl | LZAV_FRAME_RAW;
+	}
+	else
+	{
+		e -> cl = (uint32_t) cl;
+	}
+
+	if( cl != 0 && fwrite( wd, 1, (size_t) cl, w -> f ) != (size_t) cl )
+	{
+		w -> err = LZAV_E_FILE;
+	}
+
+	w -> pos += (uint64_t) cl;
+
+	return( w -> err );
+}
+
+static inline int lzav_arc_wentry_cmp( const void* const p1,
+	const void* const p2 )
+{
+	const lzav_arc_wentry* const e1 = (const lzav_arc_wentry*) p1;
+	const lzav_arc_wentry* const e2 = (const lzav_arc_wentry*) p2;
+
+	if( e1 -> h != e2 -> h )
+	{
+		return( e1 -> h < e2 -> h ? -1 : 1 );
+	}
+
+	const size_t l = ( e1 -> namel < e2 -> namel ? e1 -> namel :
+		e2 -> namel );
+
+	const int r = memcmp( e1 -> name, e2 -> name, l );
+
+	if( r != 0 )
+	{
+		return( r );
+	}
+
+	return(( e1 -> namel > e2 -> namel ) - ( e1 -> namel < e2 -> namel ));
+}
+
+/**
+ * @brief Function writes archive's index and name table, finishes the
+ * archive, and releases the writer. On error, the archive file is removed.
+ *
+ * @param w Archive writer.
+ * @return 0 on success, `LZAV_E_PARAMS` if entry names are not unique, or
+ * another negative `LZAV_E_` error code.
+ */
+
+static inline int lzav_arc_writer_close( lzav_arc_writer* const w )
+{
+	uint8_t ix[ LZAV_ARC_IDX_LEN ];
+	size_t i;
+
+	if( w -> f == 0 )
+	{
+		return( w -> err != 0 ? w -> err : LZAV_E_PARAMS );
+	}
+
+	if( w -> err == 0 && w -> n != 0 )
+	{
+		qsort( w -> e, w -> n, sizeof( lzav_arc_wentry ),
+			lzav_arc_wentry_cmp );
+
+		for( i = 1; i < w -> n; i++ )
+		{
+			if( lzav_arc_wentry_cmp( w -> e + i - 1, w -> e + i ) == 0 )
+			{
+				w -> err = LZAV_E_PARAMS;
+				break;
+			}
+		}
+	}
+
+	const uint64_t io = w -> pos;
+	const uint64_t no = io + (uint64_t) w -> n * LZAV_ARC_IDX_LEN;
+	uint64_t nl = 0;
+
+	for( i = 0; i < w -> n && w -> err == 0; i++ )
+	{
+		const lzav_arc_wentry* const e = w -> e + i;
+
+		if( nl + e -> namel > 0xFFFFFFFF || w -> n > 0xFFFFFFFF )
+		{
+			w -> err = LZAV_E_PARAMS;
+			break;
+		}
+
+		lzav_arc_st64( ix, e -> o );
+		lzav_frame_st32( ix + 8, e -> cl );
+		lzav_frame_st32( ix + 12, e -> len );
+		lzav_frame_st32( ix + 16, e -> h );
+		lzav_frame_st32( ix + 20, (uint32_t) nl );
+		lzav_frame_st32( ix + 24, (uint32_t) e -> namel );
+		lzav_frame_st32( ix + 28, e -> check );
+		nl += e -> namel;
+
+		if( fwrite( ix, 1, sizeof( ix ), w -> f ) != sizeof( ix ))
+		{
+			w -> err = LZAV_E_FILE;
+		}
+	}
+
+	for( i = 0; i < w -> n && w -> err == 0; i++ )
+	{
+		const lzav_arc_wentry* const e = w -> e + i;
+
+		if( fwrite( e -> name, 1, e -> namel, w -> f ) != e -> namel )
+		{
+			w -> err = LZAV_E_FILE;
+		}
+	}
+
+	if( w -> err == 0 )
+	{
+		uint8_t hdr[ LZAV_ARC_HDR_LEN ];
+		memset( hdr, 0, sizeof( hdr ));
+
+		lzav_frame_st32( hdr, LZAV_ARC_MAGIC );
+		hdr[ 4 ] = LZAV_ARC_VER;
+		lzav_frame_st32( hdr + 8, (uint32_t) w -> n );
+		lzav_arc_st64( hdr + 16, io );
+		lzav_arc_st64( hdr + 24, no );
+
+		if( fseek( w -> f, 0, SEEK_SET ) != 0 ||
+			fwrite( hdr, 1, sizeof( hdr ), w -> f ) != sizeof( hdr ))
+		{
+			w -> err = LZAV_E_FILE;
+		}
+	}
+
+	if( fclose( w -> f ) != 0 && w -> err == 0 )
+	{
+		w -> err = LZAV_E_FILE;
+	}
+
+	if( w -> err != 0 )
+	{
+		remove( w -> fn );
+	}
+
+	for( i = 0; i < w -> n; i++ )
+	{
+		lzav_free( &w -> al, w -> e[ i ].name, w -> e[ i ].namel + 1 );
+	}
+
+	const int r = w -> err;
+
+	lzav_free( &w -> al, w -> buf, w -> bufc );
+	lzav_free( &w -> al, w -> e, w -> c );
+	lzav_free( &w -> al, w -> fn, strlen( w -> fn ) + 1 );
+	memset( w, 0, sizeof( lzav_arc_writer ));
+
+	return( r );
+}
+
+#endif // LZAV_ARC_INCLUDED
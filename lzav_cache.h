@@ -0,0 +1,841 @@
+/**
+ * @file lzav_cache.h
+ *
+ * @version 4.5
+ *
+ * @brief The inclusion file for the "LZAV" decompressed-block cache, and
+ * random-access reading of framed data and archives.
+ *
+ * The cache keeps decompressed blocks (framed data segments, or archive
+ * entries) in memory, keyed by a container identifier and a block
+ * identifier, and limited by a total length in bytes. The cache is split
+ * into `LZAV_CACHE_SHARDS` independently-locked shards, selected by key
+ * hash, so that concurrent readers rarely contend. Each shard evicts blocks
+ * via the CLOCK (second-chance) algorithm, which approximates LRU without
+ * reordering a list on each hit.
+ *
+ * The lzav_frame_pread() function reads an arbitrary range of uncompressed
+ * data from in-memory (e.g., memory-mapped) framed data, using a segment
+ * index built once by lzav_frame_index_build(). Segments are looked up in
+ * the cache first, and only missed segments are decompressed, so repeated
+ * reads of hot segments run at memory copy speed.
+ *
+ * Description is available at https://github.com/avaneev/lzav
+ *
+ * E-mail: aleksey.vaneev@gmail.com or info@voxengo.com
+ *
+ * LICENSE:
+ *
+ * Copyright (c) 2023-2024 Aleksey Vaneev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef LZAV_CACHE_INCLUDED
+#define LZAV_CACHE_INCLUDED
+
+#include "lzav_arc.h"
+
+#define LZAV_CACHE_SHARDS 16 ///< The number of cache shards, a power of 2.
+
+/**
+ * @brief Cache entry.
+ */
+
+typedef struct
+{
+	uint64_t cid; ///< Container identifier.
+	uint64_t bid; ///< Block identifier.
+	uint8_t* data; ///< Block's data, `len` + 1 bytes allocated, 0 if the
+		///< slot is free.
+	size_t len; ///< Block's length.
+	uint32_t next; ///< Next entry in the bucket's chain, plus 1, or 0.
+	int ref; ///< CLOCK reference bit.
+} lzav_cache_ent;
+
+/**
+ * @brief Cache shard.
+ */
+
+typedef struct
+{
+	lzav_mutex_t mtx; ///< Shard's mutex.
+	lzav_cache_ent* e; ///< Entry slots.
+	size_t ec; ///< Capacity of `e`, in bytes.
+	uint32_t n; ///< The number of entry slots in use, including free ones.
+	uint32_t fr; ///< The first free slot, plus 1, or 0.
+	uint32_t* b; ///< Bucket chain heads, plus 1.
+	uint32_t bm; ///< Bucket index mask.
+	uint32_t cnt; ///< The number of cached blocks.
+	uint32_t hand; ///< CLOCK hand.
+	size_t bytes; ///< The total length of cached blocks.
+	size_t cap; ///< The maximal total length of cached blocks.
+	uint64_t hits; ///< The number of lookup hits.
+	uint64_t misses; ///< The number of lookup misses.
+} lzav_cache_shard;
+
+/**
+ * @brief Decompressed-block cache.
+ */
+
+typedef struct
+{
+	lzav_cache_shard s[ LZAV_CACHE_SHARDS ]; ///< Shards.
+	lzav_alloc al; ///< Allocator of cache's structures and blocks.
+} lzav_cache;
+
+/**
+ * @brief Function allocates zero-initialized bucket chain heads.
+ *
+ * @param al Allocator.
+ * @param bm Bucket index mask.
+ */
+
+static inline uint32_t* lzav_cache_alloc_b( const lzav_alloc* const al,
+	const uint32_t bm )
+{
+	const size_t l = ( (size_t) bm + 1 ) * sizeof( uint32_t );
+	uint32_t* const b = (uint32_t*) lzav_malloc( al, l );
+
+	if( b != 0 )
+	{
+		memset( b, 0, l );
+	}
+
+	return( b );
+}
+
+/**
+ * @brief Function initializes the cache.
+ *
+ * @param[out] c Cache, should be released via lzav_cache_free().
+ * @param cap The maximal total length of cached blocks, in bytes. Each shard
+ * receives an equal part, which also limits the length of a cacheable
+ * block.
+ * @param al Allocator, 0 - the global allocator.
+ * @return 0 on success, or `LZAV_E_NOMEM`.
+ */
+
+static inline int lzav_cache_init_al( lzav_cache* const c, const size_t cap,
+	const lzav_alloc* const al )
+{
+	int i;
+
+	memset( c, 0, sizeof( lzav_cache ));
+	c -> al = lzav_alloc_use( al );
+
+	for( i = 0; i < LZAV_CACHE_SHARDS; i++ )
+	{
+		lzav_cache_shard* const s = c -> s + i;
+
+		s -> bm = 63;
+		s -> b = lzav_cache_alloc_b( &c -> al, s -> bm );
+
+		if( s -> b == 0 )
+		{
+			while( i > 0 )
+			{
+				i--;
+				lzav_free( &c -> al, c -> s[ i ].b,
+					( (size_t) c -> s[ i ].bm + 1 ) * sizeof( uint32_t ));
+
+				lzav_mutex_destroy( &c -> s[ i ].mtx );
+			}
+
+			return( LZAV_E_NOMEM );
+		}
+
+		s -> cap = cap / LZAV_CACHE_SHARDS;
+		lzav_mutex_init( &s -> mtx );
+	}
+
+	return( 0 );
+}
+
+/**
+ * @brief Function initializes the cache, with the global allocator. See
+ * lzav_cache_init_al().
+ */
+
+static inline int lzav_cache_init( lzav_cache* const c, const size_t cap )
+{
+	return( lzav_cache_init_al( c, cap, 0 ));
+}
+
+/**
+ * @brief Function allocates a block's buffer, for lzav_cache_insert().
+ *
+ * @param c Cache.
+ * @param len Block's length.
+ * @return Buffer's pointer, or 0 if not enough memory.
+ */
+
+static inline uint8_t* lzav_cache_alloc( lzav_cache* const c,
+	const size_t len )
+{
+	return( (uint8_t*) lzav_malloc( &c -> al, len + 1 ));
+}
+
+/**
+ * @brief Function releases the cache and all cached blocks.
+ */
+
+static inline void lzav_cache_free( lzav_cache* const c )
+{
+	int i;
+
+	for( i = 0; i < LZAV_CACHE_SHARDS; i++ )
+	{
+		lzav_cache_shard* const s = c -> s + i;
+		uint32_t j;
+
+		for( j = 0; j < s -> n; j++ )
+		{
+			if( s -> e[ j ].data != 0 )
+			{
+				lzav_free( &c -> al, s -> e[ j ].data, s -> e[ j ].len + 1 );
+			}
+		}
+
+		lzav_free( &c -> al, s -> e, s -> ec );
+		lzav_free( &c -> al, s -> b,
+			( (size_t) s -> bm + 1 ) * sizeof( uint32_t ));
+
+		lzav_mutex_destroy( &s -> mtx );
+	}
+
+	memset( c, 0, sizeof( lzav_cache ));
+}
+
+/**
+ * @brief Function returns key's hash value. The upper bits select a shard,
+ * the lower bits select a bucket.
+ */
+
+static inline uint64_t lzav_cache_hash( const uint64_t cid,
+	const uint64_t bid )
+{
+	uint64_t h = ( cid ^ 0x243F6A8885A308D3 ) * 0x9E3779B97F4A7C15;
+	h = ( h ^ ( h >> 29 ) ^ bid ) * 0xBF58476D1CE4E5B9;
+
+	return( h ^ ( h >> 32 ));
+}
+
+static inline lzav_cache_shard* lzav_cache_shard_of( lzav_cache* const c,
+	const uint64_t h )
+{
+	return( c -> s + ( h >> 60 & ( LZAV_CACHE_SHARDS - 1 )));
+}
+
+/**
+ * @brief Function finds an entry in the shard, the shard should be locked.
+ *
+ * @return Entry's pointer, or 0 if not found.
+ */
+
+static inline lzav_cache_ent* lzav_cache_find( lzav_cache_shard* const s,
+	const uint64_t h, const uint64_t cid, const uint64_t bid )
+{
+	uint32_t i = s -> b[ h & s -> bm ];
+
+	while( i != 0 )
+	{
+		lzav_cache_ent* const e = s -> e + i - 1;
+
+		if( e -> cid == cid && e -> bid == bid )
+		{
+			return( e );
+		}
+
+		i = e -> next;
+	}
+
+	return( 0 );
+}
+
+/**
+ * @brief Function removes an entry from the shard, and frees its data. The
+ * shard should be locked.
+ */
+
+static inline void lzav_cache_evict( const lzav_alloc* const al,
+	lzav_cache_shard* const s, const uint32_t i )
+{
+	lzav_cache_ent* const e = s -> e + i;
+	uint32_t* pn = s -> b + ( lzav_cache_hash( e -> cid, e -> bid ) &
+		s -> bm );
+
+	while( *pn != i + 1 )
+	{
+		pn = &s -> e[ *pn - 1 ].next;
+	}
+
+	*pn = e -> next;
+	lzav_free( al, e -> data, e -> len + 1 );
+	s -> bytes -= e -> len;
+	s -> cnt--;
+
+	e -> data = 0;
+	e -> next = s -> fr;
+	s -> fr = i + 1;
+}
+
+/**
+ * @brief Function doubles the number of shard's buckets, and rehashes
+ * entries. The shard should be locked. On allocation failure, the current
+ * buckets are kept.
+ */
+
+static inline void lzav_cache_rehash( const lzav_alloc* const al,
+	lzav_cache_shard* const s )
+{
+	const uint32_t bm = s -> bm * 2 + 1;
+	uint32_t* const b = lzav_cache_alloc_b( al, bm );
+
+	uint32_t i;
+
+	if( b == 0 )
+	{
+		return;
+	}
+
+	for( i = 0; i < s -> n; i++ )
+	{
+		lzav_cache_ent* const e = s -> e + i;
+
+		if( e -> data != 0 )
+		{
+			uint32_t* const ph = b + ( lzav_cache_hash( e -> cid,
+				e -> bid ) & bm );
+
+			e -> next = *ph;
+			*ph = i + 1;
+		}
+	}
+
+	lzav_free( al, s -> b, ( (size_t) s -> bm + 1 ) * sizeof( uint32_t ));
+	s -> b = b;
+	s -> bm = bm;
+}
+
+/**
+ * @brief Function copies a part of a cached block.
+ *
+ * @param c Cache.
+ * @param cid Container identifier.
+ * @param bid Block identifier.
+ * @param[out] dst Destination buffer.
+ * @param off Offset within the block.
+ * @param len The number of bytes to copy.
+ * @return 1 if the block is cached and the range is within it, 0 otherwise.
+ */
+
+static inline int lzav_cache_get( lzav_cache* const c, const uint64_t cid,
+	const uint64_t bid, void* const dst, const size_t off, const size_t len )
+{
+	const uint64_t h = lzav_cache_hash( cid, bid );
+	lzav_cache_shard* const s = lzav_cache_shard_of( c, h );
+	int r = 0;
+
+	lzav_mutex_lock( &s -> mtx );
+
+	lzav_cache_ent* const e = lzav_cache_find( s, h, cid, bid );
+
+	if( e != 0 && off <= e -> len && len <= e -> len - off )
+	{
+		memcpy( dst, e -> data + off, len );
+		e -> ref = 1;
+		s -> hits++;
+		r = 1;
+	}
+	else
+	{
+		s -> misses++;
+	}
+
+	lzav_mutex_unlock( &s -> mtx );
+
+	return( r );
+}
+
+/**
+ * @brief Function inserts a block into the cache, taking ownership of an
+ * allocated buffer.
+ *
+ * Least recently used blocks are evicted to make room. If the block is
+ * already cached, or it is longer than the shard's capacity, or memory
+ * cannot be allocated, the buffer is released.
+ *
+ * @param c Cache.
+ * @param cid Container identifier.
+ * @param bid Block identifier.
+ * @param data Block's data, allocated via lzav_cache_alloc().
+ * @param len Block's length.
+ */
+
+static inline void lzav_cache_insert( lzav_cache* const c,
+	const uint64_t cid, const uint64_t bid, uint8_t* const data,
+	const size_t len )
+{
+	const uint64_t h = lzav_cache_hash( cid, bid );
+	lzav_cache_shard* const s = lzav_cache_shard_of( c, h );
+
+	lzav_mutex_lock( &s -> mtx );
+
+	if( len > s -> cap || lzav_cache_find( s, h, cid, bid ) != 0 )
+	{
+		lzav_mutex_unlock( &s -> mtx );
+		lzav_free( &c -> al, data, len + 1 );
+		return;
+	}
+
+	// CLOCK sweep: blocks referenced since the last pass get a second
+	// chance.
+
+	while( s -> bytes + len > s -> cap )
+	{
+		lzav_cache_ent* const e = s -> e + s -> hand;
+
+		if( e -> data != 0 )
+		{
+			if( e -> ref != 0 )
+			{
+				e -> ref = 0;
+			}
+			else
+			{
+				lzav_cache_evict( &c -> al, s, s -> hand );
+			}
+		}
+
+		s -> hand = ( s -> hand + 1 == s -> n ? 0 : s -> hand + 1 );
+	}
+
+	if( s -> cnt > s -> bm )
+	{
+		lzav_cache_rehash( &c -> al, s );
+	}
+
+	uint32_t i;
+
+	if( s -> fr != 0 )
+	{
+		i = s -> fr - 1;
+		s -> fr = s -> e[ i ].next;
+	}
+	else
+	{
+		if( s -> n == 0xFFFFFFFE || !lzav_arc_grow( &c -> al,
+			(void**) &s -> e, &s -> ec,
+			( (size_t) s -> n + 1 ) * sizeof( lzav_cache_ent )))
+		{
+			lzav_mutex_unlock( &s -> mtx );
+			lzav_free( &c -> al, data, len + 1 );
+			return;
+		}
+
+		i = s -> n++;
+	}
+
+	lzav_cache_ent* const e = s -> e + i;
+	uint32_t* const ph = s -> b + ( h & s -> bm );
+
+	e -> cid = cid;
+	e -> bid = bid;
+	e -> data = data;
+	e -> len = len;
+	e -> ref = 0;
+	e -> next = *ph;
+	*ph = i + 1;
+
+	s -> bytes += len;
+	s -> cnt++;
+
+	lzav_mutex_unlock( &s -> mtx );
+}
+
+/**
+ * @brief Function copies a block into the cache, see lzav_cache_insert().
+ */
+
+static inline void lzav_cache_put( lzav_cache* const c, const uint64_t cid,
+	const uint64_t bid, const void* const data, const size_t len )
+{
+	uint8_t* const p = lzav_cache_alloc( c, len );
+
+	if( p != 0 )
+	{
+		memcpy( p, data, len );
+		lzav_cache_insert( c, cid, bid, p, len );
+	}
+}
+
+/**
+ * @brief Function removes all blocks of a container from the cache, e.g.,
+ * when the container is closed.
+ */
+
+static inline void lzav_cache_drop( lzav_cache* const c, const uint64_t cid )
+{
+	int i;
+
+	for( i = 0; i < LZAV_CACHE_SHARDS; i++ )
+	{
+		lzav_cache_shard* const s = c -> s + i;
+		uint32_t j;
+
+		lzav_mutex_lock( &s -> mtx );
+
+		for( j = 0; j < s -> n; j++ )
+		{
+			if( s -> e[ j ].data != 0 && s -> e[ j ].cid == cid )
+			{
+				lzav_cache_evict( &c -> al, s, j );
+			}
+		}
+
+		lzav_mutex_unlock( &s -> mtx );
+	}
+}
+
+/**
+ * @brief Function returns cache statistics, summed over shards.
+ *
+ * @param c Cache.
+ * @param[out] hits Receiver of the number of lookup hits, can be 0.
+ * @param[out] misses Receiver of the number of lookup misses, can be 0.
+ * @param[out] bytes Receiver of the total length of cached blocks, can be 0.
+ */
+
+static inline void lzav_cache_stats( lzav_cache* const c,
+	uint64_t* const hits, uint64_t* const misses, size_t* const bytes )
+{
+	uint64_t h = 0;
+	uint64_t m = 0;
+	size_t b = 0;
+	int i;
+
+	for( i = 0; i < LZAV_CACHE_SHARDS; i++ )
+	{
+		lzav_cache_shard* const s = c -> s + i;
+
+		lzav_mutex_lock( &s -> mtx );
+		h += s -> hits;
+		m += s -> misses;
+		b += s -> bytes;
+		lzav_mutex_unlock( &s -> mtx );
+	}
+
+	if( hits != 0 )
+	{
+		*hits = h;
+	}
+
+	if( misses != 0 )
+	{
+		*misses = m;
+	}
+
+	if( bytes != 0 )
+	{
+		*bytes = b;
+	}
+}
+
+/**
+ * @brief Framed data segment's location.
+ */
+
+typedef struct
+{
+	uint64_t off; ///< Uncompressed data offset.
+	const uint8_t* p; ///< Segment's payload.
+	lzav_frame_seg seg; ///< Segment's header information.
+	int flags; ///< Frame's flags.
+} lzav_frame_iseg;
+
+/**
+ * @brief Segment index of in-memory framed data.
+ */
+
+typedef struct
+{
+	lzav_frame_iseg* s; ///< Segments, ordered by offset.
+	size_t n; ///< The number of segments.
+	size_t c; ///< Capacity of `s`, in bytes.
+	uint64_t len; ///< Uncompressed data length.
+	lzav_alloc al; ///< Allocator of `s`, and of temporary buffers.
+} lzav_frame_index;
+
+/**
+ * @brief Function builds a segment index of framed data, which can consist
+ * of several concatenated frames. Framed data is not copied, and should
+ * remain available while the index is used.
+ *
+ * @param[out] ix Index, should be released via lzav_frame_index_free().
+ * @param src Framed data.
+ * @param srcl Framed data length, in bytes.
+ * @param al Allocator, 0 - the global allocator.
+ * @return 0 on success, or a negative `LZAV_E_` error code.
+ */
+
+static inline int lzav_frame_index_build_al( lzav_frame_index* const ix,
+	const void* const src, const size_t srcl, const lzav_alloc* const al )
+{
+	const uint8_t* ip = (const uint8_t*) src;
+	const uint8_t* const ipe = ip + srcl;
+
+	memset( ix, 0, sizeof( lzav_frame_index ));
+	ix -> al = lzav_alloc_use( al );
+
+	if( src == 0 || srcl == 0 )
+	{
+		return( LZAV_E_PARAMS );
+	}
+
+	while( ip != ipe )
+	{
+		lzav_frame_info fi;
+		lzav_frame_seg seg;
+
+		if( (size_t) ( ipe - ip ) < LZAV_FRAME_HDR_LEN ||
+			lzav_frame_read_hdr( ip, &fi ) < 0 )
+		{
+			return( LZAV_E_UNKFMT );
+		}
+
+		ip += LZAV_FRAME_HDR_LEN;
+
+		while( 1 )
+		{
+			if( ipe - ip < LZAV_FRAME_SEG_HDR_MAX &&
+				( ipe - ip < LZAV_FRAME_END_LEN ||
+				lzav_frame_ld32( ip ) != 0 ))
+			{
+				return( LZAV_E_SRCOOB );
+			}
+
+			const int hl = lzav_frame_read_seg( ip, &fi, &seg );
+
+			if( hl < 0 )
+			{
+				return( hl );
+			}
+
+			ip += hl;
+
+			if( seg.cl == 0 )
+			{
+				break;
+			}
+
+			if( ipe - ip < seg.cl )
+			{
+				return( LZAV_E_SRCOOB );
+			}
+
+			if( !lzav_arc_grow( &ix -> al, (void**) &ix -> s, &ix -> c,
+				( ix -> n + 1 ) * sizeof( lzav_frame_iseg )))
+			{
+				return( LZAV_E_NOMEM );
+			}
+
+			lzav_frame_iseg* const is = ix -> s + ix -> n;
+			ix -> n++;
+
+			is -> off = ix -> len;
+			is -> p = ip;
+			is -> seg = seg;
+			is -> flags = fi.flags;
+
+			ip += seg.cl;
+			ix -> len += (uint64_t) seg.srcl;
+		}
+	}
+
+	return( 0 );
+}
+
+/**
+ * @brief Function builds a segment index of framed data, with the global
+ * allocator. See lzav_frame_index_build_al().
+ */
+
+static inline int lzav_frame_index_build( lzav_frame_index* const ix,
+	const void* const src, const size_t srcl )
+{
+	return( lzav_frame_index_build_al( ix, src, srcl, 0 ));
+}
+
+/**
+ * @brief Function releases the segment index.
+ */
+
+static inline void lzav_frame_index_free( lzav_frame_index* const ix )
+{
+	lzav_free( &ix -> al, ix -> s, ix -> c );
+	memset( ix, 0, sizeof( lzav_frame_index ));
+}
+
+/**
+ * @brief Function reads a range of uncompressed data from indexed framed
+ * data.
+ *
+ * Segments covered by the range are copied from the cache, if present.
+ * Missed segments are decompressed, verified, and inserted into the cache.
+ *
+ * @param ix Segment index.
+ * @param c Cache, can be 0.
+ * @param cid Container identifier, unique among containers sharing the
+ * cache.
+ * @param[out] dst Destination buffer, at least `len` bytes long.
+ * @param off Uncompressed data offset.
+ * @param len The number of bytes to read.
+ * @return 0 on success, or a negative `LZAV_E_` error code.
+ * `LZAV_E_PARAMS` is returned if the range is outside of uncompressed data.
+ */
+
+static inline int lzav_frame_pread( const lzav_frame_index* const ix,
+	lzav_cache* const c, const uint64_t cid, void* const dst,
+	const uint64_t off, size_t len )
+{
+	if( off > ix -> len || len > ix -> len - off )
+	{
+		return( LZAV_E_PARAMS );
+	}
+
+	uint8_t* op = (uint8_t*) dst;
+	size_t lo = 0;
+	size_t hi = ix -> n;
+
+	// Binary search for the segment containing `off`.
+
+	while( hi - lo > 1 )
+	{
+		const size_t m = ( lo + hi ) >> 1;
+
+		if( ix -> s[ m ].off <= off )
+		{
+			lo = m;
+		}
+		else
+		{
+			hi = m;
+		}
+	}
+
+	uint64_t so = off - ( ix -> n == 0 ? 0 : ix -> s[ lo ].off );
+
+	while( len != 0 )
+	{
+		const lzav_frame_iseg* const is = ix -> s + lo;
+		const size_t sl = (size_t) is -> seg.srcl;
+		const size_t cl = ( len < sl - so ? len : sl - (size_t) so );
+
+		if( c == 0 || !lzav_cache_get( c, cid, lo, op, (size_t) so, cl ))
+		{
+			lzav_frame_info fi;
+			fi.flags = is -> flags;
+
+			// Segment is decompressed directly into `dst`, if it is not
+			// cached and is fully covered by the range.
+
+			const int direct = ( c == 0 && cl == sl );
+			const lzav_alloc* const al = ( c == 0 ? &ix -> al : &c -> al );
+			uint8_t* const buf = ( direct ? op :
+				(uint8_t*) lzav_malloc( al, sl + 1 ));
+
+			if( buf == 0 )
+			{
+				return( LZAV_E_NOMEM );
+			}
+
+			const int r = lzav_frame_decompress_seg( &is -> seg, is -> p,
+				buf, &fi );
+
+			if( r != is -> seg.srcl )
+			{
+				if( !direct )
+				{
+					lzav_free( al, buf, sl + 1 );
+				}
+
+				return( r < 0 ? r : LZAV_E_DSTLEN );
+			}
+
+			if( !direct )
+			{
+				memcpy( op, buf + so, cl );
+
+				if( c != 0 )
+				{
+					lzav_cache_insert( c, cid, lo, buf, sl );
+				}
+				else
+				{
+					lzav_free( al, buf, sl + 1 );
+				}
+			}
+		}
+
+		op += cl;
+		len -= cl;
+		so = 0;
+		lo++;
+	}
+
+	return( 0 );
+}
+
+/**
+ * @brief Function decompresses an archive entry via the cache, see
+ * lzav_arc_decompress(). Entries are keyed by compressed data offset.
+ *
+ * @param a Archive.
+ * @param c Cache.
+ * @param cid Container identifier, unique among containers sharing the
+ * cache.
+ * @param e Entry's information, as returned by lzav_arc_find().
+ * @param[out] dst Destination buffer, at least `e -> len` bytes large.
+ * @return The length of decompressed data, or a negative `LZAV_E_` error
+ * code.
+ */
+
+static inline int lzav_arc_decompress_cached( const lzav_arc* const a,
+	lzav_cache* const c, const uint64_t cid, const lzav_arc_entry* const e,
+	void* const dst )
+{
+	const uint64_t bid = (uint64_t) ( e -> data - a -> p );
+
+	if( lzav_cache_get( c, cid, bid, dst, 0, e -> len ))
+	{
+		return( (int) e -> len );
+	}
+
+	const int r = lzav_arc_decompress( e, dst );
+
+	if( r > 0 )
+	{
+		lzav_cache_put( c, cid, bid, dst, e -> len );
+	}
+
+	return( r );
+}
+
+#endif // LZAV_CACHE_INCLUDED
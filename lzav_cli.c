@@ -0,0 +1,1861 @@
+/**
+ * @file lzav_cli.c
+ *
+ * @version 4.5
+ *
+ * @brief Command-line utility for the "LZAV" in-memory data compression and
+ * decompression algorithms.
+ *
+ * Compresses and decompresses files and pipes into the self-describing
+ * framed format (see lzav_frame.h), with multi-threaded segment processing.
+ * Single-threaded file-to-file processing uses memory-mapped I/O (see
+ * lzav_file.h).
+ * Also provides a multi-threaded benchmark that measures how compression and
+ * decompression throughput scales with the number of concurrently-running
+ * independent jobs.
+ *
+ * Build with: cc -O3 -o lzav lzav_cli.c -lpthread
+ *
+ * Description is available at https://github.com/avaneev/lzav
+ *
+ * E-mail: aleksey.vaneev@gmail.com or info@voxengo.com
+ *
+ * LICENSE:
+ *
+ * Copyright (c) 2023-2024 Aleksey Vaneev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#if !defined( _GNU_SOURCE )
+	#define _GNU_SOURCE // For clock_gettime() and sysconf().
+#endif // !defined( _GNU_SOURCE )
+
+#include "lzav_dedup.h"
+#include <stdio.h>
+#include <sys/stat.h>
+
+#if defined( _WIN32 )
+	#include <fcntl.h>
+	#include <io.h>
+#else // defined( _WIN32 )
+	#include <time.h>
+	#include <unistd.h>
+#endif // defined( _WIN32 )
+
+#define CLI_KNEE_GAIN 0.5 ///< Minimal relative throughput gain of an added
+	///< thread (in single-thread throughput units) below which the scaling
+	///< curve is considered to be past its knee.
+
+/**
+ * @brief Function returns a monotonic time stamp, in seconds.
+ */
+
+static double cli_time( void )
+{
+#if defined( _WIN32 )
+
+	LARGE_INTEGER f, c;
+	QueryPerformanceFrequency( &f );
+	QueryPerformanceCounter( &c );
+
+	return( (double) c.QuadPart / (double) f.QuadPart );
+
+#else // defined( _WIN32 )
+
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+
+	return( (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9 );
+
+#endif // defined( _WIN32 )
+}
+
+/**
+ * @brief Function returns the number of online logical processors.
+ */
+
+static int cli_cpu_count( void )
+{
+#if defined( _WIN32 )
+
+	SYSTEM_INFO si;
+	GetSystemInfo( &si );
+
+	return( (int) si.dwNumberOfProcessors );
+
+#else // defined( _WIN32 )
+
+	const long n = sysconf( _SC_NPROCESSORS_ONLN );
+
+	return( n < 1 ? 1 : (int) n );
+
+#endif // defined( _WIN32 )
+}
+
+/**
+ * @brief Reusable thread barrier.
+ */
+
+typedef struct
+{
+	lzav_mutex_t m; ///< Barrier's mutex.
+	lzav_cond_t c; ///< Barrier's condition variable.
+	int n; ///< The number of participating threads.
+	int w; ///< The number of currently waiting threads.
+	int gen; ///< Barrier's generation counter.
+} cli_barrier;
+
+static void cli_barrier_init( cli_barrier* const b, const int n )
+{
+	lzav_mutex_init( &b -> m );
+	lzav_cond_init( &b -> c );
+	b -> n = n;
+	b -> w = 0;
+	b -> gen = 0;
+}
+
+static void cli_barrier_destroy( cli_barrier* const b )
+{
+	lzav_cond_destroy( &b -> c );
+	lzav_mutex_destroy( &b -> m );
+}
+
+static void cli_barrier_wait( cli_barrier* const b )
+{
+	lzav_mutex_lock( &b -> m );
+
+	const int gen = b -> gen;
+	b -> w++;
+
+	if( b -> w == b -> n )
+	{
+		b -> w = 0;
+		b -> gen++;
+		lzav_cond_broadcast( &b -> c );
+	}
+	else
+	{
+		while( gen == b -> gen )
+		{
+			lzav_cond_wait( &b -> c, &b -> m );
+		}
+	}
+
+	lzav_mutex_unlock( &b -> m );
+}
+
+/**
+ * @brief Function parses a size value with an optional K, M or G suffix.
+ *
+ * @param s String to parse.
+ * @param[out] v Parsed value receiver.
+ * @return 1 on success, 0 on syntax error.
+ */
+
+static int cli_parse_size( const char* s, size_t* const v )
+{
+	size_t r = 0;
+
+	if( *s < '0' || *s > '9' )
+	{
+		return( 0 );
+	}
+
+	while( *s >= '0' && *s <= '9' )
+	{
+		r = r * 10 + (size_t) ( *s - '0' );
+		s++;
+	}
+
+	if( *s == 'K' || *s == 'k' )
+	{
+		r <<= 10;
+		s++;
+	}
+	else
+	if( *s == 'M' || *s == 'm' )
+	{
+		r <<= 20;
+		s++;
+	}
+	else
+	if( *s == 'G' || *s == 'g' )
+	{
+		r <<= 30;
+		s++;
+	}
+
+	*v = r;
+
+	return( *s == 0 );
+}
+
+/**
+ * @brief Function reads the whole file into a newly-allocated buffer.
+ *
+ * @param fn File name.
+ * @param[out] len Receiver of the file's length.
+ * @return Buffer pointer, to be released via free(), or 0 on error. A
+ * diagnostic message is printed on error.
+ */
+
+static uint8_t* cli_read_file( const char* const fn, size_t* const len )
+{
+	FILE* const f = fopen( fn, "rb" );
+
+	if( f == 0 )
+	{
+		fprintf( stderr, "lzav: cannot open %s\n", fn );
+		return( 0 );
+	}
+
+	size_t cap = 1 << 20;
+	size_t l = 0;
+	uint8_t* buf = (uint8_t*) malloc( cap );
+
+	while( buf != 0 )
+	{
+		l += fread( buf + l, 1, cap - l, f );
+
+		if( l < cap )
+		{
+			break;
+		}
+
+		uint8_t* const nbuf = (uint8_t*) realloc( buf, cap * 2 );
+
+		if( nbuf == 0 )
+		{
+			free( buf );
+			buf = 0;
+			break;
+		}
+
+		buf = nbuf;
+		cap *= 2;
+	}
+
+	if( buf == 0 )
+	{
+		fprintf( stderr, "lzav: not enough memory to read %s\n", fn );
+	}
+	else
+	if( ferror( f ))
+	{
+		fprintf( stderr, "lzav: read error on %s\n", fn );
+		free( buf );
+		buf = 0;
+	}
+
+	fclose( f );
+	*len = l;
+
+	return( buf );
+}
+
+/**
+ * @brief Benchmark's shared state.
+ */
+
+typedef struct
+{
+	const uint8_t* data; ///< Source data.
+	size_t len; ///< Source data length.
+	int blkl; ///< Block length; source data is compressed in blocks.
+	int blkc; ///< The number of blocks.
+	size_t cbufl; ///< Capacity of the per-thread compressed data buffer.
+	int level; ///< Compression level: 1 - default, 2 - higher-ratio, 3 -
+		///< higher-ratio with faster decompression.
+	int wlog; ///< log2 of LZ77 window length, 0 - the full window.
+	double mint; ///< Minimal duration of each measurement, in seconds.
+	cli_barrier bar; ///< Phase synchronization barrier.
+} cli_bench;
+
+/**
+ * @brief Per-thread benchmark job.
+ */
+
+typedef struct
+{
+	cli_bench* b; ///< Shared state.
+	lzav_thread_t t; ///< Job's thread.
+	double ctime; ///< Total compression time, in seconds.
+	double cbytes; ///< Total source bytes compressed.
+	double dtime; ///< Total decompression time, in seconds.
+	double dbytes; ///< Total bytes decompressed.
+	size_t cmpl; ///< Compressed length of the whole source data.
+	const char* err; ///< Error message, 0 if none.
+} cli_bench_job;
+
+/**
+ * @brief Benchmark's thread function.
+ *
+ * Each job works on its own private copy of the source data, with its own
+ * buffers (allocated and first touched by the job's thread), so that the
+ * jobs compete only for shared caches and memory bandwidth.
+ */
+
+static LZAV_THREAD_FUNC( cli_bench_thread, arg )
+{
+	cli_bench_job* const j = (cli_bench_job*) arg;
+	cli_bench* const b = j -> b;
+	uint8_t* const src = (uint8_t*) malloc( b -> len );
+	uint8_t* const cbuf = (uint8_t*) malloc( b -> cbufl );
+	uint8_t* const dbuf = (uint8_t*) malloc( b -> len );
+	int* const cl = (int*) malloc( b -> blkc * sizeof( int ));
+	int i;
+
+	if( src == 0 || cbuf == 0 || dbuf == 0 || cl == 0 )
+	{
+		j -> err = "not enough memory";
+	}
+	else
+	{
+		memcpy( src, b -> data, b -> len );
+		memset( cbuf, 0, b -> cbufl );
+		memset( dbuf, 0, b -> len );
+	}
+
+	cli_barrier_wait( &b -> bar );
+
+	double t0 = cli_time();
+	double t;
+
+	do
+	{
+		if( j -> err != 0 )
+		{
+			break;
+		}
+
+		const uint8_t* ip = src;
+		uint8_t* op = cbuf;
+		size_t l = b -> len;
+		j -> cmpl = 0;
+
+		for( i = 0; i < b -> blkc; i++ )
+		{
+			const int bl = ( l > (size_t) b -> blkl ? b -> blkl : (int) l );
+			const int bnd = ( b -> level > 1 ? lzav_compress_bound_hi( bl ) :
+				lzav_compress_bound( bl ));
+
+			cl[ i ] = ( b -> level > 1 ?
+				lzav_compress_hi_2( ip, op, bl, bnd, 0, b -> wlog,
+				b -> level == 3 ) :
+				lzav_compress_win( ip, op, bl, bnd, 0, 0, 0, b -> wlog ));
+
+			if( cl[ i ] == 0 )
+			{
+				j -> err = "compression failed";
+				break;
+			}
+
+			j -> cmpl += (size_t) cl[ i ];
+			ip += bl;
+			op += bnd;
+			l -= (size_t) bl;
+		}
+
+		j -> cbytes += (double) b -> len;
+		t = cli_time() - t0;
+
+	} while( t < b -> mint );
+
+	j -> ctime = cli_time() - t0;
+
+	cli_barrier_wait( &b -> bar );
+
+	int pass = 0;
+	t0 = cli_time();
+
+	do
+	{
+		if( j -> err != 0 )
+		{
+			break;
+		}
+
+		const uint8_t* ip = cbuf;
+		uint8_t* op = dbuf;
+		size_t l = b -> len;
+
+		for( i = 0; i < b -> blkc; i++ )
+		{
+			const int bl = ( l > (size_t) b -> blkl ? b -> blkl : (int) l );
+
+			if( lzav_decompress( ip, op, cl[ i ], bl ) != bl )
+			{
+				j -> err = "decompression failed";
+				break;
+			}
+
+			ip += ( b -> level > 1 ? lzav_compress_bound_hi( bl ) :
+				lzav_compress_bound( bl ));
+
+			op += bl;
+			l -= (size_t) bl;
+		}
+
+		if( pass == 0 && j -> err == 0 &&
+			memcmp( dbuf, src, b -> len ) != 0 )
+		{
+			j -> err = "decompressed data mismatch";
+		}
+
+		pass++;
+		j -> dbytes += (double) b -> len;
+		t = cli_time() - t0;
+
+	} while( t < b -> mint );
+
+	j -> dtime = cli_time() - t0;
+
+	free( cl );
+	free( dbuf );
+	free( cbuf );
+	free( src );
+
+	LZAV_THREAD_RETURN;
+}
+
+/**
+ * @brief Multi-threaded scaling benchmark.
+ *
+ * Function runs 1 to `maxt` concurrent independent compression and
+ * decompression jobs on the same source data, and reports aggregate
+ * throughput, per-thread throughput and scaling efficiency (relative to a
+ * single thread), and the estimated memory stream bandwidth (source plus
+ * destination bytes per second; hash-table accesses are not included). The
+ * "knee" of each scaling curve is the last thread count at which an added
+ * thread still contributed at least CLI_KNEE_GAIN of single-thread
+ * throughput.
+ *
+ * @param fn Source file name.
+ * @param level Compression level.
+ * @param wlog log2 of LZ77 window length, 0 - the full window.
+ * @param maxt Maximal number of threads, 0 - all logical processors.
+ * @param blkl Block length.
+ * @param mint Minimal duration of each measurement, in seconds.
+ * @return Process exit code.
+ */
+
+static int cli_bench_run( const char* const fn, const int level,
+	const int wlog, int maxt,
+	const size_t blkl, const double mint )
+{
+	cli_bench b;
+	b.data = cli_read_file( fn, &b.len );
+
+	if( b.data == 0 )
+	{
+		return( 1 );
+	}
+
+	if( b.len == 0 )
+	{
+		fprintf( stderr, "lzav: %s is empty\n", fn );
+		free( (void*) b.data );
+		return( 1 );
+	}
+
+	if( maxt <= 0 )
+	{
+		maxt = cli_cpu_count();
+	}
+
+	b.blkl = (int) ( blkl > b.len ? b.len : blkl );
+	b.blkc = (int) (( b.len + b.blkl - 1 ) / b.blkl );
+	b.cbufl = (size_t) b.blkc * (size_t) ( level > 1 ?
+		lzav_compress_bound_hi( b.blkl ) : lzav_compress_bound( b.blkl ));
+
+	b.level = level;
+	b.wlog = wlog;
+	b.mint = mint;
+
+	cli_bench_job* const jobs =
+		(cli_bench_job*) calloc( maxt, sizeof( cli_bench_job ));
+
+	double* const cagg = (double*) calloc( maxt + 1, sizeof( double ));
+	double* const dagg = (double*) calloc( maxt + 1, sizeof( double ));
+
+	if( jobs == 0 || cagg == 0 || dagg == 0 )
+	{
+		fprintf( stderr, "lzav: not enough memory\n" );
+		free( dagg );
+		free( cagg );
+		free( jobs );
+		free( (void*) b.data );
+		return( 1 );
+	}
+
+	printf( "LZAV %s scaling benchmark: %s, %zu bytes, %d block(s) of %d "
+		"bytes, %s, %d KiB window, %.1f s per run\n", LZAV_VER_STR, fn,
+		b.len, b.blkc, b.blkl,
+		( level > 2 ? "lzav_compress_hi_fd()" : level > 1 ?
+		"lzav_compress_hi()" : "lzav_compress()" ),
+		(int) (( lzav_win_max( wlog ) + 1 ) >> 10 ), mint );
+
+	printf( "Thr  Comp MB/s   /thread  eff %%  I/O GB/s | "
+		"Dec MB/s    /thread  eff %%  I/O GB/s\n" );
+
+	int ret = 0;
+	double cr = 0.0; // Compression ratio.
+	int cknee = 0;
+	int dknee = 0;
+	int n, i;
+
+	for( n = 1; n <= maxt; n++ )
+	{
+		cli_barrier_init( &b.bar, n );
+		memset( jobs, 0, n * sizeof( cli_bench_job ));
+
+		for( i = 0; i < n; i++ )
+		{
+			jobs[ i ].b = &b;
+
+			if( !lzav_thread_start( &jobs[ i ].t, cli_bench_thread,
+				jobs + i ))
+			{
+				fprintf( stderr, "lzav: cannot start thread\n" );
+				exit( 1 );
+			}
+		}
+
+		double ct = 0.0;
+		double dt = 0.0;
+
+		for( i = 0; i < n; i++ )
+		{
+			lzav_thread_join( jobs[ i ].t );
+
+			if( jobs[ i ].err != 0 )
+			{
+				fprintf( stderr, "lzav: %s\n", jobs[ i ].err );
+				ret = 1;
+			}
+			else
+			{
+				cagg[ n ] += jobs[ i ].cbytes / jobs[ i ].ctime;
+				dagg[ n ] += jobs[ i ].dbytes / jobs[ i ].dtime;
+			}
+
+			ct += jobs[ i ].ctime;
+			dt += jobs[ i ].dtime;
+		}
+
+		cli_barrier_destroy( &b.bar );
+
+		if( ret != 0 )
+		{
+			break;
+		}
+
+		cr = (double) jobs[ 0 ].cmpl / (double) b.len;
+
+		if( cknee == 0 &&
+			cagg[ n ] - cagg[ n - 1 ] < cagg[ 1 ] * CLI_KNEE_GAIN )
+		{
+			cknee = n - 1;
+		}
+
+		if( dknee == 0 &&
+			dagg[ n ] - dagg[ n - 1 ] < dagg[ 1 ] * CLI_KNEE_GAIN )
+		{
+			dknee = n - 1;
+		}
+
+		printf( "%3d %10.1f %9.1f %6.1f %9.2f | %10.1f %9.1f %6.1f %9.2f\n",
+			n, cagg[ n ] * 1e-6, cagg[ n ] * 1e-6 / n,
+			cagg[ n ] / ( cagg[ 1 ] * n ) * 100.0,
+			cagg[ n ] * ( 1.0 + cr ) * 1e-9,
+			dagg[ n ] * 1e-6, dagg[ n ] * 1e-6 / n,
+			dagg[ n ] / ( dagg[ 1 ] * n ) * 100.0,
+			dagg[ n ] * ( 1.0 + cr ) * 1e-9 );
+
+		fflush( stdout );
+	}
+
+	if( ret == 0 )
+	{
+		const char* const nk = "no knee up to %d thread(s)\n";
+		const char* const k = "knee at %d thread(s), %.1f%% efficiency\n";
+
+		printf( "Compression ratio: %.2f%%\n", cr * 100.0 );
+		printf( "Compression scaling: " );
+
+		if( cknee == 0 )
+		{
+			printf( nk, maxt );
+		}
+		else
+		{
+			printf( k, cknee, cagg[ cknee ] / ( cagg[ 1 ] * cknee ) * 100.0 );
+		}
+
+		printf( "Decompression scaling: " );
+
+		if( dknee == 0 )
+		{
+			printf( nk, maxt );
+		}
+		else
+		{
+			printf( k, dknee, dagg[ dknee ] / ( dagg[ 1 ] * dknee ) * 100.0 );
+		}
+	}
+
+	free( dagg );
+	free( cagg );
+	free( jobs );
+	free( (void*) b.data );
+
+	return( ret );
+}
+
+/**
+ * @brief Page benchmark's state.
+ */
+
+typedef struct
+{
+	const uint8_t* data; ///< Source data.
+	int pagel; ///< Page length.
+	int pagec; ///< The number of whole pages in the source data.
+	int bnd; ///< Compressed page buffer's capacity, LZAV_PAGE_BOUND( pagel ).
+	uint8_t* cbuf[ 2 ]; ///< Compressed pages, of general and page functions.
+	int* cl[ 2 ]; ///< Compressed page lengths.
+	uint8_t* dbuf; ///< Decompressed page buffer.
+	lzav_page_ctx* ctx; ///< Page compression context.
+} cli_page_bench;
+
+/**
+ * @brief Function performs a single benchmarked operation on a page.
+ *
+ * @param b Benchmark's state.
+ * @param op Operation: 0 - lzav_compress(), 1 - lzav_compress_page(),
+ * 2 - lzav_decompress(), 3 - lzav_decompress_page().
+ * @param i Page index.
+ * @return Resulting length, 0 or negative on error.
+ */
+
+static int cli_page_op( cli_page_bench* const b, const int op, const int i )
+{
+	const uint8_t* const sp = b -> data + (size_t) i * b -> pagel;
+	const int k = op & 1;
+	uint8_t* const cp = b -> cbuf[ k ] + (size_t) i * b -> bnd;
+
+	switch( op )
+	{
+		case 0:
+			return( b -> cl[ k ][ i ] = lzav_compress_default( sp, cp,
+				b -> pagel, b -> bnd ));
+
+		case 1:
+			return( b -> cl[ k ][ i ] = lzav_compress_page( b -> ctx, sp, cp,
+				b -> pagel, b -> bnd ));
+
+		case 2:
+			return( lzav_decompress( cp, b -> dbuf, b -> cl[ k ][ i ],
+				b -> pagel ));
+	}
+
+	return( lzav_decompress_page( cp, b -> dbuf, b -> cl[ k ][ i ],
+		b -> pagel ));
+}
+
+static int cli_cmp_double( const void* const a, const void* const b )
+{
+	const double x = *(const double*) a;
+	const double y = *(const double*) b;
+
+	return(( x > y ) - ( x < y ));
+}
+
+/**
+ * @brief Fixed-size page latency benchmark.
+ *
+ * Function splits the source data into whole pages, and compares per-page
+ * latency of the general lzav_compress() and lzav_decompress() functions
+ * against the lzav_compress_page() and lzav_decompress_page() functions.
+ * The mean latency is measured over repeated passes over all pages, the
+ * median and 99th percentile latencies are measured on a separate pass,
+ * with each page timed individually.
+ *
+ * @param fn Source file name.
+ * @param pagel Page length.
+ * @param mint Minimal duration of each measurement, in seconds.
+ * @return Process exit code.
+ */
+
+static int cli_page_run( const char* const fn, const int pagel,
+	const double mint )
+{
+	static const char* const names[ 4 ] = { "lzav_compress()",
+		"lzav_compress_page()", "lzav_decompress()",
+		"lzav_decompress_page()" };
+
+	cli_page_bench b;
+	size_t len;
+	b.data = cli_read_file( fn, &len );
+
+	if( b.data == 0 )
+	{
+		return( 1 );
+	}
+
+	b.pagel = pagel;
+	b.pagec = (int) ( len / (size_t) pagel );
+	b.bnd = LZAV_PAGE_BOUND( pagel );
+
+	if( b.pagec == 0 )
+	{
+		fprintf( stderr, "lzav: %s is shorter than a page\n", fn );
+		free( (void*) b.data );
+		return( 1 );
+	}
+
+	const size_t cbufl = (size_t) b.pagec * (size_t) b.bnd;
+	b.cbuf[ 0 ] = (uint8_t*) malloc( cbufl );
+	b.cbuf[ 1 ] = (uint8_t*) malloc( cbufl );
+	b.cl[ 0 ] = (int*) malloc( b.pagec * sizeof( int ));
+	b.cl[ 1 ] = (int*) malloc( b.pagec * sizeof( int ));
+	b.dbuf = (uint8_t*) malloc( pagel );
+	b.ctx = (lzav_page_ctx*) malloc( sizeof( lzav_page_ctx ));
+	double* const lat = (double*) malloc( b.pagec * sizeof( double ));
+	int ret = 1;
+	int op, i;
+
+	if( b.cbuf[ 0 ] == 0 || b.cbuf[ 1 ] == 0 || b.cl[ 0 ] == 0 ||
+		b.cl[ 1 ] == 0 || b.dbuf == 0 || b.ctx == 0 || lat == 0 )
+	{
+		fprintf( stderr, "lzav: not enough memory\n" );
+		goto _end;
+	}
+
+	lzav_page_init( b.ctx );
+
+	printf( "LZAV %s page benchmark: %s, %d page(s) of %d bytes, "
+		"%.1f s per run\n", LZAV_VER_STR, fn, b.pagec, pagel, mint );
+
+	printf( "Function                Ratio %%    Mean us  Median us     "
+		"P99 us      MB/s\n" );
+
+	for( op = 0; op < 4; op++ )
+	{
+		double t0 = cli_time();
+		double t = 0.0;
+		double n = 0.0;
+
+		do
+		{
+			for( i = 0; i < b.pagec; i++ )
+			{
+				const int r = cli_page_op( &b, op, i );
+
+				if( r <= 0 || ( op > 1 && r != pagel ))
+				{
+					fprintf( stderr, "lzav: %s failed\n", names[ op ]);
+					goto _end;
+				}
+			}
+
+			if( op > 1 && memcmp( b.dbuf, b.data + (size_t) ( b.pagec - 1 ) *
+				pagel, pagel ) != 0 )
+			{
+				fprintf( stderr, "lzav: %s data mismatch\n", names[ op ]);
+				goto _end;
+			}
+
+			n += b.pagec;
+			t = cli_time() - t0;
+
+		} while( t < mint );
+
+		for( i = 0; i < b.pagec; i++ )
+		{
+			t0 = cli_time();
+			cli_page_op( &b, op, i );
+			lat[ i ] = cli_time() - t0;
+		}
+
+		qsort( lat, b.pagec, sizeof( double ), cli_cmp_double );
+
+		double cl = 0.0;
+
+		for( i = 0; i < b.pagec; i++ )
+		{
+			cl += b.cl[ op & 1 ][ i ];
+		}
+
+		printf( "%-22s %8.2f %10.3f %10.3f %10.3f %9.1f\n", names[ op ],
+			cl * 100.0 / ( (double) b.pagec * pagel ), t / n * 1e6,
+			lat[ b.pagec / 2 ] * 1e6, lat[ b.pagec - 1 - b.pagec / 100 ] * 1e6,
+			n * pagel / t * 1e-6 );
+
+		fflush( stdout );
+	}
+
+	ret = 0;
+
+_end:
+	free( lat );
+	free( b.ctx );
+	free( b.dbuf );
+	free( b.cl[ 1 ]);
+	free( b.cl[ 0 ]);
+	free( b.cbuf[ 1 ]);
+	free( b.cbuf[ 0 ]);
+	free( (void*) b.data );
+
+	return( ret );
+}
+
+/**
+ * @brief Decoder comparison benchmark.
+ *
+ * Function compresses each file named by positional command-line arguments
+ * with both compression levels, and measures decompression throughput of
+ * the lzav_decompress(), lzav_decompress_tab() and lzav_decompress_batch()
+ * functions. Decoders are run in alternating rounds, and the best round of
+ * each decoder is reported, which reduces the effect of CPU frequency
+ * changes.
+ *
+ * @param wlog log2 of LZ77 window length, 0 - the full window.
+ * @param mint Minimal total duration of each measurement, in seconds.
+ * @return Process exit code.
+ */
+
+static int cli_dec_run( const int argc, char** const argv, const int wlog,
+	const double mint )
+{
+	static const int rounds = 5;
+	int i, lv, r, k;
+
+	printf( "LZAV %s decoder benchmark, %.1f s per run\n", LZAV_VER_STR,
+		mint );
+
+	printf( "Lvl  Ratio %%  decompress MB/s  _tab MB/s  Diff %%  "
+		"_batch MB/s  Diff %%  File\n" );
+
+	for( i = 1; i < argc; i++ )
+	{
+		const char* const fn = argv[ i ];
+
+		if( fn[ 0 ] == '-' )
+		{
+			continue;
+		}
+
+		size_t len;
+		uint8_t* const data = cli_read_file( fn, &len );
+
+		if( data == 0 )
+		{
+			return( 1 );
+		}
+
+		if( len == 0 || len > ( 1 << 30 ))
+		{
+			fprintf( stderr, "lzav: %s is empty or longer than 1 GiB\n",
+				fn );
+
+			free( data );
+			return( 1 );
+		}
+
+		const int srcl = (int) len;
+		const int bnd0 = lzav_compress_bound( srcl );
+		const int bndh = lzav_compress_bound_hi( srcl );
+		const int bnd = ( bnd0 > bndh ? bnd0 : bndh ); // For both levels.
+		uint8_t* const cbuf = (uint8_t*) malloc( bnd );
+		uint8_t* const dbuf = (uint8_t*) malloc( len );
+
+		if( cbuf == 0 || dbuf == 0 )
+		{
+			fprintf( stderr, "lzav: not enough memory\n" );
+			free( dbuf );
+			free( cbuf );
+			free( data );
+			return( 1 );
+		}
+
+		for( lv = 1; lv < 3; lv++ )
+		{
+			const int cl = ( lv > 1 ?
+				lzav_compress_hi_win( data, cbuf, srcl, bnd, 0, wlog ) :
+				lzav_compress_win( data, cbuf, srcl, bnd, 0, 0, 0, wlog ));
+
+			double best[ 3 ] = { 0.0, 0.0, 0.0 };
+
+			for( r = 0; r < rounds && cl > 0; r++ )
+			{
+				for( k = 0; k < 3; k++ )
+				{
+					const double t0 = cli_time();
+					double t = 0.0;
+					double m = 0.0;
+
+					do
+					{
+						const int l = ( k == 0 ?
+							lzav_decompress( cbuf, dbuf, cl, srcl ) :
+							k == 1 ?
+							lzav_decompress_tab( cbuf, dbuf, cl, srcl ) :
+							lzav_decompress_batch( cbuf, dbuf, cl, srcl ));
+
+						if( l != srcl || memcmp( dbuf, data, len ) != 0 )
+						{
+							fprintf( stderr, "lzav: %s: decoder %d failed\n",
+								fn, k );
+
+							free( dbuf );
+							free( cbuf );
+							free( data );
+							return( 1 );
+						}
+
+						m += (double) len;
+						t = cli_time() - t0;
+
+					} while( t < mint / rounds );
+
+					if( m / t > best[ k ])
+					{
+						best[ k ] = m / t;
+					}
+				}
+			}
+
+			if( cl <= 0 )
+			{
+				fprintf( stderr, "lzav: %s: compression failed\n", fn );
+				break;
+			}
+
+			printf( "%3d %8.2f %16.1f %10.1f %7.1f %12.1f %7.1f  %s\n", lv,
+				cl * 100.0 / len, best[ 0 ] * 1e-6, best[ 1 ] * 1e-6,
+				( best[ 1 ] / best[ 0 ] - 1.0 ) * 100.0, best[ 2 ] * 1e-6,
+				( best[ 2 ] / best[ 0 ] - 1.0 ) * 100.0, fn );
+
+			fflush( stdout );
+		}
+
+		free( dbuf );
+		free( cbuf );
+		free( data );
+	}
+
+	return( 0 );
+}
+
+/**
+ * @brief Function returns a message for a negative `LZAV_E_` error code.
+ */
+
+static const char* cli_strerror( const int e )
+{
+	switch( e )
+	{
+		case LZAV_E_SRCOOB:
+			return( "truncated or corrupted data" );
+
+		case LZAV_E_UNKFMT:
+			return( "not in LZAV frame format" );
+
+		case LZAV_E_CHECK:
+			return( "checksum mismatch" );
+
+		case LZAV_E_FILE:
+			return( "file I/O error" );
+
+		case LZAV_E_NOMEM:
+			return( "not enough memory" );
+	}
+
+	return( "corrupted data" );
+}
+
+/**
+ * @brief Function returns the length of a regular file, or
+ * `LZAV_FRAME_LEN_UNK` if the length cannot be obtained.
+ */
+
+static uint64_t cli_file_len( const char* const fn )
+{
+#if defined( _WIN32 )
+
+	struct _stat64 st;
+
+	if( _stat64( fn, &st ) == 0 && ( st.st_mode & _S_IFREG ) != 0 )
+	{
+		return( (uint64_t) st.st_size );
+	}
+
+#else // defined( _WIN32 )
+
+	struct stat st;
+
+	if( stat( fn, &st ) == 0 && S_ISREG( st.st_mode ))
+	{
+		return( (uint64_t) st.st_size );
+	}
+
+#endif // defined( _WIN32 )
+
+	return( LZAV_FRAME_LEN_UNK );
+}
+
+static void cli_usage( void )
+{
+	fprintf( stderr,
+		"LZAV %s command-line utility\n"
+		"Usage: lzav [options] [input] [output]\n"
+		"Input and output default to stdin and stdout, \"-\" denotes stdin.\n"
+		"  -z      Compress (default), output file gets .lzav suffix\n"
+		"  -d      Decompress, .lzav suffix is removed from output file\n"
+		"  -t      Test integrity of compressed data\n"
+		"  -c      Write output to stdout\n"
+		"  -f      Overwrite existing output file\n"
+		"  -v      Print compression summary\n"
+		"  -1      Default compression (lzav_compress)\n"
+		"  -2      Higher-ratio compression (lzav_compress_hi)\n"
+		"  -3      Higher-ratio compression with faster decompression\n"
+		"          (lzav_compress_hi_fd)\n"
+		"  -W#     LZ77 window length, power of 2, 64K to 1G (default: 8M);\n"
+		"          smaller - faster decompression, larger than 8M - higher\n"
+		"          ratio with -2\n"
+		"  -T#     Number of threads, 0 - all processors (default: 1)\n"
+		"  -B#     Segment length, power of 2 from 64K to 1G (default: 8M,\n"
+		"          or the -W window if it is larger)\n"
+		"  --no-check  Do not store segment checksums\n"
+		"  --ldm   Long-distance matching with -1, finds repeats farther\n"
+		"          apart than about 1M within the window (slower)\n"
+		"  -H      Allocate hash-tables and buffers from huge memory pages\n"
+		"  -b      Run multi-threaded scaling benchmark on the input file;\n"
+		"          -T sets maximal thread count, -B sets block length\n"
+		"  -P#     Run page latency benchmark on the input file, with page\n"
+		"          length # (e.g., 4K, 16K, up to 64K)\n"
+		"  -D      Compare lzav_decompress(), lzav_decompress_tab() and\n"
+		"          lzav_decompress_batch() decoder speed on the input files\n"
+		"  -i#     Seconds per benchmark measurement (default: 1)\n"
+		"  -A      Create archive (first file) of files that follow\n"
+		"  --dedup With -A, create deduplicating container: identical\n"
+		"          data regions of files are stored once\n"
+		"  -L      List archive's entries\n"
+		"  -X      Extract archive's entry (second argument) to stdout\n",
+		LZAV_VER_STR );
+}
+
+/**
+ * @brief Function checks if an output file can be written, refusing to
+ * overwrite an existing file unless `force` is non-zero.
+ */
+
+static int cli_check_out( const char* const fn, const int force )
+{
+	if( !force )
+	{
+		FILE* const f = fopen( fn, "rb" );
+
+		if( f != 0 )
+		{
+			fclose( f );
+			fprintf( stderr, "lzav: %s already exists, use -f to "
+				"overwrite\n", fn );
+
+			return( 0 );
+		}
+	}
+
+	return( 1 );
+}
+
+/**
+ * @brief Function opens an output file, see cli_check_out().
+ */
+
+static FILE* cli_open_out( const char* const fn, const int force )
+{
+	if( !cli_check_out( fn, force ))
+	{
+		return( 0 );
+	}
+
+	FILE* const f = fopen( fn, "wb" );
+
+	if( f == 0 )
+	{
+		fprintf( stderr, "lzav: cannot create %s\n", fn );
+	}
+
+	return( f );
+}
+
+static int cli_isatty( FILE* const f )
+{
+#if defined( _WIN32 )
+	return( _isatty( _fileno( f )));
+#else // defined( _WIN32 )
+	return( isatty( fileno( f )));
+#endif // defined( _WIN32 )
+}
+
+/**
+ * @brief Function creates an archive from the files named by positional
+ * command-line arguments following the archive's name. Entry names are
+ * file names as specified.
+ *
+ * @return Process exit code.
+ */
+
+static int cli_arc_create( const int argc, char** const argv,
+	const int level )
+{
+	lzav_arc_writer w;
+	const char* afn = 0;
+	int n = 0;
+	int r = 0;
+	int i;
+
+	for( i = 1; i < argc && r == 0; i++ )
+	{
+		const char* const a = argv[ i ];
+
+		if( a[ 0 ] == '-' )
+		{
+			continue;
+		}
+
+		if( afn == 0 )
+		{
+			afn = a;
+			r = lzav_arc_writer_open( &w, afn, level );
+			continue;
+		}
+
+		size_t l;
+		uint8_t* const buf = cli_read_file( a, &l );
+
+		if( buf == 0 )
+		{
+			w.err = LZAV_E_FILE;
+			lzav_arc_writer_close( &w );
+			return( 1 );
+		}
+
+		r = lzav_arc_add( &w, a, strlen( a ), buf, l );
+		free( buf );
+		n++;
+	}
+
+	if( afn == 0 )
+	{
+		cli_usage();
+		return( 1 );
+	}
+
+	if( w.f != 0 )
+	{
+		// Also reports a sticky error, and removes the archive file.
+
+		r = lzav_arc_writer_close( &w );
+	}
+
+	if( r < 0 )
+	{
+		fprintf( stderr, "lzav: %s: %s\n", afn, ( r == LZAV_E_PARAMS ?
+			"duplicate or oversized entry" : cli_strerror( r )));
+
+		return( 1 );
+	}
+
+	fprintf( stderr, "lzav: %s: %d entries\n", afn, n );
+
+	return( 0 );
+}
+
+/**
+ * @brief Function creates a deduplicating container from the files named by
+ * positional command-line arguments following the container's name. Files
+ * are read as streams, and are not loaded into memory.
+ *
+ * @return Process exit code.
+ */
+
+static int cli_dedup_create( const int argc, char** const argv,
+	const int level )
+{
+	lzav_dedup_writer w;
+	const char* afn = 0;
+	uint8_t* const buf = (uint8_t*) malloc( 1 << 20 );
+	int n = 0;
+	int r = 0;
+	int i;
+
+	if( buf == 0 )
+	{
+		fprintf( stderr, "lzav: %s\n", cli_strerror( LZAV_E_NOMEM ));
+		return( 1 );
+	}
+
+	for( i = 1; i < argc && r == 0; i++ )
+	{
+		const char* const a = argv[ i ];
+
+		if( a[ 0 ] == '-' )
+		{
+			continue;
+		}
+
+		if( afn == 0 )
+		{
+			afn = a;
+			r = lzav_dedup_writer_open( &w, afn, level );
+			continue;
+		}
+
+		FILE* const f = fopen( a, "rb" );
+
+		if( f == 0 )
+		{
+			fprintf( stderr, "lzav: cannot open %s\n", a );
+			w.err = LZAV_E_FILE;
+			lzav_dedup_writer_close( &w );
+			free( buf );
+			return( 1 );
+		}
+
+		r = lzav_dedup_begin( &w, a, strlen( a ));
+
+		while( r == 0 )
+		{
+			const size_t l = fread( buf, 1, 1 << 20, f );
+
+			if( l == 0 )
+			{
+				r = ( ferror( f ) ? LZAV_E_FILE : lzav_dedup_end( &w ));
+				break;
+			}
+
+			r = lzav_dedup_write( &w, buf, l );
+		}
+
+		fclose( f );
+		n++;
+	}
+
+	free( buf );
+
+	if( afn == 0 )
+	{
+		cli_usage();
+		return( 1 );
+	}
+
+	const uint64_t ul = w.ulen;
+	const uint64_t dl = w.dlen;
+
+	if( w.fn != 0 )
+	{
+		if( r < 0 && w.err == 0 )
+		{
+			w.err = r;
+		}
+
+		// Also reports a sticky error, and removes the container file.
+
+		r = lzav_dedup_writer_close( &w );
+	}
+
+	if( r < 0 )
+	{
+		fprintf( stderr, "lzav: %s: %s\n", afn, ( r == LZAV_E_PARAMS ?
+			"duplicate stream name" : cli_strerror( r )));
+
+		return( 1 );
+	}
+
+	fprintf( stderr, "lzav: %s: %d streams, %llu of %llu bytes "
+		"deduplicated\n", afn, n, (unsigned long long) dl,
+		(unsigned long long) ul );
+
+	return( 0 );
+}
+
+/**
+ * @brief Function lists container's streams, or extracts a stream to stdout
+ * if `name` is non-zero.
+ *
+ * @param d Opened container reader, released by the function.
+ * @return Process exit code.
+ */
+
+static int cli_dedup_read( lzav_dedup* const d, const char* const afn,
+	const char* const name )
+{
+	lzav_dedup_entry e;
+	int r = 0;
+	uint32_t i;
+
+	if( name == 0 )
+	{
+		for( i = 0; i < d -> n && r == 0; i++ )
+		{
+			r = lzav_dedup_get( d, i, &e );
+
+			if( r == 0 )
+			{
+				printf( "%12llu %12u  %.*s\n", (unsigned long long) e.len,
+					e.nch, (int) e.namel, e.name );
+			}
+		}
+	}
+	else
+	{
+		r = lzav_dedup_find( d, name, strlen( name ), &e );
+
+		if( r >= 0 )
+		{
+#if defined( _WIN32 )
+			_setmode( _fileno( stdout ), _O_BINARY );
+#endif // defined( _WIN32 )
+
+			r = lzav_dedup_extract( d, &e, stdout );
+		}
+	}
+
+	lzav_dedup_close( d );
+
+	if( r < 0 )
+	{
+		fprintf( stderr, "lzav: %s: %s\n", afn, ( r == LZAV_E_NOENT ?
+			"stream not found" : cli_strerror( r )));
+
+		return( 1 );
+	}
+
+	return( 0 );
+}
+
+/**
+ * @brief Function lists archive's entries, or extracts an entry to stdout
+ * if `name` is non-zero. Deduplicating containers are handled by
+ * cli_dedup_read().
+ *
+ * @return Process exit code.
+ */
+
+static int cli_arc_read( const char* const afn, const char* const name )
+{
+	lzav_dedup d;
+
+	if( lzav_dedup_open( &d, afn ) == 0 )
+	{
+		return( cli_dedup_read( &d, afn, name ));
+	}
+
+	lzav_arc a;
+	lzav_arc_entry e;
+	int r = lzav_arc_open( &a, afn );
+	uint32_t i;
+
+	if( r < 0 )
+	{
+		fprintf( stderr, "lzav: %s: %s\n", afn, ( r == LZAV_E_UNKFMT ?
+			"not an LZAV archive" : cli_strerror( r )));
+
+		return( 1 );
+	}
+
+	if( name == 0 )
+	{
+		for( i = 0; i < a.n && r == 0; i++ )
+		{
+			r = lzav_arc_get( &a, i, &e );
+
+			if( r == 0 )
+			{
+				printf( "%12zu %12zu  %.*s\n", e.len, e.cl, (int) e.namel,
+					e.name );
+			}
+		}
+	}
+	else
+	{
+		r = lzav_arc_find( &a, name, strlen( name ), &e );
+
+		if( r >= 0 )
+		{
+			uint8_t* const buf = (uint8_t*) malloc( e.len + 1 );
+
+			if( buf == 0 )
+			{
+				r = LZAV_E_NOMEM;
+			}
+			else
+			{
+				r = lzav_arc_decompress( &e, buf );
+
+#if defined( _WIN32 )
+				_setmode( _fileno( stdout ), _O_BINARY );
+#endif // defined( _WIN32 )
+
+				if( r >= 0 && fwrite( buf, 1, e.len, stdout ) != e.len )
+				{
+					r = LZAV_E_FILE;
+				}
+
+				free( buf );
+			}
+		}
+	}
+
+	lzav_arc_close( &a );
+
+	if( r < 0 )
+	{
+		fprintf( stderr, "lzav: %s: %s\n", afn, ( r == LZAV_E_NOENT ?
+			"entry not found" : cli_strerror( r )));
+
+		return( 1 );
+	}
+
+	return( 0 );
+}
+
+int main( int argc, char** argv )
+{
+	const char* fn[ 2 ] = { 0, 0 }; // Input and output file names.
+	int fnc = 0;
+	int mode = 'z';
+	int tostd = 0;
+	int force = 0;
+	int verbose = 0;
+	int level = 1;
+	int ldm = 0; // `LZAV_FRAME_LDM`, if the long-distance matching is used.
+	int dedup = 0;
+	int wlog = 0; // log2 of LZ77 window length, 0 - the full window.
+	int flags = LZAV_FRAME_F_CHECK;
+	int nt = -1; // Number of threads, -1 - not specified.
+	size_t blkl = 0; // 0 - not specified.
+	size_t pagel = 0;
+	double mint = 1.0;
+	int i;
+
+	for( i = 1; i < argc; i++ )
+	{
+		const char* const a = argv[ i ];
+
+		if( a[ 0 ] != '-' || a[ 1 ] == 0 )
+		{
+			if( fnc < 2 )
+			{
+				fn[ fnc ] = a;
+			}
+
+			fnc++;
+		}
+		else
+		if( strcmp( a, "--no-check" ) == 0 )
+		{
+			flags &= ~LZAV_FRAME_F_CHECK;
+		}
+		else
+		if( strcmp( a, "--ldm" ) == 0 )
+		{
+			ldm = LZAV_FRAME_LDM;
+		}
+		else
+		if( strcmp( a, "--dedup" ) == 0 )
+		{
+			dedup = 1;
+		}
+		else
+		if( a[ 1 ] == 'T' )
+		{
+			nt = atoi( a + 2 );
+		}
+		else
+		if( a[ 1 ] == 'B' )
+		{
+			if( !cli_parse_size( a + 2, &blkl ) || blkl < 16 ||
+				blkl > ( 1U << LZAV_FRAME_SEG_LOG_MAX ))
+			{
+				fprintf( stderr, "lzav: invalid block length %s\n", a + 2 );
+				return( 1 );
+			}
+		}
+		else
+		if( a[ 1 ] == 'W' )
+		{
+			size_t wl = 0;
+			wlog = 0;
+
+			if( cli_parse_size( a + 2, &wl ))
+			{
+				while(( (size_t) 1 << wlog ) < wl &&
+					wlog < LZAV_WIN_LOG_MAX )
+				{
+					wlog++;
+				}
+			}
+
+			if( wlog < LZAV_WIN_LOG_MIN || ( (size_t) 1 << wlog ) != wl )
+			{
+				fprintf( stderr, "lzav: invalid window length %s\n", a + 2 );
+				return( 1 );
+			}
+
+			if( wlog == LZAV_WIN_LOG )
+			{
+				wlog = 0;
+			}
+		}
+		else
+		if( a[ 1 ] == 'P' )
+		{
+			if( !cli_parse_size( a + 2, &pagel ) || pagel == 0 ||
+				pagel > LZAV_PAGE_LEN_MAX )
+			{
+				fprintf( stderr, "lzav: invalid page length %s\n", a + 2 );
+				return( 1 );
+			}
+
+			mode = 'p';
+		}
+		else
+		if( a[ 1 ] == 'i' )
+		{
+			mint = atof( a + 2 );
+
+			if( mint <= 0.0 )
+			{
+				mint = 1.0;
+			}
+		}
+		else
+		if( strchr( "zdtbALXD", a[ 1 ] ) != 0 && a[ 2 ] == 0 )
+		{
+			mode = a[ 1 ];
+		}
+		else
+		if( a[ 1 ] >= '1' && a[ 1 ] <= '3' && a[ 2 ] == 0 )
+		{
+			level = a[ 1 ] - '0';
+		}
+		else
+		if( strcmp( a, "-c" ) == 0 )
+		{
+			tostd = 1;
+		}
+		else
+		if( strcmp( a, "-f" ) == 0 )
+		{
+			force = 1;
+		}
+		else
+		if( strcmp( a, "-v" ) == 0 )
+		{
+			verbose = 1;
+		}
+		else
+		if( strcmp( a, "-H" ) == 0 )
+		{
+			const lzav_alloc al = lzav_huge_alloc();
+			lzav_set_alloc( &al );
+		}
+		else
+		{
+			cli_usage();
+			return( 1 );
+		}
+	}
+
+	if( blkl == 0 )
+	{
+		// A large window is only effective within a segment of its length.
+
+		blkl = ( wlog > LZAV_WIN_LOG ? (size_t) 1 << wlog : 8 << 20 );
+	}
+
+	// The window length and the long-distance matching are recorded in the
+	// frame header as level modifiers.
+
+	const int wlevel = level | ( level > 1 ? 0 : ldm ) |
+		( wlog == 0 ? 0 : LZAV_FRAME_WIN( wlog ));
+
+	if( mode == 'D' )
+	{
+		if( fn[ 0 ] == 0 )
+		{
+			cli_usage();
+			return( 1 );
+		}
+
+		return( cli_dec_run( argc, argv, wlog, mint ));
+	}
+
+	if( mode == 'A' )
+	{
+		if( dedup )
+		{
+			return( cli_dedup_create( argc, argv, wlevel ));
+		}
+
+		return( cli_arc_create( argc, argv, wlevel ));
+	}
+
+	if( fnc > 2 )
+	{
+		cli_usage();
+		return( 1 );
+	}
+
+	if( mode == 'L' || mode == 'X' )
+	{
+		if( fn[ 0 ] == 0 || ( mode == 'X' ) != ( fn[ 1 ] != 0 ))
+		{
+			cli_usage();
+			return( 1 );
+		}
+
+		return( cli_arc_read( fn[ 0 ], fn[ 1 ]));
+	}
+
+	if( mode == 'b' )
+	{
+		if( fn[ 0 ] == 0 || fnc > 1 )
+		{
+			cli_usage();
+			return( 1 );
+		}
+
+		return( cli_bench_run( fn[ 0 ], level, wlog, nt, blkl, mint ));
+	}
+
+	if( mode == 'p' )
+	{
+		if( fn[ 0 ] == 0 || fnc > 1 )
+		{
+			cli_usage();
+			return( 1 );
+		}
+
+		return( cli_page_run( fn[ 0 ], (int) pagel, mint ));
+	}
+
+	nt = ( nt < 0 ? 1 : ( nt == 0 ? cli_cpu_count() : nt ));
+
+	lzav_frame_info fi;
+	fi.len = LZAV_FRAME_LEN_UNK;
+	fi.flags = flags;
+	fi.level = wlevel;
+	fi.seg_log = LZAV_FRAME_SEG_LOG_MIN;
+
+	while(( (size_t) 1 << fi.seg_log ) < blkl )
+	{
+		fi.seg_log++;
+	}
+
+	if(( (size_t) 1 << fi.seg_log ) != blkl )
+	{
+		fprintf( stderr, "lzav: segment length should be a power of 2, "
+			"64K to 1G\n" );
+
+		return( 1 );
+	}
+
+	if( fn[ 0 ] != 0 && strcmp( fn[ 0 ], "-" ) == 0 )
+	{
+		fn[ 0 ] = 0;
+	}
+
+	char* ofn = 0; // Derived output file name.
+
+	if( fn[ 0 ] != 0 && fn[ 1 ] == 0 && !tostd && mode != 't' )
+	{
+		const size_t l = strlen( fn[ 0 ] );
+		ofn = (char*) malloc( l + 6 );
+
+		if( ofn == 0 )
+		{
+			fprintf( stderr, "lzav: not enough memory\n" );
+			return( 1 );
+		}
+
+		memcpy( ofn, fn[ 0 ], l + 1 );
+
+		if( mode == 'z' )
+		{
+			strcat( ofn, ".lzav" );
+		}
+		else
+		if( l > 5 && strcmp( ofn + l - 5, ".lzav" ) == 0 )
+		{
+			ofn[ l - 5 ] = 0;
+		}
+		else
+		{
+			fprintf( stderr, "lzav: %s: unknown suffix, use -c or specify "
+				"output file\n", fn[ 0 ]);
+
+			free( ofn );
+			return( 1 );
+		}
+
+		fn[ 1 ] = ofn;
+	}
+
+	if( fn[ 1 ] != 0 && strcmp( fn[ 1 ], "-" ) == 0 )
+	{
+		fn[ 1 ] = 0;
+	}
+
+#if defined( _WIN32 )
+	_setmode( _fileno( stdin ), _O_BINARY );
+	_setmode( _fileno( stdout ), _O_BINARY );
+#endif // defined( _WIN32 )
+
+	FILE* in = stdin;
+	FILE* out = 0;
+	uint64_t tl[ 2 ]; // Input and output lengths.
+	int ret = 1;
+	int r;
+
+	if( fn[ 0 ] != 0 && fn[ 1 ] != 0 && mode != 't' && nt == 1 )
+	{
+		// Single-threaded file-to-file processing.
+
+		if( !cli_check_out( fn[ 1 ], force ))
+		{
+			goto _end;
+		}
+
+		tl[ 0 ] = cli_file_len( fn[ 0 ]);
+
+		r = ( mode == 'z' ?
+			lzav_compress_file( fn[ 0 ], fn[ 1 ], wlevel, fi.seg_log, flags,
+				tl + 1 ) :
+			lzav_decompress_file( fn[ 0 ], fn[ 1 ], tl + 1 ));
+
+		if( r < 0 )
+		{
+			fprintf( stderr, "lzav: %s: %s\n", fn[ 0 ], cli_strerror( r ));
+			goto _end;
+		}
+
+		ret = 0;
+		goto _summary;
+	}
+
+	if( fn[ 0 ] != 0 )
+	{
+		in = fopen( fn[ 0 ], "rb" );
+
+		if( in == 0 )
+		{
+			fprintf( stderr, "lzav: cannot open %s\n", fn[ 0 ]);
+			goto _end;
+		}
+
+		fi.len = cli_file_len( fn[ 0 ]);
+	}
+
+	if( mode != 't' )
+	{
+		if( fn[ 1 ] == 0 )
+		{
+			if( mode == 'z' && cli_isatty( stdout ))
+			{
+				fprintf( stderr, "lzav: refusing to write compressed data "
+					"to a terminal\n" );
+
+				goto _end;
+			}
+
+			out = stdout;
+		}
+		else
+		{
+			out = cli_open_out( fn[ 1 ], force );
+
+			if( out == 0 )
+			{
+				goto _end;
+			}
+		}
+	}
+
+	if( mode == 'z' )
+	{
+		r = lzav_compress_stream_mt( in, out, &fi, nt, tl, tl + 1 );
+	}
+	else
+	{
+		r = lzav_decompress_stream_mt( in, out, nt, tl, tl + 1 );
+	}
+
+	if( r < 0 )
+	{
+		fprintf( stderr, "lzav: %s: %s\n", ( fn[ 0 ] == 0 ? "stdin" :
+			fn[ 0 ]), cli_strerror( r ));
+
+		goto _end;
+	}
+
+	ret = 0;
+
+_summary:
+	if( ret == 0 && verbose )
+	{
+		const uint64_t ul = tl[ mode == 'z' ? 0 : 1 ];
+		const uint64_t cl = tl[ mode == 'z' ? 1 : 0 ];
+
+		fprintf( stderr, "%s: %llu -> %llu bytes (%.2f%%)%s\n",
+			( fn[ 0 ] == 0 ? "stdin" : fn[ 0 ]), (unsigned long long) ul,
+			(unsigned long long) cl,
+			( ul == 0 ? 0.0 : (double) cl * 100.0 / (double) ul ),
+			( mode == 't' ? ", OK" : "" ));
+	}
+
+_end:
+	if( out != 0 && out != stdout )
+	{
+		if( fclose( out ) != 0 && ret == 0 )
+		{
+			fprintf( stderr, "lzav: write error\n" );
+			ret = 1;
+		}
+
+		if( ret != 0 )
+		{
+			remove( fn[ 1 ]);
+		}
+	}
+
+	if( in != 0 && in != stdin )
+	{
+		fclose( in );
+	}
+
+	free( ofn );
+
+	return( ret );
+}
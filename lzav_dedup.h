@@ -0,0 +1,1292 @@
+/**
+ * @file lzav_dedup.h
+ *
+ * @version 4.5
+ *
+ * @brief The inclusion file for the "LZAV" deduplicating container of named
+ * data streams.
+ *
+ * A container stores data streams (e.g., backups or file system images)
+ * that share large identical regions, possibly at different offsets. Each
+ * stream is split into variable-length chunks at content-defined
+ * boundaries: a "gear" rolling hash is computed over stream's bytes, and a
+ * chunk ends where the hash value has its upper `LZAV_DEDUP_AVG_LOG` bits
+ * equal to zero, within `LZAV_DEDUP_MIN` to `LZAV_DEDUP_MAX` limits. Since
+ * boundaries depend on the contents only, an insertion or a deletion in a
+ * stream shifts the nearby boundaries only, and the following chunks
+ * remain identical to the previously-stored ones.
+ *
+ * Each chunk is identified by its 128-bit fingerprint made of two
+ * lzav_hash64() (komihash) values with different seeds. Taking the two
+ * values as independent, a fingerprint collision among `n` distinct chunks
+ * has a probability of about n^2 / 2^129, e.g., 2^-65 for 2^32 chunks. A
+ * chunk with an already-seen fingerprint is not stored again, but is
+ * referenced. Unique chunks are
+ * collected into packs of up to 2^`LZAV_DEDUP_PACK_LOG` bytes, which are
+ * compressed as frame segments, so that small chunks do not lose
+ * compression ratio. A stream is stored as a list of chunk indices.
+ *
+ * Like an archive, a container reader memory-maps the container file, and
+ * performs no parsing on open. When reading a chunk, its pack is
+ * decompressed into a small cache of recently-used packs, and chunk's
+ * contents are verified against its fingerprint.
+ *
+ * Container layout (all values are little-endian):
+ *
+ * Container header, `LZAV_DEDUP_HDR_LEN` bytes:
+ * 0-3: `LZAV_DEDUP_MAGIC` value.
+ * 4: Container format version, `LZAV_DEDUP_VER`.
+ * 5-7: Reserved, zero.
+ * 8-11: The number of chunks.
+ * 12-15: The number of streams.
+ * 16-23: Chunk table offset.
+ * 24-31: Stream table offset.
+ *
+ * Packs follow the header. A pack is a frame segment (see lzav_frame.h)
+ * without a checksum, with a segment length of 2^`LZAV_DEDUP_PACK_LOG`
+ * bytes.
+ *
+ * The chunk table follows packs, and consists of `LZAV_DEDUP_CHUNK_LEN`-byte
+ * items:
+ * 0-7: Pack's offset.
+ * 8-11: Chunk's offset within pack's uncompressed data.
+ * 12-15: Chunk's length.
+ * 16-23: lzav_hash64() of chunk's contents, with seed 0.
+ * 24-31: lzav_hash64() of chunk's contents, with seed `LZAV_DEDUP_SEED`.
+ *
+ * The chunk list table follows the chunk table, and extends to the stream
+ * table. It consists of 4-byte chunk indices.
+ *
+ * The stream table consists of `LZAV_DEDUP_IDX_LEN`-byte items, sorted by
+ * name hash, and then by name:
+ * 0-7: Stream's length.
+ * 8-15: Index of stream's first item in the chunk list table.
+ * 16-19: The number of stream's chunks.
+ * 20-23: The lower 32 bits of lzav_hash64() of the name.
+ * 24-27: Name offset, relative to the name table.
+ * 28-31: Name length.
+ *
+ * The name table follows the stream table, and extends to the end of the
+ * file. Names are not zero-terminated.
+ *
+ * Description is available at https://github.com/avaneev/lzav
+ *
+ * E-mail: aleksey.vaneev@gmail.com or info@voxengo.com
+ *
+ * LICENSE:
+ *
+ * Copyright (c) 2023-2024 Aleksey Vaneev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef LZAV_DEDUP_INCLUDED
+#define LZAV_DEDUP_INCLUDED
+
+#include "lzav_arc.h"
+
+#define LZAV_DEDUP_MAGIC 0x44444C8CU ///< Container identifier, "\x8CLDD"
+	///< bytes.
+#define LZAV_DEDUP_VER 1 ///< Container format version.
+#define LZAV_DEDUP_HDR_LEN 32 ///< Container header length, in bytes.
+#define LZAV_DEDUP_CHUNK_LEN 32 ///< Chunk table item length, in bytes.
+#define LZAV_DEDUP_IDX_LEN 32 ///< Stream table item length, in bytes.
+#define LZAV_DEDUP_MIN 2048 ///< Minimal chunk length, in bytes.
+#define LZAV_DEDUP_MAX 65536 ///< Maximal chunk length, in bytes.
+#define LZAV_DEDUP_AVG_LOG 13 ///< log2 of average chunk length above the
+	///< minimal length.
+#define LZAV_DEDUP_PACK_LOG 18 ///< log2 of maximal pack length.
+#define LZAV_DEDUP_CACHE 4 ///< The number of packs cached by the reader.
+#define LZAV_DEDUP_SEED 0x5D1E2A0FA7C3B61D ///< Second fingerprint's seed.
+
+/**
+ * @brief Container stream information. Pointers refer to the container's
+ * memory.
+ */
+
+typedef struct
+{
+	const char* name; ///< Stream's name, not zero-terminated.
+	size_t namel; ///< Name's length, in bytes.
+	uint64_t len; ///< Stream's length.
+	const uint8_t* list; ///< Chunk indices, 4 bytes each.
+	uint32_t nch; ///< The number of chunks.
+} lzav_dedup_entry;
+
+/**
+ * @brief Container reader. Not thread-safe, as it caches decompressed
+ * packs.
+ */
+
+typedef struct
+{
+	const uint8_t* p; ///< Container's data.
+	size_t l; ///< Container's length.
+	const uint8_t* chunks; ///< Chunk table.
+	uint32_t nc; ///< The number of chunks.
+	const uint8_t* list; ///< Chunk list table.
+	uint64_t nl; ///< The number of chunk list items.
+	const uint8_t* idx; ///< Stream table.
+	uint32_t n; ///< The number of streams.
+	const uint8_t* names; ///< Name table.
+	size_t namesl; ///< Name table's length.
+	uint8_t* pbuf; ///< Pack cache, allocated on first use.
+	uint64_t po[ LZAV_DEDUP_CACHE ]; ///< Offsets of cached packs, 0 - none.
+	int pl[ LZAV_DEDUP_CACHE ]; ///< Lengths of cached packs.
+	int pn; ///< Pack cache's next replaced slot.
+	int own; ///< lzav_arc_load() result, 0 - external.
+	size_t c; ///< Allocated capacity of `p`, if `own` is 2.
+	lzav_alloc al; ///< Allocator of `p` and `pbuf`.
+} lzav_dedup;
+
+/**
+ * @brief Function opens a container residing in memory.
+ *
+ * Only the header is validated: table items are validated on access.
+ *
+ * @param[out] d Container reader, should be released via
+ * lzav_dedup_close().
+ * @param p Container's data, should remain valid while the reader is used.
+ * @param l Container's length.
+ * @return 0 on success, or `LZAV_E_UNKFMT` if the data is not a valid
+ * container.
+ */
+
+static inline int lzav_dedup_open_mem( lzav_dedup* const d,
+	const void* const p, const size_t l )
+{
+	const uint8_t* const s = (const uint8_t*) p;
+
+	memset( d, 0, sizeof( lzav_dedup ));
+	d -> al = lzav_alloc_use( 0 );
+
+	if( s == 0 || l < LZAV_DEDUP_HDR_LEN ||
+		lzav_frame_ld32( s ) != LZAV_DEDUP_MAGIC ||
+		s[ 4 ] != LZAV_DEDUP_VER )
+	{
+		return( LZAV_E_UNKFMT );
+	}
+
+	const uint64_t nc = lzav_frame_ld32( s + 8 );
+	const uint64_t n = lzav_frame_ld32( s + 12 );
+	const uint64_t co = lzav_arc_ld64( s + 16 );
+	const uint64_t io = lzav_arc_ld64( s + 24 );
+
+	if( co < LZAV_DEDUP_HDR_LEN || co > l || io > l ||
+		nc > ( l - co ) / LZAV_DEDUP_CHUNK_LEN ||
+		io < co + nc * LZAV_DEDUP_CHUNK_LEN ||
+		n > ( l - io ) / LZAV_DEDUP_IDX_LEN )
+	{
+		return( LZAV_E_UNKFMT );
+	}
+
+	const uint64_t lo = co + nc * LZAV_DEDUP_CHUNK_LEN;
+
+	d -> p = s;
+	d -> l = l;
+	d -> chunks = s + co;
+	d -> nc = (uint32_t) nc;
+	d -> list = s + lo;
+	d -> nl = ( io - lo ) / 4;
+	d -> idx = s + io;
+	d -> n = (uint32_t) n;
+	d -> names = d -> idx + n * LZAV_DEDUP_IDX_LEN;
+	d -> namesl = l - (size_t) ( io + n * LZAV_DEDUP_IDX_LEN );
+
+	return( 0 );
+}
+
+/**
+ * @brief Function opens a container file.
+ *
+ * The file is loaded via lzav_arc_load().
+ *
+ * @param[out] d Container reader, should be released via
+ * lzav_dedup_close().
+ * @param fn File name.
+ * @param al Allocator of the file's contents and the pack cache; 0 - the
+ * global allocator.
+ * @return 0 on success, or a negative `LZAV_E_` error code.
+ */
+
+static inline int lzav_dedup_open_al( lzav_dedup* const d,
+	const char* const fn, const lzav_alloc* const al )
+{
+	const lzav_alloc cal = lzav_alloc_use( al );
+	const uint8_t* p;
+	size_t l;
+	size_t c;
+
+	memset( d, 0, sizeof( lzav_dedup ));
+
+	const int own = lzav_arc_load( fn, &cal, &p, &l, &c );
+
+	if( own < 0 )
+	{
+		return( own );
+	}
+
+	const int r = lzav_dedup_open_mem( d, p, l );
+
+	if( r < 0 )
+	{
+		lzav_arc_unload( p, l, own, c, &cal );
+		return( r );
+	}
+
+	d -> own = own;
+	d -> c = c;
+	d -> al = cal;
+
+	return( 0 );
+}
+
+/**
+ * @brief Function opens a container file, with the global allocator. See
+ * lzav_dedup_open_al().
+ */
+
+static inline int lzav_dedup_open( lzav_dedup* const d,
+	const char* const fn )
+{
+	return( lzav_dedup_open_al( d, fn, 0 ));
+}
+
+/**
+ * @brief Function releases a container reader.
+ */
+
+static inline void lzav_dedup_close( lzav_dedup* const d )
+{
+	if( d -> pbuf != 0 )
+	{
+		lzav_free( &d -> al, d -> pbuf,
+			(size_t) LZAV_DEDUP_CACHE << LZAV_DEDUP_PACK_LOG );
+	}
+
+	lzav_arc_unload( d -> p, d -> l, d -> own, d -> c, &d -> al );
+	memset( d, 0, sizeof( lzav_dedup ));
+}
+
+/**
+ * @brief Function returns information about a container's stream by its
+ * index position.
+ *
+ * @param d Container reader.
+ * @param i Stream's index position, 0 to `d -> n` - 1.
+ * @param[out] e Receiver of stream's information.
+ * @return 0 on success, `LZAV_E_PARAMS` if `i` is out of range, or
+ * `LZAV_E_UNKFMT` if the stream table item is invalid.
+ */
+
+static inline int lzav_dedup_get( const lzav_dedup* const d,
+	const uint32_t i, lzav_dedup_entry* const e )
+{
+	if( i >= d -> n )
+	{
+		return( LZAV_E_PARAMS );
+	}
+
+	const uint8_t* const ix = d -> idx + (size_t) i * LZAV_DEDUP_IDX_LEN;
+	const uint64_t lo = lzav_arc_ld64( ix + 8 );
+	const uint32_t nch = lzav_frame_ld32( ix + 16 );
+	const size_t no = lzav_frame_ld32( ix + 24 );
+	const size_t nl = lzav_frame_ld32( ix + 28 );
+
+	if( lo > d -> nl || nch > d -> nl - lo || no > d -> namesl ||
+		nl > d -> namesl - no )
+	{
+		return( LZAV_E_UNKFMT );
+	}
+
+	e -> name = (const char*) d -> names + no;
+	e -> namel = nl;
+	e -> len = lzav_arc_ld64( ix );
+	e -> list = d -> list + (size_t) lo * 4;
+	e -> nch = nch;
+
+	return( 0 );
+}
+
+/**
+ * @brief Function finds a container's stream by its name.
+ *
+ * @param d Container reader.
+ * @param name Stream's name.
+ * @param namel Name's length, in bytes.
+ * @param[out] e Receiver of stream's information, can be 0.
+ * @return Stream's index position, `LZAV_E_NOENT` if the stream was not
+ * found, or `LZAV_E_UNKFMT` if the stream table is invalid.
+ */
+
+static inline int lzav_dedup_find( const lzav_dedup* const d,
+	const char* const name, const size_t namel, lzav_dedup_entry* const e )
+{
+	const uint32_t h = lzav_arc_name_hash( name, namel );
+	uint32_t lo = 0;
+	uint32_t hi = d -> n;
+
+	while( lo < hi ) // Find the first item with a matching hash.
+	{
+		const uint32_t m = lo + ( hi - lo ) / 2;
+
+		if( lzav_frame_ld32( d -> idx + (size_t) m * LZAV_DEDUP_IDX_LEN +
+			20 ) < h )
+		{
+			lo = m + 1;
+		}
+		else
+		{
+			hi = m;
+		}
+	}
+
+	lzav_dedup_entry te;
+	lzav_dedup_entry* const pe = ( e == 0 ? &te : e );
+
+	while( lo < d -> n && lzav_frame_ld32( d -> idx +
+		(size_t) lo * LZAV_DEDUP_IDX_LEN + 20 ) == h )
+	{
+		const int r = lzav_dedup_get( d, lo, pe );
+
+		if( r < 0 )
+		{
+			return( r );
+		}
+
+		if( pe -> namel == namel && memcmp( pe -> name, name, namel ) == 0 )
+		{
+			return( (int) lo );
+		}
+
+		lo++;
+	}
+
+	return( LZAV_E_NOENT );
+}
+
+/**
+ * @brief Function returns a pointer to chunk's contents, decompressing its
+ * pack if it is not cached, and verifies chunk's fingerprint.
+ *
+ * @param d Container reader.
+ * @param ci Chunk's index.
+ * @param[out] pp Receiver of the pointer to chunk's contents, valid until
+ * the next call on the reader.
+ * @return Chunk's length, or a negative `LZAV_E_` error code.
+ */
+
+static inline int lzav_dedup_chunk( lzav_dedup* const d, const uint32_t ci,
+	const uint8_t** const pp )
+{
+	if( ci >= d -> nc )
+	{
+		return( LZAV_E_UNKFMT );
+	}
+
+	const uint8_t* const cx = d -> chunks +
+		(size_t) ci * LZAV_DEDUP_CHUNK_LEN;
+
+	const uint64_t po = lzav_arc_ld64( cx );
+	const uint32_t co = lzav_frame_ld32( cx + 8 );
+	const uint32_t cl = lzav_frame_ld32( cx + 12 );
+	int i;
+
+	for( i = 0; i < LZAV_DEDUP_CACHE; i++ )
+	{
+		if( d -> po[ i ] == po )
+		{
+			break;
+		}
+	}
+
+	if( i == LZAV_DEDUP_CACHE )
+	{
+		lzav_frame_info fi;
+		lzav_frame_seg seg;
+
+		fi.flags = 0;
+		fi.seg_log = LZAV_DEDUP_PACK_LOG;
+		fi.level = 0;
+
+		const size_t hl = (size_t) lzav_frame_seg_hdr_len( fi.flags );
+
+		if( po < LZAV_DEDUP_HDR_LEN || po > d -> l - hl ||
+			lzav_frame_read_seg( d -> p + po, &fi, &seg ) < 0 ||
+			seg.cl == 0 || (size_t) seg.cl > d -> l - po - hl )
+		{
+			return( LZAV_E_UNKFMT );
+		}
+
+		if( d -> pbuf == 0 )
+		{
+			d -> pbuf = (uint8_t*) lzav_malloc( &d -> al,
+				(size_t) LZAV_DEDUP_CACHE << LZAV_DEDUP_PACK_LOG );
+
+			if( d -> pbuf == 0 )
+			{
+				return( LZAV_E_NOMEM );
+			}
+		}
+
+		i = d -> pn;
+		d -> pn = ( i + 1 ) % LZAV_DEDUP_CACHE;
+		d -> po[ i ] = 0;
+
+		const int l = lzav_frame_decompress_seg( &seg, d -> p + po + hl,
+			d -> pbuf + ( (size_t) i << LZAV_DEDUP_PACK_LOG ), &fi );
+
+		if( l < 0 )
+		{
+			return( l );
+		}
+
+		d -> po[ i ] = po;
+		d -> pl[ i ] = l;
+	}
+
+	if( co > (uint32_t) d -> pl[ i ] || cl > (uint32_t) d -> pl[ i ] - co )
+	{
+		return( LZAV_E_UNKFMT );
+	}
+
+	const uint8_t* const p = d -> pbuf +
+		( (size_t) i << LZAV_DEDUP_PACK_LOG ) + co;
+
+	if( lzav_hash64( p, cl, 0 ) != lzav_arc_ld64( cx + 16 ))
+	{
+		return( LZAV_E_CHECK );
+	}
+
+	*pp = p;
+
+	return( (int) cl );
+}
+
+/**
+ * @brief Function decompresses a container's stream into memory.
+ *
+ * @param d Container reader.
+ * @param e Stream's information.
+ * @param[out] dst Destination buffer, at least `e -> len` bytes large.
+ * @return 0 on success, or a negative `LZAV_E_` error code.
+ */
+
+static inline int lzav_dedup_decompress( lzav_dedup* const d,
+	const lzav_dedup_entry* const e, void* const dst )
+{
+	uint8_t* op = (uint8_t*) dst;
+	uint64_t rl = e -> len;
+	uint32_t i;
+
+	for( i = 0; i < e -> nch; i++ )
+	{
+		const uint8_t* p = 0;
+		const int l = lzav_dedup_chunk( d,
+			lzav_frame_ld32( e -> list + (size_t) i * 4 ), &p );
+
+		if( l < 0 )
+		{
+			return( l );
+		}
+
+		if( (uint64_t) l > rl )
+		{
+			return( LZAV_E_DSTLEN );
+		}
+
+		memcpy( op, p, l );
+		op += l;
+		rl -= (uint64_t) l;
+	}
+
+	return( rl == 0 ? 0 : LZAV_E_DSTLEN );
+}
+
+/**
+ * @brief Function decompresses a container's stream to a file.
+ *
+ * @param d Container reader.
+ * @param e Stream's information.
+ * @param out Output file.
+ * @return 0 on success, or a negative `LZAV_E_` error code.
+ */
+
+static inline int lzav_dedup_extract( lzav_dedup* const d,
+	const lzav_dedup_entry* const e, FILE* const out )
+{
+	uint64_t rl = e -> len;
+	uint32_t i;
+
+	for( i = 0; i < e -> nch; i++ )
+	{
+		const uint8_t* p = 0;
+		const int l = lzav_dedup_chunk( d,
+			lzav_frame_ld32( e -> list + (size_t) i * 4 ), &p );
+
+		if( l < 0 )
+		{
+			return( l );
+		}
+
+		if( (uint64_t) l > rl )
+		{
+			return( LZAV_E_DSTLEN );
+		}
+
+		if( fwrite( p, 1, (size_t) l, out ) != (size_t) l )
+		{
+			return( LZAV_E_FILE );
+		}
+
+		rl -= (uint64_t) l;
+	}
+
+	return( rl == 0 ? 0 : LZAV_E_DSTLEN );
+}
+
+/**
+ * @brief Container writer's chunk.
+ */
+
+typedef struct
+{
+	uint64_t fp[ 2 ]; ///< Fingerprint.
+	uint64_t po; ///< Pack's offset, 0 - the pack was not yet written.
+	uint32_t co; ///< Offset within the pack.
+	uint32_t len; ///< Chunk's length.
+} lzav_dedup_wchunk;
+
+/**
+ * @brief Container writer's stream.
+ */
+
+typedef struct
+{
+	uint64_t len; ///< Stream's length.
+	uint64_t lo; ///< Index of the first chunk list item.
+	uint64_t nch; ///< The number of chunks.
+	uint32_t h; ///< Name hash.
+	char* name; ///< Name, allocated.
+	size_t namel; ///< Name's length.
+} lzav_dedup_wentry;
+
+/**
+ * @brief Container writer.
+ */
+
+typedef struct
+{
+	FILE* f; ///< Container file.
+	char* fn; ///< Container file's name, allocated.
+	uint64_t pos; ///< Current write position.
+	lzav_dedup_wchunk* ch; ///< Unique chunks.
+	size_t nc; ///< The number of unique chunks.
+	size_t chc; ///< Capacity of `ch`, in bytes.
+	uint32_t* ht; ///< Chunk lookup hash-table, chunk index + 1; 0 - empty.
+	size_t htn; ///< The number of hash-table's items, power-of-2.
+	uint32_t* list; ///< Chunk list of all streams.
+	size_t nl; ///< The number of chunk list items.
+	size_t listc; ///< Capacity of `list`, in bytes.
+	lzav_dedup_wentry* e; ///< Streams.
+	size_t n; ///< The number of streams.
+	size_t c; ///< Capacity of `e`, in bytes.
+	uint8_t* cbuf; ///< Current chunk's data, `LZAV_DEDUP_MAX` bytes.
+	size_t cl; ///< Current chunk's length.
+	uint64_t h; ///< Rolling hash value.
+	uint8_t* pack; ///< Current pack's data, 2^`LZAV_DEDUP_PACK_LOG` bytes.
+	size_t pl; ///< Current pack's length.
+	size_t pc; ///< Index of the first chunk in the current pack.
+	uint8_t* buf; ///< Compression buffer.
+	size_t bufc; ///< Compression buffer's capacity.
+	uint64_t ulen; ///< Total length of written streams.
+	uint64_t dlen; ///< Total length of deduplicated chunks.
+	int level; ///< Compression level.
+	int err; ///< Sticky error code, 0 if none.
+	int ins; ///< 1, if a stream was begun and not yet ended.
+	lzav_alloc al; ///< Allocator of writer's buffers.
+	uint64_t gear[ 256 ]; ///< Rolling hash's byte values.
+} lzav_dedup_writer;
+
+/**
+ * @brief Function creates a container file for writing.
+ *
+ * @param[out] w Container writer, should be finished via
+ * lzav_dedup_writer_close().
+ * @param fn Container file name. An existing file is overwritten.
+ * @param level Compression level of packs: 1 - default, 2 - higher-ratio,
+ * 3 - higher-ratio with faster decompression; can be ORed with
+ * `LZAV_FRAME_LDM`.
+ * @param al Allocator, 0 - the global allocator.
+ * @return 0 on success, or a negative `LZAV_E_` error code.
+ */
+
+static inline int lzav_dedup_writer_open_al( lzav_dedup_writer* const w,
+	const char* const fn, const int level, const lzav_alloc* const al )
+{
+	uint8_t hdr[ LZAV_DEDUP_HDR_LEN ];
+	const size_t fnl = strlen( fn );
+
+	memset( w, 0, sizeof( lzav_dedup_writer ));
+	w -> level = level;
+	w -> al = lzav_alloc_use( al );
+	lzav_gear_init( w -> gear );
+
+	w -> fn = (char*) lzav_malloc( &w -> al, fnl + 1 );
+
+	if( w -> fn != 0 )
+	{
+		// Copied at once: lzav_dedup_writer_close() frees by its length.
+
+		memcpy( w -> fn, fn, fnl + 1 );
+	}
+
+	w -> cbuf = (uint8_t*) lzav_malloc( &w -> al, LZAV_DEDUP_MAX );
+	w -> pack = (uint8_t*) lzav_malloc( &w -> al,
+		(size_t) 1 << LZAV_DEDUP_PACK_LOG );
+
+	if( w -> fn == 0 || w -> cbuf == 0 || w -> pack == 0 )
+	{
+		w -> err = LZAV_E_NOMEM;
+		return( w -> err );
+	}
+
+	w -> f = fopen( fn, "wb" );
+
+	if( w -> f == 0 )
+	{
+		w -> err = LZAV_E_FILE;
+		return( w -> err );
+	}
+
+	// The header is rewritten on close.
+
+	memset( hdr, 0, sizeof( hdr ));
+
+	if( fwrite( hdr, 1, sizeof( hdr ), w -> f ) != sizeof( hdr ))
+	{
+		w -> err = LZAV_E_FILE;
+	}
+
+	w -> pos = sizeof( hdr );
+
+	return( w -> err );
+}
+
+/**
+ * @brief Function creates a container file for writing, with the global
+ * allocator. See lzav_dedup_writer_open_al().
+ */
+
+static inline int lzav_dedup_writer_open( lzav_dedup_writer* const w,
+	const char* const fn, const int level )
+{
+	return( lzav_dedup_writer_open_al( w, fn, level, 0 ));
+}
+
+/**
+ * @brief Function compresses and writes the current pack.
+ */
+
+static inline void lzav_dedup_flush_pack( lzav_dedup_writer* const w )
+{
+	if( w -> pl == 0 || w -> err != 0 )
+	{
+		return;
+	}
+
+	lzav_frame_info fi;
+	fi.flags = 0;
+	fi.seg_log = LZAV_DEDUP_PACK_LOG;
+	fi.level = w -> level;
+
+	const int bl = lzav_frame_seg_bound( (int) w -> pl );
+
+	if( !lzav_file_reserve( &w -> al, &w -> buf, &w -> bufc, (size_t) bl ))
+	{
+		w -> err = LZAV_E_NOMEM;
+		return;
+	}
+
+	const int l = lzav_frame_compress_seg( w -> pack, (int) w -> pl,
+		w -> buf, bl, &fi );
+
+	if( l == 0 )
+	{
+		w -> err = LZAV_E_NOMEM;
+		return;
+	}
+
+	if( fwrite( w -> buf, 1, (size_t) l, w -> f ) != (size_t) l )
+	{
+		w -> err = LZAV_E_FILE;
+		return;
+	}
+
+	while( w -> pc < w -> nc )
+	{
+		w -> ch[ w -> pc ].po = w -> pos;
+		w -> pc++;
+	}
+
+	w -> pos += (uint64_t) l;
+	w -> pl = 0;
+}
+
+/**
+ * @brief Function doubles the capacity of the chunk lookup hash-table.
+ *
+ * @return 1 on success, 0 if not enough memory.
+ */
+
+static inline int lzav_dedup_grow_ht( lzav_dedup_writer* const w )
+{
+	const size_t htn = ( w -> htn == 0 ? 1 << 12 : w -> htn * 2 );
+	uint32_t* const ht = (uint32_t*) lzav_malloc( &w -> al,
+		htn * sizeof( uint32_t ));
+
+	if( ht == 0 )
+	{
+		return( 0 );
+	}
+
+	memset( ht, 0, htn * sizeof( uint32_t ));
+	size_t i;
+
+	for( i = 0; i < w -> nc; i++ )
+	{
+		size_t hi = (size_t) w -> ch[ i ].fp[ 0 ] & ( htn - 1 );
+
+		while( ht[ hi ] != 0 )
+		{
+			hi = ( hi + 1 ) & ( htn - 1 );
+		}
+
+		ht[ hi ] = (uint32_t) ( i + 1 );
+	}
+
+	if( w -> ht != 0 )
+	{
+		lzav_free( &w -> al, w -> ht, w -> htn * sizeof( uint32_t ));
+	}
+
+	w -> ht = ht;
+	w -> htn = htn;
+
+	return( 1 );
+}
+
+/**
+ * @brief Function adds a completed chunk to the current stream: a new chunk
+ * is appended to the current pack, a duplicate chunk is referenced.
+ */
+
+static inline void lzav_dedup_put( lzav_dedup_writer* const w,
+	const uint8_t* const p, const size_t l )
+{
+	const uint64_t fp0 = lzav_hash64( p, l, 0 );
+	const uint64_t fp1 = lzav_hash64( p, l, LZAV_DEDUP_SEED );
+
+	if(( w -> nc + 1 ) * 2 > w -> htn && !lzav_dedup_grow_ht( w ))
+	{
+		w -> err = LZAV_E_NOMEM;
+		return;
+	}
+
+	size_t hi = (size_t) fp0 & ( w -> htn - 1 );
+	uint32_t ci;
+
+	while( 1 )
+	{
+		ci = w -> ht[ hi ];
+
+		if( ci == 0 )
+		{
+			break;
+		}
+
+		const lzav_dedup_wchunk* const c = w -> ch + ci - 1;
+
+		if( c -> fp[ 0 ] == fp0 && c -> fp[ 1 ] == fp1 && c -> len == l )
+		{
+			break;
+		}
+
+		hi = ( hi + 1 ) & ( w -> htn - 1 );
+	}
+
+	if( !lzav_arc_grow( &w -> al, (void**) &w -> list, &w -> listc,
+		( w -> nl + 1 ) * sizeof( uint32_t )))
+	{
+		w -> err = LZAV_E_NOMEM;
+		return;
+	}
+
+	if( ci != 0 )
+	{
+		w -> list[ w -> nl ] = ci - 1;
+		w -> nl++;
+		w -> dlen += l;
+		return;
+	}
+
+	if( w -> nc == 0xFFFFFFFF )
+	{
+		w -> err = LZAV_E_PARAMS;
+		return;
+	}
+
+	if( w -> pl + l > ( (size_t) 1 << LZAV_DEDUP_PACK_LOG ))
+	{
+		lzav_dedup_flush_pack( w );
+
+		if( w -> err != 0 )
+		{
+			return;
+		}
+	}
+
+	if( !lzav_arc_grow( &w -> al, (void**) &w -> ch, &w -> chc,
+		( w -> nc + 1 ) * sizeof( lzav_dedup_wchunk )))
+	{
+		w -> err = LZAV_E_NOMEM;
+		return;
+	}
+
+	lzav_dedup_wchunk* const c = w -> ch + w -> nc;
+	c -> fp[ 0 ] = fp0;
+	c -> fp[ 1 ] = fp1;
+	c -> po = 0;
+	c -> co = (uint32_t) w -> pl;
+	c -> len = (uint32_t) l;
+
+	memcpy( w -> pack + w -> pl, p, l );
+	w -> pl += l;
+
+	w -> ht[ hi ] = (uint32_t) ( w -> nc + 1 );
+	w -> list[ w -> nl ] = (uint32_t) w -> nc;
+	w -> nl++;
+	w -> nc++;
+}
+
+/**
+ * @brief Function begins a new stream in the container. Stream's data is
+ * then passed via lzav_dedup_write() calls, and the stream is finished via
+ * lzav_dedup_end().
+ *
+ * @param w Container writer.
+ * @param name Stream's name.
+ * @param namel Name's length, in bytes.
+ * @return 0 on success, or a negative `LZAV_E_` error code. Errors are
+ * sticky, and are also returned by lzav_dedup_writer_close().
+ */
+
+static inline int lzav_dedup_begin( lzav_dedup_writer* const w,
+	const char* const name, const size_t namel )
+{
+	if( w -> err != 0 )
+	{
+		return( w -> err );
+	}
+
+	if( w -> ins || namel > 0x7FFFFFFF )
+	{
+		return( LZAV_E_PARAMS );
+	}
+
+	lzav_dedup_wentry* e;
+
+	if( !lzav_arc_grow( &w -> al, (void**) &w -> e, &w -> c,
+		( w -> n + 1 ) * sizeof( lzav_dedup_wentry )))
+	{
+		w -> err = LZAV_E_NOMEM;
+		return( w -> err );
+	}
+
+	e = w -> e + w -> n;
+	e -> name = (char*) lzav_malloc( &w -> al, namel + 1 );
+
+	if( e -> name == 0 )
+	{
+		w -> err = LZAV_E_NOMEM;
+		return( w -> err );
+	}
+
+	memcpy( e -> name, name, namel );
+	e -> name[ namel ] = 0;
+	e -> namel = namel;
+	e -> h = lzav_arc_name_hash( name, namel );
+	e -> len = 0;
+	e -> lo = w -> nl;
+	e -> nch = 0;
+	w -> n++;
+
+	w -> cl = 0;
+	w -> h = 0;
+	w -> ins = 1;
+
+	return( 0 );
+}
+
+/**
+ * @brief Function passes the next portion of the current stream's data.
+ *
+ * @param w Container writer.
+ * @param data Data.
+ * @param len Data length, in bytes.
+ * @return 0 on success, or a negative `LZAV_E_` error code. Errors are
+ * sticky.
+ */
+
+static inline int lzav_dedup_write( lzav_dedup_writer* const w,
+	const void* const data, size_t len )
+{
+	if( w -> err != 0 )
+	{
+		return( w -> err );
+	}
+
+	if( !w -> ins )
+	{
+		return( LZAV_E_PARAMS );
+	}
+
+	const uint64_t* const gear = w -> gear;
+	const uint8_t* ip = (const uint8_t*) data;
+
+	w -> e[ w -> n - 1 ].len += len;
+	w -> ulen += len;
+
+	while( len != 0 )
+	{
+		// Hashing starts 64 bytes before the minimal chunk length, as only
+		// these bytes affect the hash value's upper bits at that length.
+
+		const size_t cl = w -> cl;
+		const size_t sl = ( len < LZAV_DEDUP_MAX - cl ? len :
+			LZAV_DEDUP_MAX - cl );
+
+		size_t i = ( cl < LZAV_DEDUP_MIN - 64 ?
+			LZAV_DEDUP_MIN - 64 - cl : 0 );
+
+		uint64_t h = w -> h;
+		size_t tl = sl; // Bytes taken into the current chunk.
+		int cut = ( cl + sl == LZAV_DEDUP_MAX );
+
+		while( i < sl )
+		{
+			h = ( h << 1 ) + gear[ ip[ i ]];
+			i++;
+
+			if(( h >> ( 64 - LZAV_DEDUP_AVG_LOG )) == 0 &&
+				cl + i >= LZAV_DEDUP_MIN )
+			{
+				tl = i;
+				cut = 1;
+				break;
+			}
+		}
+
+		w -> h = h;
+
+		if( cut && cl == 0 )
+		{
+			lzav_dedup_put( w, ip, tl );
+		}
+		else
+		{
+			memcpy( w -> cbuf + cl, ip, tl );
+			w -> cl = cl + tl;
+
+			if( cut )
+			{
+				lzav_dedup_put( w, w -> cbuf, w -> cl );
+			}
+		}
+
+		if( cut )
+		{
+			w -> e[ w -> n - 1 ].nch++;
+			w -> cl = 0;
+			w -> h = 0;
+
+			if( w -> err != 0 )
+			{
+				return( w -> err );
+			}
+		}
+
+		ip += tl;
+		len -= tl;
+	}
+
+	return( 0 );
+}
+
+/**
+ * @brief Function finishes the current stream.
+ *
+ * @param w Container writer.
+ * @return 0 on success, or a negative `LZAV_E_` error code. Errors are
+ * sticky.
+ */
+
+static inline int lzav_dedup_end( lzav_dedup_writer* const w )
+{
+	if( w -> err != 0 )
+	{
+		return( w -> err );
+	}
+
+	if( !w -> ins )
+	{
+		return( LZAV_E_PARAMS );
+	}
+
+	if( w -> cl != 0 )
+	{
+		lzav_dedup_put( w, w -> cbuf, w -> cl );
+		w -> e[ w -> n - 1 ].nch++;
+		w -> cl = 0;
+	}
+
+	w -> ins = 0;
+
+	return( w -> err );
+}
+
+/**
+ * @brief Function adds a stream residing in memory to the container. See
+ * lzav_dedup_begin().
+ *
+ * @param w Container writer.
+ * @param name Stream's name.
+ * @param namel Name's length, in bytes.
+ * @param data Stream's data.
+ * @param len Data length, in bytes.
+ * @return 0 on success, or a negative `LZAV_E_` error code.
+ */
+
+static inline int lzav_dedup_add( lzav_dedup_writer* const w,
+	const char* const name, const size_t namel, const void* const data,
+	const size_t len )
+{
+	int r = lzav_dedup_begin( w, name, namel );
+
+	if( r == 0 )
+	{
+		r = lzav_dedup_write( w, data, len );
+	}
+
+	if( r == 0 )
+	{
+		r = lzav_dedup_end( w );
+	}
+
+	return( r );
+}
+
+static inline int lzav_dedup_wentry_cmp( const void* const p1,
+	const void* const p2 )
+{
+	const lzav_dedup_wentry* const e1 = (const lzav_dedup_wentry*) p1;
+	const lzav_dedup_wentry* const e2 = (const lzav_dedup_wentry*) p2;
+
+	if( e1 -> h != e2 -> h )
+	{
+		return( e1 -> h < e2 -> h ? -1 : 1 );
+	}
+
+	const size_t l = ( e1 -> namel < e2 -> namel ? e1 -> namel :
+		e2 -> namel );
+
+	const int r = memcmp( e1 -> name, e2 -> name, l );
+
+	if( r != 0 )
+	{
+		return( r );
+	}
+
+	return(( e1 -> namel > e2 -> namel ) - ( e1 -> namel < e2 -> namel ));
+}
+
+/**
+ * @brief Function writes the last pack, container's tables, finishes the
+ * container, and releases the writer. On error, the container file is
+ * removed.
+ *
+ * @param w Container writer.
+ * @return 0 on success, `LZAV_E_PARAMS` if stream names are not unique, or
+ * a stream was not ended, or another negative `LZAV_E_` error code.
+ */
+
+static inline int lzav_dedup_writer_close( lzav_dedup_writer* const w )
+{
+	uint8_t ix[ LZAV_DEDUP_IDX_LEN ];
+	size_t i;
+
+	if( w -> err == 0 && w -> ins )
+	{
+		w -> err = LZAV_E_PARAMS;
+	}
+
+	lzav_dedup_flush_pack( w );
+
+	if( w -> err == 0 && w -> n != 0 )
+	{
+		qsort( w -> e, w -> n, sizeof( lzav_dedup_wentry ),
+			lzav_dedup_wentry_cmp );
+
+		for( i = 1; i < w -> n; i++ )
+		{
+			if( lzav_dedup_wentry_cmp( w -> e + i - 1, w -> e + i ) == 0 )
+			{
+				w -> err = LZAV_E_PARAMS;
+				break;
+			}
+		}
+	}
+
+	const uint64_t co = w -> pos;
+	const uint64_t io = co + (uint64_t) w -> nc * LZAV_DEDUP_CHUNK_LEN +
+		(uint64_t) w -> nl * 4;
+
+	for( i = 0; i < w -> nc && w -> err == 0; i++ )
+	{
+		const lzav_dedup_wchunk* const c = w -> ch + i;
+
+		lzav_arc_st64( ix, c -> po );
+		lzav_frame_st32( ix + 8, c -> co );
+		lzav_frame_st32( ix + 12, c -> len );
+		lzav_arc_st64( ix + 16, c -> fp[ 0 ]);
+		lzav_arc_st64( ix + 24, c -> fp[ 1 ]);
+
+		if( fwrite( ix, 1, LZAV_DEDUP_CHUNK_LEN, w -> f ) !=
+			LZAV_DEDUP_CHUNK_LEN )
+		{
+			w -> err = LZAV_E_FILE;
+		}
+	}
+
+	for( i = 0; i < w -> nl && w -> err == 0; i++ )
+	{
+		lzav_frame_st32( ix, w -> list[ i ]);
+
+		if( fwrite( ix, 1, 4, w -> f ) != 4 )
+		{
+			w -> err = LZAV_E_FILE;
+		}
+	}
+
+	uint64_t nl = 0;
+
+	for( i = 0; i < w -> n && w -> err == 0; i++ )
+	{
+		const lzav_dedup_wentry* const e = w -> e + i;
+
+		if( nl + e -> namel > 0xFFFFFFFF || w -> n > 0xFFFFFFFF ||
+			e -> nch > 0xFFFFFFFF )
+		{
+			w -> err = LZAV_E_PARAMS;
+			break;
+		}
+
+		lzav_arc_st64( ix, e -> len );
+		lzav_arc_st64( ix + 8, e -> lo );
+		lzav_frame_st32( ix + 16, (uint32_t) e -> nch );
+		lzav_frame_st32( ix + 20, e -> h );
+		lzav_frame_st32( ix + 24, (uint32_t) nl );
+		lzav_frame_st32( ix + 28, (uint32_t) e -> namel );
+		nl += e -> namel;
+
+		if( fwrite( ix, 1, LZAV_DEDUP_IDX_LEN, w -> f ) !=
+			LZAV_DEDUP_IDX_LEN )
+		{
+			w -> err = LZAV_E_FILE;
+		}
+	}
+
+	for( i = 0; i < w -> n && w -> err == 0; i++ )
+	{
+		const lzav_dedup_wentry* const e = w -> e + i;
+
+		if( fwrite( e -> name, 1, e -> namel, w -> f ) != e -> namel )
+		{
+			w -> err = LZAV_E_FILE;
+		}
+	}
+
+	if( w -> err == 0 )
+	{
+		uint8_t hdr[ LZAV_DEDUP_HDR_LEN ];
+		memset( hdr, 0, sizeof( hdr ));
+
+		lzav_frame_st32( hdr, LZAV_DEDUP_MAGIC );
+		hdr[ 4 ] = LZAV_DEDUP_VER;
+		lzav_frame_st32( hdr + 8, (uint32_t) w -> nc );
+		lzav_frame_st32( hdr + 12, (uint32_t) w -> n );
+		lzav_arc_st64( hdr + 16, co );
+		lzav_arc_st64( hdr + 24, io );
+
+		if( fseek( w -> f, 0, SEEK_SET ) != 0 ||
+			fwrite( hdr, 1, sizeof( hdr ), w -> f ) != sizeof( hdr ))
+		{
+			w -> err = LZAV_E_FILE;
+		}
+	}
+
+	if( w -> f != 0 )
+	{
+		if( fclose( w -> f ) != 0 && w -> err == 0 )
+		{
+			w -> err = LZAV_E_FILE;
+		}
+
+		if( w -> err != 0 )
+		{
+			remove( w -> fn );
+		}
+	}
+
+	for( i = 0; i < w -> n; i++ )
+	{
+		lzav_free( &w -> al, w -> e[ i ].name, w -> e[ i ].namel + 1 );
+	}
+
+	const int r = w -> err;
+
+	lzav_free( &w -> al, w -> buf, w -> bufc );
+	lzav_free( &w -> al, w -> e, w -> c );
+	lzav_free( &w -> al, w -> list, w -> listc );
+	lzav_free( &w -> al, w -> ch, w -> chc );
+	lzav_free( &w -> al, w -> ht, w -> htn * sizeof( uint32_t ));
+	lzav_free( &w -> al, w -> pack, (size_t) 1 << LZAV_DEDUP_PACK_LOG );
+	lzav_free( &w -> al, w -> cbuf, LZAV_DEDUP_MAX );
+
+	if( w -> fn != 0 )
+	{
+		lzav_free( &w -> al, w -> fn, strlen( w -> fn ) + 1 );
+	}
+
+	memset( w, 0, sizeof( lzav_dedup_writer ));
+
+	return( r );
+}
+
+#endif // LZAV_DEDUP_INCLUDED
@@ -0,0 +1,1813 @@
+/**
+ * @file lzav_file.h
+ *
+ * @version 4.5
+ *
+ * @brief The inclusion file for the "LZAV" file compression and
+ * decompression helper functions.
+ *
+ * Functions in this file compress files into, and decompress files from, the
+ * framed format (see lzav_frame.h). On POSIX systems, the source file is
+ * memory-mapped and is compressed (or decompressed) directly into a
+ * memory-mapped destination file, preallocated to the maximal required
+ * length, with sequential access hints. This avoids copying data through
+ * intermediate heap buffers. If memory-mapping is unavailable (e.g., on
+ * non-POSIX systems, or if the source is not a regular file), buffered
+ * segment-wise streaming is used.
+ *
+ * Multi-threaded stream functions run a pipeline: a reader thread, several
+ * segment compression (decompression) threads, and a writer (the calling
+ * thread) work concurrently on a bounded set of in-flight segments, so that
+ * reading, compression and writing overlap. On NUMA systems (Linux and
+ * Windows), workers are bound to nodes, and process segments read into
+ * node-local memory. On POSIX systems, linking with the pthread library may
+ * be required.
+ *
+ * On POSIX systems, POSIX.1-2001 function declarations should be available:
+ * this is usually the default, but strict ISO C modes (e.g., `-std=c99`)
+ * require `_POSIX_C_SOURCE` to be defined as `200112L` or higher before any
+ * header file is included.
+ *
+ * Description is available at https://github.com/avaneev/lzav
+ *
+ * E-mail: aleksey.vaneev@gmail.com or info@voxengo.com
+ *
+ * LICENSE:
+ *
+ * Copyright (c) 2023-2024 Aleksey Vaneev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef LZAV_FILE_INCLUDED
+#define LZAV_FILE_INCLUDED
+
+#include "lzav_frame.h"
+#include <stdio.h>
+
+/**
+ * @def LZAV_FILE_MMAP
+ * @brief Macro that enables the use of memory-mapped file I/O. Can be
+ * defined as 0 via compile options, to use buffered I/O only.
+ */
+
+#if !defined( LZAV_FILE_MMAP )
+	#if defined( __unix__ ) || defined( __unix ) || defined( __APPLE__ )
+		#define LZAV_FILE_MMAP 1
+	#else // defined( __unix__ )
+		#define LZAV_FILE_MMAP 0
+	#endif // defined( __unix__ )
+#endif // !defined( LZAV_FILE_MMAP )
+
+#if defined( _WIN32 )
+	#include <windows.h>
+#else // defined( _WIN32 )
+	#include <pthread.h>
+#endif // defined( _WIN32 )
+
+#if LZAV_FILE_MMAP
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif // LZAV_FILE_MMAP
+
+/**
+ * @def LZAV_THREAD_FUNC( name, arg )
+ * @brief Thread function declaration macro, for use with the
+ * lzav_thread_start() function.
+ * @param name Function's name.
+ * @param arg Function's `void*` argument name.
+ */
+
+/**
+ * @def LZAV_THREAD_RETURN
+ * @brief Thread function's return statement.
+ */
+
+#if defined( _WIN32 )
+
+	typedef HANDLE lzav_thread_t;
+	typedef CRITICAL_SECTION lzav_mutex_t;
+	typedef CONDITION_VARIABLE lzav_cond_t;
+	typedef LPTHREAD_START_ROUTINE lzav_thread_func_t;
+
+	#define LZAV_THREAD_FUNC( name, arg ) DWORD WINAPI name( LPVOID arg )
+	#define LZAV_THREAD_RETURN return( 0 )
+
+static inline int lzav_thread_start( lzav_thread_t* const t,
+	const lzav_thread_func_t func, void* const arg )
+{
+	*t = CreateThread( 0, 0, func, arg, 0, 0 );
+
+	return( *t != 0 );
+}
+
+static inline void lzav_thread_join( const lzav_thread_t t )
+{
+	WaitForSingleObject( t, INFINITE );
+	CloseHandle( t );
+}
+
+static inline void lzav_mutex_init( lzav_mutex_t* const m )
+{
+	InitializeCriticalSection( m );
+}
+
+static inline void lzav_mutex_destroy( lzav_mutex_t* const m )
+{
+	DeleteCriticalSection( m );
+}
+
+static inline void lzav_mutex_lock( lzav_mutex_t* const m )
+{
+	EnterCriticalSection( m );
+}
+
+static inline void lzav_mutex_unlock( lzav_mutex_t* const m )
+{
+	LeaveCriticalSection( m );
+}
+
+static inline void lzav_cond_init( lzav_cond_t* const c )
+{
+	InitializeConditionVariable( c );
+}
+
+static inline void lzav_cond_destroy( lzav_cond_t* const c )
+{
+	(void) c;
+}
+
+static inline void lzav_cond_wait( lzav_cond_t* const c,
+	lzav_mutex_t* const m )
+{
+	SleepConditionVariableCS( c, m, INFINITE );
+}
+
+static inline void lzav_cond_broadcast( lzav_cond_t* const c )
+{
+	WakeAllConditionVariable( c );
+}
+
+#else // defined( _WIN32 )
+
+	typedef pthread_t lzav_thread_t;
+	typedef pthread_mutex_t lzav_mutex_t;
+	typedef pthread_cond_t lzav_cond_t;
+	typedef void* ( *lzav_thread_func_t )( void* );
+
+	#define LZAV_THREAD_FUNC( name, arg ) void* name( void* arg )
+	#define LZAV_THREAD_RETURN return( 0 )
+
+static inline int lzav_thread_start( lzav_thread_t* const t,
+	const lzav_thread_func_t func, void* const arg )
+{
+	return( pthread_create( t, 0, func, arg ) == 0 );
+}
+
+static inline void lzav_thread_join( const lzav_thread_t t )
+{
+	pthread_join( t, 0 );
+}
+
+static inline void lzav_mutex_init( lzav_mutex_t* const m )
+{
+	pthread_mutex_init( m, 0 );
+}
+
+static inline void lzav_mutex_destroy( lzav_mutex_t* const m )
+{
+	pthread_mutex_destroy( m );
+}
+
+static inline void lzav_mutex_lock( lzav_mutex_t* const m )
+{
+	pthread_mutex_lock( m );
+}
+
+static inline void lzav_mutex_unlock( lzav_mutex_t* const m )
+{
+	pthread_mutex_unlock( m );
+}
+
+static inline void lzav_cond_init( lzav_cond_t* const c )
+{
+	pthread_cond_init( c, 0 );
+}
+
+static inline void lzav_cond_destroy( lzav_cond_t* const c )
+{
+	pthread_cond_destroy( c );
+}
+
+static inline void lzav_cond_wait( lzav_cond_t* const c,
+	lzav_mutex_t* const m )
+{
+	pthread_cond_wait( c, m );
+}
+
+static inline void lzav_cond_broadcast( lzav_cond_t* const c )
+{
+	pthread_cond_broadcast( c );
+}
+
+#endif // defined( _WIN32 )
+
+/**
+ * @def LZAV_FILE_NUMA
+ * @brief Macro that enables NUMA-aware scheduling of multi-threaded pipeline
+ * workers. Can be defined as 0 via compile options, to disable it. On Linux,
+ * requires `_GNU_SOURCE` to be defined before any header file is included.
+ */
+
+#if defined( __linux__ )
+	#include <sched.h>
+#endif // defined( __linux__ )
+
+#if !defined( LZAV_FILE_NUMA )
+	#if defined( _WIN32 ) || ( defined( __linux__ ) && defined( CPU_SET ))
+		#define LZAV_FILE_NUMA 1
+	#else // defined( _WIN32 )
+		#define LZAV_FILE_NUMA 0
+	#endif // defined( _WIN32 )
+#endif // !defined( LZAV_FILE_NUMA )
+
+#define LZAV_NUMA_MAX 16 ///< The maximal number of NUMA nodes in use.
+
+#if LZAV_FILE_NUMA && defined( _WIN32 )
+	typedef ULONGLONG lzav_cpuset;
+#elif LZAV_FILE_NUMA
+	typedef cpu_set_t lzav_cpuset;
+#else // LZAV_FILE_NUMA
+	typedef int lzav_cpuset;
+#endif // LZAV_FILE_NUMA
+
+/**
+ * @brief NUMA topology, limited to processors available to the process.
+ */
+
+typedef struct
+{
+	int n; ///< The number of nodes, 0 if there is only one node.
+	lzav_cpuset all; ///< Processors available to the process.
+	lzav_cpuset cpus[ LZAV_NUMA_MAX ]; ///< Available processors of nodes.
+} lzav_numa;
+
+/**
+ * @brief Function detects NUMA topology.
+ *
+ * @param[out] nm Receiver of topology.
+ */
+
+static inline void lzav_numa_init( lzav_numa* const nm )
+{
+	nm -> n = 0;
+
+#if LZAV_FILE_NUMA && defined( _WIN32 )
+
+	DWORD_PTR pm, sm;
+	ULONG hn;
+	ULONG i;
+
+	if( !GetProcessAffinityMask( GetCurrentProcess(), &pm, &sm ) ||
+		!GetNumaHighestNodeNumber( &hn ))
+	{
+		return;
+	}
+
+	nm -> all = (ULONGLONG) pm;
+
+	for( i = 0; i <= hn && nm -> n < LZAV_NUMA_MAX; i++ )
+	{
+		ULONGLONG m;
+
+		if( GetNumaNodeProcessorMask( (UCHAR) i, &m ) &&
+			( m & nm -> all ) != 0 )
+		{
+			nm -> cpus[ nm -> n ] = m & nm -> all;
+			nm -> n++;
+		}
+	}
+
+#elif LZAV_FILE_NUMA
+
+	int i;
+
+	if( sched_getaffinity( 0, sizeof( cpu_set_t ), &nm -> all ) != 0 )
+	{
+		return;
+	}
+
+	// Node numbers can be sparse.
+
+	for( i = 0; i < 64 && nm -> n < LZAV_NUMA_MAX; i++ )
+	{
+		char fn[ 64 ];
+		sprintf( fn, "/sys/devices/system/node/node%d/cpulist", i );
+
+		FILE* const f = fopen( fn, "r" );
+
+		if( f == 0 )
+		{
+			continue;
+		}
+
+		cpu_set_t* const cs = nm -> cpus + nm -> n;
+		int a, b, c;
+
+		CPU_ZERO( cs );
+
+		// Processor list format: "0-3,8,10-11".
+
+		while( fscanf( f, "%d", &a ) == 1 && a >= 0 )
+		{
+			b = a;
+			c = fgetc( f );
+
+			if( c == '-' )
+			{
+				if( fscanf( f, "%d", &b ) != 1 )
+				{
+					break;
+				}
+
+				c = fgetc( f );
+			}
+
+			while( a <= b && a < CPU_SETSIZE )
+			{
+				if( CPU_ISSET( a, &nm -> all ))
+				{
+					CPU_SET( a, cs );
+				}
+
+				a++;
+			}
+
+			if( c != ',' )
+			{
+				break;
+			}
+		}
+
+		fclose( f );
+
+		if( CPU_COUNT( cs ) > 0 )
+		{
+			nm -> n++;
+		}
+	}
+
+#endif // LZAV_FILE_NUMA
+
+	if( nm -> n < 2 )
+	{
+		nm -> n = 0;
+	}
+}
+
+/**
+ * @brief Function binds the calling thread to processors of a NUMA node,
+ * or to all available processors.
+ *
+ * @param nm NUMA topology.
+ * @param node Node's index, -1 - all available processors.
+ */
+
+static inline void lzav_numa_bind( const lzav_numa* const nm,
+	const int node )
+{
+#if LZAV_FILE_NUMA && defined( _WIN32 )
+	SetThreadAffinityMask( GetCurrentThread(),
+		(DWORD_PTR) ( node < 0 ? nm -> all : nm -> cpus[ node ]));
+#elif LZAV_FILE_NUMA
+	sched_setaffinity( 0, sizeof( cpu_set_t ),
+		( node < 0 ? &nm -> all : nm -> cpus + node ));
+#else // LZAV_FILE_NUMA
+	(void) nm;
+	(void) node;
+#endif // LZAV_FILE_NUMA
+}
+
+/**
+ * @def LZAV_HUGE_PAGE
+ * @brief Huge memory page length, in bytes, used by the lzav_huge_alloc()
+ * allocator.
+ */
+
+#define LZAV_HUGE_PAGE ( (size_t) 1 << 21 )
+
+#if LZAV_FILE_MMAP && defined( MAP_ANONYMOUS )
+	#define LZAV_HUGE_MMAP 1
+#else // LZAV_FILE_MMAP && defined( MAP_ANONYMOUS )
+	#define LZAV_HUGE_MMAP 0
+#endif // LZAV_FILE_MMAP && defined( MAP_ANONYMOUS )
+
+/**
+ * @brief Function returns a huge-page allocator's mapping length.
+ *
+ * @param size Block's length, in bytes.
+ */
+
+static inline size_t lzav_huge_len( const size_t size )
+{
+	return(( size + LZAV_HUGE_PAGE - 1 ) & ~( LZAV_HUGE_PAGE - 1 ));
+}
+
+/**
+ * @brief Huge-page allocator's allocation function, see lzav_huge_alloc().
+ *
+ * @param opaque Unused.
+ * @param size Block's length, in bytes.
+ * @return Block's pointer, or 0 if not enough memory.
+ */
+
+static inline void* lzav_huge_malloc( void* const opaque, const size_t size )
+{
+	(void) opaque;
+
+	if( size < LZAV_HUGE_PAGE || size > (size_t) -1 - LZAV_HUGE_PAGE * 2 )
+	{
+		return( malloc( size ));
+	}
+
+	const size_t l = lzav_huge_len( size );
+
+#if defined( _WIN32 )
+
+	// Large pages require the "Lock pages in memory" privilege.
+
+	const SIZE_T lpl = GetLargePageMinimum();
+	void* p = 0;
+
+	if( lpl != 0 && l % lpl == 0 )
+	{
+		p = VirtualAlloc( 0, l, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES,
+			PAGE_READWRITE );
+	}
+
+	if( p == 0 )
+	{
+		p = VirtualAlloc( 0, l, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE );
+	}
+
+	return( p );
+
+#elif LZAV_HUGE_MMAP
+
+#if defined( MAP_HUGETLB )
+
+	// Explicit huge pages, available only if reserved by the administrator.
+
+#if defined( MAP_HUGE_2MB )
+	const int hf = MAP_HUGETLB | MAP_HUGE_2MB;
+#else // defined( MAP_HUGE_2MB )
+	const int hf = MAP_HUGETLB;
+#endif // defined( MAP_HUGE_2MB )
+
+	void* const hp = mmap( 0, l, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | hf, -1, 0 );
+
+	if( hp != MAP_FAILED )
+	{
+		return( hp );
+	}
+
+#endif // defined( MAP_HUGETLB )
+
+	// Transparent huge pages: the mapping is aligned to a huge page boundary
+	// by trimming an over-sized mapping.
+
+	uint8_t* const p = (uint8_t*) mmap( 0, l + LZAV_HUGE_PAGE,
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+
+	if( p == (uint8_t*) MAP_FAILED )
+	{
+		return( 0 );
+	}
+
+	const size_t h = ( LZAV_HUGE_PAGE -
+		( (size_t) (uintptr_t) p & ( LZAV_HUGE_PAGE - 1 ))) &
+		( LZAV_HUGE_PAGE - 1 );
+
+	if( h != 0 )
+	{
+		munmap( p, h );
+	}
+
+	munmap( p + h + l, LZAV_HUGE_PAGE - h );
+
+#if defined( MADV_HUGEPAGE )
+	madvise( p + h, l, MADV_HUGEPAGE );
+#endif // defined( MADV_HUGEPAGE )
+
+	return( p + h );
+
+#else // LZAV_HUGE_MMAP
+
+	(void) l;
+
+	return( malloc( size ));
+
+#endif // LZAV_HUGE_MMAP
+}
+
+/**
+ * @brief Huge-page allocator's release function, see lzav_huge_alloc().
+ *
+ * @param opaque Unused.
+ * @param p Block's pointer.
+ * @param size Block's length, as specified on allocation.
+ */
+
+static inline void lzav_huge_free( void* const opaque, void* const p,
+	const size_t size )
+{
+	(void) opaque;
+
+	if( size < LZAV_HUGE_PAGE || size > (size_t) -1 - LZAV_HUGE_PAGE * 2 )
+	{
+		free( p );
+		return;
+	}
+
+#if defined( _WIN32 )
+	VirtualFree( p, 0, MEM_RELEASE );
+#elif LZAV_HUGE_MMAP
+	munmap( p, lzav_huge_len( size ));
+#else // LZAV_HUGE_MMAP
+	free( p );
+#endif // LZAV_HUGE_MMAP
+}
+
+/**
+ * @brief Function returns the huge-page allocator.
+ *
+ * The allocator places blocks of `LZAV_HUGE_PAGE` length and longer (e.g.,
+ * hash-tables of lzav_compress_hi(), which are up to 8 MiB long and are
+ * accessed at random) in huge memory pages, reducing TLB misses. On Linux,
+ * explicitly reserved huge pages are used if available, otherwise
+ * transparent huge pages are requested via madvise(). On Windows, large
+ * pages are used if the process holds the required privilege. Otherwise,
+ * normal pages are used. Shorter blocks are allocated via malloc().
+ *
+ * The allocator can be installed via lzav_set_alloc(), or passed to
+ * functions with the `_al` suffix.
+ */
+
+static inline lzav_alloc lzav_huge_alloc( void )
+{
+	lzav_alloc al;
+	al.alloc = lzav_huge_malloc;
+	al.free = lzav_huge_free;
+	al.opaque = 0;
+
+	return( al );
+}
+
+/**
+ * @brief Buffered framed compression function.
+ *
+ * Function compresses a stream into a frame, segment-wise, using heap
+ * buffers.
+ *
+ * @param in Input stream, opened in binary mode.
+ * @param out Output stream, opened in binary mode.
+ * @param fi Frame information; `fi -> len` should be `LZAV_FRAME_LEN_UNK` if
+ * the input length is not known in advance.
+ * @param[out] pdl Receiver of the output length, can be 0.
+ * @return 0 on success, or a negative `LZAV_E_` error code.
+ */
+
+static inline int lzav_compress_stream( FILE* const in, FILE* const out,
+	const lzav_frame_info* const fi, uint64_t* const pdl )
+{
+	const int sm = 1 << fi -> seg_log;
+	const size_t obufl = (size_t) lzav_frame_seg_bound( sm );
+	uint8_t* const ibuf = (uint8_t*) lzav_malloc( 0, (size_t) sm );
+	uint8_t* const obuf = (uint8_t*) lzav_malloc( 0, obufl );
+	uint64_t sl = 0; // Input length.
+	uint64_t dl = 0; // Output length.
+	int ret = LZAV_E_NOMEM;
+
+	if( ibuf == 0 || obuf == 0 )
+	{
+		goto _end;
+	}
+
+	ret = LZAV_E_FILE;
+	dl = lzav_frame_write_hdr( obuf, fi );
+
+	if( fwrite( obuf, 1, LZAV_FRAME_HDR_LEN, out ) != LZAV_FRAME_HDR_LEN )
+	{
+		goto _end;
+	}
+
+	while( 1 )
+	{
+		const int l = (int) fread( ibuf, 1, sm, in );
+
+		if( l == 0 )
+		{
+			break;
+		}
+
+		const int cl = lzav_frame_compress_seg( ibuf, l, obuf,
+			lzav_frame_seg_bound( l ), fi );
+
+		if( cl == 0 )
+		{
+			ret = LZAV_E_NOMEM;
+			goto _end;
+		}
+
+		if( fwrite( obuf, 1, cl, out ) != (size_t) cl )
+		{
+			goto _end;
+		}
+
+		sl += (uint64_t) l;
+		dl += (uint64_t) cl;
+	}
+
+	if( ferror( in ) ||
+		( fi -> len != LZAV_FRAME_LEN_UNK && fi -> len != sl ))
+	{
+		goto _end;
+	}
+
+	lzav_frame_st32( obuf, 0 );
+
+	if( fwrite( obuf, 1, LZAV_FRAME_END_LEN, out ) != LZAV_FRAME_END_LEN ||
+		fflush( out ) != 0 )
+	{
+		goto _end;
+	}
+
+	dl += LZAV_FRAME_END_LEN;
+	ret = 0;
+
+_end:
+	lzav_free( 0, obuf, obufl );
+	lzav_free( 0, ibuf, (size_t) sm );
+
+	if( pdl != 0 )
+	{
+		*pdl = dl;
+	}
+
+	return( ret );
+}
+
+/**
+ * @brief Function ensures buffer's capacity, without preserving contents.
+ *
+ * @param al Allocator, 0 - the global allocator.
+ * @param[in,out] pbuf Pointer to the buffer pointer.
+ * @param[in,out] pc Pointer to the buffer's capacity.
+ * @param l Required capacity.
+ * @return 1 on success, 0 if not enough memory.
+ */
+
+static inline int lzav_file_reserve( const lzav_alloc* const al,
+	uint8_t** const pbuf, size_t* const pc, const size_t l )
+{
+	if( *pc < l )
+	{
+		lzav_free( al, *pbuf, *pc );
+		*pbuf = (uint8_t*) lzav_malloc( al, l );
+		*pc = ( *pbuf == 0 ? 0 : l );
+	}
+
+	return( *pbuf != 0 );
+}
+
+/**
+ * @brief Framed stream reader's state.
+ */
+
+typedef struct
+{
+	lzav_frame_info fi; ///< Current frame's information.
+	uint64_t fl; ///< Current frame's content length read so far.
+	uint64_t rl; ///< The number of bytes read.
+	int inf; ///< 1, if inside a frame.
+	int nf; ///< The number of frames read.
+} lzav_frame_reader;
+
+/**
+ * @brief Function reads the next segment of framed data from a stream.
+ *
+ * Function handles frame headers of concatenated frames, and validates frame
+ * content lengths.
+ *
+ * @param in Input stream.
+ * @param rd Reader's state, should be zero-initialized before the first
+ * call.
+ * @param[out] seg Receiver of segment's header information.
+ * @param[in,out] pbuf Pointer to the segment's payload buffer pointer, the
+ * buffer is reallocated if its capacity is insufficient.
+ * @param[in,out] pc Pointer to the payload buffer's capacity.
+ * @return 1 if a segment was read, 0 on the end of the stream, or a negative
+ * `LZAV_E_` error code.
+ */
+
+static inline int lzav_frame_read_next( FILE* const in,
+	lzav_frame_reader* const rd, lzav_frame_seg* const seg,
+	uint8_t** const pbuf, size_t* const pc )
+{
+	uint8_t hdr[ LZAV_FRAME_HDR_LEN ];
+	int r;
+
+	while( 1 )
+	{
+		if( !rd -> inf )
+		{
+			const size_t hl = fread( hdr, 1, LZAV_FRAME_HDR_LEN, in );
+
+			if( hl == 0 && rd -> nf != 0 && !ferror( in ))
+			{
+				return( 0 );
+			}
+
+			if( hl != LZAV_FRAME_HDR_LEN )
+			{
+				return( ferror( in ) ? LZAV_E_FILE :
+					( rd -> nf == 0 ? LZAV_E_UNKFMT : LZAV_E_SRCOOB ));
+			}
+
+			r = lzav_frame_read_hdr( hdr, &rd -> fi );
+
+			if( r < 0 )
+			{
+				return( r );
+			}
+
+			rd -> rl += LZAV_FRAME_HDR_LEN;
+			rd -> fl = 0;
+			rd -> inf = 1;
+			rd -> nf++;
+		}
+
+		const size_t shl = (size_t) lzav_frame_seg_hdr_len( rd -> fi.flags );
+
+		if( fread( hdr, 1, LZAV_FRAME_END_LEN, in ) != LZAV_FRAME_END_LEN ||
+			( lzav_frame_ld32( hdr ) != 0 &&
+			fread( hdr + LZAV_FRAME_END_LEN, 1, shl - LZAV_FRAME_END_LEN,
+			in ) != shl - LZAV_FRAME_END_LEN ))
+		{
+			return( ferror( in ) ? LZAV_E_FILE : LZAV_E_SRCOOB );
+		}
+
+		r = lzav_frame_read_seg( hdr, &rd -> fi, seg );
+
+		if( r < 0 )
+		{
+			return( r );
+		}
+
+		rd -> rl += (uint64_t) r;
+
+		if( seg -> cl != 0 )
+		{
+			break;
+		}
+
+		if( rd -> fi.len != LZAV_FRAME_LEN_UNK && rd -> fi.len != rd -> fl )
+		{
+			return( LZAV_E_DSTLEN );
+		}
+
+		rd -> inf = 0;
+	}
+
+	if( !lzav_file_reserve( 0, pbuf, pc, seg -> cl ))
+	{
+		return( LZAV_E_NOMEM );
+	}
+
+	if( fread( *pbuf, 1, seg -> cl, in ) != (size_t) seg -> cl )
+	{
+		return( ferror( in ) ? LZAV_E_FILE : LZAV_E_SRCOOB );
+	}
+
+	rd -> fl += (uint64_t) seg -> srcl;
+	rd -> rl += (uint64_t) seg -> cl;
+
+	return( 1 );
+}
+
+/**
+ * @brief Buffered framed decompression function.
+ *
+ * Function decompresses one or several concatenated frames from a stream,
+ * segment-wise, using heap buffers.
+ *
+ * @param in Input stream, opened in binary mode.
+ * @param out Output stream, opened in binary mode; 0 - verify the integrity
+ * of the data only.
+ * @param[out] pdl Receiver of the output length, can be 0.
+ * @return 0 on success, or a negative `LZAV_E_` error code.
+ */
+
+static inline int lzav_decompress_stream( FILE* const in, FILE* const out,
+	uint64_t* const pdl )
+{
+	lzav_frame_reader rd;
+	lzav_frame_seg seg;
+	uint8_t* ibuf = 0;
+	uint8_t* obuf = 0;
+	size_t ibufc = 0;
+	size_t obufc = 0;
+	uint64_t dl = 0;
+	int ret;
+
+	memset( &rd, 0, sizeof( rd ));
+
+	while( 1 )
+	{
+		ret = lzav_frame_read_next( in, &rd, &seg, &ibuf, &ibufc );
+
+		if( ret <= 0 )
+		{
+			break;
+		}
+
+		if( !lzav_file_reserve( 0, &obuf, &obufc, seg.srcl ))
+		{
+			ret = LZAV_E_NOMEM;
+			break;
+		}
+
+		ret = lzav_frame_decompress_seg( &seg, ibuf, obuf, &rd.fi );
+
+		if( ret < 0 )
+		{
+			break;
+		}
+
+		if( out != 0 && fwrite( obuf, 1, ret, out ) != (size_t) ret )
+		{
+			ret = LZAV_E_FILE;
+			break;
+		}
+
+		dl += (uint64_t) ret;
+	}
+
+	if( ret == 0 && out != 0 && fflush( out ) != 0 )
+	{
+		ret = LZAV_E_FILE;
+	}
+
+	lzav_free( 0, obuf, obufc );
+	lzav_free( 0, ibuf, ibufc );
+
+	if( pdl != 0 )
+	{
+		*pdl = dl;
+	}
+
+	return( ret );
+}
+
+/**
+ * @brief Pipeline's segment slot.
+ */
+
+typedef struct
+{
+	uint8_t* ibuf; ///< Input buffer.
+	size_t ibufc; ///< Input buffer's capacity.
+	uint8_t* obuf; ///< Output buffer.
+	size_t obufc; ///< Output buffer's capacity.
+	int il; ///< Input length.
+	int ol; ///< Output length, 0 or a negative `LZAV_E_` code on error.
+	lzav_frame_info fi; ///< Frame information of the segment.
+	lzav_frame_seg seg; ///< Segment header information, for decompression.
+	int node; ///< Index of the NUMA node the slot's buffers are local to.
+	int taken; ///< 1, if the segment was taken for processing.
+	int done; ///< 1, if the segment was processed.
+} lzav_pipe_slot;
+
+/**
+ * @brief Multi-threaded compression or decompression pipeline's state.
+ *
+ * Segment slots are used in a circular manner. Slot `n % ns` holds the
+ * `n`-th segment of the stream. The reader fills slots while less than `ns`
+ * segments are in flight, workers process filled slots in stream order, and
+ * the writer outputs processed slots in stream order, and then releases
+ * them.
+ *
+ * On NUMA systems, workers are distributed between nodes, and bound to them.
+ * Each slot is assigned a node: the reader binds itself to the slot's node
+ * while filling it, so that input pages are placed on that node, and workers
+ * take slots of their own node, so that hash-tables and output buffers are
+ * local to the input pages. A slot of another node is taken only if the
+ * writer waits for it.
+ */
+
+typedef struct
+{
+	FILE* in; ///< Input stream.
+	int dec; ///< 1 - decompression, 0 - compression.
+	lzav_frame_info fi; ///< Frame information, for compression.
+	lzav_pipe_slot* slots; ///< Segment slots.
+	int ns; ///< The number of segment slots.
+	uint64_t nr; ///< The number of segments read.
+	uint64_t np; ///< The number of segments taken for processing.
+	uint64_t nw; ///< The number of segments written.
+	uint64_t il; ///< Total input length, including frame headers.
+	int eof; ///< 1, if the reader has finished.
+	int err; ///< The first error code, 0 if none.
+	lzav_numa nm; ///< NUMA topology.
+	int na; ///< The number of NUMA nodes in use, 1 if NUMA is not in use.
+	int nk; ///< The number of started workers.
+	lzav_mutex_t m; ///< State's mutex.
+	lzav_cond_t cr; ///< Reader's condition: a slot was released.
+	lzav_cond_t cp; ///< Workers' condition: a slot was filled.
+	lzav_cond_t cw; ///< Writer's condition: a slot was processed.
+} lzav_pipe;
+
+/**
+ * @brief Function sets pipeline's error code and wakes up all threads.
+ * Should be called with the pipeline's mutex locked.
+ */
+
+static inline void lzav_pipe_fail( lzav_pipe* const pp, const int err )
+{
+	if( pp -> err == 0 )
+	{
+		pp -> err = err;
+	}
+
+	lzav_cond_broadcast( &pp -> cr );
+	lzav_cond_broadcast( &pp -> cp );
+	lzav_cond_broadcast( &pp -> cw );
+}
+
+/**
+ * @brief Pipeline's reader thread function.
+ */
+
+static inline LZAV_THREAD_FUNC( lzav_pipe_reader, arg )
+{
+	lzav_pipe* const pp = (lzav_pipe*) arg;
+	lzav_frame_reader rd;
+	const int sm = 1 << pp -> fi.seg_log;
+	int r = 0;
+
+	memset( &rd, 0, sizeof( rd ));
+
+	while( 1 )
+	{
+		lzav_mutex_lock( &pp -> m );
+
+		while( pp -> nr - pp -> nw == (uint64_t) pp -> ns && pp -> err == 0 )
+		{
+			lzav_cond_wait( &pp -> cr, &pp -> m );
+		}
+
+		const int err = pp -> err;
+
+		lzav_mutex_unlock( &pp -> m );
+
+		if( err != 0 )
+		{
+			break;
+		}
+
+		lzav_pipe_slot* const s = pp -> slots + pp -> nr % pp -> ns;
+
+		if( pp -> na > 1 )
+		{
+			lzav_numa_bind( &pp -> nm, s -> node );
+		}
+
+		if( pp -> dec )
+		{
+			r = lzav_frame_read_next( pp -> in, &rd, &s -> seg, &s -> ibuf,
+				&s -> ibufc );
+
+			if( r <= 0 )
+			{
+				break;
+			}
+
+			if( !lzav_file_reserve( 0, &s -> obuf, &s -> obufc,
+				s -> seg.srcl ))
+			{
+				r = LZAV_E_NOMEM;
+				break;
+			}
+
+			s -> fi = rd.fi;
+			s -> il = s -> seg.cl;
+			pp -> il = rd.rl;
+		}
+		else
+		{
+			if( !lzav_file_reserve( 0, &s -> ibuf, &s -> ibufc, sm ) ||
+				!lzav_file_reserve( 0, &s -> obuf, &s -> obufc,
+				lzav_frame_seg_bound( sm )))
+			{
+				r = LZAV_E_NOMEM;
+				break;
+			}
+
+			s -> il = (int) fread( s -> ibuf, 1, sm, pp -> in );
+
+			if( s -> il == 0 )
+			{
+				r = ( ferror( pp -> in ) ? LZAV_E_FILE : 0 );
+				break;
+			}
+
+			s -> fi = pp -> fi;
+			pp -> il += (uint64_t) s -> il;
+		}
+
+		lzav_mutex_lock( &pp -> m );
+		s -> taken = 0;
+		s -> done = 0;
+		pp -> nr++;
+		lzav_cond_broadcast( &pp -> cp );
+		lzav_mutex_unlock( &pp -> m );
+	}
+
+	if( pp -> dec )
+	{
+		pp -> il = rd.rl;
+	}
+
+	lzav_mutex_lock( &pp -> m );
+	pp -> eof = 1;
+
+	if( r < 0 )
+	{
+		lzav_pipe_fail( pp, r );
+	}
+	else
+	{
+		lzav_cond_broadcast( &pp -> cp );
+		lzav_cond_broadcast( &pp -> cw );
+	}
+
+	lzav_mutex_unlock( &pp -> m );
+
+	LZAV_THREAD_RETURN;
+}
+
+/**
+ * @brief Function takes the oldest filled slot of a NUMA node for
+ * processing, or the slot the writer waits for. Should be called with the
+ * pipeline's mutex locked.
+ *
+ * @param pp Pipeline.
+ * @param node Worker's NUMA node index.
+ * @return Slot's pointer, or 0 if no slot is available.
+ */
+
+static inline lzav_pipe_slot* lzav_pipe_take( lzav_pipe* const pp,
+	const int node )
+{
+	uint64_t k;
+
+	for( k = pp -> nw; k < pp -> nr; k++ )
+	{
+		lzav_pipe_slot* const s = pp -> slots + k % pp -> ns;
+
+		if( !s -> taken && ( s -> node == node || k == pp -> nw ))
+		{
+			s -> taken = 1;
+			pp -> np++;
+
+			return( s );
+		}
+	}
+
+	return( 0 );
+}
+
+/**
+ * @brief Pipeline's worker thread function.
+ */
+
+static inline LZAV_THREAD_FUNC( lzav_pipe_worker, arg )
+{
+	lzav_pipe* const pp = (lzav_pipe*) arg;
+
+	lzav_mutex_lock( &pp -> m );
+
+	const int node = pp -> nk++ % pp -> na;
+
+	if( pp -> na > 1 )
+	{
+		lzav_numa_bind( &pp -> nm, node );
+	}
+
+	while( 1 )
+	{
+		lzav_pipe_slot* s = 0;
+
+		while( pp -> err == 0 && ( s = lzav_pipe_take( pp, node )) == 0 &&
+			!( pp -> eof && pp -> np == pp -> nr ))
+		{
+			lzav_cond_wait( &pp -> cp, &pp -> m );
+		}
+
+		if( s == 0 )
+		{
+			break;
+		}
+
+		lzav_mutex_unlock( &pp -> m );
+
+		if( pp -> dec )
+		{
+			s -> ol = lzav_frame_decompress_seg( &s -> seg, s -> ibuf,
+				s -> obuf, &s -> fi );
+		}
+		else
+		{
+			s -> ol = lzav_frame_compress_seg( s -> ibuf, s -> il, s -> obuf,
+				(int) s -> obufc, &s -> fi );
+
+			if( s -> ol == 0 )
+			{
+				s -> ol = LZAV_E_NOMEM;
+			}
+		}
+
+		lzav_mutex_lock( &pp -> m );
+		s -> done = 1;
+		lzav_cond_broadcast( &pp -> cw );
+	}
+
+	lzav_mutex_unlock( &pp -> m );
+
+	LZAV_THREAD_RETURN;
+}
+
+/**
+ * @brief Function runs a multi-threaded compression or decompression
+ * pipeline. The calling thread acts as the writer.
+ *
+ * @param pp Pipeline, with `in`, `dec` and `fi` fields initialized.
+ * @param out Output stream, 0 - do not write output.
+ * @param nt The number of worker threads.
+ * @param[out] psl Receiver of the input length, can be 0.
+ * @param[out] pdl Receiver of the output length, can be 0.
+ * @return 0 on success, or a negative `LZAV_E_` error code.
+ */
+
+static inline int lzav_pipe_run( lzav_pipe* const pp, FILE* const out,
+	int nt, uint64_t* const psl, uint64_t* const pdl )
+{
+	lzav_thread_t rt;
+	lzav_thread_t* wt;
+	uint64_t dl = 0;
+	int i, n;
+
+	if( nt < 1 )
+	{
+		nt = 1;
+	}
+
+	pp -> ns = nt + 2;
+	pp -> nr = 0;
+	pp -> np = 0;
+	pp -> nw = 0;
+	pp -> il = 0;
+	pp -> eof = 0;
+	pp -> err = 0;
+	pp -> na = 1;
+	pp -> nk = 0;
+
+	if( nt > 1 )
+	{
+		lzav_numa_init( &pp -> nm );
+
+		if( pp -> nm.n > 1 )
+		{
+			pp -> na = ( pp -> nm.n < nt ? pp -> nm.n : nt );
+		}
+	}
+
+	const size_t slotsl = (size_t) pp -> ns * sizeof( lzav_pipe_slot );
+	const size_t wtl = (size_t) nt * sizeof( lzav_thread_t );
+
+	pp -> slots = (lzav_pipe_slot*) lzav_malloc( 0, slotsl );
+	wt = (lzav_thread_t*) lzav_malloc( 0, wtl );
+
+	if( pp -> slots == 0 || wt == 0 )
+	{
+		lzav_free( 0, wt, wtl );
+		lzav_free( 0, pp -> slots, slotsl );
+		return( LZAV_E_NOMEM );
+	}
+
+	memset( pp -> slots, 0, slotsl );
+
+	for( i = 0; i < pp -> ns; i++ )
+	{
+		pp -> slots[ i ].node = i % pp -> na;
+	}
+
+	lzav_mutex_init( &pp -> m );
+	lzav_cond_init( &pp -> cr );
+	lzav_cond_init( &pp -> cp );
+	lzav_cond_init( &pp -> cw );
+
+	if( !lzav_thread_start( &rt, lzav_pipe_reader, pp ))
+	{
+		pp -> err = LZAV_E_NOMEM;
+		goto _free;
+	}
+
+	for( n = 0; n < nt; n++ )
+	{
+		if( !lzav_thread_start( wt + n, lzav_pipe_worker, pp ))
+		{
+			break;
+		}
+	}
+
+	if( n == 0 )
+	{
+		lzav_mutex_lock( &pp -> m );
+		lzav_pipe_fail( pp, LZAV_E_NOMEM );
+		lzav_mutex_unlock( &pp -> m );
+	}
+
+	if( !pp -> dec && out != 0 )
+	{
+		uint8_t hdr[ LZAV_FRAME_HDR_LEN ];
+		dl = lzav_frame_write_hdr( hdr, &pp -> fi );
+
+		if( fwrite( hdr, 1, LZAV_FRAME_HDR_LEN, out ) != LZAV_FRAME_HDR_LEN )
+		{
+			lzav_mutex_lock( &pp -> m );
+			lzav_pipe_fail( pp, LZAV_E_FILE );
+			lzav_mutex_unlock( &pp -> m );
+		}
+	}
+
+	lzav_mutex_lock( &pp -> m );
+
+	while( 1 )
+	{
+		lzav_pipe_slot* const s = pp -> slots + pp -> nw % pp -> ns;
+
+		while( pp -> err == 0 && !( pp -> nw < pp -> nr && s -> done ) &&
+			!( pp -> eof && pp -> nw == pp -> nr ))
+		{
+			lzav_cond_wait( &pp -> cw, &pp -> m );
+		}
+
+		if( pp -> err != 0 || pp -> nw == pp -> nr )
+		{
+			break;
+		}
+
+		lzav_mutex_unlock( &pp -> m );
+
+		int r = s -> ol;
+
+		if( r > 0 && out != 0 &&
+			fwrite( s -> obuf, 1, s -> ol, out ) != (size_t) s -> ol )
+		{
+			r = LZAV_E_FILE;
+		}
+
+		dl += (uint64_t) s -> ol;
+
+		lzav_mutex_lock( &pp -> m );
+
+		if( r < 0 )
+		{
+			lzav_pipe_fail( pp, r );
+			break;
+		}
+
+		pp -> nw++;
+		lzav_cond_broadcast( &pp -> cr );
+
+		if( pp -> na > 1 )
+		{
+			// The next segment may be taken by a worker of another node.
+
+			lzav_cond_broadcast( &pp -> cp );
+		}
+	}
+
+	lzav_mutex_unlock( &pp -> m );
+
+	for( i = 0; i < n; i++ )
+	{
+		lzav_thread_join( wt[ i ]);
+	}
+
+	lzav_thread_join( rt );
+
+	if( pp -> err == 0 && !pp -> dec )
+	{
+		if( pp -> fi.len != LZAV_FRAME_LEN_UNK && pp -> fi.len != pp -> il )
+		{
+			pp -> err = LZAV_E_FILE;
+		}
+		else
+		if( out != 0 )
+		{
+			uint8_t hdr[ LZAV_FRAME_END_LEN ];
+			lzav_frame_st32( hdr, 0 );
+
+			if( fwrite( hdr, 1, LZAV_FRAME_END_LEN, out ) !=
+				LZAV_FRAME_END_LEN )
+			{
+				pp -> err = LZAV_E_FILE;
+			}
+
+			dl += LZAV_FRAME_END_LEN;
+		}
+	}
+
+	if( pp -> err == 0 && out != 0 && fflush( out ) != 0 )
+	{
+		pp -> err = LZAV_E_FILE;
+	}
+
+_free:
+	lzav_cond_destroy( &pp -> cw );
+	lzav_cond_destroy( &pp -> cp );
+	lzav_cond_destroy( &pp -> cr );
+	lzav_mutex_destroy( &pp -> m );
+
+	for( i = 0; i < pp -> ns; i++ )
+	{
+		lzav_free( 0, pp -> slots[ i ].ibuf, pp -> slots[ i ].ibufc );
+		lzav_free( 0, pp -> slots[ i ].obuf, pp -> slots[ i ].obufc );
+	}
+
+	lzav_free( 0, pp -> slots, slotsl );
+	lzav_free( 0, wt, wtl );
+
+	if( psl != 0 )
+	{
+		*psl = pp -> il;
+	}
+
+	if( pdl != 0 )
+	{
+		*pdl = dl;
+	}
+
+	return( pp -> err );
+}
+
+/**
+ * @brief Multi-threaded framed compression function.
+ *
+ * Function compresses a stream into a frame using a pipeline: a reader
+ * thread, `nt` compression threads, and the calling thread as the writer,
+ * with `nt + 2` segments in flight. Reading, compression and writing are
+ * overlapped.
+ *
+ * @param in Input stream, opened in binary mode.
+ * @param out Output stream, opened in binary mode.
+ * @param fi Frame information; `fi -> len` should be `LZAV_FRAME_LEN_UNK` if
+ * the input length is not known in advance.
+ * @param nt The number of compression threads.
+ * @param[out] psl Receiver of the input length, can be 0.
+ * @param[out] pdl Receiver of the output length, can be 0.
+ * @return 0 on success, or a negative `LZAV_E_` error code.
+ */
+
+static inline int lzav_compress_stream_mt( FILE* const in, FILE* const out,
+	const lzav_frame_info* const fi, const int nt, uint64_t* const psl,
+	uint64_t* const pdl )
+{
+	lzav_pipe pp;
+	pp.in = in;
+	pp.dec = 0;
+	pp.fi = *fi;
+
+	return( lzav_pipe_run( &pp, out, nt, psl, pdl ));
+}
+
+/**
+ * @brief Multi-threaded framed decompression function.
+ *
+ * Function decompresses one or several concatenated frames from a stream
+ * using a pipeline: a reader thread, `nt` decompression threads, and the
+ * calling thread as the writer, with `nt + 2` segments in flight.
+ *
+ * @param in Input stream, opened in binary mode.
+ * @param out Output stream, opened in binary mode; 0 - verify the integrity
+ * of the data only.
+ * @param nt The number of decompression threads.
+ * @param[out] psl Receiver of the input length, can be 0.
+ * @param[out] pdl Receiver of the output length, can be 0.
+ * @return 0 on success, or a negative `LZAV_E_` error code.
+ */
+
+static inline int lzav_decompress_stream_mt( FILE* const in, FILE* const out,
+	const int nt, uint64_t* const psl, uint64_t* const pdl )
+{
+	lzav_pipe pp;
+	pp.in = in;
+	pp.dec = 1;
+	memset( &pp.fi, 0, sizeof( pp.fi ));
+
+	return( lzav_pipe_run( &pp, out, nt, psl, pdl ));
+}
+
+#if LZAV_FILE_MMAP
+
+/**
+ * @brief Function memory-maps the whole source file for sequential reading.
+ *
+ * @param fn File name.
+ * @param[out] pp Receiver of the mapping pointer, 0 if the file is empty.
+ * @param[out] pl Receiver of the file's length.
+ * @return 1 if the file was mapped, 0 if the file cannot be mapped (but
+ * can be read via buffered I/O), `LZAV_E_FILE` if the file cannot be opened.
+ */
+
+static inline int lzav_file_map_src( const char* const fn, void** const pp,
+	size_t* const pl )
+{
+	struct stat st;
+	const int fd = open( fn, O_RDONLY );
+
+	*pp = 0;
+	*pl = 0;
+
+	if( fd < 0 )
+	{
+		return( LZAV_E_FILE );
+	}
+
+	if( fstat( fd, &st ) != 0 || !S_ISREG( st.st_mode ) ||
+		(uint64_t) st.st_size > (uint64_t) ( ~(size_t) 0 >> 1 ))
+	{
+		close( fd );
+		return( 0 );
+	}
+
+	if( st.st_size != 0 )
+	{
+		void* const p = mmap( 0, (size_t) st.st_size, PROT_READ, MAP_PRIVATE,
+			fd, 0 );
+
+		if( p == MAP_FAILED )
+		{
+			close( fd );
+			return( 0 );
+		}
+
+		posix_madvise( p, (size_t) st.st_size, POSIX_MADV_SEQUENTIAL );
+		*pp = p;
+	}
+
+	close( fd ); // The mapping remains valid.
+	*pl = (size_t) st.st_size;
+
+	return( 1 );
+}
+
+/**
+ * @brief Function creates the destination file of the specified length and
+ * memory-maps it for sequential writing.
+ *
+ * On Linux, file's storage is preallocated, to avoid a SIGBUS signal on
+ * write to the mapping if the storage device becomes full.
+ *
+ * @param fn File name.
+ * @param l File's length.
+ * @param[out] pp Receiver of the mapping pointer, 0 if `l` is 0.
+ * @return File descriptor which should be closed after the mapping is
+ * released, `LZAV_E_FILE` if the file cannot be created, `LZAV_E_NOMEM` if
+ * the file cannot be mapped. The file is removed on error.
+ */
+
+static inline int lzav_file_map_dst( const char* const fn, const size_t l,
+	void** const pp )
+{
+	const int fd = open( fn, O_RDWR | O_CREAT | O_TRUNC, 0666 );
+
+	*pp = 0;
+
+	if( fd < 0 )
+	{
+		return( LZAV_E_FILE );
+	}
+
+	if( l == 0 )
+	{
+		return( fd );
+	}
+
+#if defined( __linux__ )
+	if( posix_fallocate( fd, 0, (off_t) l ) != 0 )
+#else // defined( __linux__ )
+	if( ftruncate( fd, (off_t) l ) != 0 )
+#endif // defined( __linux__ )
+	{
+		close( fd );
+		remove( fn );
+		return( LZAV_E_FILE );
+	}
+
+	void* const p = mmap( 0, l, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+
+	if( p == MAP_FAILED )
+	{
+		close( fd );
+		remove( fn );
+		return( LZAV_E_NOMEM );
+	}
+
+	posix_madvise( p, l, POSIX_MADV_SEQUENTIAL );
+	*pp = p;
+
+	return( fd );
+}
+
+#endif // LZAV_FILE_MMAP
+
+/**
+ * @brief File compression function.
+ *
+ * Function compresses a file into a new file, in the framed format. If the
+ * destination file exists, it is overwritten. The destination file is
+ * removed on error.
+ *
+ * @param srcfn Source file name.
+ * @param dstfn Destination file name.
+ * @param level Compression level: 1 - default, 2 - higher-ratio, 3 -
+ * higher-ratio with faster decompression; can be ORed with LZAV_FRAME_WIN().
+ * @param seg_log log2 of segment length, see `LZAV_FRAME_SEG_LOG_` macros.
+ * @param flags Frame flags, see `LZAV_FRAME_F_` macros.
+ * @param[out] pdl Receiver of the compressed length, can be 0.
+ * @return 0 on success, or a negative `LZAV_E_` error code.
+ */
+
+static inline int lzav_compress_file( const char* const srcfn,
+	const char* const dstfn, const int level, const int seg_log,
+	const int flags, uint64_t* const pdl )
+{
+	lzav_frame_info fi;
+	fi.len = LZAV_FRAME_LEN_UNK;
+	fi.seg_log = seg_log;
+	fi.flags = flags;
+	fi.level = level;
+
+	if( pdl != 0 )
+	{
+		*pdl = 0;
+	}
+
+	if( seg_log < LZAV_FRAME_SEG_LOG_MIN || seg_log > LZAV_FRAME_SEG_LOG_MAX ||
+		( flags & ~LZAV_FRAME_F_ALL ) != 0 )
+	{
+		return( LZAV_E_PARAMS );
+	}
+
+#if LZAV_FILE_MMAP
+
+	void* src;
+	size_t srcl;
+	int r = lzav_file_map_src( srcfn, &src, &srcl );
+
+	if( r < 0 )
+	{
+		return( r );
+	}
+
+	if( r > 0 )
+	{
+		const size_t bl = lzav_frame_bound( srcl, seg_log );
+		void* dst;
+		const int fd = lzav_file_map_dst( dstfn, bl, &dst );
+
+		if( fd < 0 )
+		{
+			if( src != 0 )
+			{
+				munmap( src, srcl );
+			}
+
+			return( fd );
+		}
+
+		const size_t dl = lzav_frame_compress( src, srcl, dst, bl, level,
+			seg_log, flags );
+
+		r = ( dl == 0 ? LZAV_E_NOMEM : 0 );
+
+		munmap( dst, bl );
+
+		if( src != 0 )
+		{
+			munmap( src, srcl );
+		}
+
+		if( r == 0 && ftruncate( fd, (off_t) dl ) != 0 )
+		{
+			r = LZAV_E_FILE;
+		}
+
+		if( close( fd ) != 0 && r == 0 )
+		{
+			r = LZAV_E_FILE;
+		}
+
+		if( r != 0 )
+		{
+			remove( dstfn );
+		}
+		else
+		if( pdl != 0 )
+		{
+			*pdl = dl;
+		}
+
+		return( r );
+	}
+
+#endif // LZAV_FILE_MMAP
+
+	FILE* const in = fopen( srcfn, "rb" );
+
+	if( in == 0 )
+	{
+		return( LZAV_E_FILE );
+	}
+
+	FILE* const out = fopen( dstfn, "wb" );
+
+	if( out == 0 )
+	{
+		fclose( in );
+		return( LZAV_E_FILE );
+	}
+
+	int ret = lzav_compress_stream( in, out, &fi, pdl );
+
+	fclose( in );
+
+	if( fclose( out ) != 0 && ret == 0 )
+	{
+		ret = LZAV_E_FILE;
+	}
+
+	if( ret != 0 )
+	{
+		remove( dstfn );
+	}
+
+	return( ret );
+}
+
+/**
+ * @brief File decompression function.
+ *
+ * Function decompresses a file containing one or several concatenated
+ * frames into a new file. If the destination file exists, it is overwritten.
+ * The destination file is removed on error.
+ *
+ * @param srcfn Source file name.
+ * @param dstfn Destination file name.
+ * @param[out] pdl Receiver of the decompressed length, can be 0.
+ * @return 0 on success, or a negative `LZAV_E_` error code.
+ */
+
+static inline int lzav_decompress_file( const char* const srcfn,
+	const char* const dstfn, uint64_t* const pdl )
+{
+	if( pdl != 0 )
+	{
+		*pdl = 0;
+	}
+
+#if LZAV_FILE_MMAP
+
+	void* src;
+	size_t srcl;
+	int r = lzav_file_map_src( srcfn, &src, &srcl );
+
+	if( r < 0 )
+	{
+		return( r );
+	}
+
+	if( r > 0 )
+	{
+		uint64_t l;
+		r = lzav_frame_scan( src, srcl, &l );
+
+		if( r == 0 && l > (uint64_t) ( ~(size_t) 0 >> 1 ))
+		{
+			r = LZAV_E_NOMEM;
+		}
+
+		if( r < 0 )
+		{
+			if( src != 0 )
+			{
+				munmap( src, srcl );
+			}
+
+			return( r );
+		}
+
+		void* dst;
+		const int fd = lzav_file_map_dst( dstfn, (size_t) l, &dst );
+
+		if( fd < 0 )
+		{
+			munmap( src, srcl );
+			return( fd );
+		}
+
+		size_t dl;
+		r = lzav_frame_decompress( src, srcl, dst, (size_t) l, &dl );
+
+		if( dst != 0 )
+		{
+			munmap( dst, (size_t) l );
+		}
+
+		munmap( src, srcl );
+
+		if( close( fd ) != 0 && r == 0 )
+		{
+			r = LZAV_E_FILE;
+		}
+
+		if( r != 0 )
+		{
+			remove( dstfn );
+		}
+		else
+		if( pdl != 0 )
+		{
+			*pdl = dl;
+		}
+
+		return( r );
+	}
+
+#endif // LZAV_FILE_MMAP
+
+	FILE* const in = fopen( srcfn, "rb" );
+
+	if( in == 0 )
+	{
+		return( LZAV_E_FILE );
+	}
+
+	FILE* const out = fopen( dstfn, "wb" );
+
+	if( out == 0 )
+	{
+		fclose( in );
+		return( LZAV_E_FILE );
+	}
+
+	int ret = lzav_decompress_stream( in, out, pdl );
+
+	fclose( in );
+
+	if( fclose( out ) != 0 && ret == 0 )
+	{
+		ret = LZAV_E_FILE;
+	}
+
+	if( ret != 0 )
+	{
+		remove( dstfn );
+	}
+
+	return( ret );
+}
+
+#endif // LZAV_FILE_INCLUDED
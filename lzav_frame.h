@@ -0,0 +1,995 @@
+/**
+ * @file lzav_frame.h
+ *
+ * @version 4.5
+ *
+ * @brief The inclusion file for the "LZAV" self-describing framed format.
+ *
+ * The framed format wraps "raw" LZAV compressed streams into independently
+ * compressed segments, with a header that identifies the format and stores
+ * the segment length and (optionally) the content length. Each segment
+ * carries its compressed and uncompressed lengths and, optionally, a
+ * checksum of the uncompressed data. This makes the format suitable for
+ * files and pipes, and allows segments to be compressed and decompressed in
+ * parallel.
+ *
+ * Frame layout (all values are little-endian):
+ *
+ * Frame header, `LZAV_FRAME_HDR_LEN` bytes:
+ * 0-3: `LZAV_FRAME_MAGIC` value.
+ * 4: Frame format version, `LZAV_FRAME_VER`.
+ * 5: Flags, see `LZAV_FRAME_F_` macros. Unknown flags are rejected.
+ * 6: log2 of the maximal uncompressed segment length.
+ * 7: Compression level used (informational): bits 0-2 hold the level, bit 3
+ * is set if the long-distance matching was used, bits 4-7 hold the LZ77
+ * window code: 0 - the full `LZAV_WIN_LEN` window, otherwise the window
+ * length is 2^(code + 15) bytes.
+ * 8-15: Uncompressed content length, or `LZAV_FRAME_LEN_UNK`.
+ *
+ * Segment header, 8 bytes, or 12 bytes if `LZAV_FRAME_F_CHECK` is set:
+ * 0-3: Compressed payload length, ORed with `LZAV_FRAME_RAW` if the payload
+ * is stored uncompressed. A zero value denotes the end of frame, and no
+ * further segment header bytes follow.
+ * 4-7: Uncompressed segment length.
+ * 8-11: The lower 32 bits of lzav_hash64() of the uncompressed data.
+ *
+ * Frames can be concatenated.
+ *
+ * Description is available at https://github.com/avaneev/lzav
+ *
+ * E-mail: aleksey.vaneev@gmail.com or info@voxengo.com
+ *
+ * LICENSE:
+ *
+ * Copyright (c) 2023-2024 Aleksey Vaneev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef LZAV_FRAME_INCLUDED
+#define LZAV_FRAME_INCLUDED
+
+#include "lzav.h"
+
+#define LZAV_FRAME_MAGIC 0x565A4C8CU ///< Frame identifier, "\x8CLZV" bytes.
+#define LZAV_FRAME_VER 1 ///< Frame format version.
+#define LZAV_FRAME_HDR_LEN 16 ///< Frame header length, in bytes.
+#define LZAV_FRAME_SEG_HDR_MAX 12 ///< Maximal segment header length.
+#define LZAV_FRAME_END_LEN 4 ///< End-of-frame mark length, in bytes.
+#define LZAV_FRAME_RAW 0x80000000U ///< Stored (uncompressed) segment flag.
+#define LZAV_FRAME_LEN_UNK 0xFFFFFFFFFFFFFFFFU ///< Unknown content length.
+
+#define LZAV_FRAME_SEG_LOG_MIN 16 ///< Minimal log2 of segment length.
+#define LZAV_FRAME_SEG_LOG_MAX 30 ///< Maximal log2 of segment length.
+#define LZAV_FRAME_SEG_LOG_DEF 23 ///< Default log2 of segment length.
+
+#define LZAV_FRAME_F_CHECK 1 ///< Segments carry uncompressed data checksums.
+#define LZAV_FRAME_F_ALL 1 ///< All flags known to this implementation.
+
+/**
+ * @def LZAV_FRAME_WIN( wl )
+ * @brief Macro returns a compression level modifier which restricts LZ77
+ * window length of the compressor, see lzav_compress_win(). The modifier
+ * should be ORed with the compression level, and is recorded in the frame
+ * header.
+ *
+ * @param wl log2 of window length, `LZAV_WIN_LOG_MIN` to 22 (4 MiB), or 24 to
+ * `LZAV_WIN_LOG_MAX` for a large window (effective with the higher-ratio
+ * level, in segments longer than `LZAV_WIN_LEN`).
+ */
+
+#define LZAV_FRAME_WIN( wl ) ((( wl ) - 15 ) << 4 )
+
+#define LZAV_FRAME_LDM 8 ///< Compression level modifier which enables the
+	///< long-distance matching of the default level, see lzav_compress_ldm().
+
+/**
+ * @brief Framed data information.
+ */
+
+typedef struct
+{
+	uint64_t len; ///< Uncompressed content length, or `LZAV_FRAME_LEN_UNK`.
+	int seg_log; ///< log2 of the maximal uncompressed segment length.
+	int flags; ///< Frame flags, see `LZAV_FRAME_F_` macros.
+	int level; ///< Compression level: 1 - default, 2 - higher-ratio, 3 -
+		///< higher-ratio with faster decompression (lzav_compress_hi_fd());
+		///< can be ORed with LZAV_FRAME_WIN() and `LZAV_FRAME_LDM`.
+} lzav_frame_info;
+
+/**
+ * @brief Function returns log2 of LZ77 window length, for use with the
+ * lzav_compress_win() function.
+ *
+ * @param level Compression level, possibly ORed with LZAV_FRAME_WIN().
+ * @return log2 of window length, or 0 - the full window.
+ */
+
+static inline int lzav_frame_win_log( const int level )
+{
+	const int wc = ( level >> 4 ) & 15;
+
+	return( wc == 0 ? 0 : wc + 15 );
+}
+
+/**
+ * @brief Segment header information.
+ */
+
+typedef struct
+{
+	int cl; ///< Compressed payload length, 0 - end of frame.
+	int srcl; ///< Uncompressed segment length.
+	int raw; ///< 1, if the payload is stored uncompressed.
+	uint32_t check; ///< Uncompressed data checksum.
+} lzav_frame_seg;
+
+/**
+ * @brief Function performs a 64-bit by 64-bit unsigned multiplication, for
+ * lzav_hash64().
+ *
+ * @param m1 Multiplier 1.
+ * @param m2 Multiplier 2.
+ * @param[out] rl The lower half of the 128-bit result.
+ * @param[out] rh The higher half of the 128-bit result.
+ */
+
+static inline void lzav_m128( const uint64_t m1, const uint64_t m2,
+	uint64_t* const rl, uint64_t* const rh )
+{
+#if defined( __SIZEOF_INT128__ )
+
+	const unsigned __int128 r = (unsigned __int128) m1 * m2;
+
+	*rh = (uint64_t) ( r >> 64 );
+	*rl = (uint64_t) r;
+
+#elif defined( _MSC_VER ) && defined( _M_X64 ) && \
+	!defined( LZAV_GCC_BUILTINS )
+
+	*rl = _umul128( m1, m2, rh );
+
+#else // defined( _MSC_VER )
+
+	const uint64_t ll = ( m1 & 0xFFFFFFFF ) * ( m2 & 0xFFFFFFFF );
+	const uint64_t lh = ( m1 & 0xFFFFFFFF ) * ( m2 >> 32 );
+	const uint64_t hl = ( m1 >> 32 ) * ( m2 & 0xFFFFFFFF );
+	const uint64_t c = ( ll >> 32 ) + ( lh & 0xFFFFFFFF ) +
+		( hl & 0xFFFFFFFF );
+
+	*rl = c << 32 | ( ll & 0xFFFFFFFF );
+	*rh = ( m1 >> 32 ) * ( m2 >> 32 ) + ( lh >> 32 ) + ( hl >> 32 ) +
+		( c >> 32 );
+
+#endif // defined( _MSC_VER )
+}
+
+/**
+ * @brief Function loads a little-endian 32-bit value, for lzav_hash64().
+ */
+
+static inline uint64_t lzav_hash_lu32( const uint8_t* const p )
+{
+	uint32_t v;
+	memcpy( &v, p, 4 );
+	LZAV_IEC32( v );
+
+	return( v );
+}
+
+/**
+ * @brief Function loads a little-endian 64-bit value, for lzav_hash64().
+ */
+
+static inline uint64_t lzav_hash_lu64( const uint8_t* const p )
+{
+	uint64_t v;
+	memcpy( &v, p, 8 );
+	LZAV_IEC64( v );
+
+	return( v );
+}
+
+/**
+ * @brief Function loads 0 to 7 message bytes, padded with a 1 bit after the
+ * last byte. Up to 3 bytes preceding `p` are read, but not used.
+ */
+
+static inline uint64_t lzav_hash_lpu64_l3( const uint8_t* const p,
+	const size_t l )
+{
+	const int l8 = (int) ( l * 8 );
+
+	if( l < 4 )
+	{
+		const uint8_t* const p3 = p + l - 1;
+		const uint64_t m = (uint64_t) p3[ 0 ] << 16 |
+			(uint64_t) p3[ -1 ] << 8 | p3[ -2 ];
+
+		return( (uint64_t) 1 << l8 | m >> ( 24 - l8 ));
+	}
+
+	const uint64_t mh = lzav_hash_lu32( p + l - 4 );
+	const uint64_t ml = lzav_hash_lu32( p );
+
+	return( (uint64_t) 1 << l8 | ml | ( mh >> ( 64 - l8 )) << 32 );
+}
+
+/**
+ * @brief Function loads 1 to 7 message bytes, padded with a 1 bit after the
+ * last byte. Bytes outside the message are not read.
+ */
+
+static inline uint64_t lzav_hash_lpu64_nz( const uint8_t* const p,
+	const size_t l )
+{
+	const int l8 = (int) ( l * 8 );
+
+	if( l < 4 )
+	{
+		uint64_t m = p[ 0 ];
+
+		if( l > 1 )
+		{
+			m |= (uint64_t) p[ 1 ] << 8;
+
+			if( l > 2 )
+			{
+				m |= (uint64_t) p[ 2 ] << 16;
+			}
+		}
+
+		return( (uint64_t) 1 << l8 | m );
+	}
+
+	const uint64_t mh = lzav_hash_lu32( p + l - 4 );
+	const uint64_t ml = lzav_hash_lu32( p );
+
+	return( (uint64_t) 1 << l8 | ml | ( mh >> ( 64 - l8 )) << 32 );
+}
+
+/**
+ * @brief Function loads 0 to 7 message bytes, padded with a 1 bit after the
+ * last byte. Up to 8 bytes preceding `p` are read, but not used.
+ */
+
+static inline uint64_t lzav_hash_lpu64_l4( const uint8_t* const p,
+	const size_t l )
+{
+	const int l8 = (int) ( l * 8 );
+
+	if( l < 5 )
+	{
+		return( (uint64_t) 1 << l8 |
+			lzav_hash_lu32( p + l - 4 ) >> ( 32 - l8 ));
+	}
+
+	return( (uint64_t) 1 << l8 | lzav_hash_lu64( p + l - 8 ) >> ( 64 - l8 ));
+}
+
+/**
+ * @brief 64-bit hash function, for data integrity checks, and data
+ * identification.
+ *
+ * Function implements the komihash 5 hash function
+ * (https://github.com/avaneev/komihash), and produces the same values as
+ * its reference implementation, on big- and little-endian systems. E.g.,
+ * the hash of the 32-byte "This is a 32-byte testing string" string, with
+ * seed 0, is 0x05AD960802903A9D. komihash passes the SMHasher and
+ * SMHasher3 test suites, which include collision, avalanche, and
+ * differential tests: hash values of distinct inputs behave as independent
+ * uniformly-distributed 64-bit values. For `n` distinct inputs, the
+ * probability of any collision is thus about n^2 / 2^65, and that of an
+ * undetected corruption of a block checked by the lower 32 bits of the
+ * hash value is 2^-32. The function is not cryptographic: it does not
+ * resist collisions constructed on purpose.
+ *
+ * @param p0 Data pointer, can be 0 if `l` is 0.
+ * @param l Data length, in bytes.
+ * @param seed Hash seed value. Different seeds produce unrelated hash
+ * values.
+ * @return 64-bit hash value.
+ */
+
+static inline uint64_t lzav_hash64( const void* const p0, size_t l,
+	const uint64_t seed )
+{
+	const uint8_t* p = (const uint8_t*) p0;
+
+	// The seeds are initialized to the first mantissa bits of PI.
+
+	uint64_t s1 = 0x243F6A8885A308D3 ^ ( seed & 0x5555555555555555 );
+	uint64_t s5 = 0x452821E638D01377 ^ ( seed & 0xAAAAAAAAAAAAAAAA );
+	uint64_t r1h, r2h;
+
+	#define LZAV_HASH_ROUND \
+		lzav_m128( s1, s5, &s1, &r1h ); \
+		s5 += r1h; \
+		s1 ^= s5;
+
+	#define LZAV_HASH_16( m ) \
+		lzav_m128( s1 ^ lzav_hash_lu64( m ), \
+			s5 ^ lzav_hash_lu64( m + 8 ), &s1, &r1h ); \
+		s5 += r1h; \
+		s1 ^= s5;
+
+	#define LZAV_HASH_FIN \
+		lzav_m128( r1h, r2h, &s1, &r1h ); \
+		s5 += r1h; \
+		s1 ^= s5; \
+		LZAV_HASH_ROUND
+
+	LZAV_HASH_ROUND
+
+	if( LZAV_LIKELY( l < 16 ))
+	{
+		r1h = s1;
+		r2h = s5;
+
+		if( l > 7 )
+		{
+			r2h ^= lzav_hash_lpu64_l3( p + 8, l - 8 );
+			r1h ^= lzav_hash_lu64( p );
+		}
+		else
+		if( l != 0 )
+		{
+			r1h ^= lzav_hash_lpu64_nz( p, l );
+		}
+	}
+	else
+	if( l < 32 )
+	{
+		LZAV_HASH_16( p )
+
+		if( l > 23 )
+		{
+			r2h = s5 ^ lzav_hash_lpu64_l4( p + 24, l - 24 );
+			r1h = s1 ^ lzav_hash_lu64( p + 16 );
+		}
+		else
+		{
+			r1h = s1 ^ lzav_hash_lpu64_l4( p + 16, l - 16 );
+			r2h = s5;
+		}
+	}
+	else
+	{
+		if( l > 63 )
+		{
+			uint64_t s2 = 0x13198A2E03707344 ^ s1;
+			uint64_t s3 = 0xA4093822299F31D0 ^ s1;
+			uint64_t s4 = 0x082EFA98EC4E6C89 ^ s1;
+			uint64_t s6 = 0xBE5466CF34E90C6C ^ s5;
+			uint64_t s7 = 0xC0AC29B7C97C50DD ^ s5;
+			uint64_t s8 = 0x3F84D5B5B5470917 ^ s5;
+			uint64_t r3h, r4h;
+
+			do
+			{
+				lzav_m128( s1 ^ lzav_hash_lu64( p ),
+					s5 ^ lzav_hash_lu64( p + 32 ), &s1, &r1h );
+
+				lzav_m128( s2 ^ lzav_hash_lu64( p + 8 ),
+					s6 ^ lzav_hash_lu64( p + 40 ), &s2, &r2h );
+
+				lzav_m128( s3 ^ lzav_hash_lu64( p + 16 ),
+					s7 ^ lzav_hash_lu64( p + 48 ), &s3, &r3h );
+
+				lzav_m128( s4 ^ lzav_hash_lu64( p + 24 ),
+					s8 ^ lzav_hash_lu64( p + 56 ), &s4, &r4h );
+
+				p += 64;
+				l -= 64;
+				s5 += r1h;
+				s6 += r2h;
+				s7 += r3h;
+				s8 += r4h;
+				s2 ^= s5;
+				s3 ^= s6;
+				s4 ^= s7;
+				s1 ^= s8;
+
+			} while( LZAV_LIKELY( l > 63 ));
+
+			s5 ^= s6 ^ s7 ^ s8;
+			s1 ^= s2 ^ s3 ^ s4;
+		}
+
+		if( LZAV_LIKELY( l > 31 ))
+		{
+			LZAV_HASH_16( p )
+			LZAV_HASH_16( p + 16 )
+
+			p += 32;
+			l -= 32;
+		}
+
+		if( l > 15 )
+		{
+			LZAV_HASH_16( p )
+
+			p += 16;
+			l -= 16;
+		}
+
+		// At least 16 preceding message bytes are available here.
+
+		if( l > 7 )
+		{
+			r2h = s5 ^ lzav_hash_lpu64_l4( p + 8, l - 8 );
+			r1h = s1 ^ lzav_hash_lu64( p );
+		}
+		else
+		{
+			r1h = s1 ^ lzav_hash_lpu64_l4( p, l );
+			r2h = s5;
+		}
+	}
+
+	LZAV_HASH_FIN
+
+	#undef LZAV_HASH_ROUND
+	#undef LZAV_HASH_16
+	#undef LZAV_HASH_FIN
+
+	return( s1 );
+}
+
+/**
+ * @brief Little-endian 32-bit value storing function.
+ */
+
+static inline void lzav_frame_st32( uint8_t* const p, const uint32_t v )
+{
+	p[ 0 ] = (uint8_t) v;
+	p[ 1 ] = (uint8_t) ( v >> 8 );
+	p[ 2 ] = (uint8_t) ( v >> 16 );
+	p[ 3 ] = (uint8_t) ( v >> 24 );
+}
+
+/**
+ * @brief Little-endian 32-bit value loading function.
+ */
+
+static inline uint32_t lzav_frame_ld32( const uint8_t* const p )
+{
+	return( (uint32_t) p[ 0 ] | (uint32_t) p[ 1 ] << 8 |
+		(uint32_t) p[ 2 ] << 16 | (uint32_t) p[ 3 ] << 24 );
+}
+
+/**
+ * @brief Function returns segment header length for the specified flags.
+ *
+ * @param flags Frame flags.
+ */
+
+static inline int lzav_frame_seg_hdr_len( const int flags )
+{
+	return(( flags & LZAV_FRAME_F_CHECK ) != 0 ? 12 : 8 );
+}
+
+/**
+ * @brief Function writes frame header.
+ *
+ * @param[out] dst Destination buffer, at least `LZAV_FRAME_HDR_LEN` bytes
+ * long.
+ * @param fi Frame information.
+ * @return The number of bytes written, `LZAV_FRAME_HDR_LEN`.
+ */
+
+static inline int lzav_frame_write_hdr( void* const dst,
+	const lzav_frame_info* const fi )
+{
+	uint8_t* const op = (uint8_t*) dst;
+
+	lzav_frame_st32( op, LZAV_FRAME_MAGIC );
+	op[ 4 ] = LZAV_FRAME_VER;
+	op[ 5 ] = (uint8_t) fi -> flags;
+	op[ 6 ] = (uint8_t) fi -> seg_log;
+	op[ 7 ] = (uint8_t) fi -> level;
+	lzav_frame_st32( op + 8, (uint32_t) fi -> len );
+	lzav_frame_st32( op + 12, (uint32_t) ( fi -> len >> 32 ));
+
+	return( LZAV_FRAME_HDR_LEN );
+}
+
+/**
+ * @brief Function reads and validates frame header.
+ *
+ * @param src Source buffer, at least `LZAV_FRAME_HDR_LEN` bytes long.
+ * @param[out] fi Receiver of frame information.
+ * @return `LZAV_FRAME_HDR_LEN`, or `LZAV_E_UNKFMT` if the header is not a
+ * valid frame header.
+ */
+
+static inline int lzav_frame_read_hdr( const void* const src,
+	lzav_frame_info* const fi )
+{
+	const uint8_t* const ip = (const uint8_t*) src;
+
+	if( lzav_frame_ld32( ip ) != LZAV_FRAME_MAGIC || ip[ 4 ] != LZAV_FRAME_VER ||
+		( ip[ 5 ] & ~LZAV_FRAME_F_ALL ) != 0 ||
+		ip[ 6 ] < LZAV_FRAME_SEG_LOG_MIN || ip[ 6 ] > LZAV_FRAME_SEG_LOG_MAX )
+	{
+		return( LZAV_E_UNKFMT );
+	}
+
+	fi -> flags = ip[ 5 ];
+	fi -> seg_log = ip[ 6 ];
+	fi -> level = ip[ 7 ];
+	fi -> len = (uint64_t) lzav_frame_ld32( ip + 8 ) |
+		(uint64_t) lzav_frame_ld32( ip + 12 ) << 32;
+
+	return( LZAV_FRAME_HDR_LEN );
+}
+
+/**
+ * @brief Function reads and validates segment header.
+ *
+ * @param src Source buffer, at least `LZAV_FRAME_END_LEN` bytes long, and
+ * lzav_frame_seg_hdr_len() bytes long if the end-of-frame mark is not
+ * present.
+ * @param fi Frame information.
+ * @param[out] seg Receiver of segment header information.
+ * @return Segment header's length, or `LZAV_FRAME_END_LEN` if the
+ * end-of-frame mark was read (`seg -> cl` equals 0 in this case), or
+ * `LZAV_E_SRCOOB` if segment header is invalid.
+ */
+
+static inline int lzav_frame_read_seg( const void* const src,
+	const lzav_frame_info* const fi, lzav_frame_seg* const seg )
+{
+	const uint8_t* const ip = (const uint8_t*) src;
+	const uint32_t cl = lzav_frame_ld32( ip );
+
+	if( cl == 0 )
+	{
+		seg -> cl = 0;
+		seg -> srcl = 0;
+		seg -> raw = 0;
+		seg -> check = 0;
+
+		return( LZAV_FRAME_END_LEN );
+	}
+
+	const uint32_t sl = lzav_frame_ld32( ip + 4 );
+	const uint32_t sm = (uint32_t) 1 << fi -> seg_log;
+
+	seg -> raw = (( cl & LZAV_FRAME_RAW ) != 0 );
+	seg -> cl = (int) ( cl & ~LZAV_FRAME_RAW );
+	seg -> srcl = (int) sl;
+
+	if( sl == 0 || sl > sm || ( seg -> raw ? seg -> cl != seg -> srcl :
+		seg -> cl > lzav_compress_bound_hi( (int) sl )))
+	{
+		return( LZAV_E_SRCOOB );
+	}
+
+	if(( fi -> flags & LZAV_FRAME_F_CHECK ) != 0 )
+	{
+		seg -> check = lzav_frame_ld32( ip + 8 );
+		return( 12 );
+	}
+
+	seg -> check = 0;
+
+	return( 8 );
+}
+
+/**
+ * @brief Function returns the maximal length of a compressed segment,
+ * including its header.
+ *
+ * Note that this is also the size of the output buffer required by the
+ * lzav_frame_compress_seg() function, which uses either compressor: the
+ * larger of their bounds depends on the length.
+ *
+ * @param srcl Uncompressed segment length.
+ */
+
+static inline int lzav_frame_seg_bound( const int srcl )
+{
+	const int b = lzav_compress_bound( srcl );
+	const int bh = lzav_compress_bound_hi( srcl );
+
+	return( LZAV_FRAME_SEG_HDR_MAX + ( b > bh ? b : bh ));
+}
+
+/**
+ * @brief Function compresses a single segment, with its header.
+ *
+ * If the compressed data is not shorter than the source data, the segment is
+ * stored uncompressed.
+ *
+ * @param[in] src Source data pointer.
+ * @param srcl Source data length, in bytes, positive, and not greater than
+ * the frame's segment length.
+ * @param[out] dst Destination buffer pointer.
+ * @param dstl Destination buffer's capacity, should be at least
+ * lzav_frame_seg_bound( srcl ) bytes.
+ * @param fi Frame information.
+ * @return The number of bytes written to `dst`, or 0 on error.
+ */
+
+static inline int lzav_frame_compress_seg( const void* const src,
+	const int srcl, void* const dst, const int dstl,
+	const lzav_frame_info* const fi )
+{
+	if( srcl <= 0 || dstl < lzav_frame_seg_bound( srcl ))
+	{
+		return( 0 );
+	}
+
+	uint8_t* const op = (uint8_t*) dst;
+	const int hl = lzav_frame_seg_hdr_len( fi -> flags );
+	int cl;
+
+	const int wl = lzav_frame_win_log( fi -> level );
+
+	if(( fi -> level & 7 ) > 1 )
+	{
+		cl = lzav_compress_hi_2( src, op + hl, srcl, dstl - hl, 0, wl,
+			( fi -> level & 7 ) == 3 );
+	}
+	else
+	{
+		cl = lzav_compress_2( src, op + hl, srcl, dstl - hl, 0, 0, 0, wl,
+			( fi -> level & LZAV_FRAME_LDM ) != 0 );
+	}
+
+	if( cl == 0 )
+	{
+		return( 0 );
+	}
+
+	if( cl < srcl )
+	{
+		lzav_frame_st32( op, (uint32_t) cl );
+	}
+	else
+	{
+		cl = srcl;
+		memcpy( op + hl, src, srcl );
+		lzav_frame_st32( op, (uint32_t) cl | LZAV_FRAME_RAW );
+	}
+
+	lzav_frame_st32( op + 4, (uint32_t) srcl );
+
+	if(( fi -> flags & LZAV_FRAME_F_CHECK ) != 0 )
+	{
+		lzav_frame_st32( op + 8, (uint32_t) lzav_hash64( src, srcl, 0 ));
+	}
+
+	return( hl + cl );
+}
+
+/**
+ * @brief Function decompresses a single segment's payload.
+ *
+ * @param seg Segment header information, as returned by
+ * lzav_frame_read_seg().
+ * @param[in] src Segment's payload pointer, `seg -> cl` bytes long.
+ * @param[out] dst Destination buffer pointer, at least `seg -> srcl` bytes
+ * long.
+ * @param fi Frame information.
+ * @return The length of decompressed data, in bytes, or any negative value if
+ * some error happened.
+ */
+
+static inline int lzav_frame_decompress_seg( const lzav_frame_seg* const seg,
+	const void* const src, void* const dst, const lzav_frame_info* const fi )
+{
+	int l;
+
+	if( seg -> raw )
+	{
+		memcpy( dst, src, seg -> srcl );
+		l = seg -> srcl;
+	}
+	else
+	{
+		l = lzav_decompress( src, dst, seg -> cl, seg -> srcl );
+
+		if( l < 0 )
+		{
+			return( l );
+		}
+	}
+
+	if(( fi -> flags & LZAV_FRAME_F_CHECK ) != 0 &&
+		(uint32_t) lzav_hash64( dst, l, 0 ) != seg -> check )
+	{
+		return( LZAV_E_CHECK );
+	}
+
+	return( l );
+}
+
+/**
+ * @brief Function returns buffer size required for framed compression.
+ *
+ * @param srcl The length of the source data to be compressed.
+ * @param seg_log log2 of segment length.
+ * @return The required allocation size for the destination buffer.
+ */
+
+static inline size_t lzav_frame_bound( const size_t srcl, const int seg_log )
+{
+	const size_t sm = (size_t) 1 << seg_log;
+	const size_t sl = ( srcl < sm ? srcl : sm );
+
+	return( LZAV_FRAME_HDR_LEN + LZAV_FRAME_END_LEN + srcl +
+		( srcl + sm - 1 ) / sm * LZAV_FRAME_SEG_HDR_MAX +
+		( lzav_frame_seg_bound( (int) sl ) - sl ));
+}
+
+/**
+ * @brief In-memory framed compression function.
+ *
+ * @param[in] src Source data pointer, can be 0 if `srcl` is 0.
+ * @param srcl Source data length, in bytes.
+ * @param[out] dst Destination buffer pointer.
+ * @param dstl Destination buffer's capacity, should be at least
+ * lzav_frame_bound() bytes.
+ * @param level Compression level: 1 - default, 2 - higher-ratio, 3 -
+ * higher-ratio with faster decompression; can be ORed with LZAV_FRAME_WIN().
+ * @param seg_log log2 of segment length, see `LZAV_FRAME_SEG_LOG_` macros.
+ * @param flags Frame flags, see `LZAV_FRAME_F_` macros.
+ * @return The length of framed data, in bytes, or 0 on error.
+ */
+
+static inline size_t lzav_frame_compress( const void* const src,
+	size_t srcl, void* const dst, const size_t dstl, const int level,
+	const int seg_log, const int flags )
+{
+	if(( src == 0 && srcl != 0 ) | ( dst == 0 ) |
+		( seg_log < LZAV_FRAME_SEG_LOG_MIN ) |
+		( seg_log > LZAV_FRAME_SEG_LOG_MAX ) |
+		(( flags & ~LZAV_FRAME_F_ALL ) != 0 ) |
+		( dstl < lzav_frame_bound( srcl, seg_log )))
+	{
+		return( 0 );
+	}
+
+	lzav_frame_info fi;
+	fi.len = srcl;
+	fi.seg_log = seg_log;
+	fi.flags = flags;
+	fi.level = level;
+
+	const uint8_t* ip = (const uint8_t*) src;
+	uint8_t* op = (uint8_t*) dst;
+	const size_t sm = (size_t) 1 << seg_log;
+
+	op += lzav_frame_write_hdr( op, &fi );
+
+	while( srcl != 0 )
+	{
+		const int sl = (int) ( srcl < sm ? srcl : sm );
+		const int l = lzav_frame_compress_seg( ip, sl, op,
+			lzav_frame_seg_bound( sl ), &fi );
+
+		if( l == 0 )
+		{
+			return( 0 );
+		}
+
+		ip += sl;
+		srcl -= (size_t) sl;
+		op += l;
+	}
+
+	lzav_frame_st32( op, 0 );
+	op += LZAV_FRAME_END_LEN;
+
+	return( (size_t) ( op - (uint8_t*) dst ));
+}
+
+/**
+ * @brief In-memory framed decompression function.
+ *
+ * Function decompresses one or several concatenated frames.
+ *
+ * @param[in] src Source (framed) data pointer.
+ * @param srcl Source data length, in bytes.
+ * @param[out] dst Destination buffer pointer.
+ * @param dstl Destination buffer's capacity, in bytes.
+ * @param[out] pdl Receiver of the decompressed data length.
+ * @return 0 on success, or any negative value if some error happened (see the
+ * `LZAV_E_` macros for possible values).
+ */
+
+static inline int lzav_frame_decompress( const void* const src,
+	const size_t srcl, void* const dst, const size_t dstl, size_t* const pdl )
+{
+	const uint8_t* ip = (const uint8_t*) src;
+	const uint8_t* const ipe = ip + srcl;
+	uint8_t* op = (uint8_t*) dst;
+	uint8_t* const ope = op + dstl;
+
+	*pdl = 0;
+
+	if( src == 0 || ( dst == 0 && dstl != 0 ) || srcl == 0 )
+	{
+		return( LZAV_E_PARAMS );
+	}
+
+	while( ip != ipe )
+	{
+		lzav_frame_info fi;
+		lzav_frame_seg seg;
+		uint8_t* const ops = op;
+
+		if( (size_t) ( ipe - ip ) < LZAV_FRAME_HDR_LEN )
+		{
+			return( LZAV_E_SRCOOB );
+		}
+
+		if( lzav_frame_read_hdr( ip, &fi ) < 0 )
+		{
+			return( LZAV_E_UNKFMT );
+		}
+
+		ip += LZAV_FRAME_HDR_LEN;
+
+		while( 1 )
+		{
+			if( ipe - ip < LZAV_FRAME_SEG_HDR_MAX &&
+				( ipe - ip < LZAV_FRAME_END_LEN ||
+				lzav_frame_ld32( ip ) != 0 ))
+			{
+				return( LZAV_E_SRCOOB );
+			}
+
+			const int hl = lzav_frame_read_seg( ip, &fi, &seg );
+
+			if( hl < 0 )
+			{
+				return( hl );
+			}
+
+			ip += hl;
+
+			if( seg.cl == 0 )
+			{
+				break;
+			}
+
+			if( ipe - ip < seg.cl )
+			{
+				return( LZAV_E_SRCOOB );
+			}
+
+			if( ope - op < seg.srcl )
+			{
+				return( LZAV_E_DSTOOB );
+			}
+
+			const int l = lzav_frame_decompress_seg( &seg, ip, op, &fi );
+
+			if( l < 0 )
+			{
+				return( l );
+			}
+
+			ip += seg.cl;
+			op += l;
+			*pdl += (size_t) l;
+		}
+
+		if( fi.len != LZAV_FRAME_LEN_UNK && fi.len != (uint64_t) ( op - ops ))
+		{
+			return( LZAV_E_DSTLEN );
+		}
+	}
+
+	return( 0 );
+}
+
+/**
+ * @brief Function scans framed data and returns its decompressed length.
+ *
+ * Function walks segment headers of one or several concatenated frames,
+ * without decompressing them, and validates frame structure. This function
+ * can be used to allocate the destination buffer of an exact length before
+ * calling lzav_frame_decompress().
+ *
+ * @param[in] src Source (framed) data pointer.
+ * @param srcl Source data length, in bytes.
+ * @param[out] plen Receiver of the decompressed data length.
+ * @return 0 on success, or any negative value if some error happened (see the
+ * `LZAV_E_` macros for possible values).
+ */
+
+static inline int lzav_frame_scan( const void* const src, const size_t srcl,
+	uint64_t* const plen )
+{
+	const uint8_t* ip = (const uint8_t*) src;
+	const uint8_t* const ipe = ip + srcl;
+
+	*plen = 0;
+
+	if( src == 0 || srcl == 0 )
+	{
+		return( LZAV_E_PARAMS );
+	}
+
+	while( ip != ipe )
+	{
+		lzav_frame_info fi;
+		lzav_frame_seg seg;
+		uint64_t fl = 0;
+
+		if( (size_t) ( ipe - ip ) < LZAV_FRAME_HDR_LEN )
+		{
+			return( LZAV_E_SRCOOB );
+		}
+
+		if( lzav_frame_read_hdr( ip, &fi ) < 0 )
+		{
+			return( LZAV_E_UNKFMT );
+		}
+
+		ip += LZAV_FRAME_HDR_LEN;
+
+		while( 1 )
+		{
+			if( ipe - ip < LZAV_FRAME_SEG_HDR_MAX &&
+				( ipe - ip < LZAV_FRAME_END_LEN ||
+				lzav_frame_ld32( ip ) != 0 ))
+			{
+				return( LZAV_E_SRCOOB );
+			}
+
+			const int hl = lzav_frame_read_seg( ip, &fi, &seg );
+
+			if( hl < 0 )
+			{
+				return( hl );
+			}
+
+			ip += hl;
+
+			if( seg.cl == 0 )
+			{
+				break;
+			}
+
+			if( ipe - ip < seg.cl )
+			{
+				return( LZAV_E_SRCOOB );
+			}
+
+			ip += seg.cl;
+			fl += (uint64_t) seg.srcl;
+		}
+
+		if( fi.len != LZAV_FRAME_LEN_UNK && fi.len != fl )
+		{
+			return( LZAV_E_DSTLEN );
+		}
+
+		*plen += fl;
+	}
+
+	return( 0 );
+}
+
+#endif // LZAV_FRAME_INCLUDED
@@ -0,0 +1,1639 @@
+/**
+ * @file lzav_test.c
+ *
+ * @version 4.5
+ *
+ * @brief Self-test program for the "LZAV" in-memory data compression and
+ * decompression algorithms.
+ *
+ * Round-trips generated data of various kinds and lengths (including all
+ * lengths 0 to 16) through all public compression and decompression
+ * functions: scatter-gather segment splits, resumable and callback-sink
+ * decompression, sequences, framed data, file streams, archives, and
+ * deduplicating containers. Corrupted and truncated compressed data is
+ * passed to all decompressors, which should not crash, nor access memory
+ * out of bounds (buffers have exact lengths, best built with
+ * -fsanitize=address). Allocation failures are injected via an allocator
+ * which also checks that all allocated memory is released.
+ *
+ * Build with: cc -O2 -o lzav_test lzav_test.c -lpthread
+ *
+ * Run in a writable directory: temporary files are created there. The exit
+ * code is 0 if all checks passed.
+ *
+ * Description is available at https://github.com/avaneev/lzav
+ *
+ * E-mail: aleksey.vaneev@gmail.com or info@voxengo.com
+ *
+ * LICENSE:
+ *
+ * Copyright (c) 2023-2024 Aleksey Vaneev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#if !defined( _GNU_SOURCE )
+	#define _GNU_SOURCE // For mmap() flags used by lzav_file.h.
+#endif // !defined( _GNU_SOURCE )
+
+#include "lzav_cache.h"
+#include "lzav_dedup.h"
+#include <stdio.h>
+
+#define TEST_KINDS 4 ///< The number of generated data kinds.
+#define TEST_COMPS 14 ///< The number of tested compression functions.
+#define TEST_SPLITS 4 ///< The number of segment split patterns.
+#define TEST_IOV_MAX 512 ///< The maximal number of segments of a split.
+#define TEST_FN_ARC "lzav_test_arc.tmp" ///< Temporary archive file name.
+#define TEST_FN_DD "lzav_test_dd.tmp" ///< Temporary container file name.
+#define TEST_FN_SRC "lzav_test_src.tmp" ///< Temporary source file name.
+#define TEST_FN_DST "lzav_test_dst.tmp" ///< Temporary output file name.
+
+static int test_fails = 0; ///< The number of failed checks.
+static int test_checks = 0; ///< The number of performed checks.
+static size_t test_l = 0; ///< Data length of the current test.
+static int test_kind = 0; ///< Data kind of the current test.
+static uint64_t test_seed = 1; ///< Pseudo-random number generator's state.
+
+/**
+ * @brief Function records a check's result, and reports a failed check.
+ *
+ * @param ok Non-zero, if the check passed.
+ * @param what Description of the checked function or property.
+ * @param r The checked function's result, for the report.
+ */
+
+static void test_check( const int ok, const char* const what, const int r )
+{
+	test_checks++;
+
+	if( !ok )
+	{
+		test_fails++;
+
+		if( test_fails <= 50 )
+		{
+			fprintf( stderr, "FAIL: %s, length %zu, data kind %d, "
+				"result %d\n", what, test_l, test_kind, r );
+		}
+	}
+}
+
+/**
+ * @brief Function returns the next pseudo-random number (xorshift64).
+ */
+
+static uint32_t test_rnd( void )
+{
+	test_seed ^= test_seed << 13;
+	test_seed ^= test_seed >> 7;
+	test_seed ^= test_seed << 17;
+
+	return( (uint32_t) ( test_seed >> 32 ));
+}
+
+/**
+ * @brief Function allocates a buffer of the exact length, so that an
+ * address sanitizer detects out-of-bounds accesses. Exits on failure.
+ */
+
+static uint8_t* test_alloc( const size_t l )
+{
+	uint8_t* const p = (uint8_t*) malloc( l == 0 ? 1 : l );
+
+	if( p == 0 )
+	{
+		fprintf( stderr, "lzav_test: not enough memory\n" );
+		exit( 2 );
+	}
+
+	return( p );
+}
+
+/**
+ * @brief Function fills a buffer with generated data.
+ *
+ * @param[out] p Buffer pointer.
+ * @param l Buffer's length.
+ * @param kind Data kind: 0 - zeroes, 1 - random bytes, 2 - random bytes of
+ * a small alphabet, 3 - a mix of random literals and copies of preceding
+ * data at random offsets (overlapping copies included).
+ */
+
+static void test_fill( uint8_t* const p, const size_t l, const int kind )
+{
+	size_t i = 0;
+
+	if( kind == 0 )
+	{
+		memset( p, 0, l );
+		return;
+	}
+
+	while( i < l )
+	{
+		size_t c;
+
+		if( kind == 3 && i > 0 && test_rnd() % 3 != 0 )
+		{
+			const size_t d = 1 + test_rnd() % i;
+			c = 4 + test_rnd() % 200;
+			c = ( c > l - i ? l - i : c );
+
+			size_t k;
+
+			for( k = 0; k < c; k++ )
+			{
+				p[ i + k ] = p[ i + k - d ];
+			}
+		}
+		else
+		{
+			c = 1 + test_rnd() % 24;
+			c = ( c > l - i ? l - i : c );
+
+			size_t k;
+
+			for( k = 0; k < c; k++ )
+			{
+				p[ i + k ] = (uint8_t) ( kind == 1 ? test_rnd() :
+					'a' + test_rnd() % 6 );
+			}
+		}
+
+		i += c;
+	}
+}
+
+/**
+ * @brief Test allocator's state.
+ */
+
+typedef struct
+{
+	long long n; ///< The number of live blocks.
+	long long sz; ///< The total length of live blocks.
+	int left; ///< The number of allocations before a failure, -1 - none.
+} test_al_state;
+
+static void* test_al_alloc( void* const opaque, const size_t size )
+{
+	test_al_state* const st = (test_al_state*) opaque;
+
+	if( st -> left == 0 )
+	{
+		return( 0 );
+	}
+
+	if( st -> left > 0 )
+	{
+		st -> left--;
+	}
+
+	void* const p = malloc( size == 0 ? 1 : size );
+
+	if( p != 0 )
+	{
+		st -> n++;
+		st -> sz += (long long) size;
+	}
+
+	return( p );
+}
+
+static void test_al_free( void* const opaque, void* const p,
+	const size_t size )
+{
+	test_al_state* const st = (test_al_state*) opaque;
+
+	st -> n--;
+	st -> sz -= (long long) size;
+	free( p );
+}
+
+/**
+ * @brief Function initializes a test allocator.
+ *
+ * @param[out] al Allocator.
+ * @param[out] st Allocator's state.
+ * @param left The number of allocations before a failure, -1 - none.
+ */
+
+static void test_al_init( lzav_alloc* const al, test_al_state* const st,
+	const int left )
+{
+	st -> n = 0;
+	st -> sz = 0;
+	st -> left = left;
+	al -> alloc = test_al_alloc;
+	al -> free = test_al_free;
+	al -> opaque = st;
+}
+
+/**
+ * @brief Function checks that all blocks of a test allocator were released
+ * with their allocated lengths.
+ */
+
+static void test_al_check( const test_al_state* const st,
+	const char* const what )
+{
+	test_check( st -> n == 0 && st -> sz == 0, what, (int) st -> n );
+}
+
+/**
+ * @brief Function produces segment lengths of a split of data.
+ *
+ * @param[out] sl Receiver of segment lengths, `TEST_IOV_MAX` items.
+ * @param l Data length.
+ * @param pat Split pattern: 0 - two halves, 1 - equal segments, 2 - random
+ * segments including zero-length ones, 3 - data between zero-length
+ * segments.
+ * @return The number of segments.
+ */
+
+static int test_split( size_t* const sl, const size_t l, const int pat )
+{
+	int n = 0;
+
+	if( pat == 0 )
+	{
+		sl[ 0 ] = l / 2;
+		sl[ 1 ] = l - l / 2;
+		return( 2 );
+	}
+
+	if( pat == 3 )
+	{
+		sl[ 0 ] = 0;
+		sl[ 1 ] = l;
+		sl[ 2 ] = 0;
+		return( 3 );
+	}
+
+	const size_t ul = ( l / 200 > 7 ? l / 200 : 7 );
+	size_t o = 0;
+
+	while( o < l && n < TEST_IOV_MAX - 1 )
+	{
+		size_t c = ( pat == 1 ? ul : test_rnd() % ( l / 8 + 3 ));
+
+		if( pat == 2 && test_rnd() % 4 == 0 )
+		{
+			c = 0;
+		}
+
+		c = ( c > l - o ? l - o : c );
+		sl[ n ] = c;
+		n++;
+		o += c;
+	}
+
+	sl[ n ] = l - o;
+	n++;
+
+	return( n );
+}
+
+/**
+ * @brief Function allocates segments of the specified lengths, each with
+ * the exact length. Zero-length segments receive alternately a 0 and a
+ * valid pointer.
+ */
+
+static void test_iov_alloc( lzav_iovec* const iov, const size_t* const sl,
+	const int n )
+{
+	int i;
+
+	for( i = 0; i < n; i++ )
+	{
+		iov[ i ].iov_len = sl[ i ];
+		iov[ i ].iov_base = ( sl[ i ] == 0 && ( i & 1 ) == 0 ? 0 :
+			test_alloc( sl[ i ]));
+	}
+}
+
+/**
+ * @brief Function releases segments allocated via test_iov_alloc().
+ */
+
+static void test_iov_free( lzav_iovec* const iov, const int n )
+{
+	int i;
+
+	for( i = 0; i < n; i++ )
+	{
+		free( iov[ i ].iov_base );
+	}
+}
+
+/**
+ * @brief Function compares segments' contents to data.
+ */
+
+static int test_iov_cmp( const lzav_iovec* const iov, const int n,
+	const uint8_t* p )
+{
+	int i;
+
+	for( i = 0; i < n; i++ )
+	{
+		if( iov[ i ].iov_len != 0 &&
+			memcmp( iov[ i ].iov_base, p, iov[ i ].iov_len ) != 0 )
+		{
+			return( 0 );
+		}
+
+		p += iov[ i ].iov_len;
+	}
+
+	return( 1 );
+}
+
+static const char* const test_comp_names[ TEST_COMPS ] = {
+	"lzav_compress_default", "lzav_compress", "lzav_compress_win",
+	"lzav_compress_ldm", "lzav_compress_al", "lzav_compress_hi",
+	"lzav_compress_hi_win", "lzav_compress_hi_win(24)", "lzav_compress_hi_fd",
+	"lzav_compress_hi_al", "lzav_compress_page", "lzav_compress_iov",
+	"lzav_encode_sequences(1)", "lzav_encode_sequences(2)" };
+
+/**
+ * @brief Function returns the destination buffer length a compression
+ * function requires.
+ */
+
+static int test_comp_bound( const int ci, const int l )
+{
+	if( ci == 10 )
+	{
+		return( l == 0 ? 1 : LZAV_PAGE_BOUND( l ));
+	}
+
+	if( ci >= 5 && ci <= 9 )
+	{
+		return( lzav_compress_bound_hi( l ));
+	}
+
+	return( lzav_compress_bound( l ));
+}
+
+/**
+ * @brief Function compresses data with the specified compression function.
+ *
+ * @param ci Compression function's index in `test_comp_names`.
+ * @param[in] src Source data.
+ * @param l Source data length.
+ * @param[out] dst Destination buffer of test_comp_bound() bytes.
+ * @return The compressed data length, or -1 if the function is not
+ * applicable to the length.
+ */
+
+static int test_compress( const int ci, const uint8_t* const src,
+	const int l, uint8_t* const dst )
+{
+	static lzav_page_ctx pc; // Kept between calls.
+	static uint8_t ext_buf[ 65536 ];
+	const int dl = test_comp_bound( ci, l );
+	lzav_alloc al;
+	test_al_state st;
+	int r = -1;
+
+	test_al_init( &al, &st, -1 );
+
+	switch( ci )
+	{
+		case 0:
+			r = lzav_compress_default( src, dst, l, dl );
+			break;
+
+		case 1:
+			r = lzav_compress( src, dst, l, dl, ext_buf, sizeof( ext_buf ));
+			break;
+
+		case 2:
+			r = lzav_compress_win( src, dst, l, dl, 0, 0, 0,
+				LZAV_WIN_LOG_MIN );
+
+			break;
+
+		case 3:
+			r = lzav_compress_ldm( src, dst, l, dl, 0, 0 );
+			break;
+
+		case 4:
+			r = lzav_compress_al( src, dst, l, dl, 0, 0, &al );
+			break;
+
+		case 5:
+			r = lzav_compress_hi( src, dst, l, dl );
+			break;
+
+		case 6:
+			r = lzav_compress_hi_win( src, dst, l, dl, 0,
+				LZAV_WIN_LOG_MIN );
+
+			break;
+
+		case 7:
+			r = lzav_compress_hi_win( src, dst, l, dl, 0, 24 );
+			break;
+
+		case 8:
+			r = lzav_compress_hi_fd( src, dst, l, dl, 0, 0 );
+			break;
+
+		case 9:
+			r = lzav_compress_hi_al( src, dst, l, dl, &al );
+			break;
+
+		case 10:
+			if( l > LZAV_PAGE_LEN_MAX )
+			{
+				break;
+			}
+
+			if( l == 0 )
+			{
+				lzav_page_init( &pc );
+			}
+
+			r = lzav_compress_page( &pc, src, dst, l, dl );
+			break;
+
+		case 11:
+		{
+			static size_t sl[ TEST_IOV_MAX ];
+			static lzav_iovec iov[ TEST_IOV_MAX ];
+			const int n = test_split( sl, (size_t) l, l % TEST_SPLITS );
+			const uint8_t* p = src;
+			int i;
+
+			test_iov_alloc( iov, sl, n );
+
+			for( i = 0; i < n; i++ )
+			{
+				if( sl[ i ] != 0 )
+				{
+					memcpy( iov[ i ].iov_base, p, sl[ i ]);
+				}
+
+				p += sl[ i ];
+			}
+
+			r = lzav_compress_iov( iov, n, dst, dl, 0, 0 );
+			test_iov_free( iov, n );
+			break;
+		}
+
+		case 12:
+		case 13:
+		{
+			const int sn = lzav_seq_bound( l );
+			lzav_seq* const seq = (lzav_seq*) test_alloc(
+				(size_t) sn * sizeof( lzav_seq ));
+
+			const int n = lzav_find_sequences( src, l, seq, sn, ci - 11,
+				&al );
+
+			test_check( ( n > 0 ) == ( l > 0 ), "lzav_find_sequences", n );
+			r = lzav_encode_sequences( src, dst, l, dl, seq, n );
+			free( seq );
+			break;
+		}
+	}
+
+	test_al_check( &st, test_comp_names[ ci ]);
+
+	return( r );
+}
+
+/**
+ * @brief Callback-sink decompressor's test context: compares delivered
+ * data to the expected data.
+ */
+
+typedef struct
+{
+	const uint8_t* p; ///< Expected data.
+	size_t l; ///< Expected data length.
+	size_t o; ///< The number of bytes delivered.
+	size_t cbl; ///< Expected chunk length, 0 - not checked.
+	int bad; ///< Non-zero, if a mismatch was found.
+} test_sink;
+
+static int test_sink_cb( void* const ctx, const void* const p,
+	const size_t l )
+{
+	test_sink* const ts = (test_sink*) ctx;
+
+	if( l == 0 || l > ts -> l - ts -> o ||
+		memcmp( p, ts -> p + ts -> o, l ) != 0 ||
+		( ts -> cbl != 0 && l != ts -> cbl && ts -> o + l != ts -> l ))
+	{
+		ts -> bad = 1;
+		return( 1 );
+	}
+
+	ts -> o += l;
+
+	return( 0 );
+}
+
+/**
+ * @brief Function decompresses data via the resumable stream decompressor,
+ * feeding input in chunks of the specified length.
+ *
+ * @return The decompressed data length, or a negative error code.
+ */
+
+static int test_dstream( const uint8_t* const c, const size_t cl,
+	uint8_t* const dst, const size_t l, const size_t step,
+	const size_t outl )
+{
+	lzav_dstream ds;
+	size_t o = 0;
+	int r;
+
+	lzav_dstream_init( &ds, dst, l );
+
+	while( 1 )
+	{
+		const size_t n = ( step < cl - o ? step : cl - o );
+		size_t ul;
+
+		r = lzav_dstream_run( &ds, c + o, n, &ul, outl );
+		o += ul;
+
+		if(( r < 0 ) | ( r == LZAV_DS_END ) |
+			( r == LZAV_DS_INPUT && o == cl ))
+		{
+			break;
+		}
+	}
+
+	if( r == LZAV_DS_END )
+	{
+		return( (int) ds.wl );
+	}
+
+	return( r < 0 ? r : LZAV_E_SRCOOB );
+}
+
+/**
+ * @brief Function decompresses data via the callback-sink decompressor,
+ * feeding input in chunks of the specified length.
+ *
+ * @return 0 on success, or a negative error code.
+ */
+
+static int test_dsink( const uint8_t* const c, const size_t cl,
+	test_sink* const ts, const size_t cbl, const size_t step )
+{
+	lzav_dsink dk;
+	size_t o = 0;
+	int r = lzav_dsink_init( &dk, ts -> l, cbl, test_sink_cb, ts, 0, 0 );
+
+	while( r == 0 )
+	{
+		const size_t n = ( step < cl - o ? step : cl - o );
+		size_t ul;
+
+		r = lzav_dsink_run( &dk, c + o, n, &ul );
+		o += ul;
+
+		if( r != LZAV_DS_INPUT )
+		{
+			break;
+		}
+
+		r = ( o == cl ? LZAV_E_SRCOOB : 0 );
+	}
+
+	lzav_dsink_free( &dk );
+
+	return( r );
+}
+
+/**
+ * @brief Function decompresses data into segments of the specified split
+ * pattern, and compares them to the expected data.
+ *
+ * @return Non-zero, if the decompression succeeded, and data matches.
+ */
+
+static int test_iov_dec( const uint8_t* const c, const int cl,
+	const uint8_t* const src, const int l, const int pat, int* const pr )
+{
+	static size_t sl[ TEST_IOV_MAX ];
+	static lzav_iovec iov[ TEST_IOV_MAX ];
+	const int n = test_split( sl, (size_t) l, pat );
+
+	test_iov_alloc( iov, sl, n );
+	*pr = lzav_decompress_iov( c, iov, cl, n );
+
+	const int ok = ( *pr == l && ( src == 0 || test_iov_cmp( iov, n, src )));
+	test_iov_free( iov, n );
+
+	return( ok );
+}
+
+/**
+ * @brief Function decompresses valid compressed data with all decompression
+ * functions, and compares the results to the source data.
+ *
+ * @param[in] c Compressed data.
+ * @param cl Compressed data length, 0 if `l` is 0.
+ * @param[in] src Source data.
+ * @param l Source data length.
+ */
+
+static void test_decompress( const uint8_t* const c, const int cl,
+	const uint8_t* const src, const int l )
+{
+	uint8_t* const d = test_alloc( (size_t) l );
+	const int cur = ( cl > 0 && *c >> 4 == LZAV_FMT_CUR );
+	test_sink ts;
+	int r, i;
+
+	r = lzav_decompress( c, d, cl, l );
+	test_check( r == l && memcmp( d, src, l ) == 0, "lzav_decompress", r );
+
+	memset( d, 0, l );
+	r = lzav_decompress_tab( c, d, cl, l );
+	test_check( r == l && memcmp( d, src, l ) == 0, "lzav_decompress_tab",
+		r );
+
+	memset( d, 0, l );
+	r = lzav_decompress_batch( c, d, cl, l );
+	test_check( r == l && memcmp( d, src, l ) == 0,
+		"lzav_decompress_batch", r );
+
+	memset( d, 0, l );
+	r = lzav_decompress_partial( c, d, cl, l );
+	test_check( r == l && memcmp( d, src, l ) == 0,
+		"lzav_decompress_partial", r );
+
+	if( l > 1 )
+	{
+		r = lzav_decompress_partial( c, d, cl, l / 2 );
+		test_check( r == l / 2 && memcmp( d, src, l / 2 ) == 0,
+			"lzav_decompress_partial(half)", r );
+	}
+
+	for( i = 0; i < TEST_SPLITS; i++ )
+	{
+		if( l > 0 && !cur )
+		{
+			break;
+		}
+
+		test_check( test_iov_dec( c, cl, src, l, i, &r ),
+			"lzav_decompress_iov", r );
+	}
+
+	ts.p = src;
+	ts.l = (size_t) l;
+	ts.o = 0;
+	ts.cbl = 0;
+	ts.bad = 0;
+	r = lzav_decompress_cb( c, (size_t) cl, (size_t) l, 0, test_sink_cb,
+		&ts );
+
+	test_check( r == 0 && ts.o == (size_t) l && !ts.bad,
+		"lzav_decompress_cb", r );
+
+	if( l == 0 || !cur )
+	{
+		free( d );
+		return;
+	}
+
+	memset( d, 0, l );
+	r = lzav_decompress_page( c, d, cl, l );
+	test_check( r == l && memcmp( d, src, l ) == 0, "lzav_decompress_page",
+		r );
+
+	const size_t step = ( l > 4096 ? 4099 : 1 );
+
+	memset( d, 0, l );
+	r = test_dstream( c, (size_t) cl, d, (size_t) l, step, 0 );
+	test_check( r == l && memcmp( d, src, l ) == 0, "lzav_dstream_run", r );
+
+	memset( d, 0, l );
+	r = test_dstream( c, (size_t) cl, d, (size_t) l, (size_t) cl, 64 );
+	test_check( r == l && memcmp( d, src, l ) == 0,
+		"lzav_dstream_run(outl)", r );
+
+	ts.o = 0;
+	ts.cbl = 1000;
+	r = test_dsink( c, (size_t) cl, &ts, ts.cbl, step + 12 );
+	test_check( r == LZAV_DS_END && ts.o == (size_t) l && !ts.bad,
+		"lzav_dsink_run", r );
+
+	free( d );
+}
+
+/**
+ * @brief Function passes corrupted variants of valid compressed data to all
+ * decompression functions, which should not access memory out of bounds,
+ * and should return either a failure, or the expected length.
+ *
+ * @param[in] c Valid compressed data.
+ * @param cl Compressed data length.
+ * @param l Uncompressed data length.
+ * @param trials The number of corrupted variants.
+ */
+
+static void test_corrupt( const uint8_t* const c, const int cl,
+	const int l, const int trials )
+{
+	uint8_t* const d = test_alloc( (size_t) l );
+	int t;
+
+	for( t = 0; t < trials; t++ )
+	{
+		// Even trials flip bytes, odd trials truncate.
+
+		const int tl = ( t & 1 ? (int) ( test_rnd() % (uint32_t) cl ) : cl );
+		uint8_t* const cc = test_alloc( (size_t) tl );
+		test_sink ts;
+		int r, i;
+
+		memcpy( cc, c, tl );
+
+		if(( t & 1 ) == 0 )
+		{
+			const int nf = 1 + (int) ( test_rnd() % 3 );
+
+			for( i = 0; i < nf; i++ )
+			{
+				cc[ test_rnd() % (uint32_t) cl ] ^=
+					(uint8_t) ( 1 + test_rnd() % 255 );
+			}
+		}
+
+		r = lzav_decompress( cc, d, tl, l );
+		test_check( r == l || r < 0, "lzav_decompress(corrupt)", r );
+
+		if( tl < cl )
+		{
+			test_check( r < 0, "lzav_decompress(truncated)", r );
+		}
+
+		r = lzav_decompress_tab( cc, d, tl, l );
+		test_check( r == l || r < 0, "lzav_decompress_tab(corrupt)", r );
+
+		r = lzav_decompress_batch( cc, d, tl, l );
+		test_check( r == l || r < 0, "lzav_decompress_batch(corrupt)", r );
+
+		r = lzav_decompress_page( cc, d, tl, l );
+		test_check( r == l || r < 0, "lzav_decompress_page(corrupt)", r );
+
+		r = lzav_decompress_partial( cc, d, tl, l );
+		test_check( r >= 0 && r <= l, "lzav_decompress_partial(corrupt)",
+			r );
+
+		test_iov_dec( cc, tl, 0, l, t % TEST_SPLITS, &r );
+		test_check( r == l || r < 0, "lzav_decompress_iov(corrupt)", r );
+
+		r = test_dstream( cc, (size_t) tl, d, (size_t) l, 7, 0 );
+		test_check( r == l || r < 0, "lzav_dstream_run(corrupt)", r );
+
+		ts.p = d;
+		ts.l = (size_t) l;
+		ts.o = 0;
+		ts.cbl = 0;
+		ts.bad = 0;
+
+		// The callback only checks chunk lengths here: `d` is not the
+		// expected data.
+
+		r = lzav_decompress_cb( cc, (size_t) tl, (size_t) l, 0,
+			test_sink_cb, &ts );
+
+		test_check( r <= 0, "lzav_decompress_cb(corrupt)", r );
+
+		free( cc );
+	}
+
+	free( d );
+}
+
+/**
+ * @brief Function tests all compression and decompression functions with
+ * data of the current length and kind.
+ */
+
+static void test_raw( const uint8_t* const src, const int l )
+{
+	int ci;
+
+	for( ci = 0; ci < TEST_COMPS; ci++ )
+	{
+		const int bl = test_comp_bound( ci, l );
+		uint8_t* const c = test_alloc( (size_t) bl );
+		const int cl = test_compress( ci, src, l, c );
+
+		if( cl < 0 )
+		{
+			free( c );
+			continue;
+		}
+
+		if( l == 0 )
+		{
+			test_check( cl == 0, test_comp_names[ ci ], cl );
+		}
+		else
+		{
+			test_check( cl > 0 && cl <= bl, test_comp_names[ ci ], cl );
+		}
+
+		if( cl == 0 && l != 0 )
+		{
+			free( c );
+			continue;
+		}
+
+		test_decompress( c, cl, src, l );
+
+		if( l > 0 && ( ci == 0 || ci == 5 || ci == 8 ))
+		{
+			test_corrupt( c, cl, l, ( l > 65536 ? 4 : 16 ));
+		}
+
+		free( c );
+	}
+}
+
+/**
+ * @brief Function tests scatter-gather decompression of 1 to 6 byte data
+ * into every split over 2 and 3 segments, including zero-length ones.
+ * Compressed streams of such data end with a zero padding, which should
+ * not be parsed as a block.
+ */
+
+static void test_iov_short( void )
+{
+	static const uint8_t src[ 6 ] = { 'l', 'z', 'a', 'v', 0, 1 };
+	uint8_t c[ 32 ];
+	int l;
+
+	for( l = 1; l <= 6; l++ )
+	{
+		const int cl = lzav_compress_default( src, c, l, sizeof( c ));
+		size_t a, b;
+
+		test_l = (size_t) l;
+		test_check( cl > 0, "lzav_compress_default", cl );
+
+		for( a = 0; a <= (size_t) l; a++ )
+		{
+			for( b = a; b <= (size_t) l; b++ )
+			{
+				size_t sl[ 3 ];
+				lzav_iovec iov[ 3 ];
+				int n;
+
+				sl[ 0 ] = a;
+				sl[ 1 ] = b - a;
+				sl[ 2 ] = (size_t) l - b;
+
+				for( n = 2; n <= 3; n++ )
+				{
+					if( n == 2 && sl[ 2 ] != 0 )
+					{
+						continue;
+					}
+
+					test_iov_alloc( iov, sl, n );
+					const int r = lzav_decompress_iov( c, iov, cl, n );
+
+					test_check( r == l && test_iov_cmp( iov, n, src ),
+						"lzav_decompress_iov(short)", r );
+
+					test_iov_free( iov, n );
+				}
+			}
+		}
+	}
+}
+
+/**
+ * @brief Function tests the large-window stream format 3: data longer than
+ * `LZAV_WIN_LEN` repeats its random head farther than `LZAV_WIN_LEN` back,
+ * and is compressed with several window lengths.
+ */
+
+static void test_large_win( void )
+{
+	static const char* const names[ 4 ] = { "lzav_compress_hi_win(24)",
+		"lzav_compress_hi_win(26)", "lzav_compress_hi_win(30)",
+		"lzav_compress_hi_fd(26)" };
+
+	static const int wls[ 4 ] = { 24, 26, LZAV_WIN_LOG_MAX, 26 };
+	const size_t rl = 1 << 18; // The length of the repeated head.
+	const int l = (int) ( LZAV_WIN_LEN + rl * 2 );
+	const int bl = lzav_compress_bound_hi( l );
+	uint8_t* const src = test_alloc( (size_t) l );
+	uint8_t* const c = test_alloc( (size_t) bl );
+	uint8_t* const d = test_alloc( (size_t) l );
+	int i, r;
+
+	test_l = (size_t) l;
+	test_kind = 3;
+	test_fill( src, rl, 1 );
+	test_fill( src + rl, rl, 3 );
+	test_fill( src + rl * 2, LZAV_WIN_LEN - rl, 1 );
+	memcpy( src + rl + LZAV_WIN_LEN, src, rl );
+
+	// The 8 MiB window can't reach the repeat, which should be mostly
+	// referenced with a large window.
+
+	const int cl2 = lzav_compress_hi( src, c, l, bl );
+
+	for( i = 0; i < 4; i++ )
+	{
+		const int cl = ( i < 3 ?
+			lzav_compress_hi_win( src, c, l, bl, 0, wls[ i ]) :
+			lzav_compress_hi_fd( src, c, l, bl, 0, wls[ i ]));
+
+		test_check( cl > 0 && *c >> 4 == LZAV_FMT_LW &&
+			cl < cl2 - (int) rl / 2, names[ i ], cl );
+
+		if( cl <= 0 )
+		{
+			continue;
+		}
+
+		memset( d, 0, l );
+		r = lzav_decompress( c, d, cl, l );
+		test_check( r == l && memcmp( d, src, l ) == 0,
+			"lzav_decompress(large)", r );
+
+		memset( d, 0, l );
+		r = lzav_decompress_tab( c, d, cl, l );
+		test_check( r == l && memcmp( d, src, l ) == 0,
+			"lzav_decompress_tab(large)", r );
+
+		memset( d, 0, l );
+		r = lzav_decompress_batch( c, d, cl, l );
+		test_check( r == l && memcmp( d, src, l ) == 0,
+			"lzav_decompress_batch(large)", r );
+
+		memset( d, 0, l );
+		r = lzav_decompress_partial( c, d, cl, l );
+		test_check( r == l && memcmp( d, src, l ) == 0,
+			"lzav_decompress_partial(large)", r );
+
+		// A prefix that ends within the repeat.
+
+		memset( d, 0, l );
+		r = lzav_decompress_partial( c, d, cl, l - (int) rl / 2 );
+		test_check( r == l - (int) rl / 2 && memcmp( d, src, r ) == 0,
+			"lzav_decompress_partial(large, prefix)", r );
+
+		r = lzav_decompress_page( c, d, cl, l );
+		test_check( r == LZAV_E_UNKFMT, "lzav_decompress_page(large)", r );
+	}
+
+	free( d );
+	free( c );
+	free( src );
+}
+
+/**
+ * @brief Function tests framed compression, decompression, segment
+ * indexing, and cached range reads, with the current data.
+ */
+
+static void test_frame( const uint8_t* const src, const size_t l )
+{
+	static const int levels[ 5 ] = { 1, 2, 3, 1 | LZAV_FRAME_LDM,
+		2 | LZAV_FRAME_WIN( LZAV_WIN_LOG_MIN ) };
+
+	int li;
+
+	for( li = 0; li < 5; li++ )
+	{
+		const int flags = ( li & 1 ? 0 : LZAV_FRAME_F_CHECK );
+		const int sg = LZAV_FRAME_SEG_LOG_MIN;
+		const size_t bl = lzav_frame_bound( l, sg );
+		uint8_t* const c = test_alloc( bl );
+		uint8_t* const d = test_alloc( l );
+		const size_t cl = lzav_frame_compress( src, l, c, bl, levels[ li ],
+			sg, flags );
+
+		size_t dl;
+		uint64_t sl;
+		int r;
+
+		test_check( cl > 0 && cl <= bl, "lzav_frame_compress", (int) cl );
+
+		r = lzav_frame_decompress( c, cl, d, l, &dl );
+		test_check( r == 0 && dl == l && memcmp( d, src, l ) == 0,
+			"lzav_frame_decompress", r );
+
+		r = lzav_frame_scan( c, cl, &sl );
+		test_check( r == 0 && sl == l, "lzav_frame_scan", r );
+
+		if( l > 0 && flags != 0 )
+		{
+			// Corrupted frames fail, or produce the original data.
+
+			uint8_t* const cc = test_alloc( cl );
+			int t;
+
+			for( t = 0; t < 8; t++ )
+			{
+				memcpy( cc, c, cl );
+				cc[ test_rnd() % cl ] ^= (uint8_t) ( 1 + test_rnd() % 255 );
+				r = lzav_frame_decompress( cc, cl, d, l, &dl );
+
+				test_check( r < 0 || ( dl == l && memcmp( d, src, l ) == 0 ),
+					"lzav_frame_decompress(corrupt)", r );
+
+				r = lzav_frame_decompress( c, cl - 1 - test_rnd() % cl, d, l,
+					&dl );
+
+				test_check( r < 0, "lzav_frame_decompress(truncated)", r );
+			}
+
+			free( cc );
+		}
+
+		if( l > 0 )
+		{
+			lzav_frame_index ix;
+			lzav_cache cache;
+			lzav_alloc al;
+			test_al_state st;
+			int t;
+
+			test_al_init( &al, &st, -1 );
+			r = lzav_frame_index_build_al( &ix, c, cl, &al );
+			test_check( r == 0 && ix.len == l, "lzav_frame_index_build", r );
+			r = lzav_cache_init_al( &cache, 1 << 20, &al );
+			test_check( r == 0, "lzav_cache_init", r );
+
+			for( t = 0; t < 16; t++ )
+			{
+				const size_t o = test_rnd() % l;
+				const size_t rl = test_rnd() % ( l - o + 1 );
+
+				r = lzav_frame_pread( &ix, ( t & 1 ? &cache : 0 ), 1, d, o,
+					rl );
+
+				test_check( r == 0 && memcmp( d, src + o, rl ) == 0,
+					"lzav_frame_pread", r );
+			}
+
+			r = lzav_frame_pread( &ix, &cache, 1, d, l, 1 );
+			test_check( r == LZAV_E_PARAMS, "lzav_frame_pread(range)", r );
+
+			lzav_cache_free( &cache );
+			lzav_frame_index_free( &ix );
+			test_al_check( &st, "lzav_frame_index_free" );
+		}
+
+		free( d );
+		free( c );
+	}
+}
+
+/**
+ * @brief Function tests single- and multi-threaded stream compression and
+ * decompression, and file compression and decompression, with the
+ * current data.
+ */
+
+static void test_stream( const uint8_t* const src, const size_t l )
+{
+	lzav_frame_info fi;
+	int mt;
+
+	fi.len = ( l & 1 ? LZAV_FRAME_LEN_UNK : l );
+	fi.seg_log = LZAV_FRAME_SEG_LOG_MIN;
+	fi.flags = LZAV_FRAME_F_CHECK;
+	fi.level = 1 + (int) ( l % 3 );
+
+	for( mt = 0; mt < 2; mt++ )
+	{
+		FILE* const in = tmpfile();
+		FILE* const cf = tmpfile();
+		FILE* const out = tmpfile();
+		uint8_t* const d = test_alloc( l );
+		uint64_t sl, dl;
+		int r;
+
+		if( in == 0 || cf == 0 || out == 0 ||
+			fwrite( src, 1, l, in ) != l )
+		{
+			fprintf( stderr, "lzav_test: cannot create temporary files\n" );
+			exit( 2 );
+		}
+
+		rewind( in );
+		r = ( mt ? lzav_compress_stream_mt( in, cf, &fi, 3, &sl, &dl ) :
+			lzav_compress_stream( in, cf, &fi, &dl ));
+
+		test_check( r == 0 && dl == (uint64_t) ftell( cf ) &&
+			( mt == 0 || sl == l ), "lzav_compress_stream", r );
+
+		rewind( cf );
+		r = ( mt ? lzav_decompress_stream_mt( cf, out, 3, &sl, &dl ) :
+			lzav_decompress_stream( cf, out, &dl ));
+
+		test_check( r == 0 && dl == l, "lzav_decompress_stream", r );
+
+		rewind( out );
+		test_check( fread( d, 1, l, out ) == l && fgetc( out ) == EOF &&
+			memcmp( d, src, l ) == 0, "lzav_decompress_stream(data)", 0 );
+
+		fclose( out );
+		fclose( cf );
+		fclose( in );
+		free( d );
+	}
+
+	FILE* const f = fopen( TEST_FN_SRC, "wb" );
+
+	if( f == 0 || fwrite( src, 1, l, f ) != l )
+	{
+		fprintf( stderr, "lzav_test: cannot write %s\n", TEST_FN_SRC );
+		exit( 2 );
+	}
+
+	fclose( f );
+
+	uint64_t dl;
+	int r = lzav_compress_file( TEST_FN_SRC, TEST_FN_ARC, 2,
+		LZAV_FRAME_SEG_LOG_MIN, LZAV_FRAME_F_CHECK, &dl );
+
+	test_check( r == 0 && dl >= LZAV_FRAME_HDR_LEN + LZAV_FRAME_END_LEN,
+		"lzav_compress_file", r );
+
+	r = lzav_decompress_file( TEST_FN_ARC, TEST_FN_DST, &dl );
+	test_check( r == 0 && dl == l, "lzav_decompress_file", r );
+
+	FILE* const g = fopen( TEST_FN_DST, "rb" );
+	uint8_t* const d = test_alloc( l );
+
+	test_check( g != 0 && fread( d, 1, l, g ) == l && fgetc( g ) == EOF &&
+		memcmp( d, src, l ) == 0, "lzav_decompress_file(data)", 0 );
+
+	if( g != 0 )
+	{
+		fclose( g );
+	}
+
+	free( d );
+	remove( TEST_FN_SRC );
+	remove( TEST_FN_DST );
+	remove( TEST_FN_ARC );
+}
+
+/**
+ * @brief Function tests archives and deduplicating containers with entries
+ * of all tested lengths and kinds.
+ *
+ * @param ents Entries' data.
+ * @param lens Entries' lengths.
+ * @param n The number of entries.
+ */
+
+static void test_arc( uint8_t** const ents, const size_t* const lens,
+	const int n )
+{
+	lzav_arc_writer w;
+	lzav_dedup_writer dw;
+	lzav_arc a;
+	lzav_dedup dd;
+	lzav_cache cache;
+	char name[ 32 ];
+	int i, r;
+
+	r = lzav_arc_writer_open( &w, TEST_FN_ARC, 1 );
+	test_check( r == 0, "lzav_arc_writer_open", r );
+	r = lzav_dedup_writer_open( &dw, TEST_FN_DD, 2 );
+	test_check( r == 0, "lzav_dedup_writer_open", r );
+
+	for( i = 0; i < n; i++ )
+	{
+		snprintf( name, sizeof( name ), "e%d", i );
+
+		r = lzav_arc_add( &w, name, strlen( name ), ents[ i ], lens[ i ]);
+		test_check( r == 0, "lzav_arc_add", r );
+
+		r = lzav_dedup_add( &dw, name, strlen( name ), ents[ i ], lens[ i ]);
+		test_check( r == 0, "lzav_dedup_add", r );
+	}
+
+	r = lzav_arc_writer_close( &w );
+	test_check( r == 0, "lzav_arc_writer_close", r );
+	r = lzav_dedup_writer_close( &dw );
+	test_check( r == 0, "lzav_dedup_writer_close", r );
+
+	r = lzav_arc_open( &a, TEST_FN_ARC );
+	test_check( r == 0, "lzav_arc_open", r );
+	r = lzav_dedup_open( &dd, TEST_FN_DD );
+	test_check( r == 0, "lzav_dedup_open", r );
+	r = lzav_cache_init( &cache, 1 << 22 );
+	test_check( r == 0, "lzav_cache_init", r );
+
+	for( i = 0; i < n; i++ )
+	{
+		uint8_t* const d = test_alloc( lens[ i ]);
+		lzav_arc_entry e;
+		lzav_dedup_entry de;
+
+		snprintf( name, sizeof( name ), "e%d", i );
+		test_l = lens[ i ];
+
+		r = lzav_arc_find( &a, name, strlen( name ), &e );
+		test_check( r >= 0 && e.len == lens[ i ], "lzav_arc_find", r );
+
+		if( r >= 0 )
+		{
+			r = lzav_arc_decompress( &e, d );
+			test_check( r == (int) lens[ i ] &&
+				memcmp( d, ents[ i ], lens[ i ]) == 0,
+				"lzav_arc_decompress", r );
+
+			r = lzav_arc_decompress_cached( &a, &cache, 1, &e, d );
+			test_check( r == (int) lens[ i ] &&
+				memcmp( d, ents[ i ], lens[ i ]) == 0,
+				"lzav_arc_decompress_cached", r );
+		}
+
+		r = lzav_dedup_find( &dd, name, strlen( name ), &de );
+		test_check( r >= 0 && de.len == lens[ i ], "lzav_dedup_find", r );
+
+		if( r >= 0 )
+		{
+			r = lzav_dedup_decompress( &dd, &de, d );
+			test_check( r == 0 && memcmp( d, ents[ i ], lens[ i ]) == 0,
+				"lzav_dedup_decompress", r );
+		}
+
+		free( d );
+	}
+
+	r = lzav_arc_find( &a, "none", 4, 0 );
+	test_check( r == LZAV_E_NOENT, "lzav_arc_find(none)", r );
+	r = lzav_dedup_find( &dd, "none", 4, 0 );
+	test_check( r == LZAV_E_NOENT, "lzav_dedup_find(none)", r );
+
+	lzav_cache_free( &cache );
+	lzav_dedup_close( &dd );
+	lzav_arc_close( &a );
+	remove( TEST_FN_DD );
+	remove( TEST_FN_ARC );
+}
+
+/**
+ * @brief Function tests allocation failure handling: functions should
+ * report a failure (`LZAV_E_NOMEM` where error codes are returned), and
+ * release memory allocated before the failure.
+ */
+
+static void test_nomem( void )
+{
+	const int l = 100000;
+	uint8_t* const src = test_alloc( (size_t) l );
+	uint8_t* const c = test_alloc( (size_t) lzav_compress_bound( l ));
+	lzav_seq* const seq = (lzav_seq*) test_alloc(
+		(size_t) lzav_seq_bound( l ) * sizeof( lzav_seq ));
+
+	lzav_alloc al;
+	test_al_state st;
+	int k, r;
+
+	test_l = (size_t) l;
+	test_kind = 3;
+	test_fill( src, (size_t) l, 3 );
+
+	const int cl = lzav_compress_default( src, c, l,
+		lzav_compress_bound( l ));
+
+	uint8_t* const c2 = test_alloc( (size_t) lzav_compress_bound( l ));
+	uint8_t* const d2 = test_alloc( (size_t) l );
+
+	test_al_init( &al, &st, 0 );
+	r = lzav_compress_al( src, c2, l, lzav_compress_bound( l ), 0, 0, &al );
+	test_check( r == 0, "lzav_compress_al(nomem)", r );
+	r = lzav_compress_hi_al( src, c2, l, lzav_compress_bound_hi( l ), &al );
+	test_check( r == 0, "lzav_compress_hi_al(nomem)", r );
+	test_al_check( &st, "lzav_compress_hi_al(nomem)" );
+
+	// Segment offsets of over 32 segments, then the hash-table are
+	// allocated.
+
+	lzav_iovec siov[ 40 ];
+
+	for( k = 0; k < 40; k++ )
+	{
+		siov[ k ].iov_base = src + (size_t) l / 40 * k;
+		siov[ k ].iov_len = (size_t) l / 40;
+	}
+
+	for( k = 0; k < 3; k++ )
+	{
+		test_al_init( &al, &st, k );
+		r = lzav_compress_iov_al( siov, 40, c2, lzav_compress_bound( l ), 0,
+			0, &al );
+
+		test_check(( r == 0 && k < 2 ) || ( r == cl && k == 2 &&
+			memcmp( c2, c, cl ) == 0 ), "lzav_compress_iov_al(nomem)", r );
+
+		test_al_check( &st, "lzav_compress_iov_al(nomem)" );
+	}
+
+	// `k` is the number of successful allocations before the failure.
+
+	for( k = 0; k < 20; k++ )
+	{
+		test_al_init( &al, &st, k );
+		r = lzav_find_sequences( src, l, seq, lzav_seq_bound( l ), 1 + k % 2,
+			&al );
+
+		if( r > 0 )
+		{
+			const int el = lzav_encode_sequences( src, c2, l,
+				lzav_compress_bound( l ), seq, r );
+
+			r = ( el > 0 && lzav_decompress( c2, d2, el, l ) == l &&
+				memcmp( d2, src, l ) == 0 ? 1 : -1 );
+		}
+
+		// Fails on the buffer's or the hash-table's allocation; a later
+		// failure can only affect the parse.
+
+		test_check(( r == 0 && k < 2 ) || ( r == 1 && k >= 2 ) ||
+			( r == 0 && k < 10 && ( k & 1 ) != 0 ),
+			"lzav_find_sequences(nomem)", r );
+
+		test_al_check( &st, "lzav_find_sequences(nomem)" );
+
+		test_al_init( &al, &st, k );
+
+		lzav_dsink dk;
+		test_sink ts;
+		ts.p = src;
+		ts.l = (size_t) l;
+		ts.o = 0;
+		ts.cbl = 0;
+		ts.bad = 0;
+
+		r = lzav_dsink_init_al( &dk, (size_t) l, 0, test_sink_cb, &ts, 0, 0,
+			&al );
+
+		test_check( r == ( k == 0 ? LZAV_E_NOMEM : 0 ),
+			"lzav_dsink_init_al(nomem)", r );
+
+		lzav_dsink_free( &dk );
+		test_al_check( &st, "lzav_dsink_free" );
+
+		test_al_init( &al, &st, k );
+		lzav_cache cache;
+		r = lzav_cache_init_al( &cache, 1 << 20, &al );
+		test_check( r == ( k < LZAV_CACHE_SHARDS ? LZAV_E_NOMEM : 0 ),
+			"lzav_cache_init_al(nomem)", r );
+
+		if( r == 0 )
+		{
+			lzav_cache_free( &cache );
+		}
+
+		test_al_check( &st, "lzav_cache_init_al(nomem)" );
+
+		test_al_init( &al, &st, k );
+		lzav_dedup_writer dw;
+		r = lzav_dedup_writer_open_al( &dw, TEST_FN_DD, 1, &al );
+		test_check( r == ( k < 3 ? LZAV_E_NOMEM : 0 ),
+			"lzav_dedup_writer_open_al(nomem)", r );
+
+		lzav_dedup_writer_close( &dw );
+		test_al_check( &st, "lzav_dedup_writer_open_al(nomem)" );
+		remove( TEST_FN_DD );
+	}
+
+	// Scatter-gather decompression of over 32 segments allocates via the
+	// global allocator.
+
+	static size_t sl[ TEST_IOV_MAX ];
+	static lzav_iovec iov[ TEST_IOV_MAX ];
+	const int n = test_split( sl, (size_t) l, 1 );
+
+	test_al_init( &al, &st, 0 );
+	lzav_set_alloc( &al );
+	test_iov_alloc( iov, sl, n );
+	r = lzav_decompress_iov( c, iov, cl, n );
+	test_check( r == LZAV_E_NOMEM, "lzav_decompress_iov(nomem)", r );
+
+	r = lzav_decompress_cb( c, (size_t) cl, (size_t) l, 0, test_sink_cb, 0 );
+	test_check( r == LZAV_E_NOMEM, "lzav_decompress_cb(nomem)", r );
+
+	st.left = -1;
+	r = lzav_decompress_iov( c, iov, cl, n );
+	test_check( r == l && test_iov_cmp( iov, n, src ),
+		"lzav_decompress_iov(global alloc)", r );
+
+	lzav_set_alloc( 0 );
+	test_al_check( &st, "lzav_set_alloc" );
+	test_iov_free( iov, n );
+
+	free( d2 );
+	free( c2 );
+	free( seq );
+	free( c );
+	free( src );
+}
+
+/**
+ * @brief Function checks lzav_hash64() against komihash's reference values.
+ */
+
+static void test_hash( void )
+{
+	static const uint64_t hv[ 6 ] = { 0x7A9717E9EEA4BE8B,
+		0x64C2AD96013F70FE, 0xC77E02ED4B201B9A, 0x36EB9E6A4C2C5E4B,
+		0x90B07E2158F88CC0, 0x94C3DBDCA59DDF57 };
+
+	static const size_t hl[ 6 ] = { 3, 12, 31, 47, 64, 256 };
+	static const char s[] = "This is a 32-byte testing string";
+	uint8_t b[ 256 ];
+	int i;
+
+	test_kind = 0;
+
+	for( i = 0; i < 256; i++ )
+	{
+		b[ i ] = (uint8_t) i;
+	}
+
+	for( i = 0; i < 6; i++ )
+	{
+		test_l = hl[ i ];
+		test_check( lzav_hash64( b, hl[ i ], 0 ) == hv[ i ],
+			"lzav_hash64", 0 );
+	}
+
+	test_l = 32;
+	test_check( lzav_hash64( s, 32, 0 ) == 0x05AD960802903A9D,
+		"lzav_hash64", 0 );
+
+	test_check( lzav_hash64( s, 32, 0x0123456789ABCDEF ) ==
+		0x6CE66A2E8D4979A5, "lzav_hash64(seed)", 0 );
+
+	test_l = 0;
+	test_check( lzav_hash64( 0, 0, 0 ) == lzav_hash64( s, 0, 0 ),
+		"lzav_hash64(empty)", 0 );
+}
+
+/**
+ * @brief Function tests the reaction to invalid parameters.
+ */
+
+static void test_params( void )
+{
+	uint8_t b[ 64 ];
+	uint8_t d[ 64 ];
+	lzav_iovec iov[ 2 ];
+	int r;
+
+	test_l = 16;
+	test_kind = 0;
+	memset( b, 0, sizeof( b ));
+
+	r = lzav_compress_default( b, d, 16, 16 );
+	test_check( r == 0, "lzav_compress_default(dstl)", r );
+	r = lzav_compress_default( b, b, 16, 64 );
+	test_check( r == 0, "lzav_compress_default(src == dst)", r );
+	r = lzav_compress_hi( b, d, -1, 64 );
+	test_check( r == 0, "lzav_compress_hi(srcl)", r );
+
+	const int cl = lzav_compress_default( b, d, 16, 64 );
+
+	r = lzav_decompress( d, b, cl, -1 );
+	test_check( r == LZAV_E_PARAMS, "lzav_decompress(dstl)", r );
+	r = lzav_decompress( d, b, cl, 15 );
+	test_check( r < 0, "lzav_decompress(short dstl)", r );
+	r = lzav_decompress( d, b, cl, 17 );
+	test_check( r == LZAV_E_DSTLEN, "lzav_decompress(long dstl)", r );
+	r = lzav_decompress( d, b, cl, 0 );
+	test_check( r == LZAV_E_PARAMS, "lzav_decompress(zero dstl)", r );
+	r = lzav_decompress( 0, b, 0, 16 );
+	test_check( r == LZAV_E_PARAMS, "lzav_decompress(zero srcl)", r );
+
+	d[ 0 ] = (uint8_t) ( d[ 0 ] & 15 );
+	r = lzav_decompress( d, b, cl, 16 );
+	test_check( r == LZAV_E_UNKFMT, "lzav_decompress(format)", r );
+	r = lzav_decompress_page( d, b, cl, 16 );
+	test_check( r == LZAV_E_UNKFMT, "lzav_decompress_page(format)", r );
+
+	iov[ 0 ].iov_base = b;
+	iov[ 0 ].iov_len = 8;
+	iov[ 1 ].iov_base = 0;
+	iov[ 1 ].iov_len = 8;
+	r = lzav_decompress_iov( d, iov, cl, 2 );
+	test_check( r == LZAV_E_PARAMS, "lzav_decompress_iov(base)", r );
+	r = lzav_decompress_iov( d, iov, cl, -1 );
+	test_check( r == LZAV_E_PARAMS, "lzav_decompress_iov(iovcnt)", r );
+
+	size_t dl;
+	r = lzav_frame_decompress( b, sizeof( b ), d, sizeof( d ), &dl );
+	test_check( r == LZAV_E_UNKFMT, "lzav_frame_decompress(format)", r );
+	r = (int) lzav_frame_compress( b, 16, d, sizeof( d ), 1,
+		LZAV_FRAME_SEG_LOG_MIN - 1, 0 );
+
+	test_check( r == 0, "lzav_frame_compress(seg_log)", r );
+}
+
+int main( void )
+{
+	static const size_t lens_ext[] = { 17, 18, 20, 21, 24, 31, 32, 33, 47,
+		63, 64, 65, 100, 127, 128, 255, 256, 1000, 4095, 4096, 4097, 16384,
+		65535, 65536, 65537, 200000, 1100007 };
+
+	const int nl = 17 + (int) ( sizeof( lens_ext ) / sizeof( lens_ext[ 0 ]));
+	uint8_t* ents[ 64 ];
+	size_t lens[ 64 ];
+	int ne = 0;
+	int i;
+
+	printf( "LZAV %s self-test\n", LZAV_VER_STR );
+
+	test_hash();
+	test_params();
+	test_iov_short();
+
+	for( test_kind = 0; test_kind < TEST_KINDS; test_kind++ )
+	{
+		for( i = 0; i < nl; i++ )
+		{
+			test_l = ( i < 17 ? (size_t) i : lens_ext[ i - 17 ]);
+
+			uint8_t* const src = test_alloc( test_l );
+			test_fill( src, test_l, test_kind );
+
+			test_raw( src, (int) test_l );
+
+			if( i % 5 == 0 || test_l > 65536 )
+			{
+				test_frame( src, test_l );
+				test_stream( src, test_l );
+			}
+
+			if( ne < 64 && ( i % 3 == 0 || test_l > 65536 ))
+			{
+				ents[ ne ] = src;
+				lens[ ne ] = test_l;
+				ne++;
+			}
+			else
+			{
+				free( src );
+			}
+		}
+
+		printf( "Data kind %d: %d checks, %d failed\n", test_kind,
+			test_checks, test_fails );
+	}
+
+	test_large_win();
+	test_arc( ents, lens, ne );
+	test_nomem();
+
+	for( i = 0; i < ne; i++ )
+	{
+		free( ents[ i ]);
+	}
+
+	if( test_fails != 0 )
+	{
+		printf( "%d of %d checks failed\n", test_fails, test_checks );
+		return( 1 );
+	}
+
+	printf( "All %d checks passed\n", test_checks );
+
+	return( 0 );
+}
@@ -0,0 +1,788 @@
+/**
+ * @file lzav_test.cpp
+ *
+ * @version 4.5
+ *
+ * @brief Self-test program for the C++ interface of the "LZAV" in-memory
+ * data compression and decompression algorithms.
+ *
+ * Round-trips generated data through the function templates for
+ * compile-time constant lengths (checking their bounds against the C
+ * functions), the resumable stream decoder, and the callback-sink
+ * decompressor. With C++20, also round-trips data through the `std::span`
+ * functions, the reusable compressor with a counting `std::pmr` memory
+ * resource (with injected allocation failures), and the coroutine generator,
+ * and checks error statuses of results.
+ *
+ * Build with: c++ -std=c++11 -O2 -o lzav_test_cpp lzav_test.cpp
+ * or with: c++ -std=c++20 -O2 -o lzav_test_cpp lzav_test.cpp
+ *
+ * The exit code is 0 if all checks passed.
+ *
+ * Description is available at https://github.com/avaneev/lzav
+ *
+ * E-mail: aleksey.vaneev@gmail.com or info@voxengo.com
+ *
+ * LICENSE:
+ *
+ * Copyright (c) 2023-2024 Aleksey Vaneev
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "lzav.hpp"
+#include <cstdio>
+#include <vector>
+
+static int test_fails = 0; ///< The number of failed checks.
+static int test_checks = 0; ///< The number of performed checks.
+static size_t test_l = 0; ///< Data length of the current test.
+static uint64_t test_seed = 1; ///< Pseudo-random number generator's state.
+
+static_assert( lzav::compress_bound< 100 >() == LZAV_PAGE_BOUND( 100 ),
+	"compress_bound() should be a constant expression" );
+
+static_assert( lzav::compress_bound_hi< 100 >() == LZAV_BOUND_HI( 100 ),
+	"compress_bound_hi() should be a constant expression" );
+
+/**
+ * @brief Function records a check's result, and reports a failed check.
+ *
+ * @param ok Non-zero, if the check passed.
+ * @param what Description of the checked function or property.
+ * @param r The checked function's result, for the report.
+ */
+
+static void test_check( const int ok, const char* const what, const int r )
+{
+	test_checks++;
+
+	if( !ok )
+	{
+		test_fails++;
+
+		if( test_fails <= 50 )
+		{
+			fprintf( stderr, "FAIL: %s, length %zu, result %d\n", what,
+				test_l, r );
+		}
+	}
+}
+
+/**
+ * @brief Function returns the next pseudo-random number (xorshift64).
+ */
+
+static uint32_t test_rnd()
+{
+	test_seed ^= test_seed << 13;
+	test_seed ^= test_seed >> 7;
+	test_seed ^= test_seed << 17;
+
+	return( (uint32_t) ( test_seed >> 32 ));
+}
+
+/**
+ * @brief Function fills a buffer with a mix of random literals of a small
+ * alphabet and copies of preceding data at random offsets.
+ *
+ * @param[out] p Buffer pointer.
+ * @param l Buffer's length.
+ */
+
+static void test_fill( uint8_t* const p, const size_t l )
+{
+	size_t i = 0;
+
+	while( i < l )
+	{
+		size_t c;
+		size_t k;
+
+		if( i > 0 && test_rnd() % 3 != 0 )
+		{
+			const size_t d = 1 + test_rnd() % i;
+			c = 4 + test_rnd() % 200;
+			c = ( c > l - i ? l - i : c );
+
+			for( k = 0; k < c; k++ )
+			{
+				p[ i + k ] = p[ i + k - d ];
+			}
+		}
+		else
+		{
+			c = 1 + test_rnd() % 24;
+			c = ( c > l - i ? l - i : c );
+
+			for( k = 0; k < c; k++ )
+			{
+				p[ i + k ] = (uint8_t) ( 'a' + test_rnd() % 6 );
+			}
+		}
+
+		i += c;
+	}
+}
+
+/**
+ * @brief Function returns generated data of the specified length.
+ */
+
+static std::vector< uint8_t > test_data( const size_t l )
+{
+	std::vector< uint8_t > s( l );
+	test_fill( s.data(), l );
+
+	return( s );
+}
+
+/**
+ * @brief Function round-trips a page through the page context variant of
+ * lzav::compress< N >(), if `N` is within LZAV_PAGE_LEN_MAX.
+ */
+
+template< int N >
+static void test_fixed_page( const std::vector< uint8_t >& src,
+	std::true_type )
+{
+	std::vector< uint8_t > c( (size_t) lzav::compress_bound< N >() );
+	std::vector< uint8_t > d( (size_t) N );
+	lzav_page_ctx* const ctx = new lzav_page_ctx;
+	int i;
+
+	lzav_page_init( ctx );
+
+	for( i = 0; i < 2; i++ ) // Also checks context reuse.
+	{
+		const int cl = lzav::compress< N >( ctx, src.data(), c.data() );
+		test_check( cl > 0 && cl <= lzav::compress_bound< N >(),
+			"compress< N >( ctx )", cl );
+
+		const int r = lzav::decompress< N >( c.data(), d.data(), cl );
+		test_check( r == N && d == src, "decompress< N >( ctx )", r );
+	}
+
+	delete ctx;
+}
+
+template< int N >
+static void test_fixed_page( const std::vector< uint8_t >&,
+	std::false_type )
+{
+}
+
+/**
+ * @brief Function checks compression bounds of a compile-time constant
+ * length against the C functions, and round-trips generated data through
+ * the function templates.
+ *
+ * @tparam N Data length, in bytes.
+ */
+
+template< int N >
+static void test_fixed()
+{
+	test_l = (size_t) N;
+
+	test_check( lzav::compress_bound< N >() == lzav_compress_bound( N ),
+		"compress_bound< N >", lzav::compress_bound< N >() );
+
+	test_check( lzav::compress_bound_hi< N >() == lzav_compress_bound_hi( N ),
+		"compress_bound_hi< N >", lzav::compress_bound_hi< N >() );
+
+	const std::vector< uint8_t > src = test_data( (size_t) N );
+	std::vector< uint8_t > c( (size_t) lzav::compress_bound_hi< N >() );
+	std::vector< uint8_t > d( (size_t) N );
+
+	int cl = lzav::compress< N >( src.data(), c.data() );
+	test_check( cl > 0 && cl <= lzav::compress_bound< N >(),
+		"compress< N >", cl );
+
+	int r = lzav::decompress< N >( c.data(), d.data(), cl );
+	test_check( r == N && d == src, "decompress< N >", r );
+
+	r = lzav::decompress< N >( c.data(), d.data(), cl - 1 );
+	test_check( r < 0, "decompress< N >, truncated", r );
+
+	cl = lzav::compress_hi< N >( src.data(), c.data() );
+	test_check( cl > 0 && cl <= lzav::compress_bound_hi< N >(),
+		"compress_hi< N >", cl );
+
+	r = lzav_decompress( c.data(), d.data(), cl, N );
+	test_check( r == N && d == src, "compress_hi< N >, decompress", r );
+
+	// Incompressible data, to the exact-length bound buffers.
+
+	std::vector< uint8_t > rnd( (size_t) N );
+	std::vector< uint8_t > cb( (size_t) lzav::compress_bound< N >() );
+	size_t i;
+
+	for( i = 0; i < rnd.size(); i++ )
+	{
+		rnd[ i ] = (uint8_t) test_rnd();
+	}
+
+	cl = lzav::compress< N >( rnd.data(), cb.data() );
+	r = lzav::decompress< N >( cb.data(), d.data(), cl );
+	test_check( cl > 0 && r == N && d == rnd, "compress< N >, random", cl );
+
+	cl = lzav::compress_hi< N >( rnd.data(), c.data() );
+	r = lzav_decompress( c.data(), d.data(), cl, N );
+	test_check( cl > 0 && r == N && d == rnd, "compress_hi< N >, random",
+		cl );
+
+	test_fixed_page< N >( src, std::integral_constant< bool,
+		N <= LZAV_PAGE_LEN_MAX >() );
+}
+
+/**
+ * @brief Test record, for compress_obj() and decompress_obj().
+ */
+
+struct test_rec
+{
+	uint32_t id;
+	uint16_t v[ 40 ];
+	char name[ 28 ];
+};
+
+/**
+ * @brief Function round-trips a trivially-copyable object.
+ */
+
+static void test_obj()
+{
+	test_rec a;
+	test_rec b;
+	uint8_t c[ lzav::compress_bound< (int) sizeof( test_rec )>() ];
+
+	test_l = sizeof( test_rec );
+	test_fill( (uint8_t*) &a, sizeof( a ));
+	memset( &b, 0, sizeof( b ));
+
+	const int cl = lzav::compress_obj( a, c );
+	test_check( cl > 0 && cl <= (int) sizeof( c ), "compress_obj", cl );
+
+	const int r = lzav::decompress_obj( c, cl, b );
+	test_check( r == (int) sizeof( b ) && memcmp( &a, &b, sizeof( a )) == 0,
+		"decompress_obj", r );
+}
+
+/**
+ * @brief Function compresses generated data with lzav_compress_default().
+ *
+ * @param src Source data.
+ * @return Compressed data.
+ */
+
+static std::vector< uint8_t > test_comp( const std::vector< uint8_t >& src )
+{
+	std::vector< uint8_t > c( (size_t) lzav_compress_bound(
+		(int) src.size() ));
+
+	const int cl = lzav_compress_default( src.data(), c.data(),
+		(int) src.size(), (int) c.size() );
+
+	test_check( cl > 0, "lzav_compress_default", cl );
+	c.resize( (size_t) cl );
+
+	return( c );
+}
+
+/**
+ * @brief Function feeds compressed data to the decoder in chunks of random
+ * lengths, with and without an output limit, and passes truncated and
+ * mismatching data to it.
+ *
+ * @param l Data length, in bytes.
+ */
+
+static void test_decoder( const size_t l )
+{
+	test_l = l;
+
+	const std::vector< uint8_t > src = test_data( l );
+	const std::vector< uint8_t > c = test_comp( src );
+	int k;
+
+	for( k = 0; k < 2; k++ )
+	{
+		std::vector< uint8_t > d( l );
+		lzav::decoder dec( d.data(), l );
+		const size_t outl = ( k == 0 ? 0 : 5000 );
+		size_t ip = 0;
+		int ok = 1;
+		int r;
+
+		while( true )
+		{
+			const size_t wl = dec.produced();
+			const size_t cc = 1 + test_rnd() % 700;
+			const size_t n = ( cc > c.size() - ip ? c.size() - ip : cc );
+			size_t cl;
+
+			r = dec.feed( c.data() + ip, n, cl, outl );
+			ip += cl;
+
+			if( dec.produced() < wl || ( r == LZAV_DS_INPUT && cl != n ) ||
+				memcmp( dec.data(), src.data(), dec.produced() ) != 0 )
+			{
+				ok = 0;
+			}
+
+			if( r != LZAV_DS_INPUT && r != LZAV_DS_OUTPUT )
+			{
+				break;
+			}
+
+			if( ip == c.size() && r == LZAV_DS_INPUT )
+			{
+				break;
+			}
+		}
+
+		test_check( ok && r == LZAV_DS_END && dec.done() &&
+			dec.error() == 0 && dec.produced() == l && d == src,
+			"decoder", r );
+	}
+
+	std::vector< uint8_t > d( l );
+	size_t cl;
+	int r;
+
+	if( l >= 100 ) // Short streams end with padding.
+	{
+		lzav::decoder dect( d.data(), l );
+		r = dect.feed( c.data(), c.size() / 2, cl );
+		test_check( r == LZAV_DS_INPUT && cl == c.size() / 2 &&
+			!dect.done() && dect.error() == 0, "decoder, truncated", r );
+	}
+
+	lzav::decoder decs( d.data(), l - 1 );
+	r = decs.feed( c.data(), c.size(), cl );
+	test_check( r < 0 && decs.error() == r && !decs.done(),
+		"decoder, short destination", r );
+}
+
+/**
+ * @brief Function decompresses data to function objects, which collect
+ * output chunks, and which abort decompression.
+ *
+ * @param l Data length, in bytes.
+ */
+
+static void test_sink( const size_t l )
+{
+	test_l = l;
+
+	const std::vector< uint8_t > src = test_data( l );
+	const std::vector< uint8_t > c = test_comp( src );
+	std::vector< uint8_t > d;
+	size_t n = 0;
+	int ok = 1;
+
+	int r = lzav::decompress_sink( c.data(), c.size(), l,
+		[ & ]( const uint8_t* const p, const size_t pl )
+		{
+			ok &= ( pl > 0 && pl <= 1000 );
+			d.insert( d.end(), p, p + pl );
+			n++;
+			return( true );
+		}, 1000 );
+
+	test_check( r == 0 && ok && d == src && n == ( l + 999 ) / 1000,
+		"decompress_sink", r );
+
+	n = 0;
+
+	r = lzav::decompress_sink( c.data(), c.size(), l,
+		[ & ]( const uint8_t*, size_t )
+		{
+			n++;
+			return( false );
+		}, 1000 );
+
+	test_check( r == LZAV_E_SINK && n == 1, "decompress_sink, abort", r );
+
+	r = lzav::decompress_sink( c.data(), c.size() / 2, l,
+		[]( const uint8_t*, size_t )
+		{
+			return( true );
+		});
+
+	test_check( r < 0 || l < 100, "decompress_sink, truncated", r );
+}
+
+#if defined( LZAV_CPP20 )
+
+/**
+ * @brief Memory resource which counts allocations and live bytes, and
+ * injects an allocation failure.
+ */
+
+class test_resource : public std::pmr::memory_resource
+{
+public:
+	int allocs = 0; ///< The number of allocation requests.
+	size_t live = 0; ///< The number of allocated, not yet released, bytes.
+	int fail_at = -1; ///< Index of the failing allocation, -1 - none.
+
+protected:
+	void* do_allocate( const size_t l, const size_t al ) override
+	{
+		if( allocs++ == fail_at )
+		{
+			throw std::bad_alloc();
+		}
+
+		live += l;
+
+		return( std::pmr::new_delete_resource() -> allocate( l, al ));
+	}
+
+	void do_deallocate( void* const p, const size_t l,
+		const size_t al ) override
+	{
+		live -= l;
+		std::pmr::new_delete_resource() -> deallocate( p, l, al );
+	}
+
+	bool do_is_equal( const std::pmr::memory_resource& o ) const
+		noexcept override
+	{
+		return( this == &o );
+	}
+};
+
+/**
+ * @brief Function returns a byte span of a vector.
+ */
+
+static std::span< const std::byte > test_span(
+	const std::vector< uint8_t >& v )
+{
+	return( std::as_bytes( std::span< const uint8_t >( v )));
+}
+
+/**
+ * @brief Function checks that a span has the same contents as a vector.
+ */
+
+static bool test_equal( const std::span< const std::byte > s,
+	const std::vector< uint8_t >& v )
+{
+	return( s.size() == v.size() &&
+		( v.empty() || memcmp( s.data(), v.data(), v.size() ) == 0 ));
+}
+
+/**
+ * @brief Function checks the buffer's storage management.
+ */
+
+static void test_buffer()
+{
+	test_resource res;
+
+	test_l = 0;
+
+	{
+		lzav::buffer b( &res );
+		test_check( b.empty() && b.capacity() == 0 && b.resource() == &res,
+			"buffer, empty", (int) b.size() );
+
+		b.resize( 1000 );
+		memset( b.data(), 1, b.size() );
+		b.resize( 3000 );
+		test_check( b.size() == 3000 && b.capacity() >= 3000 &&
+			b.data()[ 999 ] == std::byte( 1 ), "buffer, resize",
+			(int) b.size() );
+
+		const size_t cap = b.capacity();
+		const int allocs = res.allocs;
+		b.clear();
+		b.resize( 100 );
+		test_check( b.capacity() == cap && res.allocs == allocs,
+			"buffer, storage reuse", res.allocs - allocs );
+
+		b.reserve( 100000 );
+		test_check( b.size() == 100 && b.capacity() >= 100000 &&
+			b.data()[ 99 ] == std::byte( 1 ), "buffer, reserve",
+			(int) b.size() );
+
+		lzav::buffer m( std::move( b ));
+		test_check( b.empty() && b.capacity() == 0 && m.size() == 100 &&
+			m.resource() == &res, "buffer, move", (int) m.size() );
+
+		lzav::buffer a;
+		a = std::move( m );
+		test_check( a.size() == 100 && a.resource() == &res && m.empty(),
+			"buffer, move assignment", (int) a.size() );
+	}
+
+	test_check( res.live == 0, "buffer, release", (int) res.live );
+}
+
+/**
+ * @brief Function round-trips data through the `std::span` functions and the
+ * reusable compressor at both compression levels, and checks that all
+ * allocations are made from, and returned to, the compressor's memory
+ * resource.
+ *
+ * @param l Data length, in bytes.
+ */
+
+static void test_compressor( const size_t l )
+{
+	test_l = l;
+
+	const std::vector< uint8_t > src = test_data( l );
+	test_resource res;
+	test_resource ores;
+	int level;
+
+	for( level = 1; level <= 2; level++ )
+	{
+		{
+			lzav::compressor cmp( &res );
+			lzav::buffer c( &ores );
+			int k;
+
+			for( k = 0; k < 2; k++ ) // Also checks compressor reuse.
+			{
+				const int allocs = res.allocs;
+				const int cl = cmp.compress( test_span( src ), c, level );
+
+				test_check( cl > 0 && (size_t) cl == c.size(),
+					"compressor::compress", cl );
+
+				test_check( level == 1 || l < 16 || res.allocs > allocs,
+					"compressor::compress, resource use",
+					res.allocs - allocs );
+
+				const lzav::result d = lzav::decompress( c.span(),
+					(int) l, &ores );
+
+				test_check( d && d.status() == (int) l &&
+					d.data().resource() == &ores &&
+					test_equal( d.span(), src ), "decompress( span )",
+					d.status() );
+			}
+
+			lzav::result r = cmp.compress( test_span( src ), level, &ores );
+
+			test_check( r.ok() && (size_t) r.status() == r.data().size() &&
+				r.data().resource() == &ores, "compressor::compress, result",
+				r.status() );
+
+			lzav::buffer d( &ores );
+			const int dl = lzav::decompress( r.span(), d, (int) l );
+
+			test_check( dl == (int) l && test_equal( d.span(), src ),
+				"decompress( span, buffer )", dl );
+		}
+
+		test_check( res.live == 0 && ores.live == 0,
+			"compressor, release", (int) ( res.live + ores.live ));
+
+		// Free functions, with the output buffer's resource.
+
+		{
+			lzav::buffer c( &ores );
+			const int cl = lzav::compress( test_span( src ), c, level );
+			lzav::result r = lzav::compress( test_span( src ), level );
+
+			test_check( cl > 0 && r.status() == cl &&
+				memcmp( c.data(), r.data().data(), (size_t) cl ) == 0,
+				"compress( span )", cl );
+
+			lzav::buffer d = lzav::decompress( r.span(), (int) l ).release();
+			test_check( test_equal( d.span(), src ),
+				"result::release", (int) d.size() );
+		}
+
+		test_check( ores.live == 0, "compress( span ), release",
+			(int) ores.live );
+
+		// Allocation failures: the hash-table (level 1 data over 4 KiB),
+		// or the higher-ratio compressor's hash-tables (data of at least 16
+		// bytes).
+
+		if(( level == 2 && l >= 16 ) || l > 4096 )
+		{
+			lzav::compressor cmp( &res );
+			lzav::buffer c;
+			int thrown = 0;
+
+			res.fail_at = res.allocs;
+
+			try
+			{
+				cmp.compress( test_span( src ), c, level );
+			}
+			catch( const std::bad_alloc& )
+			{
+				thrown = 1;
+			}
+
+			res.fail_at = -1;
+			test_check( thrown, "compressor::compress, bad_alloc", level );
+		}
+
+		test_check( res.live == 0, "compressor, release after bad_alloc",
+			(int) res.live );
+	}
+}
+
+/**
+ * @brief Function checks statuses of results on errors, and of empty data.
+ */
+
+static void test_result()
+{
+	const size_t l = 10000;
+	test_l = l;
+
+	const std::vector< uint8_t > src = test_data( l );
+	const lzav::result c = lzav::compress( test_span( src ));
+
+	lzav::result r = lzav::compress( std::span< const std::byte >() );
+	test_check( r && r.status() == 0 && r.data().empty(),
+		"compress, empty", r.status() );
+
+	r = lzav::decompress( std::span< const std::byte >(), 0 );
+	test_check( r && r.status() == 0 && r.data().empty(),
+		"decompress, empty", r.status() );
+
+	r = lzav::decompress( c.span(), -1 );
+	test_check( !r && r.status() == LZAV_E_PARAMS && r.data().empty(),
+		"decompress, negative length", r.status() );
+
+	r = lzav::decompress( c.span().first( c.span().size() - 1 ), (int) l );
+	test_check( !r.ok() && r.status() < 0 && r.data().empty(),
+		"decompress, truncated", r.status() );
+
+	r = lzav::decompress( c.span(), (int) l - 1 );
+	test_check( !r && r.status() < 0 && r.data().empty(),
+		"decompress, short length", r.status() );
+
+	lzav::buffer d;
+	int st = lzav::decompress( c.span(), d, (int) l );
+	const size_t cap = d.capacity();
+	test_check( st == (int) l && test_equal( d.span(), src ),
+		"decompress( span, buffer )", st );
+
+	std::vector< uint8_t > bad( 1, 0 );
+	bad[ 0 ] = 0xFF; // Unknown format.
+	st = lzav::decompress( test_span( bad ), d, (int) l );
+	test_check( st < 0 && d.empty() && d.capacity() == cap,
+		"decompress( span, buffer ), unknown format", st );
+}
+
+/**
+ * @brief Function decompresses data with the coroutine generator, feeding
+ * input in chunks, and checks the yielded spans.
+ *
+ * @param l Data length, in bytes.
+ */
+
+static void test_generator( const size_t l )
+{
+	test_l = l;
+
+	const std::vector< uint8_t > src = test_data( l );
+	const std::vector< uint8_t > c = test_comp( src );
+	std::vector< uint8_t > d( l );
+	lzav::decoder dec( d.data(), l );
+	size_t wl = 0;
+	size_t ip = 0;
+	int ok = 1;
+
+	while( ip < c.size() && !dec.done() && dec.error() == 0 )
+	{
+		const size_t n = ( c.size() - ip < 997 ? c.size() - ip : 997 );
+
+		for( auto s : lzav::decode( dec, test_span( c ).subspan( ip, n ),
+			4096 ))
+		{
+			ok &= ( s.data() == (const std::byte*) d.data() + wl &&
+				!s.empty() );
+
+			wl += s.size();
+		}
+
+		ip += n;
+	}
+
+	test_check( ok && dec.done() && wl == l && d == src, "decode",
+		dec.error() );
+}
+
+#endif // defined( LZAV_CPP20 )
+
+int main()
+{
+	static const size_t lens[] = { 1, 16, 100, 4096, 65536, 200000,
+		1100007 };
+
+	size_t i;
+
+	printf( "LZAV %s C++ self-test\n", LZAV_VER_STR );
+
+	test_fixed< 1 >();
+	test_fixed< 7 >();
+	test_fixed< 16 >();
+	test_fixed< 17 >();
+	test_fixed< 100 >();
+	test_fixed< 1000 >();
+	test_fixed< 4096 >();
+	test_fixed< 65536 >();
+	test_fixed< 65537 >();
+	test_fixed< 1000000 >();
+	test_obj();
+
+	for( i = 0; i < sizeof( lens ) / sizeof( lens[ 0 ]); i++ )
+	{
+		test_decoder( lens[ i ]);
+		test_sink( lens[ i ]);
+	}
+
+#if defined( LZAV_CPP20 )
+
+	test_buffer();
+	test_result();
+
+	for( i = 0; i < sizeof( lens ) / sizeof( lens[ 0 ]); i++ )
+	{
+		test_compressor( lens[ i ]);
+		test_generator( lens[ i ]);
+	}
+
+#endif // defined( LZAV_CPP20 )
+
+	if( test_fails != 0 )
+	{
+		printf( "%d of %d checks failed\n", test_fails, test_checks );
+		return( 1 );
+	}
+
+	printf( "All %d checks passed\n", test_checks );
+
+	return( 0 );
+}